@@ -16,6 +16,12 @@
 #define UART_TX_PIN                &IfxAsclin0_TX_P14_0_OUT
 #define UART_RX_PIN                &IfxAsclin0_RXA_P14_1_IN
 
+/* Logging Configuration (levels in UART_Log.h)
+ * LOG_MAX_BUILD is the highest level compiled in; LOG_LEVEL_WARN keeps the DoIP path silent in production builds.
+ * LOG_MAX_<module> lowers it per module. LOG_MASK_DEFAULT is the runtime mask at start-up (UDS DID 0xF1C0). */
+#define LOG_MAX_BUILD              LOG_LEVEL_DEBUG
+#define LOG_MASK_DEFAULT           LOG_MASK_UP_TO(LOG_LEVEL_INFO)
+
 /* Ethernet Configuration */
 #define ETH_MAC_ADDR_0             0xDE
 #define ETH_MAC_ADDR_1             0xAD
@@ -39,6 +45,12 @@
 #define VMG_IP_ADDR_3              100
 #define VMG_PORT                   13400
 
+#define ZONE_ECU_IP_ADDR_0         192
+#define ZONE_ECU_IP_ADDR_1         168
+#define ZONE_ECU_IP_ADDR_2         1
+#define ZONE_ECU_IP_ADDR_3         11
+#define ZONE_ECU_DOIP_PORT         13401
+
 /* VCI Configuration */
 #define VCI_MAGIC                  0x56434921
 #define VCI_COLLECTION_TIMEOUT_MS  10000
@@ -51,6 +51,11 @@
 
 #define IFX_CFG_STM_TICKS_PER_MS    (100000)                /* Value of the system timer in ticks per millisecond   */
 
-#define CPU_WHICH_SERVICE_ETHERNET  0                       /* Define the CPU which services the Ethernet           */
+/* Deployment: the CPU (0..2) each subsystem runs on. Its initialisation, scheduler tasks and interrupts follow the
+ * setting, subsystems on different CPUs talk through the Ipc mailboxes. CPU0 also does the board bring-up. */
+#define CPU_WHICH_SERVICE_ETHERNET  1                       /* CPU running lwIP, the GETH ISRs and DoIP transport   */
+#define CPU_WHICH_SERVICE_APP       0                       /* CPU running UDS, DoIP diagnostics, VCI and health    */
+#define CPU_WHICH_SERVICE_FLASH     0                       /* CPU taking the Flash4 QSPI interrupts                */
+#define CPU_WHICH_SERVICE_LOG       0                       /* CPU taking the UART log DMA interrupt                */
 
 #endif
@@ -31,8 +31,12 @@
 /*********************************************************************************************************************/
 /*------------------------------------------------------Macros-------------------------------------------------------*/
 /*********************************************************************************************************************/
+#define ISR_PRIORITY_SCHED_WAKE     97                          /* Scheduler post from the other core, per core     */
+#define ISR_PRIORITY_APP_TICK       98                          /* Application core timer interrupt priority        */
 #define ISR_PRIORITY_OS_TICK        99                          /* Define the timer interrupt priority              */
 #define ISR_PRIORITY_GETH_TX        100                         /* Define the Ethernet transmit interrupt priority  */
 #define ISR_PRIORITY_GETH_RX        101                         /* Define the Ethernet receive interrupt priority   */
+#define ISR_PRIORITY_GETH_TX1       102                         /* Ethernet transmit interrupt, best-effort queue   */
+#define ISR_PRIORITY_GETH_RX1       103                         /* Ethernet receive interrupt, best-effort queue    */
 
 #endif
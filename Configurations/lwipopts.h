@@ -42,9 +42,27 @@
 #define LWIP_NETCONN            0                   /* Disable Netconn API                                                  */
 #define LWIP_SOCKET             0                   /* Disable the Socket API                                               */
 #define SYS_LIGHTWEIGHT_PROT    0                   /* Disable inter-task protection                                        */
+#define MEMP_NUM_TCP_PCB        8                   /* VMG client + DOIP_SERVER_MAX_CONNECTIONS testers + echo clients      */
+#define MEMP_NUM_TCP_SEG        32                  /* Queued segments, shared by all DoIP connections                      */
+#define ARP_QUEUEING            1                   /* Queue requests routed to a zone ECU while its ARP entry resolves     */
+#define MEMP_NUM_ARP_QUEUE      16                  /* DOIP_ROUTER_MAX_PENDING: every forwarded request may be waiting      */
+#define ARP_QUEUE_LEN           16                  /* ... for the same zone ECU                                            */
 
 
+#define IFX_NETIF_RX_ZERO_COPY  1                   /* Pass GETH RX DMA buffers to lwIP as PBUF_CUSTOM instead of copying   */
+#define IFX_NETIF_RX_SPARE_BUFFERS  8               /* RX DMA buffers beyond the descriptor ring, held by lwIP meanwhile    */
+#define IFX_NETIF_TX_ZERO_COPY  1                   /* Map each TX pbuf segment onto its own GETH TX descriptor             */
+
+#define IFX_NETIF_QUEUES        2                   /* GETH DMA channels: 0 DoIP diagnostics, 1 best effort (ARP, VCI, ...) */
+#define IFX_NETIF_DIAG_PORT     13400               /* TCP port of the frames sent on the diagnostic queue                  */
+#define IFX_NETIF_DIAG_VLAN_PRIORITIES  0xE0        /* VLAN PCPs 5..7 are received on the diagnostic queue                  */
+
+#if IFX_NETIF_RX_ZERO_COPY
+#define ETH_PAD_SIZE            0                   /* DMA writes frames at the word-aligned buffer start, no room for pad  */
+#define LWIP_SUPPORT_CUSTOM_PBUF    1               /* RX frames are wrapped in PBUF_CUSTOM                                 */
+#else
 #define ETH_PAD_SIZE            2                   /* Add 2 bytes before the Ethernet header to ensure payload alignment   */
+#endif
 
 #define __LWIP_DEBUG__                              /* Enable debugging through UART interface                              */
 
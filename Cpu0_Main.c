@@ -27,11 +27,10 @@ DoIP_VCI_Info g_zgw_vci;
 DoIP_HealthStatus_Info g_health_data[MAX_ZONE_ECUS + 1];
 
 boolean g_vci_collection_active = FALSE;
-uint32 g_vci_collection_start_time = 0;
 
 void core0_main(void)
 {
-    SystemInit_All();
-    SystemMain_Loop();
+    SystemInit_Core();
+    SystemMain_Run();
 }
 
@@ -28,6 +28,8 @@
 #include "IfxCpu.h"
 #include "IfxScuWdt.h"
 #include "Ifx_Cfg_Ssw.h"
+#include "SystemInit.h"
+#include "SystemMain.h"
 
 extern IfxCpu_syncEvent g_cpuSyncEvent;
 
@@ -44,7 +46,7 @@ void core1_main(void)
     IfxCpu_emitEvent(&g_cpuSyncEvent);
     IfxCpu_waitEvent(&g_cpuSyncEvent, 1);
     
-    while(1)
-    {
-    }
+    /* What runs here is set by the deployment in Configuration.h */
+    SystemInit_Core();
+    SystemMain_Run();
 }
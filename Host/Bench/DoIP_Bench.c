@@ -0,0 +1,1212 @@
+/**
+ * @file DoIP_Bench.c
+ * @brief DoIP/UDS throughput and latency benchmark for the host build
+ * @details Plays the role of test/vmg_server.py on the peer netif: accepts the
+ *          gateway's DoIP connection, answers routing activation and then
+ *          drives a fixed request mix (alive check, 0x22 VCI/health reads,
+ *          0x31 VCI report, unsupported service). With -f it runs a UDS
+ *          download (0x34/0x36/0x37) into the Flash4 model instead and
+ *          reports the sustained KB/s, with -u an upload (0x35/0x36/0x37).
+ *          With -t it also opens tester connections to the gateway's DoIP
+ *          server, each reading DIDs next to the VMG's request mix; with -z
+ *          the testers read from a simulated zone ECU behind the gateway
+ *          instead, which answers over UDP on a second peer netif, and with
+ *          -g they send the reads to the functional address.
+ *
+ *          Usage: zgw_doip_bench [-n requests] [-d depth] [-r budget] [-b baudrate] [-l logmask] [-e] [-f kb] [-u kb]
+ *                                [-t testers] [-z] [-g] [-v]
+ *            -n  number of measured requests (default 20000)
+ *            -d  requests sent back-to-back before waiting (default 1)
+ *            -r  RX frames per Ifx_Lwip_pollReceiveFlags() (default IFX_LWIP_RX_BUDGET)
+ *            -b  emulate the UART drain at this baud rate (default off)
+ *            -l  runtime log mask for all modules (UART_Log.h)
+ *            -e  error mix: adds an oversized request and a garbage run
+ *            -f  download this many KB into Flash4 and verify them
+ *            -u  upload this many KB from Flash4 and verify them
+ *            -t  tester connections (one more than the server takes is refused)
+ *            -z  tester reads are routed to the zone ECU (implies -t 1)
+ *            -g  tester reads are functional, fanned out to the zone ECUs (implies -z)
+ *            -v  echo gateway UART output to stdout
+ */
+
+#include "HostGateway.h"
+#include "HostNetif.h"
+#include "HostUart.h"
+#include "HostFlash4.h"
+#include "UART_Log.h"
+#include "IfxStm.h"
+#include "Ifx_Lwip.h"
+#include "AppConfig.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "Libraries/DoIP/doip_client.h"
+#include "Libraries/DoIP/doip_message.h"
+#include "Libraries/DoIP/doip_router.h"
+#include "Libraries/DoIP/doip_server.h"
+#include "Libraries/DoIP/uds_handler.h"
+#include "Libraries/DoIP/uds_transaction.h"
+#include "Libraries/DoIP/uds_download.h"
+#include "Sched.h"
+#include "Timer_Wheel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_REQUESTS      20000U
+#define BENCH_MAX_STEPS             100000U     /* Main-loop passes before a request counts as lost */
+#define BENCH_RX_BUFFER_SIZE        8192U       /* Holds a whole upload block response */
+#define BENCH_DOWNLOAD_TIMEOUT_MS   10000U      /* Wall time for one download response, 0x78 included */
+#define BENCH_MAX_TESTERS           (DOIP_SERVER_MAX_CONNECTIONS + 1)
+#define BENCH_TESTER_ADDRESS        0x0E80      /* Source address of the first tester */
+#define BENCH_ZONE_PENDING_EVERY    8U          /* The zone ECU sends 0x78 before every 8th response */
+
+#define DOIP_HDR(type, len) \
+    DOIP_PROTOCOL_VERSION, DOIP_INVERSE_VERSION, (uint8)((type) >> 8), (uint8)(type), \
+    0x00, 0x00, (uint8)((len) >> 8), (uint8)(len)
+
+#define DIAG_ROUTE  (uint8)(DOIP_VMG_ADDRESS >> 8), (uint8)DOIP_VMG_ADDRESS, \
+                    (uint8)(DOIP_ZONAL_GW_ADDRESS >> 8), (uint8)DOIP_ZONAL_GW_ADDRESS
+
+/* Request frames are sent without TCP_WRITE_FLAG_COPY, so they must stay static */
+static const uint8 g_reqAliveCheck[] = { DOIP_HDR(DOIP_ALIVE_CHECK_REQ, 0) };
+static const uint8 g_reqReadVci[]    = { DOIP_HDR(DOIP_DIAGNOSTIC_MESSAGE, 7), DIAG_ROUTE,
+                                         UDS_SID_READ_DATA_BY_IDENTIFIER, 0xF1, 0x94 };
+static const uint8 g_reqReadHealth[] = { DOIP_HDR(DOIP_DIAGNOSTIC_MESSAGE, 7), DIAG_ROUTE,
+                                         UDS_SID_READ_DATA_BY_IDENTIFIER, 0xF1, 0xA0 };
+static const uint8 g_reqVciReport[]  = { DOIP_HDR(DOIP_DIAGNOSTIC_MESSAGE, 8), DIAG_ROUTE,
+                                         UDS_SID_ROUTINE_CONTROL, UDS_RC_START_ROUTINE, 0xF0, 0x02 };
+static const uint8 g_reqUnsupported[] = { DOIP_HDR(DOIP_DIAGNOSTIC_MESSAGE, 5), DIAG_ROUTE,
+                                          UDS_SID_TESTER_PRESENT };
+/* Error mix (-e): an oversized request answered with a generic NACK, and an
+ * alive check behind a run of garbage that costs one NACK and a resync */
+static const uint8 g_reqOversized[DOIP_HEADER_SIZE + DOIP_MAX_PAYLOAD_SIZE + 1] =
+                                       { DOIP_HDR(DOIP_DIAGNOSTIC_MESSAGE, DOIP_MAX_PAYLOAD_SIZE + 1), DIAG_ROUTE,
+                                         UDS_SID_READ_DATA_BY_IDENTIFIER, 0xF1, 0x94 };
+static const uint8 g_reqGarbage[]    = { 0xFF, 0x02, 0x13, 0x37, 0xFD, 0x00,
+                                         DOIP_HDR(DOIP_ALIVE_CHECK_REQ, 0) };
+static const uint8 g_resRouting[]    = { DOIP_HDR(DOIP_ROUTING_ACTIVATION_RES, 9),
+                                         (uint8)(DOIP_VMG_ADDRESS >> 8), (uint8)DOIP_VMG_ADDRESS,
+                                         (uint8)(DOIP_ZONAL_GW_ADDRESS >> 8), (uint8)DOIP_ZONAL_GW_ADDRESS,
+                                         DOIP_RA_RES_SUCCESS, 0x00, 0x00, 0x00, 0x00 };
+
+typedef struct
+{
+    const uint8 *frame;
+    uint16       len;
+} Bench_Request;
+
+/* Every request completes with exactly one alive check response or diagnostic message */
+static const Bench_Request g_requestMix[] = {
+    { g_reqAliveCheck,  sizeof(g_reqAliveCheck) },
+    { g_reqReadVci,     sizeof(g_reqReadVci) },
+    { g_reqReadHealth,  sizeof(g_reqReadHealth) },
+    { g_reqVciReport,   sizeof(g_reqVciReport) },
+    { g_reqUnsupported, sizeof(g_reqUnsupported) },
+};
+
+static const Bench_Request g_errorMix[] = {
+    { g_reqAliveCheck,  sizeof(g_reqAliveCheck) },
+    { g_reqReadVci,     sizeof(g_reqReadVci) },
+    { g_reqOversized,   sizeof(g_reqOversized) },
+    { g_reqGarbage,     sizeof(g_reqGarbage) },
+    { g_reqReadHealth,  sizeof(g_reqReadHealth) },
+};
+
+#define BENCH_MIX_COUNT (sizeof(g_requestMix) / sizeof(g_requestMix[0]))
+#define BENCH_ERROR_MIX_COUNT (sizeof(g_errorMix) / sizeof(g_errorMix[0]))
+
+/* Simulated VMG */
+static struct tcp_pcb *g_vmgListen = NULL;
+static struct tcp_pcb *g_vmgConn = NULL;
+static uint8           g_vmgRx[BENCH_RX_BUFFER_SIZE];
+static uint32          g_vmgRxLen = 0;
+static uint32          g_completions = 0;
+static uint32          g_reportsSeen = 0;
+static uint32          g_nacksSeen = 0;
+static uint32          g_pendingSeen = 0;
+static uint8           g_lastUds[BENCH_RX_BUFFER_SIZE];  /* Last final diagnostic response */
+static uint32          g_lastUdsLen = 0;
+
+/* Simulated testers on the gateway's DoIP server */
+typedef struct
+{
+    struct tcp_pcb *pcb;
+    uint16          address;
+    uint16          target;         /* Target address of the reads */
+    uint16          responder;      /* Source address of their responses */
+    boolean         active;         /* Routing activated */
+    boolean         refused;        /* Connection reset by the gateway */
+    uint8           reqReadVci[DOIP_HEADER_SIZE + 7];
+    uint8           reqReadHealth[DOIP_HEADER_SIZE + 7];
+    uint8           rx[BENCH_RX_BUFFER_SIZE];
+    uint32          rxLen;
+    uint32          completions;    /* Diagnostic responses addressed to this tester */
+    uint32          acks;           /* Diagnostic message positive acknowledges */
+    uint32          pending;        /* 0x78 responses */
+    uint32          misrouted;      /* Responses or NACKs meant for somebody else */
+} Bench_Tester;
+
+static Bench_Tester    g_testers[BENCH_MAX_TESTERS];
+static uint32          g_testerCount = 0;
+
+static struct udp_pcb *g_zoneEcu = NULL;
+static uint32          g_zoneRequests = 0;
+
+/*******************************************************************************
+ * Helpers
+ ******************************************************************************/
+
+static uint64 Bench_nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000ULL + (uint64)ts.tv_nsec;
+}
+
+static void Bench_step(void)
+{
+    HostGateway_step();
+    HostNetif_pollPeer();
+}
+
+/* Per-task run time and post-to-run latency of a core's scheduler, in us */
+static void Bench_printTasks(const Sched *sched)
+{
+    const double ticksPerUs = HOST_STM_TICKS_PER_MS / 1000.0;
+
+    for (uint8 task = 0; task < sched->count; task++)
+    {
+        const Sched_TaskStats *stats = Sched_getStats(sched, task);
+
+        printf("  task %-12s : %u runs, %.2f us avg, max %.2f us, max latency %.2f us\n", sched->task[task].name,
+               stats->runs, (stats->runs != 0) ? (stats->runTicks / ticksPerUs) / stats->runs : 0.0,
+               stats->maxRunTicks / ticksPerUs, stats->maxLatencyTicks / ticksPerUs);
+    }
+}
+
+static int Bench_compare(const void *a, const void *b)
+{
+    uint64 x = *(const uint64 *)a;
+    uint64 y = *(const uint64 *)b;
+    return (x > y) - (x < y);
+}
+
+static boolean Vmg_send(const uint8 *frame, uint16 len)
+{
+    if (g_vmgConn != NULL && tcp_write(g_vmgConn, frame, len, 0) == ERR_OK)
+    {
+        tcp_output(g_vmgConn);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* Diagnostic message to the gateway, copied into the send queue */
+static boolean Vmg_sendUds(const uint8 *uds, uint16 len)
+{
+    uint8 frame[DOIP_HEADER_SIZE + 4 + UDS_DOWNLOAD_MAX_BLOCK_LENGTH];
+    const uint8 head[] = { DOIP_HDR(DOIP_DIAGNOSTIC_MESSAGE, 4 + len), DIAG_ROUTE };
+
+    memcpy(frame, head, sizeof(head));
+    memcpy(&frame[sizeof(head)], uds, len);
+
+    if (g_vmgConn != NULL && tcp_write(g_vmgConn, frame, (u16_t)(sizeof(head) + len), TCP_WRITE_FLAG_COPY) == ERR_OK)
+    {
+        tcp_output(g_vmgConn);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/*******************************************************************************
+ * Simulated VMG (lwIP raw API on the peer netif)
+ ******************************************************************************/
+
+static void Vmg_processMessage(uint16 type, const uint8 *payload, uint32 payloadLen)
+{
+    if (type == DOIP_ROUTING_ACTIVATION_REQ)
+    {
+        Vmg_send(g_resRouting, sizeof(g_resRouting));
+    }
+    else if (type == DOIP_VCI_REPORT)
+    {
+        g_reportsSeen++;
+    }
+
+    else if (type == DOIP_DIAGNOSTIC_MESSAGE && payload[4] == UDS_SID_NEGATIVE_RESPONSE &&
+             payload[6] == UDS_NRC_REQUEST_CORRECTLY_RECEIVED)
+    {
+        /* 0x78: the final response is still to come */
+        g_pendingSeen++;
+    }
+    else if (type == DOIP_ALIVE_CHECK_RES || type == DOIP_DIAGNOSTIC_MESSAGE)
+    {
+        if (type == DOIP_DIAGNOSTIC_MESSAGE)
+        {
+            g_lastUdsLen = (payloadLen - 4 < sizeof(g_lastUds)) ? payloadLen - 4 : sizeof(g_lastUds);
+            memcpy(g_lastUds, &payload[4], g_lastUdsLen);
+        }
+        g_completions++;
+    }
+    else if (type == DOIP_GENERIC_NACK)
+    {
+        /* only the oversized request completes with a NACK */
+        g_nacksSeen++;
+        if (payload[0] == DOIP_NACK_MESSAGE_TOO_LARGE)
+        {
+            g_completions++;
+        }
+    }
+}
+
+static err_t Vmg_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+    (void)arg;
+    (void)err;
+
+    if (p == NULL)
+    {
+        tcp_close(tpcb);
+        g_vmgConn = NULL;
+        return ERR_OK;
+    }
+
+    /* Byte-wise reassembly keeps the VMG out of the lwIP copy counters */
+    for (struct pbuf *q = p; q != NULL; q = q->next)
+    {
+        const uint8 *src = (const uint8 *)q->payload;
+        for (uint16 i = 0; i < q->len && g_vmgRxLen < BENCH_RX_BUFFER_SIZE; i++)
+        {
+            g_vmgRx[g_vmgRxLen++] = src[i];
+        }
+    }
+
+    while (g_vmgRxLen >= DOIP_HEADER_SIZE)
+    {
+        uint16 type = ((uint16)g_vmgRx[2] << 8) | g_vmgRx[3];
+        uint32 payloadLen = ((uint32)g_vmgRx[4] << 24) | ((uint32)g_vmgRx[5] << 16) |
+                            ((uint32)g_vmgRx[6] << 8) | g_vmgRx[7];
+        uint32 total = DOIP_HEADER_SIZE + payloadLen;
+
+        if (total > BENCH_RX_BUFFER_SIZE)
+        {
+            g_vmgRxLen = 0;
+            break;
+        }
+        if (g_vmgRxLen < total)
+        {
+            break;
+        }
+
+        Vmg_processMessage(type, &g_vmgRx[DOIP_HEADER_SIZE], payloadLen);
+
+        g_vmgRxLen -= total;
+        for (uint32 i = 0; i < g_vmgRxLen; i++)
+        {
+            g_vmgRx[i] = g_vmgRx[total + i];
+        }
+    }
+
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+
+    /* ACK at once like a desktop stack in quick-ack mode, otherwise the
+     * gateway's short send queue fills up behind our delayed ACKs */
+    tcp_ack_now(tpcb);
+    tcp_output(tpcb);
+    return ERR_OK;
+}
+
+static err_t Vmg_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+    (void)arg;
+
+    if (err != ERR_OK || newpcb == NULL)
+    {
+        return ERR_VAL;
+    }
+
+    g_vmgConn = newpcb;
+    g_vmgRxLen = 0;
+    tcp_nagle_disable(newpcb);
+    tcp_recv(newpcb, Vmg_recv);
+    return ERR_OK;
+}
+
+static boolean Vmg_listen(const ip4_addr_t *vmgIp)
+{
+    struct tcp_pcb *pcb = tcp_new();
+    if (pcb == NULL || tcp_bind(pcb, vmgIp, VMG_PORT) != ERR_OK)
+    {
+        return FALSE;
+    }
+
+    g_vmgListen = tcp_listen(pcb);
+    if (g_vmgListen == NULL)
+    {
+        return FALSE;
+    }
+
+    tcp_accept(g_vmgListen, Vmg_accept);
+    return TRUE;
+}
+
+/*******************************************************************************
+ * Simulated testers (lwIP raw API on the peer netif)
+ ******************************************************************************/
+
+static void Tester_buildRead(uint8 *frame, uint16 address, uint16 target, uint16 did)
+{
+    const uint8 head[] = { DOIP_HDR(DOIP_DIAGNOSTIC_MESSAGE, 7), (uint8)(address >> 8), (uint8)address,
+                           (uint8)(target >> 8), (uint8)target,
+                           UDS_SID_READ_DATA_BY_IDENTIFIER, (uint8)(did >> 8), (uint8)did };
+    memcpy(frame, head, sizeof(head));
+}
+
+static boolean Tester_send(Bench_Tester *tester, const uint8 *frame, uint16 len)
+{
+    if (tester->pcb != NULL && tcp_write(tester->pcb, frame, len, 0) == ERR_OK)
+    {
+        tcp_output(tester->pcb);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void Tester_processMessage(Bench_Tester *tester, uint16 type, const uint8 *payload, uint32 payloadLen)
+{
+    uint16 source = (payloadLen >= 4) ? (uint16)(((uint16)payload[0] << 8) | payload[1]) : 0;
+    uint16 target = (payloadLen >= 4) ? (uint16)(((uint16)payload[2] << 8) | payload[3]) : 0;
+
+    if (type == DOIP_ROUTING_ACTIVATION_RES)
+    {
+        tester->active = (payloadLen >= 9 && payload[4] == DOIP_RA_RES_SUCCESS);
+    }
+    else if (type == DOIP_DIAGNOSTIC_MESSAGE_ACK && target == tester->address)
+    {
+        tester->acks++;
+    }
+    else if (type == DOIP_DIAGNOSTIC_MESSAGE && target == tester->address && source == tester->responder)
+    {
+        if (payloadLen == 7 && payload[4] == UDS_SID_NEGATIVE_RESPONSE &&
+            payload[6] == UDS_NRC_REQUEST_CORRECTLY_RECEIVED)
+        {
+            tester->pending++;
+        }
+        else
+        {
+            tester->completions++;
+        }
+    }
+    else
+    {
+        tester->misrouted++;
+    }
+}
+
+static err_t Tester_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+    Bench_Tester *tester = (Bench_Tester *)arg;
+    (void)err;
+
+    if (p == NULL)
+    {
+        tcp_close(tpcb);
+        tester->pcb = NULL;
+        tester->active = FALSE;
+        return ERR_OK;
+    }
+
+    for (struct pbuf *q = p; q != NULL; q = q->next)
+    {
+        const uint8 *src = (const uint8 *)q->payload;
+        for (uint16 i = 0; i < q->len && tester->rxLen < BENCH_RX_BUFFER_SIZE; i++)
+        {
+            tester->rx[tester->rxLen++] = src[i];
+        }
+    }
+
+    while (tester->rxLen >= DOIP_HEADER_SIZE)
+    {
+        uint16 type = ((uint16)tester->rx[2] << 8) | tester->rx[3];
+        uint32 payloadLen = ((uint32)tester->rx[4] << 24) | ((uint32)tester->rx[5] << 16) |
+                            ((uint32)tester->rx[6] << 8) | tester->rx[7];
+        uint32 total = DOIP_HEADER_SIZE + payloadLen;
+
+        if (total > BENCH_RX_BUFFER_SIZE)
+        {
+            tester->rxLen = 0;
+            break;
+        }
+        if (tester->rxLen < total)
+        {
+            break;
+        }
+
+        Tester_processMessage(tester, type, &tester->rx[DOIP_HEADER_SIZE], payloadLen);
+
+        tester->rxLen -= total;
+        memmove(tester->rx, &tester->rx[total], tester->rxLen);
+    }
+
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+    tcp_ack_now(tpcb);
+    tcp_output(tpcb);
+    return ERR_OK;
+}
+
+static void Tester_error(void *arg, err_t err)
+{
+    Bench_Tester *tester = (Bench_Tester *)arg;
+    (void)err;
+
+    /* A socket beyond DOIP_SERVER_MAX_CONNECTIONS is reset on accept */
+    tester->pcb = NULL;
+    tester->active = FALSE;
+    tester->refused = TRUE;
+}
+
+static err_t Tester_connected(void *arg, struct tcp_pcb *tpcb, err_t err)
+{
+    Bench_Tester *tester = (Bench_Tester *)arg;
+    uint8 request[DOIP_HEADER_SIZE + 7];
+    (void)tpcb;
+
+    if (err != ERR_OK)
+    {
+        return err;
+    }
+
+    DoIP_CreateRoutingActivationRequest(request, tester->address);
+    tcp_nagle_disable(tester->pcb);
+    if (tcp_write(tester->pcb, request, sizeof(request), TCP_WRITE_FLAG_COPY) == ERR_OK)
+    {
+        tcp_output(tester->pcb);
+    }
+    return ERR_OK;
+}
+
+/* Connect the testers from the peer address and wait until each is activated or refused */
+static boolean Tester_connectAll(const ip4_addr_t *peerIp, uint32 count, uint16 target)
+{
+    ip4_addr_t gatewayIp;
+    IP4_ADDR(&gatewayIp, ETH_IP_ADDR_0, ETH_IP_ADDR_1, ETH_IP_ADDR_2, ETH_IP_ADDR_3);
+
+    g_testerCount = count;
+    for (uint32 i = 0; i < count; i++)
+    {
+        Bench_Tester *tester = &g_testers[i];
+
+        memset(tester, 0, sizeof(*tester));
+        tester->address = (uint16)(BENCH_TESTER_ADDRESS + i);
+        tester->target = target;
+        tester->responder = (target == DOIP_FUNCTIONAL_ADDRESS) ? DOIP_ZONE_ECU_ADDRESS : target;
+        Tester_buildRead(tester->reqReadVci, tester->address, target, 0xF194);
+        Tester_buildRead(tester->reqReadHealth, tester->address, target, 0xF1A0);
+
+        tester->pcb = tcp_new();
+        if (tester->pcb == NULL || tcp_bind(tester->pcb, peerIp, 0) != ERR_OK)
+        {
+            return FALSE;
+        }
+        tcp_arg(tester->pcb, tester);
+        tcp_recv(tester->pcb, Tester_recv);
+        tcp_err(tester->pcb, Tester_error);
+        if (tcp_connect(tester->pcb, &gatewayIp, DOIP_TCP_DATA_PORT, Tester_connected) != ERR_OK)
+        {
+            return FALSE;
+        }
+    }
+
+    for (uint32 step = 0; step < BENCH_MAX_STEPS; step++)
+    {
+        uint32 settled = 0;
+
+        Bench_step();
+        for (uint32 i = 0; i < count; i++)
+        {
+            settled += (g_testers[i].active || g_testers[i].refused) ? 1U : 0U;
+        }
+        if (settled == count)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* Pipeline depth reads on every active tester, with depth VMG requests alongside */
+static int Bench_testers(const ip4_addr_t *peerIp, uint32 count, uint32 requests, uint32 depth, uint16 target)
+{
+    if (!Tester_connectAll(peerIp, count, target))
+    {
+        fprintf(stderr, "Tester connections did not settle\n");
+        return 1;
+    }
+
+    uint32 active = 0;
+    for (uint32 i = 0; i < count; i++)
+    {
+        active += g_testers[i].active ? 1U : 0U;
+    }
+
+    uint32 lost = 0;
+    uint32 total = 0;
+    uint64 start = Bench_nowNs();
+
+    for (uint32 n = 0; n < requests; n += depth)
+    {
+        uint32 batch = ((requests - n) < depth) ? (requests - n) : depth;
+        uint32 vmgTarget = g_completions + batch;
+        uint32 testerTarget[BENCH_MAX_TESTERS];
+        uint32 testerSent[BENCH_MAX_TESTERS];
+        uint32 vmgSent = 0;
+
+        for (uint32 i = 0; i < count; i++)
+        {
+            testerTarget[i] = g_testers[i].completions + (g_testers[i].active ? batch : 0U);
+            testerSent[i] = g_testers[i].active ? 0U : batch;
+        }
+
+        for (uint32 step = 0; step < BENCH_MAX_STEPS; step++)
+        {
+            boolean done = (g_completions >= vmgTarget);
+
+            while (vmgSent < batch && Vmg_send(g_requestMix[(n + vmgSent) % BENCH_MIX_COUNT].frame,
+                                               g_requestMix[(n + vmgSent) % BENCH_MIX_COUNT].len))
+            {
+                vmgSent++;
+            }
+
+            for (uint32 i = 0; i < count; i++)
+            {
+                Bench_Tester *tester = &g_testers[i];
+
+                while (testerSent[i] < batch &&
+                       Tester_send(tester, ((n + testerSent[i]) & 1U) ? tester->reqReadHealth : tester->reqReadVci,
+                                   sizeof(tester->reqReadVci)))
+                {
+                    testerSent[i]++;
+                }
+                done = done && (tester->completions >= testerTarget[i]);
+            }
+
+            if (done)
+            {
+                break;
+            }
+            Bench_step();
+        }
+
+        total += batch * (1U + active);
+        if (g_completions < vmgTarget)
+        {
+            lost += vmgTarget - g_completions;
+            g_completions = vmgTarget;
+        }
+        for (uint32 i = 0; i < count; i++)
+        {
+            if (g_testers[i].completions < testerTarget[i])
+            {
+                lost += testerTarget[i] - g_testers[i].completions;
+                g_testers[i].completions = testerTarget[i];
+            }
+        }
+    }
+
+    uint64 elapsed = Bench_nowNs() - start;
+    const DoIP_ServerStats *server = DoIP_Server_GetStats();
+    uint32 misrouted = 0;
+
+    printf("DoIP server benchmark: %u testers (%u activated) + VMG, %u requests each, depth %u, target 0x%04X\n",
+           count, active, requests, depth, target);
+    printf("  throughput        : %.1f msg/s (all connections)\n", total / (elapsed / 1e9));
+    for (uint32 i = 0; i < count; i++)
+    {
+        const Bench_Tester *tester = &g_testers[i];
+        printf("  tester 0x%04X     : %s, %u responses, %u acks, %u pending\n", tester->address,
+               tester->active ? "active" : (tester->refused ? "refused" : "closed"),
+               tester->completions, tester->acks, tester->pending);
+        misrouted += tester->misrouted;
+    }
+    printf("  server            : %u accepted, %u rejected, %u activations\n",
+           server->accepted, server->rejected, server->activations);
+    if (target != DOIP_ZONAL_GW_ADDRESS)
+    {
+        const DoIP_RouterStats *router = DoIP_Router_GetStats();
+        printf("  zone ECU          : %u requests\n", g_zoneRequests);
+        printf("  router            : %u forwarded, %u responses, %u pending, high-water %u of %u\n",
+               router->forwarded, router->responses, router->pending, router->high_water, DOIP_ROUTER_MAX_PENDING);
+        printf("  router functional : %u fanned out, %u complete, %u silent ECUs\n",
+               router->functional, router->fanouts_complete, router->silent);
+        printf("  router drops      : %u refused, %u unmatched, %u timeouts, %u send errors\n",
+               router->refused, router->unmatched, router->timeouts, router->send_errors);
+        printf("  dropped frames    : %u\n", HostNetif_getStats()->drops);
+    }
+    printf("  uds transactions  : high-water %u of %u, exhausted %u\n",
+           UDS_Transaction_GetStats()->high_water, UDS_TRANSACTION_POOL_SIZE, UDS_Transaction_GetStats()->exhausted);
+    printf("  misrouted         : %u\n", misrouted);
+    printf("  lost requests     : %u\n", lost);
+
+    return (lost == 0 && misrouted == 0) ? 0 : 1;
+}
+
+/*******************************************************************************
+ * Simulated zone ECU (UDP on a second peer netif)
+ ******************************************************************************/
+
+/* Answers every read like test/ecu_011_simulator.py, some after a 0x78 */
+static void ZoneEcu_recv(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    uint8 request[DOIP_HEADER_SIZE + 7];
+    (void)arg;
+
+    if (p->tot_len != sizeof(request) || pbuf_copy_partial(p, request, sizeof(request), 0) != sizeof(request) ||
+        request[DOIP_HEADER_SIZE + 4] != UDS_SID_READ_DATA_BY_IDENTIFIER)
+    {
+        pbuf_free(p);
+        return;
+    }
+    pbuf_free(p);
+
+    /* The ECU answers the tester with its own address, also to a functional request */
+    const uint8 *route = &request[DOIP_HEADER_SIZE];
+    const uint8 ecu[] = { (uint8)(DOIP_ZONE_ECU_ADDRESS >> 8), (uint8)DOIP_ZONE_ECU_ADDRESS };
+    const uint8 pending[] = { DOIP_HDR(DOIP_DIAGNOSTIC_MESSAGE, 7), ecu[0], ecu[1], route[0], route[1],
+                              UDS_SID_NEGATIVE_RESPONSE, UDS_SID_READ_DATA_BY_IDENTIFIER,
+                              UDS_NRC_REQUEST_CORRECTLY_RECEIVED };
+    const uint8 response[] = { DOIP_HDR(DOIP_DIAGNOSTIC_MESSAGE, 14), ecu[0], ecu[1], route[0], route[1],
+                               UDS_SID_READ_DATA_BY_IDENTIFIER + 0x40, route[5], route[6],
+                               'E', 'C', 'U', '_', '0', '1', '1' };
+
+    if ((g_zoneRequests++ % BENCH_ZONE_PENDING_EVERY) == 0)
+    {
+        struct pbuf *q = pbuf_alloc(PBUF_TRANSPORT, sizeof(pending), PBUF_RAM);
+        if (q != NULL)
+        {
+            memcpy(q->payload, pending, sizeof(pending));
+            udp_sendto(upcb, q, addr, port);
+            pbuf_free(q);
+        }
+    }
+
+    struct pbuf *q = pbuf_alloc(PBUF_TRANSPORT, sizeof(response), PBUF_RAM);
+    if (q != NULL)
+    {
+        memcpy(q->payload, response, sizeof(response));
+        udp_sendto(upcb, q, addr, port);
+        pbuf_free(q);
+    }
+}
+
+static boolean ZoneEcu_start(const ip4_addr_t *zoneIp)
+{
+    g_zoneEcu = udp_new();
+    if (g_zoneEcu == NULL || udp_bind(g_zoneEcu, zoneIp, ZONE_ECU_DOIP_PORT) != ERR_OK)
+    {
+        return FALSE;
+    }
+
+    udp_recv(g_zoneEcu, ZoneEcu_recv, NULL);
+    return TRUE;
+}
+
+/*******************************************************************************
+ * Benchmark
+ ******************************************************************************/
+
+static boolean Bench_waitForRouting(void)
+{
+    boolean skipped = FALSE;
+
+    /* The client only dials after DOIP_RECONNECT_INTERVAL */
+    HostStm_skipMs(DOIP_RECONNECT_INTERVAL);
+
+    for (uint32 step = 0; step < BENCH_MAX_STEPS; step++)
+    {
+        Bench_step();
+
+        if (DoIP_Client_IsActive())
+        {
+            return TRUE;
+        }
+
+        /* Skip the 200 ms settle time before the routing activation request,
+         * then let the gateway's TCP fast timer flush the unsent request */
+        if (DoIP_Client_GetState() == DOIP_STATE_CONNECTED)
+        {
+            HostStm_skipMs(skipped ? 1U : 250U);
+            skipped = TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* Send one UDS request and run the gateway until its final response (0x78 skipped) */
+static boolean Bench_udsRequest(const uint8 *uds, uint16 len)
+{
+    uint32 target = g_completions + 1;
+    uint64 deadline = Bench_nowNs() + (uint64)BENCH_DOWNLOAD_TIMEOUT_MS * 1000000ULL;
+    boolean sent = FALSE;
+
+    while (g_completions < target)
+    {
+        if (!sent)
+        {
+            sent = Vmg_sendUds(uds, len);
+        }
+
+        Bench_step();
+
+        if (Bench_nowNs() > deadline)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static uint8 Bench_pattern(uint32 offset)
+{
+    return (uint8)((offset * 31U) ^ (offset >> 9));
+}
+
+static int Bench_download(uint32 kb)
+{
+    uint32 size = kb * 1024U;
+    uint32 address = UDS_DOWNLOAD_REGION_START;
+    uint8 uds[UDS_DOWNLOAD_MAX_BLOCK_LENGTH];
+
+    /* 0x34: plain data, 4-byte address and size */
+    const uint8 request[] = { UDS_SID_REQUEST_DOWNLOAD, 0x00, 0x44,
+                              (uint8)(address >> 24), (uint8)(address >> 16), (uint8)(address >> 8), (uint8)address,
+                              (uint8)(size >> 24), (uint8)(size >> 16), (uint8)(size >> 8), (uint8)size };
+
+    if (!Bench_udsRequest(request, sizeof(request)) ||
+        g_lastUds[0] != (UDS_SID_REQUEST_DOWNLOAD + UDS_POSITIVE_RESPONSE_OFFSET))
+    {
+        fprintf(stderr, "RequestDownload rejected (0x%02X 0x%02X 0x%02X)\n", g_lastUds[0], g_lastUds[1], g_lastUds[2]);
+        return 1;
+    }
+
+    /* maxNumberOfBlockLength counts the SID and the block sequence counter */
+    uint16 maxBlock = ((uint16)g_lastUds[2] << 8) | g_lastUds[3];
+    uint16 chunk = (uint16)(maxBlock - 2);
+    uint32 blocks = 0;
+    uint8 bsc = 1;
+    uint64 start = Bench_nowNs();
+
+    for (uint32 offset = 0; offset < size; offset += chunk)
+    {
+        uint16 n = ((size - offset) < chunk) ? (uint16)(size - offset) : chunk;
+
+        uds[0] = UDS_SID_TRANSFER_DATA;
+        uds[1] = bsc;
+        for (uint16 i = 0; i < n; i++)
+        {
+            uds[2 + i] = Bench_pattern(offset + i);
+        }
+
+        if (!Bench_udsRequest(uds, (uint16)(n + 2)) ||
+            g_lastUds[0] != (UDS_SID_TRANSFER_DATA + UDS_POSITIVE_RESPONSE_OFFSET) || g_lastUds[1] != bsc)
+        {
+            fprintf(stderr, "TransferData block %u failed (0x%02X 0x%02X 0x%02X)\n", blocks + 1,
+                    g_lastUds[0], g_lastUds[1], g_lastUds[2]);
+            return 1;
+        }
+
+        bsc++;
+        blocks++;
+    }
+
+    uds[0] = UDS_SID_REQUEST_TRANSFER_EXIT;
+    if (!Bench_udsRequest(uds, 1) || g_lastUds[0] != (UDS_SID_REQUEST_TRANSFER_EXIT + UDS_POSITIVE_RESPONSE_OFFSET))
+    {
+        fprintf(stderr, "RequestTransferExit failed (0x%02X 0x%02X 0x%02X)\n", g_lastUds[0], g_lastUds[1], g_lastUds[2]);
+        return 1;
+    }
+
+    uint64 elapsed = Bench_nowNs() - start;
+    uint16 kbps = ((uint16)g_lastUds[1] << 8) | g_lastUds[2];
+    uint32 ms = ((uint32)g_lastUds[3] << 24) | ((uint32)g_lastUds[4] << 16) | ((uint32)g_lastUds[5] << 8) | g_lastUds[6];
+
+    /* Read back what the gateway programmed */
+    uint8 page[FLASH4_MAX_PAGE_SIZE];
+    uint32 mismatch = size;
+    for (uint32 offset = 0; offset < size && mismatch == size; offset += FLASH4_MAX_PAGE_SIZE)
+    {
+        uint16 n = ((size - offset) < FLASH4_MAX_PAGE_SIZE) ? (uint16)(size - offset) : FLASH4_MAX_PAGE_SIZE;
+        Flash4_ReadFlash4(address + offset, page, n);
+        for (uint16 i = 0; i < n; i++)
+        {
+            if (page[i] != Bench_pattern(offset + i))
+            {
+                mismatch = offset + i;
+                break;
+            }
+        }
+    }
+
+    const UDS_DownloadStats *dl = UDS_Download_GetStats();
+    const HostFlash4_Stats *flash = HostFlash4_getStats();
+
+    printf("UDS download benchmark: %u KB to Flash4 0x%08X (%u-byte blocks)\n", kb, address, chunk);
+    printf("  wall time         : %.1f ms (%.1f KB/s)\n", elapsed / 1e6, (double)kb / (elapsed / 1e9));
+    printf("  gateway reported  : %u KB/s over %u ms\n", kbps, ms);
+    printf("  blocks            : %u (%u waited for a page buffer, %u x 0x78)\n",
+           blocks, dl->blocks_deferred, g_pendingSeen);
+    printf("  flash             : %u pages, %u sectors erased, %u erase suspends, %u rejected\n",
+           flash->pagePrograms, flash->sectorErases, flash->suspends, flash->rejected);
+    if (mismatch == size)
+    {
+        printf("  verify            : OK\n");
+        return 0;
+    }
+
+    printf("  verify            : MISMATCH at offset %u\n", mismatch);
+    return 1;
+}
+
+static int Bench_upload(uint32 kb)
+{
+    uint32 size = kb * 1024U;
+    uint32 address = UDS_DOWNLOAD_REGION_START;
+    uint8 page[FLASH4_MAX_PAGE_SIZE];
+
+    /* Fill the (erased) region behind the gateway's back */
+    for (uint32 offset = 0; offset < size; offset += FLASH4_MAX_PAGE_SIZE)
+    {
+        uint16 n = ((size - offset) < FLASH4_MAX_PAGE_SIZE) ? (uint16)(size - offset) : FLASH4_MAX_PAGE_SIZE;
+        for (uint16 i = 0; i < n; i++)
+        {
+            page[i] = Bench_pattern(offset + i);
+        }
+        Flash4_PageProgram(address + offset, page, n);
+    }
+
+    /* 0x35: plain data, 4-byte address and size */
+    const uint8 request[] = { UDS_SID_REQUEST_UPLOAD, 0x00, 0x44,
+                              (uint8)(address >> 24), (uint8)(address >> 16), (uint8)(address >> 8), (uint8)address,
+                              (uint8)(size >> 24), (uint8)(size >> 16), (uint8)(size >> 8), (uint8)size };
+
+    if (!Bench_udsRequest(request, sizeof(request)) ||
+        g_lastUds[0] != (UDS_SID_REQUEST_UPLOAD + UDS_POSITIVE_RESPONSE_OFFSET))
+    {
+        fprintf(stderr, "RequestUpload rejected (0x%02X 0x%02X 0x%02X)\n", g_lastUds[0], g_lastUds[1], g_lastUds[2]);
+        return 1;
+    }
+
+    uint16 maxBlock = ((uint16)g_lastUds[2] << 8) | g_lastUds[3];
+    uint32 received = 0;
+    uint32 blocks = 0;
+    uint32 mismatch = size;
+    uint8 uds[2];
+    uint8 bsc = 1;
+    uint64 start = Bench_nowNs();
+
+    while (received < size)
+    {
+        uds[0] = UDS_SID_TRANSFER_DATA;
+        uds[1] = bsc;
+
+        if (!Bench_udsRequest(uds, sizeof(uds)) || g_lastUdsLen < 2 || g_lastUdsLen > maxBlock ||
+            g_lastUds[0] != (UDS_SID_TRANSFER_DATA + UDS_POSITIVE_RESPONSE_OFFSET) || g_lastUds[1] != bsc)
+        {
+            fprintf(stderr, "TransferData block %u failed (0x%02X 0x%02X 0x%02X)\n", blocks + 1,
+                    g_lastUds[0], g_lastUds[1], g_lastUds[2]);
+            return 1;
+        }
+
+        for (uint32 i = 2; i < g_lastUdsLen && mismatch == size; i++)
+        {
+            if (g_lastUds[i] != Bench_pattern(received + i - 2))
+            {
+                mismatch = received + i - 2;
+            }
+        }
+
+        received += g_lastUdsLen - 2;
+        bsc++;
+        blocks++;
+    }
+
+    uds[0] = UDS_SID_REQUEST_TRANSFER_EXIT;
+    if (!Bench_udsRequest(uds, 1) || g_lastUds[0] != (UDS_SID_REQUEST_TRANSFER_EXIT + UDS_POSITIVE_RESPONSE_OFFSET))
+    {
+        fprintf(stderr, "RequestTransferExit failed (0x%02X 0x%02X 0x%02X)\n", g_lastUds[0], g_lastUds[1], g_lastUds[2]);
+        return 1;
+    }
+
+    uint64 elapsed = Bench_nowNs() - start;
+    uint16 kbps = ((uint16)g_lastUds[1] << 8) | g_lastUds[2];
+    uint32 ms = ((uint32)g_lastUds[3] << 24) | ((uint32)g_lastUds[4] << 16) | ((uint32)g_lastUds[5] << 8) | g_lastUds[6];
+    const UDS_DownloadStats *ul = UDS_Download_GetStats();
+    const HostFlash4_Stats *flash = HostFlash4_getStats();
+
+    printf("UDS upload benchmark: %u KB from Flash4 0x%08X (%u-byte blocks)\n", kb, address, maxBlock - 2);
+    printf("  wall time         : %.1f ms (%.1f KB/s)\n", elapsed / 1e6, (double)kb / (elapsed / 1e9));
+    printf("  gateway reported  : %u KB/s over %u ms\n", kbps, ms);
+    printf("  blocks            : %u (%u waited for the read-ahead, %u x 0x78)\n",
+           blocks, ul->blocks_deferred, g_pendingSeen);
+    printf("  flash             : %u bytes read\n", flash->readBytes);
+    if (mismatch == size)
+    {
+        printf("  verify            : OK\n");
+        return 0;
+    }
+
+    printf("  verify            : MISMATCH at offset %u\n", mismatch);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint32 requests = BENCH_DEFAULT_REQUESTS;
+    uint32 depth = 1;
+    uint16 budget = 0;
+    const Bench_Request *mix = g_requestMix;
+    uint32 mixCount = BENCH_MIX_COUNT;
+    uint32 downloadKb = 0;
+    uint32 uploadKb = 0;
+    uint32 testers = 0;
+    boolean zone = FALSE;
+    boolean functional = FALSE;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && (i + 1) < argc)
+        {
+            requests = (uint32)strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-d") == 0 && (i + 1) < argc)
+        {
+            depth = (uint32)strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && (i + 1) < argc)
+        {
+            budget = (uint16)strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-b") == 0 && (i + 1) < argc)
+        {
+            HostUart_setBaudrate((uint32)strtoul(argv[++i], NULL, 0));
+        }
+        else if (strcmp(argv[i], "-l") == 0 && (i + 1) < argc)
+        {
+            uint8 masks[LOG_MODULE_COUNT];
+            memset(masks, (int)strtoul(argv[++i], NULL, 0), sizeof(masks));
+            Log_SetMasks(masks);
+        }
+        else if (strcmp(argv[i], "-e") == 0)
+        {
+            mix = g_errorMix;
+            mixCount = BENCH_ERROR_MIX_COUNT;
+        }
+        else if (strcmp(argv[i], "-f") == 0 && (i + 1) < argc)
+        {
+            downloadKb = (uint32)strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-u") == 0 && (i + 1) < argc)
+        {
+            uploadKb = (uint32)strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && (i + 1) < argc)
+        {
+            testers = (uint32)strtoul(argv[++i], NULL, 0);
+            testers = (testers > BENCH_MAX_TESTERS) ? BENCH_MAX_TESTERS : testers;
+        }
+        else if (strcmp(argv[i], "-z") == 0)
+        {
+            zone = TRUE;
+        }
+        else if (strcmp(argv[i], "-g") == 0)
+        {
+            zone = TRUE;
+            functional = TRUE;
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            HostUart_setEcho(TRUE);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n requests] [-d depth] [-r budget] [-b baudrate] [-l logmask] [-e] [-f kb] [-u kb] [-t testers] [-z] [-g] [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (requests == 0)
+    {
+        requests = 1;
+    }
+    if (depth == 0)
+    {
+        depth = 1;
+    }
+    if (zone && testers == 0)
+    {
+        testers = 1;
+    }
+
+    HostGateway_init();
+    if (budget != 0)
+    {
+        Ifx_Lwip_setRxBudget(budget);
+    }
+
+    ip4_addr_t vmgIp, vmgMask;
+    IP4_ADDR(&vmgIp, VMG_IP_ADDR_0, VMG_IP_ADDR_1, VMG_IP_ADDR_2, VMG_IP_ADDR_3);
+    IP4_ADDR(&vmgMask, 255, 255, 255, 0);
+    HostNetif_addPeer(&vmgIp, &vmgMask);
+
+    if (!Vmg_listen(&vmgIp))
+    {
+        fprintf(stderr, "VMG listen failed\n");
+        return 1;
+    }
+
+    if (zone)
+    {
+        ip4_addr_t zoneIp;
+        IP4_ADDR(&zoneIp, ZONE_ECU_IP_ADDR_0, ZONE_ECU_IP_ADDR_1, ZONE_ECU_IP_ADDR_2, ZONE_ECU_IP_ADDR_3);
+        HostNetif_addPeer(&zoneIp, &vmgMask);
+
+        if (!ZoneEcu_start(&zoneIp))
+        {
+            fprintf(stderr, "Zone ECU bind failed\n");
+            return 1;
+        }
+    }
+
+    if (!Bench_waitForRouting())
+    {
+        fprintf(stderr, "DoIP routing activation did not complete\n");
+        return 1;
+    }
+
+    if (downloadKb != 0)
+    {
+        return Bench_download(downloadKb);
+    }
+    if (uploadKb != 0)
+    {
+        return Bench_upload(uploadKb);
+    }
+    if (testers != 0)
+    {
+        uint16 target = functional ? DOIP_FUNCTIONAL_ADDRESS : (zone ? DOIP_ZONE_ECU_ADDRESS : DOIP_ZONAL_GW_ADDRESS);
+        return Bench_testers(&vmgIp, testers, requests, depth, target);
+    }
+
+    uint64 *latency = malloc(sizeof(uint64) * requests);
+    if (latency == NULL)
+    {
+        return 1;
+    }
+
+    HostNetif_resetStats();
+    HostUart_resetStats();
+    Ifx_Lwip_resetRxStats();
+    g_reportsSeen = 0;
+    g_nacksSeen = 0;
+
+    uint32 lost = 0;
+    uint64 steps = 0;
+    uint32 timersFired = Timer_Wheel_getStats(&g_Timer_net)->fired;
+    Sched_resetStats(&g_Sched_net);
+    Sched_resetStats(&g_Sched_app);
+    uint64 start = Bench_nowNs();
+
+    for (uint32 n = 0; n < requests; n += depth)
+    {
+        uint32 batch = ((requests - n) < depth) ? (requests - n) : depth;
+        uint32 target = g_completions + batch;
+
+        uint32 sent = 0;
+        uint32 step = 0;
+
+        uint64 t0 = Bench_nowNs();
+        while (g_completions < target && step < BENCH_MAX_STEPS)
+        {
+            /* the VMG send queue is short, push what fits and retry after ACKs */
+            while (sent < batch)
+            {
+                const Bench_Request *req = &mix[(n + sent) % mixCount];
+                if (!Vmg_send(req->frame, req->len))
+                {
+                    break;
+                }
+                sent++;
+            }
+
+            Bench_step();
+            step++;
+        }
+        steps += step;
+
+        uint64 t1 = Bench_nowNs();
+        for (uint32 i = 0; i < batch; i++)
+        {
+            latency[n + i] = t1 - t0;
+        }
+
+        if (g_completions < target)
+        {
+            lost += target - g_completions;
+            g_completions = target;
+        }
+    }
+
+    uint64 elapsed = Bench_nowNs() - start;
+    const HostNetif_Stats *net = HostNetif_getStats();
+    const HostUart_Stats *uart = HostUart_getStats();
+    const Ifx_Lwip_RxStats *rx = Ifx_Lwip_getRxStats();
+
+    qsort(latency, requests, sizeof(uint64), Bench_compare);
+
+    double seconds = (double)elapsed / 1e9;
+    printf("DoIP benchmark: %u requests (%u-request mix, depth %u, rx budget %u)\n",
+           requests, mixCount, depth, (unsigned)g_Lwip.rxBudget);
+    printf("  throughput        : %.1f msg/s\n", requests / seconds);
+    printf("  latency p50       : %.2f us\n", latency[(requests * 50U) / 100U] / 1e3);
+    printf("  latency p99       : %.2f us\n", latency[(requests * 99U) / 100U] / 1e3);
+    printf("  loop passes/msg   : %.2f\n", (double)steps / requests);
+    printf("  bytes copied/msg  : %.1f (netif %.1f, lwIP %.1f)\n",
+           (double)(net->netifCopyBytes + net->lwipCopyBytes) / requests,
+           (double)net->netifCopyBytes / requests, (double)net->lwipCopyBytes / requests);
+    printf("  frames/msg        : %.2f rx, %.2f tx\n",
+           (double)net->framesToGateway / requests, (double)net->framesFromGateway / requests);
+    printf("  rx frames/poll    : %.2f (max %u, budget hits %u, ring high-water %u)\n",
+           rx->polls ? (double)rx->frames / rx->polls : 0.0, rx->maxFramesPerPoll,
+           rx->budgetHits, rx->ringHighWater);
+    for (uint8 queue = 0; queue < IFX_NETIF_QUEUES; queue++)
+    {
+        printf("  queue %u %-11s: rx %u (weight %u, hits %u), tx %u\n", queue,
+               (queue == IFX_NETIF_QUEUE_DIAG) ? "diag" : "best effort",
+               rx->queueFrames[queue], (unsigned)g_Lwip.rxWeight[queue], rx->weightHits[queue],
+               net->txQueueFrames[queue]);
+    }
+    printf("  uart bytes/msg    : %.1f (%.1f calls, %llu dropped)\n",
+           (double)uart->bytes / requests, (double)uart->calls / requests,
+           (unsigned long long)uart->dropped);
+    printf("  vci reports       : %u\n", g_reportsSeen);
+    printf("  generic nacks     : %u\n", g_nacksSeen);
+    printf("  uds transactions  : high-water %u of %u, exhausted %u\n",
+           UDS_Transaction_GetStats()->high_water, UDS_TRANSACTION_POOL_SIZE, UDS_Transaction_GetStats()->exhausted);
+    printf("  net timers fired  : %u (%.1f/s)\n", Timer_Wheel_getStats(&g_Timer_net)->fired - timersFired,
+           (Timer_Wheel_getStats(&g_Timer_net)->fired - timersFired) / seconds);
+    Bench_printTasks(&g_Sched_net);
+    Bench_printTasks(&g_Sched_app);
+    printf("  dropped frames    : %u\n", net->drops);
+    printf("  lost requests     : %u\n", lost);
+
+    free(latency);
+    return (lost == 0) ? 0 : 1;
+}
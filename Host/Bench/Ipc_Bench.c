@@ -0,0 +1,353 @@
+/**
+ * @file Ipc_Bench.c
+ * @brief Inter-core queue throughput and latency benchmark for the host build
+ * @details Runs Ipc_Queue between threads standing in for a pair of cores.
+ *          The stream phase sends from one producer (SPSC) or several (MPSC,
+ *          -p) to one consumer as fast as the queue takes it; every message
+ *          carries its producer, a sequence number and the STM0 tick of its
+ *          commit, and the consumer checks that each producer's messages
+ *          arrive complete and in order. The ping-pong phase then bounces one
+ *          message between two SPSC queues and reports the round trip, the
+ *          latency of a core pair without queueing.
+ *
+ *          Usage: zgw_ipc_bench [-n messages] [-p producers] [-m] [-q slots] [-s size] [-r rounds] [-a]
+ *            -n  messages per producer (default 1000000)
+ *            -p  producer threads (default 1, more than one implies -m)
+ *            -m  MPSC queue even with one producer
+ *            -q  queue slots, a power of two (default 64)
+ *            -s  message size in bytes, at least 12 (default 16)
+ *            -r  ping-pong round trips (default 100000, 0 to skip)
+ *            -a  pin the consumer to host CPU 0 and producer n to CPU n
+ */
+
+#define _GNU_SOURCE
+
+#include "Ipc_Queue.h"
+#include "IfxStm.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_MESSAGES      1000000U
+#define BENCH_DEFAULT_SLOTS         64U
+#define BENCH_DEFAULT_SIZE          16U
+#define BENCH_DEFAULT_ROUNDS        100000U
+#define BENCH_MAX_PRODUCERS         8U
+#define BENCH_HEADER_SIZE           12U         /* producer, sequence, commit tick */
+#define BENCH_TICKS_PER_US          100.0       /* Host STM0 runs at 100 MHz */
+
+typedef struct
+{
+    uint32 producer;
+    uint32 sequence;
+    uint32 stamp;                               /* IfxStm_getLower() at commit */
+} Bench_Header;
+
+typedef struct
+{
+    pthread_t thread;
+    uint32    index;
+    uint32    retries;                          /* Reserves that found the queue full */
+} Bench_Producer;
+
+static Ipc_Queue g_queue;
+static Ipc_Queue g_ping;
+static Ipc_Queue g_pong;
+static uint32   *g_storage;
+static uint32    g_messages = BENCH_DEFAULT_MESSAGES;
+static uint32    g_size = BENCH_DEFAULT_SIZE;
+static uint32    g_rounds = BENCH_DEFAULT_ROUNDS;
+static boolean   g_pin = FALSE;
+static volatile uint32 g_go = 0;
+
+static uint64 Bench_nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000ULL + (uint64)ts.tv_nsec;
+}
+
+static int Bench_compare(const void *a, const void *b)
+{
+    uint32 x = *(const uint32 *)a;
+    uint32 y = *(const uint32 *)b;
+    return (x > y) - (x < y);
+}
+
+/* Bind the calling thread to one host CPU, the stand-in for a TriCore core */
+static void Bench_pin(uint32 cpu)
+{
+    cpu_set_t set;
+
+    if (!g_pin)
+    {
+        return;
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    {
+        fprintf(stderr, "cannot pin a thread to CPU %u, left unpinned\n", cpu);
+    }
+}
+
+static void *Bench_produce(void *arg)
+{
+    Bench_Producer *self = (Bench_Producer *)arg;
+    uint32 i;
+
+    Bench_pin(1 + self->index);
+
+    while (g_go == 0)
+    {
+        sched_yield();
+    }
+
+    for (i = 0; i < g_messages; i++)
+    {
+        uint8 *message;
+
+        while ((message = (uint8 *)Ipc_Queue_reserve(&g_queue)) == NULL_PTR)
+        {
+            self->retries++;
+            sched_yield();
+        }
+
+        Bench_Header header = {self->index, i, IfxStm_getLower(&MODULE_STM0)};
+        memcpy(message, &header, sizeof(header));
+        memset(&message[BENCH_HEADER_SIZE], (int)(uint8)i, g_size - BENCH_HEADER_SIZE);
+        Ipc_Queue_commit(&g_queue, message);
+    }
+
+    return NULL;
+}
+
+/* The far side of the ping-pong: sends every ping straight back */
+static void *Bench_echo(void *arg)
+{
+    uint32 i;
+
+    (void)arg;
+    Bench_pin(1);
+
+    for (i = 0; i < g_rounds; i++)
+    {
+        uint32 *ping;
+
+        while ((ping = (uint32 *)Ipc_Queue_peek(&g_ping)) == NULL_PTR)
+        {
+            sched_yield();
+        }
+
+        uint32 value = *ping;
+        Ipc_Queue_release(&g_ping);
+
+        while (!Ipc_Queue_push(&g_pong, &value, sizeof(value)))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static uint32 Bench_pingPong(void)
+{
+    static uint32 pingStorage[IPC_QUEUE_WORDS(2, sizeof(uint32))];
+    static uint32 pongStorage[IPC_QUEUE_WORDS(2, sizeof(uint32))];
+    pthread_t echo;
+    uint32 *rtt = malloc(sizeof(uint32) * g_rounds);
+    uint32 bad = 0;
+    uint32 i;
+
+    if ((rtt == NULL) || (g_rounds == 0))
+    {
+        free(rtt);
+        return 0;
+    }
+
+    Ipc_Queue_init(&g_ping, pingStorage, 2, sizeof(uint32), IPC_QUEUE_SPSC);
+    Ipc_Queue_init(&g_pong, pongStorage, 2, sizeof(uint32), IPC_QUEUE_SPSC);
+    pthread_create(&echo, NULL, Bench_echo, NULL);
+
+    for (i = 0; i < g_rounds; i++)
+    {
+        uint32 start = IfxStm_getLower(&MODULE_STM0);
+        uint32 *pong;
+
+        Ipc_Queue_push(&g_ping, &i, sizeof(i));
+
+        while ((pong = (uint32 *)Ipc_Queue_peek(&g_pong)) == NULL_PTR)
+        {
+            sched_yield();
+        }
+
+        bad += (*pong != i) ? 1U : 0U;
+        Ipc_Queue_release(&g_pong);
+        rtt[i] = IfxStm_getLower(&MODULE_STM0) - start;
+    }
+
+    pthread_join(echo, NULL);
+    qsort(rtt, g_rounds, sizeof(uint32), Bench_compare);
+
+    printf("  round trip p50    : %.2f us\n", rtt[(g_rounds * 50U) / 100U] / BENCH_TICKS_PER_US);
+    printf("  round trip p99    : %.2f us\n", rtt[(g_rounds * 99U) / 100U] / BENCH_TICKS_PER_US);
+
+    free(rtt);
+    return bad;
+}
+
+int main(int argc, char **argv)
+{
+    Bench_Producer producer[BENCH_MAX_PRODUCERS];
+    uint32 expected[BENCH_MAX_PRODUCERS] = {0};
+    uint32 producers = 1;
+    uint32 slots = BENCH_DEFAULT_SLOTS;
+    Ipc_QueueMode mode = IPC_QUEUE_SPSC;
+    uint32 errors = 0;
+    uint32 retries = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && (i + 1) < argc)
+        {
+            g_messages = (uint32)strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && (i + 1) < argc)
+        {
+            producers = (uint32)strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-m") == 0)
+        {
+            mode = IPC_QUEUE_MPSC;
+        }
+        else if (strcmp(argv[i], "-q") == 0 && (i + 1) < argc)
+        {
+            slots = (uint32)strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && (i + 1) < argc)
+        {
+            g_size = (uint32)strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && (i + 1) < argc)
+        {
+            g_rounds = (uint32)strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "-a") == 0)
+        {
+            g_pin = TRUE;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n messages] [-p producers] [-m] [-q slots] [-s size] [-r rounds] [-a]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    if ((producers == 0) || (producers > BENCH_MAX_PRODUCERS) || (g_messages == 0) || (slots < 2) ||
+        ((slots & (slots - 1)) != 0) || (g_size < BENCH_HEADER_SIZE))
+    {
+        fprintf(stderr, "1..%u producers, a power of two of at least 2 slots and %u or more bytes per message\n",
+                BENCH_MAX_PRODUCERS, BENCH_HEADER_SIZE);
+        return 2;
+    }
+
+    if (producers > 1)
+    {
+        mode = IPC_QUEUE_MPSC;
+    }
+
+    uint64 total = (uint64)g_messages * producers;
+    uint32 *latency = malloc(sizeof(uint32) * total);
+    g_storage = malloc(sizeof(uint32) * IPC_QUEUE_WORDS(slots, g_size));
+    if ((latency == NULL) || (g_storage == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    /* the host STM0 starts counting on its first read: before any thread may race on it */
+    (void)IfxStm_get(&MODULE_STM0);
+    Ipc_Queue_init(&g_queue, g_storage, slots, g_size, mode);
+    Bench_pin(0);
+
+    for (uint32 p = 0; p < producers; p++)
+    {
+        producer[p].index = p;
+        producer[p].retries = 0;
+        pthread_create(&producer[p].thread, NULL, Bench_produce, &producer[p]);
+    }
+
+    uint64 start = Bench_nowNs();
+    g_go = 1;
+
+    for (uint64 received = 0; received < total; received++)
+    {
+        const uint8 *message;
+        Bench_Header header;
+
+        while ((message = (const uint8 *)Ipc_Queue_peek(&g_queue)) == NULL_PTR)
+        {
+            sched_yield();
+        }
+
+        latency[received] = IfxStm_getLower(&MODULE_STM0);
+        memcpy(&header, message, sizeof(header));
+        latency[received] -= header.stamp;
+
+        /* each producer's messages in order, none torn */
+        if ((header.producer >= producers) || (header.sequence != expected[header.producer]) ||
+            (message[g_size - 1] != (uint8)header.sequence))
+        {
+            errors++;
+        }
+
+        if (header.producer < producers)
+        {
+            expected[header.producer] = header.sequence + 1;
+        }
+
+        Ipc_Queue_release(&g_queue);
+    }
+
+    uint64 elapsed = Bench_nowNs() - start;
+
+    for (uint32 p = 0; p < producers; p++)
+    {
+        pthread_join(producer[p].thread, NULL);
+        retries += producer[p].retries;
+    }
+
+    qsort(latency, total, sizeof(uint32), Bench_compare);
+
+    double seconds = (double)elapsed / 1e9;
+    printf("Ipc queue benchmark: %llu messages (%s, %u producer%s, %u slots of %u bytes)\n",
+           (unsigned long long)total, (mode == IPC_QUEUE_MPSC) ? "MPSC" : "SPSC", producers,
+           (producers == 1) ? "" : "s", slots, g_size);
+    printf("  throughput        : %.1f msg/s (%.1f MB/s)\n", total / seconds, (total * g_size) / seconds / 1e6);
+    printf("  latency p50       : %.2f us (commit to peek, queueing included)\n",
+           latency[(total * 50U) / 100U] / BENCH_TICKS_PER_US);
+    printf("  latency p99       : %.2f us\n", latency[(total * 99U) / 100U] / BENCH_TICKS_PER_US);
+    printf("  queue full        : %u reserves (%u retried by the producers)\n", g_queue.full, retries);
+    printf("  max depth         : %u of %u\n", g_queue.maxDepth, slots);
+
+    errors += Bench_pingPong();
+
+    if (errors == 0)
+    {
+        printf("  verify            : OK\n");
+    }
+    else
+    {
+        printf("  verify            : %u messages lost, torn or out of order\n", errors);
+    }
+
+    free(latency);
+    free(g_storage);
+    return (errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,265 @@
+/**
+ * @file HostFlash4.c
+ * @brief Host replacement for Flash4_Driver.c (S25FL512S on QSPI2)
+ * @details A 64 MB array with the device's timing in STM time: page program
+ *          takes HOST_FLASH4_PROGRAM_US, a sector erase HOST_FLASH4_ERASE_MS
+ *          of running time, and WIP stays set for HOST_FLASH4_SUSPEND_US
+ *          after an erase suspend. Like the device, commands other than
+ *          status reads and suspend are ignored while WIP is set, and a
+ *          program into the sector of a suspended erase sets P_ERR.
+ *          Flash4_ReadStart() keeps the SPI busy for the clock time of the
+ *          frame at FLASH4_BAUDRATE.
+ */
+
+#include "HostFlash4.h"
+#include "IfxStm.h"
+#include <string.h>
+
+#define HOST_FLASH4_PROGRAM_US      340     /* tPP typical, 512-byte page */
+#define HOST_FLASH4_ERASE_MS        520     /* tSE typical, 256 KB sector */
+#define HOST_FLASH4_SUSPEND_US      45      /* tSL maximum */
+
+/* Stored inverted so that the zero-filled array reads as erased (0xFF) */
+static uint8            g_array[FLASH4_DEVICE_SIZE];
+static HostFlash4_Stats g_flashStats;
+static uint8            g_status1;
+static boolean          g_writeEnabled;
+static uint64           g_busyUntil;        /* Program or suspend latency: WIP until this tick */
+static boolean          g_eraseActive;      /* Erase started and not completed */
+static boolean          g_eraseSuspended;
+static uint32           g_eraseSector;
+static uint64           g_eraseLeft;        /* Running ticks the erase still needs */
+static uint64           g_eraseResumed;     /* Tick the erase last (re)started */
+static uint64           g_spiBusyUntil;     /* Non-blocking read still clocking until this tick */
+
+static uint64 HostFlash4_now(void)
+{
+    return IfxStm_get(&MODULE_STM0);
+}
+
+/* Complete the erase if it has run long enough */
+static void HostFlash4_update(void)
+{
+    uint64 now = HostFlash4_now();
+
+    if (g_eraseActive && !g_eraseSuspended && (now - g_eraseResumed) >= g_eraseLeft)
+    {
+        memset(&g_array[g_eraseSector], 0, FLASH4_SECTOR_SIZE);
+        g_eraseActive = FALSE;
+        g_flashStats.sectorErases++;
+    }
+}
+
+static boolean HostFlash4_busy(void)
+{
+    HostFlash4_update();
+    return (HostFlash4_now() < g_busyUntil) || (g_eraseActive && !g_eraseSuspended);
+}
+
+/* Program and erase need WREN and an idle device; WEL is consumed either way */
+static boolean HostFlash4_accept(void)
+{
+    boolean accepted = g_writeEnabled && !HostFlash4_busy();
+
+    g_writeEnabled = FALSE;
+    if (!accepted)
+    {
+        g_flashStats.rejected++;
+    }
+    return accepted;
+}
+
+void Flash4_Init(void)
+{
+    memset(&g_flashStats, 0, sizeof(g_flashStats));
+    g_status1 = 0;
+    g_writeEnabled = FALSE;
+    g_busyUntil = 0;
+    g_eraseActive = FALSE;
+    g_eraseSuspended = FALSE;
+    g_spiBusyUntil = 0;
+}
+
+void Flash4_WriteCommand(uint8 cmd)
+{
+    uint64 now = HostFlash4_now();
+
+    switch (cmd)
+    {
+        case FLASH4_CMD_WRITE_ENABLE_WREN:
+            g_writeEnabled = TRUE;
+            break;
+        case FLASH4_CMD_WRITE_DISABLE_WRDI:
+            g_writeEnabled = FALSE;
+            break;
+        case FLASH4_CMD_CLEAR_STATUS_REG:
+            g_status1 = 0;
+            break;
+        case FLASH4_CMD_ERASE_SUSPEND:
+            HostFlash4_update();
+            if (g_eraseActive && !g_eraseSuspended)
+            {
+                uint64 ran = now - g_eraseResumed;
+                g_eraseLeft -= ran;
+                g_eraseSuspended = TRUE;
+                g_busyUntil = now + IfxStm_getTicksFromMicroseconds(&MODULE_STM0, HOST_FLASH4_SUSPEND_US);
+                g_flashStats.suspends++;
+            }
+            break;
+        case FLASH4_CMD_ERASE_RESUME:
+            if (g_eraseActive && g_eraseSuspended && now >= g_busyUntil)
+            {
+                g_eraseSuspended = FALSE;
+                g_eraseResumed = now;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Flash4_WriteEnable(void)
+{
+    Flash4_WriteCommand(FLASH4_CMD_WRITE_ENABLE_WREN);
+}
+
+void Flash4_ReadManufacturerId(uint8 *deviceId)
+{
+    deviceId[0] = FLASH4_MANUFACTURER_ID;
+    deviceId[1] = FLASH4_DEVICE_ID_MSB;
+    deviceId[2] = FLASH4_DEVICE_ID_LSB;
+}
+
+void Flash4_ReadFlash4(uint32 address, uint8 *outData, uint16 nData)
+{
+    for (uint16 i = 0; i < nData; i++)
+    {
+        outData[i] = (uint8)~g_array[(address + i) % FLASH4_DEVICE_SIZE];
+    }
+}
+
+void Flash4_ReadStart(uint32 address, uint8 *frame, uint16 length)
+{
+    uint64 bits = (uint64)(FLASH4_READ_HEADER_SIZE + length) * 8U;
+
+    Flash4_ReadFlash4(address, &frame[FLASH4_READ_HEADER_SIZE], length);
+    g_spiBusyUntil = HostFlash4_now() + (bits * HOST_STM_TICKS_PER_MS * 1000U) / FLASH4_BAUDRATE;
+    g_flashStats.readBytes += length;
+}
+
+boolean Flash4_ReadBusy(void)
+{
+    return (HostFlash4_now() < g_spiBusyUntil) ? TRUE : FALSE;
+}
+
+void Flash4_PageProgramStart(uint32 address, uint8 *frame, uint16 length)
+{
+    /* Like the driver, the command sequence starts with WREN */
+    Flash4_WriteEnable();
+
+    if (!HostFlash4_accept())
+    {
+        return;
+    }
+
+    if (g_eraseActive && (address / FLASH4_SECTOR_SIZE) == (g_eraseSector / FLASH4_SECTOR_SIZE))
+    {
+        g_status1 |= FLASH4_SR1_P_ERR;
+        return;
+    }
+
+    /* Within one page the address wraps, as on the device; bits only go from 1 to 0 */
+    uint32 page = address & ~(uint32)(FLASH4_MAX_PAGE_SIZE - 1);
+    for (uint16 i = 0; i < length; i++)
+    {
+        uint32 at = page + ((address + i) & (FLASH4_MAX_PAGE_SIZE - 1));
+        g_array[at] |= (uint8)~frame[FLASH4_PROGRAM_HEADER_SIZE + i];
+    }
+
+    g_busyUntil = HostFlash4_now() + IfxStm_getTicksFromMicroseconds(&MODULE_STM0, HOST_FLASH4_PROGRAM_US);
+    g_flashStats.pagePrograms++;
+}
+
+void Flash4_PageProgram(uint32 address, const uint8 *data, uint16 length)
+{
+    uint8 frame[FLASH4_PROGRAM_HEADER_SIZE + FLASH4_MAX_PAGE_SIZE];
+    uint16 offset = 0;
+
+    while (offset < length)
+    {
+        uint16 chunk = (length - offset) > FLASH4_MAX_PAGE_SIZE ? FLASH4_MAX_PAGE_SIZE : (length - offset);
+
+        memcpy(&frame[FLASH4_PROGRAM_HEADER_SIZE], &data[offset], chunk);
+        Flash4_PageProgramStart(address + offset, frame, chunk);
+        Flash4_WaitReady(FLASH4_PAGE_PROGRAM_TIMEOUT_MS);
+        offset += chunk;
+    }
+}
+
+void Flash4_SectorErase(uint32 address)
+{
+    Flash4_WriteEnable();
+
+    if (!HostFlash4_accept() || g_eraseActive)
+    {
+        return;
+    }
+
+    g_eraseActive = TRUE;
+    g_eraseSuspended = FALSE;
+    g_eraseSector = (address % FLASH4_DEVICE_SIZE) & ~(FLASH4_SECTOR_SIZE - 1);
+    g_eraseLeft = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, HOST_FLASH4_ERASE_MS);
+    g_eraseResumed = HostFlash4_now();
+}
+
+void Flash4_EraseSuspend(void)
+{
+    Flash4_WriteCommand(FLASH4_CMD_ERASE_SUSPEND);
+}
+
+void Flash4_EraseResume(void)
+{
+    Flash4_WriteCommand(FLASH4_CMD_ERASE_RESUME);
+}
+
+void Flash4_ClearStatus(void)
+{
+    Flash4_WriteCommand(FLASH4_CMD_CLEAR_STATUS_REG);
+}
+
+uint8 Flash4_ReadStatusReg(void)
+{
+    return (uint8)(g_status1 | (HostFlash4_busy() ? FLASH4_SR1_WIP : 0));
+}
+
+uint8 Flash4_ReadStatusReg2(void)
+{
+    HostFlash4_update();
+    return (g_eraseActive && g_eraseSuspended) ? FLASH4_SR2_ES : 0;
+}
+
+boolean Flash4_CheckWIP(void)
+{
+    return HostFlash4_busy();
+}
+
+uint8 Flash4_WaitReady(uint32 timeoutMs)
+{
+    uint64 start = HostFlash4_now();
+    uint64 timeoutTicks = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, timeoutMs);
+
+    while (HostFlash4_busy())
+    {
+        if ((HostFlash4_now() - start) > timeoutTicks)
+        {
+            return FLASH4_TIMEOUT;
+        }
+    }
+
+    return FLASH4_OK;
+}
+
+const HostFlash4_Stats *HostFlash4_getStats(void)
+{
+    return &g_flashStats;
+}
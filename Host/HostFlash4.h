@@ -0,0 +1,23 @@
+/**
+ * @file HostFlash4.h
+ * @brief Host Flash4 model - statistics
+ */
+
+#ifndef HOST_FLASH4_H
+#define HOST_FLASH4_H
+
+#include "Ifx_Types.h"
+#include "Flash4_Driver.h"
+
+typedef struct
+{
+    uint32 pagePrograms;    /* Page program commands executed */
+    uint32 sectorErases;    /* Sector erases completed */
+    uint32 suspends;        /* Erase suspends */
+    uint32 rejected;        /* Commands ignored: device busy or write not enabled */
+    uint32 readBytes;       /* Bytes read with Flash4_ReadStart() */
+} HostFlash4_Stats;
+
+const HostFlash4_Stats *HostFlash4_getStats(void);
+
+#endif /* HOST_FLASH4_H */
@@ -0,0 +1,128 @@
+/**
+ * @file HostGateway.c
+ * @brief Host build of the Zonal Gateway application
+ * @details Hardware-free counterpart of SystemInit.c: no watchdog, STM
+ *          compare or PHY bring-up, and Flash4 is the model in HostFlash4.c.
+ */
+
+#include "HostGateway.h"
+#include "Ifx_Lwip.h"
+#include "IfxCpu.h"
+#include "Ipc_Mailbox.h"
+#include "AppConfig.h"
+#include "Configuration.h"
+#include "SystemInit.h"
+#include "SystemMain.h"
+#include "UART_Logging.h"
+#include "Libraries/DoIP/doip_client.h"
+#include "Libraries/DoIP/doip_router.h"
+#include "Libraries/DoIP/doip_server.h"
+#include "Libraries/DoIP/uds_handler.h"
+#include "Timer_Wheel.h"
+#include "vci_manager.h"
+#include "TcpEchoServer.h"
+#include "UdpEchoServer.h"
+#include <string.h>
+
+extern DoIP_VCI_Info g_zgw_vci;
+extern DoIP_VCI_Info g_vci_database[MAX_ZONE_ECUS + 1];
+extern DoIP_HealthStatus_Info g_health_data[MAX_ZONE_ECUS + 1];
+
+uint32 g_HostCpu_coreIndex;
+
+static void Init_Ethernet(void)
+{
+    eth_addr_t ethAddr;
+    ethAddr.addr[0] = ETH_MAC_ADDR_0;
+    ethAddr.addr[1] = ETH_MAC_ADDR_1;
+    ethAddr.addr[2] = ETH_MAC_ADDR_2;
+    ethAddr.addr[3] = ETH_MAC_ADDR_3;
+    ethAddr.addr[4] = ETH_MAC_ADDR_4;
+    ethAddr.addr[5] = ETH_MAC_ADDR_5;
+
+    Ifx_Lwip_init(ethAddr);
+}
+
+static void Init_DoIP(void)
+{
+    DoIP_ClientConfig doip_config;
+    IP4_ADDR(&doip_config.vmg_ip, VMG_IP_ADDR_0, VMG_IP_ADDR_1, VMG_IP_ADDR_2, VMG_IP_ADDR_3);
+    doip_config.vmg_port = VMG_PORT;
+    doip_config.source_address = DOIP_ZONAL_GW_ADDRESS;
+    DoIP_Client_Init(&doip_config);
+    DoIP_Server_Init(DOIP_ZONAL_GW_ADDRESS);
+    DoIP_Router_Init();
+}
+
+static void Init_VCI(void)
+{
+    memcpy(g_zgw_vci.ecu_id, ZGW_ECU_ID, sizeof(ZGW_ECU_ID));
+    memcpy(g_zgw_vci.sw_version, ZGW_SW_VERSION, sizeof(ZGW_SW_VERSION));
+    memcpy(g_zgw_vci.hw_version, ZGW_HW_VERSION, sizeof(ZGW_HW_VERSION));
+    memcpy(g_zgw_vci.serial_num, ZGW_SERIAL_NUM, sizeof(ZGW_SERIAL_NUM));
+    memcpy(&g_vci_database[0], &g_zgw_vci, sizeof(DoIP_VCI_Info));
+    VCI_Init();
+}
+
+static void Init_Health_Database(void)
+{
+    memcpy(g_health_data[0].ecu_id, ZONE_ECU_ID, sizeof(ZONE_ECU_ID));
+    g_health_data[0].health_status = HEALTH_STATUS_OK;
+    g_health_data[0].battery_voltage = 1302;
+    g_health_data[0].temperature = 65;
+
+    memcpy(g_health_data[1].ecu_id, ZGW_ECU_ID, sizeof(ZGW_ECU_ID));
+    g_health_data[1].health_status = HEALTH_STATUS_OK;
+    g_health_data[1].battery_voltage = 1320;
+    g_health_data[1].temperature = 68;
+}
+
+/* Host counterpart of SystemInit.c, also satisfies core0_main() in Cpu0_Main.c: one thread brings up every core */
+void SystemInit_Core(void)
+{
+    initUART();
+    Ipc_Mailbox_init();
+
+    g_HostCpu_coreIndex = CPU_WHICH_SERVICE_ETHERNET;
+    Timer_Wheel_init(&g_Timer_net, NULL_PTR);
+    SystemMain_InitNet(NULL_PTR);
+    Init_Ethernet();
+
+    tcp_echo_server_init();
+    udp_echo_server_init();
+
+    Init_DoIP();
+
+    g_HostCpu_coreIndex = CPU_WHICH_SERVICE_APP;
+    Timer_Wheel_init(&g_Timer_app, NULL_PTR);
+    SystemMain_InitApp(NULL_PTR);
+    UDS_Init();
+    Init_VCI();
+    Init_Health_Database();
+}
+
+void HostGateway_init(void)
+{
+    SystemInit_Core();
+}
+
+/* Posts the timer task of a wheel that is due, as the STM compare interrupt does on target */
+static void HostGateway_tick(Timer_Wheel *wheel)
+{
+    if (Timer_Wheel_isDue(wheel))
+    {
+        Sched_signal(&wheel->expired);
+    }
+}
+
+/* The tasks ready on the Ethernet core and on the application core, each run once, back to back */
+void HostGateway_step(void)
+{
+    g_HostCpu_coreIndex = CPU_WHICH_SERVICE_ETHERNET;
+    HostGateway_tick(&g_Timer_net);
+    SystemMain_NetStep();
+
+    g_HostCpu_coreIndex = CPU_WHICH_SERVICE_APP;
+    HostGateway_tick(&g_Timer_app);
+    SystemMain_AppStep();
+}
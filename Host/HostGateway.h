@@ -0,0 +1,23 @@
+/**
+ * @file HostGateway.h
+ * @brief Host build of the Zonal Gateway application
+ */
+
+#ifndef HOST_GATEWAY_H
+#define HOST_GATEWAY_H
+
+#include "Ifx_Types.h"
+
+/**
+ * @brief Bring up lwIP on the in-memory netif and initialize DoIP, UDS, VCI
+ *        and health data the same way SystemInit_Core() does on target
+ */
+void HostGateway_init(void);
+
+/**
+ * @brief Run one iteration of the Ethernet core loop, then one of the
+ *        application core's
+ */
+void HostGateway_step(void);
+
+#endif /* HOST_GATEWAY_H */
@@ -0,0 +1,210 @@
+/**
+ * @file HostLwip.c
+ * @brief Host replacement for the lwIP port (Ifx_Lwip.c and lwip_isr.c)
+ * @details lwIP's timeouts follow the Ethernet core's timer wheel as on the
+ *          target. There is no STM interrupt: the wheel is only polled, and
+ *          the link check is left out since the in-memory wire is always up.
+ */
+
+#include "Ifx_Lwip.h"
+#include "Ifx_Netif.h"
+#include "IfxStm.h"
+#include "Timer_Wheel.h"
+#include "lwip/timeouts.h"
+#include "UART_Log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+Ifx_Lwip        g_Lwip;
+IfxGeth_Eth     g_IfxGeth;
+
+static Timer_Entry g_timeoutsTimer;
+static uint32      g_timeoutsDeadline;
+
+static void Ifx_Lwip_onTimeoutsTimer(void *arg)
+{
+    (void)arg;
+    sys_check_timeouts();
+    Ifx_Lwip_pollTimeouts();
+}
+
+/* Only the head of lwIP's timeout list is on the wheel, as on the target */
+void Ifx_Lwip_pollTimeouts(void)
+{
+    u32_t sleepMs = sys_timeouts_sleeptime();
+
+    if (sleepMs == SYS_TIMEOUTS_SLEEPTIME_INFINITE)
+    {
+        Timer_stop(&g_timeoutsTimer);
+        return;
+    }
+
+    if (!Timer_isRunning(&g_timeoutsTimer) || (g_timeoutsDeadline != (sys_now() + sleepMs)))
+    {
+        g_timeoutsDeadline = sys_now() + sleepMs;
+        Timer_start(&g_Timer_net, &g_timeoutsTimer, sleepMs, 0);
+    }
+}
+
+/* Same RX budget and per-queue weight scheme as the target; rxPending is raised by the wire */
+void Ifx_Lwip_pollReceiveFlags(void)
+{
+    Ifx_Lwip *lwip = &g_Lwip;
+    uint32    pending;
+    uint32    available = 0;
+    uint32    frames    = 0;
+    uint32    queueFrames;
+    boolean   left      = FALSE;
+    uint8     queue;
+
+    pending         = lwip->rxPending;
+    lwip->rxPending = 0;
+
+    if (pending != 0)
+    {
+        for (queue = 0; queue < IFX_NETIF_QUEUES; queue++)
+        {
+            available += ifx_netif_rxAvailable(&lwip->netif, queue);
+        }
+
+        if (available > lwip->rxStats.ringHighWater)
+        {
+            lwip->rxStats.ringHighWater = (uint16)available;
+        }
+
+        for (queue = 0; queue < IFX_NETIF_QUEUES; queue++)
+        {
+            queueFrames = 0;
+
+            while ((queueFrames < lwip->rxWeight[queue]) && (frames < lwip->rxBudget)
+                   && (ifx_netif_rxAvailable(&lwip->netif, queue) != 0))
+            {
+                ifx_netif_input(&lwip->netif, queue);
+                queueFrames++;
+                frames++;
+            }
+
+            lwip->rxStats.queueFrames[queue] += queueFrames;
+
+            if (ifx_netif_rxAvailable(&lwip->netif, queue) != 0)
+            {
+                if (queueFrames >= lwip->rxWeight[queue])
+                {
+                    lwip->rxStats.weightHits[queue]++;
+                }
+
+                left = TRUE;
+            }
+        }
+
+        lwip->rxStats.polls++;
+        lwip->rxStats.frames += frames;
+
+        if (frames > lwip->rxStats.maxFramesPerPoll)
+        {
+            lwip->rxStats.maxFramesPerPoll = (uint16)frames;
+        }
+
+        if (left != FALSE)
+        {
+            if (frames >= lwip->rxBudget)
+            {
+                lwip->rxStats.budgetHits++;
+            }
+
+            lwip->rxPending++;
+        }
+    }
+
+    ifx_netif_txRelease(&lwip->netif);
+}
+
+void Ifx_Lwip_setRxBudget(uint16 budget)
+{
+    g_Lwip.rxBudget = (budget != 0) ? budget : 1;
+}
+
+void Ifx_Lwip_setRxWeight(uint8 queue, uint16 weight)
+{
+    if (queue < IFX_NETIF_QUEUES)
+    {
+        g_Lwip.rxWeight[queue] = (weight != 0) ? weight : 1;
+    }
+}
+
+const Ifx_Lwip_RxStats *Ifx_Lwip_getRxStats(void)
+{
+    g_Lwip.rxStats.drops = ifx_netif_rxDrops(&g_Lwip.netif);
+    return &g_Lwip.rxStats;
+}
+
+void Ifx_Lwip_resetRxStats(void)
+{
+    memset(&g_Lwip.rxStats, 0, sizeof(g_Lwip.rxStats));
+}
+
+void Ifx_Lwip_init(eth_addr_t ethAddr)
+{
+    ip_addr_t default_ipaddr, default_netmask, default_gw;
+    IP4_ADDR(&default_ipaddr, 192,168,1,10);
+    IP4_ADDR(&default_netmask, 255,255,255,0);
+    IP4_ADDR(&default_gw, 192,168,1,1);
+
+    lwip_init();
+
+    Timer_init(&g_timeoutsTimer, Ifx_Lwip_onTimeoutsTimer, NULL_PTR);
+    Ifx_Lwip_pollTimeouts();
+
+    g_Lwip.rxBudget  = IFX_LWIP_RX_BUDGET;
+    g_Lwip.rxPending = 1;
+    Sched_signal(&g_Lwip.event);
+    g_Lwip.rxWeight[IFX_NETIF_QUEUE_DIAG] = IFX_NETIF_DIAG_WEIGHT;
+#if IFX_NETIF_QUEUES > 1
+    g_Lwip.rxWeight[IFX_NETIF_QUEUE_BEST_EFFORT] = IFX_NETIF_BE_WEIGHT;
+#endif
+
+    g_Lwip.eth_addr = ethAddr;
+    netif_add(&g_Lwip.netif, &default_ipaddr, &default_netmask, &default_gw,
+        (void *)0, ifx_netif_init, ethernet_input);
+    netif_set_default(&g_Lwip.netif);
+    netif_set_up(&g_Lwip.netif);
+
+#if LWIP_NETIF_HOSTNAME
+    g_Lwip.netif.hostname = BOARDNAME;
+#endif
+}
+
+u32_t sys_now(void)
+{
+    return Timer_nowMs();
+}
+
+#define MAXCHARS 256
+
+s8_t Ifx_Lwip_printf(const char *format, ...)
+{
+    char    str[MAXCHARS + 4];
+    va_list args;
+
+    if (!LOG_ENABLED(NETIF, INFO))
+    {
+        return ERR_CONN;
+    }
+
+    va_start(args, format);
+    int cnt = vsnprintf(str, MAXCHARS, format, args);
+    va_end(args);
+
+    if (cnt > MAXCHARS - 1)
+    {
+        cnt = MAXCHARS - 1;
+    }
+    if (cnt > 0)
+    {
+        sendUARTMessage(str, cnt);
+        sendUARTMessage("\r\n", 2);
+    }
+
+    return ERR_CONN;
+}
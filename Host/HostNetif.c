@@ -0,0 +1,621 @@
+/**
+ * @file HostNetif.c
+ * @brief In-memory Ethernet wire for the host build
+ */
+
+#include "HostNetif.h"
+#include "Ifx_Lwip.h"
+#include "Ifx_Netif.h"
+#include "lwip/etharp.h"
+#include "netif/ethernet.h"
+#include <string.h>
+
+#define IFNAME0 'e'
+#define IFNAME1 'n'
+
+#define HOST_NETIF_FRAME_SIZE       (1536 + ETH_PAD_SIZE)
+
+typedef struct
+{
+    uint8  data[HOST_NETIF_FRAME_SIZE];
+    uint16 len;
+} HostNetif_Frame;
+
+typedef struct
+{
+    HostNetif_Frame frames[HOST_NETIF_RING_SIZE];
+    uint32          head;
+    uint32          tail;
+} HostNetif_Ring;
+
+#if IFX_NETIF_RX_ZERO_COPY
+/* Gateway RX mirrors the zero-copy GETH port: each ring entry acts as an RX
+ * descriptor owning a buffer slot, and a delivered frame swaps its slot for a
+ * free one instead of being copied into a PBUF_POOL chain. Every GETH queue
+ * has its own ring, the buffers are shared. */
+#define HOST_NETIF_RX_BUFFER_COUNT  (IFX_NETIF_QUEUES * HOST_NETIF_RING_SIZE + IFX_NETIF_RX_SPARE_BUFFERS)
+
+typedef struct
+{
+    struct pbuf_custom pbuf;
+    uint8              slot;
+} HostNetif_RxPbuf;
+
+typedef struct
+{
+    uint8  descrSlot[HOST_NETIF_RING_SIZE];
+    uint16 descrLen[HOST_NETIF_RING_SIZE];
+    uint32 head;
+    uint32 tail;
+} HostNetif_RxRing;
+
+static uint8            g_rxBuffer[HOST_NETIF_RX_BUFFER_COUNT][HOST_NETIF_FRAME_SIZE];
+static HostNetif_RxPbuf g_rxPbuf[HOST_NETIF_RX_BUFFER_COUNT];
+static HostNetif_RxRing g_rxRing[IFX_NETIF_QUEUES];
+static uint8            g_rxFreeSlot[HOST_NETIF_RX_BUFFER_COUNT];
+static uint32           g_rxFreeCount;
+#else
+static HostNetif_Ring  g_toGateway[IFX_NETIF_QUEUES];
+#endif
+static HostNetif_Ring  g_toPeer;
+#if IFX_NETIF_TX_ZERO_COPY
+/* Gateway TX mirrors the scatter-gather GETH port: frames are referenced, not
+ * copied, until the wire (HostNetif_pollPeer) has sent them */
+typedef struct
+{
+    pbuf_t *pbuf[IFXGETH_MAX_TX_DESCRIPTORS];
+    uint32  head;
+    uint32  done;
+    uint32  tail;
+} HostNetif_TxRing;
+
+static HostNetif_TxRing g_txRing[IFX_NETIF_QUEUES];
+static const uint32     g_txRingSize[IFX_NETIF_QUEUES] = {
+    IFX_NETIF_DIAG_TX_DESCRIPTORS,
+#if IFX_NETIF_QUEUES > 1
+    IFX_NETIF_BE_TX_DESCRIPTORS,
+#endif
+};
+#endif
+static netif_t         g_peer[HOST_NETIF_MAX_PEERS];
+static uint8           g_peerCount = 0;
+static HostNetif_Stats g_stats;
+static u32_t           g_rxDrops;
+
+/*******************************************************************************
+ * Wire
+ ******************************************************************************/
+
+static uint32 Ring_count(const HostNetif_Ring *ring)
+{
+    return ring->head - ring->tail;
+}
+
+/* Receive queue the GETH MAC steers a frame to, see low_level_init_queues() */
+static uint8 Wire_rxQueue(pbuf_t *p)
+{
+#if IFX_NETIF_QUEUES > 1
+    uint16 type = (uint16)((pbuf_get_at(p, ETH_PAD_SIZE + 12) << 8) | pbuf_get_at(p, ETH_PAD_SIZE + 13));
+    uint8  pcp;
+
+    if ((pbuf_get_at(p, ETH_PAD_SIZE) & 0x01) != 0)
+    {
+        return IFX_NETIF_QUEUE_BEST_EFFORT;     /* broadcast / multicast */
+    }
+
+    if (type == ETHTYPE_VLAN)
+    {
+        pcp = (uint8)(pbuf_get_at(p, ETH_PAD_SIZE + 14) >> 5);
+        return ((IFX_NETIF_DIAG_VLAN_PRIORITIES & (1U << pcp)) != 0) ? IFX_NETIF_QUEUE_DIAG : IFX_NETIF_QUEUE_BEST_EFFORT;
+    }
+
+    return IFX_NETIF_QUEUE_DIAG;                /* untagged unicast */
+#else
+    (void)p;
+    return IFX_NETIF_QUEUE_DIAG;
+#endif
+}
+
+/* Copies the pbuf chain into the ring (the wire, or the copying GETH TX path) */
+static err_t Ring_push(HostNetif_Ring *ring, pbuf_t *p, uint64 *copyCounter)
+{
+    if (Ring_count(ring) >= HOST_NETIF_RING_SIZE)
+    {
+        g_stats.drops++;
+        LINK_STATS_INC(link.drop);
+        return ERR_OK;  /* a full MAC queue loses the frame silently */
+    }
+
+    HostNetif_Frame *frame = &ring->frames[ring->head % HOST_NETIF_RING_SIZE];
+
+#if ETH_PAD_SIZE
+    pbuf_header(p, -ETH_PAD_SIZE);
+#endif
+
+    uint16 len = 0;
+    for (pbuf_t *q = p; q != NULL; q = q->next)
+    {
+        memcpy(&frame->data[len], q->payload, q->len);
+        len += q->len;
+    }
+    frame->len = len;
+
+#if ETH_PAD_SIZE
+    pbuf_header(p, ETH_PAD_SIZE);
+#endif
+
+    if (copyCounter != NULL)
+    {
+        *copyCounter += len;
+    }
+
+    ring->head++;
+    LINK_STATS_INC(link.xmit);
+    return ERR_OK;
+}
+
+/* Copies the oldest frame of the ring into a PBUF_POOL chain */
+static pbuf_t *Frame_toPbuf(const HostNetif_Frame *frame, uint64 *copyCounter)
+{
+    pbuf_t *p = pbuf_alloc(PBUF_RAW, frame->len + ETH_PAD_SIZE, PBUF_POOL);
+    if (p == NULL)
+    {
+        g_stats.drops++;
+        LINK_STATS_INC(link.memerr);
+        LINK_STATS_INC(link.drop);
+        return NULL;
+    }
+
+#if ETH_PAD_SIZE
+    pbuf_header(p, -ETH_PAD_SIZE);
+#endif
+
+    const uint8 *src = frame->data;
+    for (pbuf_t *q = p; q != NULL; q = q->next)
+    {
+        memcpy(q->payload, src, q->len);
+        src += q->len;
+    }
+
+#if ETH_PAD_SIZE
+    pbuf_header(p, ETH_PAD_SIZE);
+#endif
+
+    if (copyCounter != NULL)
+    {
+        *copyCounter += frame->len;
+    }
+
+    LINK_STATS_INC(link.recv);
+    return p;
+}
+
+static pbuf_t *Ring_pop(HostNetif_Ring *ring, uint64 *copyCounter)
+{
+    if (Ring_count(ring) == 0)
+    {
+        return NULL;
+    }
+
+    const HostNetif_Frame *frame = &ring->frames[ring->tail % HOST_NETIF_RING_SIZE];
+    ring->tail++;
+
+    return Frame_toPbuf(frame, copyCounter);
+}
+
+#if IFX_NETIF_RX_ZERO_COPY
+static void Rx_pbufFree(struct pbuf *p)
+{
+    g_rxFreeSlot[g_rxFreeCount++] = ((HostNetif_RxPbuf *)p)->slot;
+}
+
+static void Rx_init(void)
+{
+    uint32 i;
+    uint32 q;
+
+    for (i = 0; i < HOST_NETIF_RX_BUFFER_COUNT; i++)
+    {
+        g_rxPbuf[i].pbuf.custom_free_function = Rx_pbufFree;
+        g_rxPbuf[i].slot = (uint8)i;
+    }
+
+    for (q = 0; q < IFX_NETIF_QUEUES; q++)
+    {
+        for (i = 0; i < HOST_NETIF_RING_SIZE; i++)
+        {
+            g_rxRing[q].descrSlot[i] = (uint8)(q * HOST_NETIF_RING_SIZE + i);
+        }
+
+        g_rxRing[q].head = 0;
+        g_rxRing[q].tail = 0;
+    }
+
+    g_rxFreeCount = 0;
+    for (i = IFX_NETIF_QUEUES * HOST_NETIF_RING_SIZE; i < HOST_NETIF_RX_BUFFER_COUNT; i++)
+    {
+        g_rxFreeSlot[g_rxFreeCount++] = (uint8)i;
+    }
+}
+
+/* Peer transmit = GETH RX DMA writing into the buffer armed in the next descriptor of the steered queue */
+static err_t Rx_dmaWrite(pbuf_t *p)
+{
+    HostNetif_RxRing *ring = &g_rxRing[Wire_rxQueue(p)];
+
+    if ((ring->head - ring->tail) >= HOST_NETIF_RING_SIZE)
+    {
+        g_stats.drops++;
+        g_rxDrops++;
+        LINK_STATS_INC(link.drop);
+        return ERR_OK;
+    }
+
+    uint32 index = ring->head % HOST_NETIF_RING_SIZE;
+    uint8 *dst   = g_rxBuffer[ring->descrSlot[index]];
+    uint16 len   = 0;
+
+    /* plain memcpy: the DMA write is not a CPU copy of the gateway */
+    for (pbuf_t *q = p; q != NULL; q = q->next)
+    {
+        memcpy(&dst[len], q->payload, q->len);
+        len += q->len;
+    }
+
+    ring->descrLen[index] = len;
+    ring->head++;
+
+    /* ISR_Geth_Rx / ISR_Geth_Rx1 */
+    g_Lwip.rxPending++;
+    Sched_signal(&g_Lwip.event);
+
+    LINK_STATS_INC(link.xmit);
+    return ERR_OK;
+}
+
+/* Same as low_level_input() in the zero-copy GETH port */
+static pbuf_t *Rx_receive(uint8 queue)
+{
+    HostNetif_RxRing *ring = &g_rxRing[queue];
+
+    if (ring->head == ring->tail)
+    {
+        return NULL;
+    }
+
+    uint32 index = ring->tail % HOST_NETIF_RING_SIZE;
+    ring->tail++;
+
+    if (g_rxFreeCount == 0)
+    {
+        g_stats.drops++;
+        g_rxDrops++;
+        LINK_STATS_INC(link.memerr);
+        LINK_STATS_INC(link.drop);
+        return NULL;
+    }
+
+    HostNetif_RxPbuf *rx = &g_rxPbuf[ring->descrSlot[index]];
+    ring->descrSlot[index] = g_rxFreeSlot[--g_rxFreeCount];
+
+    LINK_STATS_INC(link.recv);
+    return pbuf_alloced_custom(PBUF_RAW, ring->descrLen[index], PBUF_REF, &rx->pbuf,
+                               g_rxBuffer[rx->slot], HOST_NETIF_FRAME_SIZE);
+}
+#endif
+
+static void Netif_setup(netif_t *netif, netif_linkoutput_fn linkoutput)
+{
+    netif->hwaddr_len = ETHARP_HWADDR_LEN;
+    netif->mtu        = 1500;
+    netif->flags      = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
+    netif->output     = etharp_output;
+    netif->linkoutput = linkoutput;
+}
+
+/*******************************************************************************
+ * Gateway netif (replaces netif.c)
+ ******************************************************************************/
+
+#if IFX_NETIF_TX_ZERO_COPY
+/* Same as low_level_output() in the scatter-gather GETH port */
+static err_t Gateway_linkOutput(netif_t *netif, pbuf_t *p)
+{
+    uint8             queue = Ifx_Lwip_getTxQueue(p);
+    HostNetif_TxRing *ring  = &g_txRing[queue];
+    uint32            size  = g_txRingSize[queue];
+    pbuf_t           *frame = p;
+    uint32            segments;
+
+    ifx_netif_txRelease(netif);
+
+    segments = pbuf_clen(p);
+    if (segments > size)
+    {
+        frame    = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+        segments = 1;
+    }
+    else
+    {
+        pbuf_ref(frame);
+    }
+
+    if ((frame == NULL) || (segments > (size - (ring->head - ring->tail))))
+    {
+        if (frame != NULL)
+        {
+            pbuf_free(frame);
+        }
+
+        g_stats.drops++;
+        LINK_STATS_INC(link.memerr);
+        LINK_STATS_INC(link.drop);
+        return ERR_MEM;
+    }
+
+    for (uint32 i = 0; i < segments; i++)
+    {
+        ring->pbuf[(ring->head + i) % size] = (i == (segments - 1)) ? frame : NULL;
+    }
+    ring->head += segments;
+    g_stats.framesFromGateway++;
+    g_stats.txQueueFrames[queue]++;
+
+    /* the wire is as fast as the DMA: the frame completes at once and is
+     * released by the next ifx_netif_txRelease() */
+    ifx_netif_txComplete(netif, queue);
+    return ERR_OK;
+}
+
+/* Stand-in for the TX DMA plus ISR_Geth_Tx: the wire reads the frames in place */
+void ifx_netif_txComplete(netif_t *netif, u8_t queue)
+{
+    HostNetif_TxRing *ring = &g_txRing[queue];
+    uint32            size = g_txRingSize[queue];
+
+    (void)netif;
+
+    for (; ring->done != ring->head; ring->done++)
+    {
+        pbuf_t *frame = ring->pbuf[ring->done % size];
+        if (frame != NULL)
+        {
+            Ring_push(&g_toPeer, frame, NULL);
+        }
+    }
+}
+
+void ifx_netif_txRelease(netif_t *netif)
+{
+    (void)netif;
+
+    for (uint8 queue = 0; queue < IFX_NETIF_QUEUES; queue++)
+    {
+        HostNetif_TxRing *ring = &g_txRing[queue];
+        uint32            size = g_txRingSize[queue];
+
+        for (; ring->tail != ring->done; ring->tail++)
+        {
+            pbuf_t **slot = &ring->pbuf[ring->tail % size];
+            if (*slot != NULL)
+            {
+                pbuf_free(*slot);
+                *slot = NULL;
+            }
+        }
+    }
+}
+#else
+static err_t Gateway_linkOutput(netif_t *netif, pbuf_t *p)
+{
+    (void)netif;
+    g_stats.framesFromGateway++;
+    g_stats.txQueueFrames[IFX_NETIF_QUEUE_DIAG]++;
+    return Ring_push(&g_toPeer, p, &g_stats.netifCopyBytes);
+}
+
+void ifx_netif_txComplete(netif_t *netif, u8_t queue)
+{
+    (void)netif;
+    (void)queue;
+}
+
+void ifx_netif_txRelease(netif_t *netif)
+{
+    (void)netif;
+}
+#endif
+
+err_t ifx_netif_init(netif_t *netif)
+{
+    LWIP_ASSERT("netif != NULL", (netif != NULL));
+
+#if LWIP_NETIF_HOSTNAME
+    netif->hostname = "lwip";
+#endif
+
+#if IFX_NETIF_RX_ZERO_COPY
+    Rx_init();
+#endif
+
+    netif->state   = IfxGeth_get();
+    netif->name[0] = IFNAME0;
+    netif->name[1] = IFNAME1;
+    memcpy(netif->hwaddr, g_Lwip.eth_addr.addr, ETHARP_HWADDR_LEN);
+    Netif_setup(netif, Gateway_linkOutput);
+
+    return ERR_OK;
+}
+
+err_t ifx_netif_input(netif_t *netif, u8_t queue)
+{
+#if IFX_NETIF_RX_ZERO_COPY
+    pbuf_t *p = Rx_receive(queue);
+#else
+    pbuf_t *p = Ring_pop(&g_toGateway[queue], &g_stats.netifCopyBytes);
+#endif
+
+    if (p == NULL)
+    {
+        return ERR_OK;
+    }
+
+    g_stats.framesToGateway++;
+    g_stats.rxQueueFrames[queue]++;
+
+    if (netif->input(p, netif) != ERR_OK)
+    {
+        pbuf_free(p);
+    }
+
+    return ERR_OK;
+}
+
+/*******************************************************************************
+ * Peer netif
+ ******************************************************************************/
+
+static err_t Peer_linkOutput(netif_t *netif, pbuf_t *p)
+{
+    (void)netif;
+#if IFX_NETIF_RX_ZERO_COPY
+    return Rx_dmaWrite(p);
+#else
+    Ring_push(&g_toGateway[Wire_rxQueue(p)], p, NULL);
+    g_Lwip.rxPending++;
+    Sched_signal(&g_Lwip.event);
+    return ERR_OK;
+#endif
+}
+
+static err_t Peer_init(netif_t *netif)
+{
+    static const uint8 peerMac[ETHARP_HWADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x01, 0x00};
+
+    netif->name[0] = 'v';
+    netif->name[1] = (char)('m' + (netif - g_peer));
+    memcpy(netif->hwaddr, peerMac, ETHARP_HWADDR_LEN);
+    netif->hwaddr[ETHARP_HWADDR_LEN - 1] = (uint8)(netif - g_peer);
+    Netif_setup(netif, Peer_linkOutput);
+
+    return ERR_OK;
+}
+
+void HostNetif_addPeer(const ip4_addr_t *ipAddr, const ip4_addr_t *netMask)
+{
+    ip4_addr_t gw;
+    ip4_addr_set_zero(&gw);
+
+    if (g_peerCount >= HOST_NETIF_MAX_PEERS)
+    {
+        return;
+    }
+
+    netif_t *peer = &g_peer[g_peerCount++];
+    netif_add(peer, ipAddr, netMask, &gw, NULL, Peer_init, ethernet_input);
+    netif_set_up(peer);
+}
+
+uint32 HostNetif_pollPeer(void)
+{
+    uint32 delivered = 0;
+    pbuf_t *p;
+
+    for (uint8 queue = 0; queue < IFX_NETIF_QUEUES; queue++)
+    {
+        ifx_netif_txComplete(Ifx_Lwip_getNetIf(), queue);
+    }
+
+    /* A switch: unicast frames go to the peer with the destination MAC, broadcasts to every peer */
+    for (; Ring_count(&g_toPeer) != 0; g_toPeer.tail++)
+    {
+        const HostNetif_Frame *frame = &g_toPeer.frames[g_toPeer.tail % HOST_NETIF_RING_SIZE];
+        boolean group = ((frame->data[0] & 0x01) != 0);
+
+        for (uint8 i = 0; i < g_peerCount; i++)
+        {
+            if (!group && memcmp(frame->data, g_peer[i].hwaddr, ETHARP_HWADDR_LEN) != 0)
+            {
+                continue;
+            }
+
+            p = Frame_toPbuf(frame, NULL);
+            if (p != NULL && g_peer[i].input(p, &g_peer[i]) != ERR_OK)
+            {
+                pbuf_free(p);
+            }
+        }
+        delivered++;
+    }
+
+    return delivered;
+}
+
+u32_t ifx_netif_rxAvailable(netif_t *netif, u8_t queue)
+{
+    (void)netif;
+#if IFX_NETIF_RX_ZERO_COPY
+    return g_rxRing[queue].head - g_rxRing[queue].tail;
+#else
+    return Ring_count(&g_toGateway[queue]);
+#endif
+}
+
+u32_t ifx_netif_rxDrops(netif_t *netif)
+{
+    (void)netif;
+    return g_rxDrops;
+}
+
+uint32 HostNetif_getGatewayBacklog(void)
+{
+    uint32 backlog = 0;
+
+    for (uint8 queue = 0; queue < IFX_NETIF_QUEUES; queue++)
+    {
+        backlog += ifx_netif_rxAvailable(Ifx_Lwip_getNetIf(), queue);
+    }
+
+    return backlog;
+}
+
+/*******************************************************************************
+ * lwIP hooks and statistics
+ ******************************************************************************/
+
+struct netif *HostNetif_routeSrc(const struct ip4_addr *src, const struct ip4_addr *dest)
+{
+    (void)dest;
+
+    if (src == NULL)
+    {
+        return NULL;
+    }
+
+    for (uint8 i = 0; i < g_peerCount; i++)
+    {
+        if (ip4_addr_cmp(src, netif_ip4_addr(&g_peer[i])))
+        {
+            return &g_peer[i];
+        }
+    }
+
+    /* All netifs share a subnet; everything not sourced by a peer is gateway traffic */
+    return Ifx_Lwip_getNetIf();
+}
+
+void *HostNetif_memcpy(void *dst, const void *src, size_t len)
+{
+    g_stats.lwipCopyBytes += len;
+    return memcpy(dst, src, len);
+}
+
+const HostNetif_Stats *HostNetif_getStats(void)
+{
+    return &g_stats;
+}
+
+void HostNetif_resetStats(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+}
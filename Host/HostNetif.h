@@ -0,0 +1,54 @@
+/**
+ * @file HostNetif.h
+ * @brief In-memory Ethernet wire for the host build
+ * @details Replaces the GETH netif (netif.c). Frames sent by the gateway
+ *          netif are queued for "peer" netifs that stand in for the VMG and
+ *          a zone ECU, and vice versa, so the full Ethernet/ARP/IP/TCP path
+ *          runs without a TAP device.
+ */
+
+#ifndef HOST_NETIF_H
+#define HOST_NETIF_H
+
+#include "Ifx_Types.h"
+#include "lwip/netif.h"
+#include "lwip/ip4_addr.h"
+#include "Ifx_Lwip.h"
+
+/* Frames buffered per direction before the wire starts dropping */
+#define HOST_NETIF_RING_SIZE        64
+#define HOST_NETIF_MAX_PEERS        2       /* VMG/testers and a zone ECU */
+
+typedef struct
+{
+    uint32 framesToGateway;     /* Frames the gateway netif received */
+    uint32 framesFromGateway;   /* Frames the gateway netif transmitted */
+    uint32 drops;               /* Frames lost because a ring was full or pbufs ran out */
+    uint32 rxQueueFrames[IFX_NETIF_QUEUES]; /* Frames the gateway received per GETH queue */
+    uint32 txQueueFrames[IFX_NETIF_QUEUES]; /* Frames the gateway transmitted per GETH queue */
+    uint64 netifCopyBytes;      /* Bytes copied by the gateway netif (RX + TX) */
+    uint64 lwipCopyBytes;       /* Bytes copied through lwIP MEMCPY */
+} HostNetif_Stats;
+
+/**
+ * @brief Add a peer netif on the far end of the wire
+ * @param ipAddr Peer IP address (e.g. the VMG at 192.168.1.100)
+ * @param netMask Peer network mask
+ */
+void HostNetif_addPeer(const ip4_addr_t *ipAddr, const ip4_addr_t *netMask);
+
+/**
+ * @brief Deliver all frames queued for the peer netifs
+ * @return Number of frames delivered
+ */
+uint32 HostNetif_pollPeer(void);
+
+/**
+ * @brief Get the number of frames waiting for the gateway netif
+ */
+uint32 HostNetif_getGatewayBacklog(void);
+
+const HostNetif_Stats *HostNetif_getStats(void);
+void HostNetif_resetStats(void);
+
+#endif /* HOST_NETIF_H */
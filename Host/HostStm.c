@@ -0,0 +1,46 @@
+/**
+ * @file HostStm.c
+ * @brief Host STM0 counter backed by CLOCK_MONOTONIC
+ */
+
+#include "IfxStm.h"
+#include <time.h>
+
+Ifx_STM MODULE_STM0;
+
+static uint64 g_skipTicks = 0;
+static uint64 g_startNs = 0;
+
+static uint64 HostStm_nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000ULL + (uint64)ts.tv_nsec;
+}
+
+uint64 IfxStm_get(Ifx_STM *stm)
+{
+    (void)stm;
+
+    uint64 now = HostStm_nowNs();
+    if (g_startNs == 0)
+    {
+        g_startNs = now;
+    }
+
+    /* 100 MHz: one tick every 10 ns */
+    return ((now - g_startNs) / 10U) + g_skipTicks;
+}
+
+void IfxStm_waitTicks(Ifx_STM *stm, uint32 ticks)
+{
+    uint64 start = IfxStm_get(stm);
+    while ((IfxStm_get(stm) - start) < ticks)
+    {
+    }
+}
+
+void HostStm_skipMs(uint32 ms)
+{
+    g_skipTicks += (uint64)ms * HOST_STM_TICKS_PER_MS;
+}
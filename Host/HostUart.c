@@ -0,0 +1,110 @@
+/**
+ * @file HostUart.c
+ * @brief Host replacement for UART_Logging.c (ASCLIN0)
+ * @details Output is counted and discarded by default. HostUart_setEcho()
+ *          forwards it to stdout. HostUart_setBaudrate() emulates the DMA
+ *          drain of the target: each core's UART_LOG_RING_SIZE ring empties
+ *          at the baud rate in STM time, and a message that does not fit is
+ *          dropped and counted instead of waiting.
+ */
+
+#include "HostUart.h"
+#include "IfxCpu.h"
+#include "IfxStm.h"
+#include "Configuration.h"
+#include <stdio.h>
+
+#define HOST_UART_CORES     (CPU_WHICH_SERVICE_ETHERNET + 1)
+
+static HostUart_Stats g_uartStats;
+static boolean        g_echo = FALSE;
+static uint32         g_baudrate = 0;
+static uint32         g_ringLevel[HOST_UART_CORES];
+static uint64         g_drainTicks;     /* STM time up to which the rings were drained */
+
+/* Remove the bytes ASCLIN0 shifted out since the last call */
+static void HostUart_drain(void)
+{
+    uint64 now = IfxStm_get(&MODULE_STM0);
+    /* 8N1: ten bit times per character */
+    uint64 ticksPerByte = (10U * HOST_STM_TICKS_PER_MS * 1000ULL) / g_baudrate;
+    uint64 budget = (now - g_drainTicks) / ticksPerByte;
+
+    g_drainTicks += budget * ticksPerByte;
+
+    for (uint32 core = 0; (core < HOST_UART_CORES) && (budget != 0); core++)
+    {
+        uint32 bytes = (budget < g_ringLevel[core]) ? (uint32)budget : g_ringLevel[core];
+        g_ringLevel[core] -= bytes;
+        budget -= bytes;
+    }
+
+    /* an idle line does not bank transmit time */
+    if (budget != 0)
+    {
+        g_drainTicks = now;
+    }
+}
+
+void initUART(void)
+{
+}
+
+void sendUARTMessage(char *msg, Ifx_SizeT count)
+{
+    uint32 core = IfxCpu_getCoreIndex();
+
+    if ((count <= 0) || (core >= HOST_UART_CORES))
+    {
+        return;
+    }
+
+    if (g_baudrate != 0)
+    {
+        HostUart_drain();
+
+        if ((uint32)count > (UART_LOG_RING_SIZE - g_ringLevel[core]))
+        {
+            g_uartStats.dropped++;
+            return;
+        }
+
+        g_ringLevel[core] += (uint32)count;
+    }
+
+    g_uartStats.calls++;
+    g_uartStats.bytes += (uint64)count;
+
+    if (g_echo)
+    {
+        fwrite(msg, 1, (size_t)count, stdout);
+    }
+}
+
+uint32 UART_getDroppedMessages(void)
+{
+    return (uint32)g_uartStats.dropped;
+}
+
+void HostUart_setEcho(boolean echo)
+{
+    g_echo = echo;
+}
+
+void HostUart_setBaudrate(uint32 baudrate)
+{
+    g_baudrate = baudrate;
+    g_drainTicks = IfxStm_get(&MODULE_STM0);
+}
+
+const HostUart_Stats *HostUart_getStats(void)
+{
+    return &g_uartStats;
+}
+
+void HostUart_resetStats(void)
+{
+    g_uartStats.calls = 0;
+    g_uartStats.bytes = 0;
+    g_uartStats.dropped = 0;
+}
@@ -0,0 +1,30 @@
+/**
+ * @file HostUart.h
+ * @brief Host UART sink - statistics and emulation controls
+ */
+
+#ifndef HOST_UART_H
+#define HOST_UART_H
+
+#include "Ifx_Types.h"
+#include "UART_Logging.h"
+
+typedef struct
+{
+    uint64 calls;       /* sendUARTMessage() calls */
+    uint64 bytes;       /* Bytes accepted into the log ring */
+    uint64 dropped;     /* Messages dropped on a full ring */
+} HostUart_Stats;
+
+void HostUart_setEcho(boolean echo);
+
+/**
+ * @brief Emulate the DMA drain rate of the target UART
+ * @param baudrate Baud rate to emulate (e.g. UART_BAUDRATE), 0 = the ring never fills
+ */
+void HostUart_setBaudrate(uint32 baudrate);
+
+const HostUart_Stats *HostUart_getStats(void);
+void HostUart_resetStats(void);
+
+#endif /* HOST_UART_H */
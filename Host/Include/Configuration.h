@@ -0,0 +1,18 @@
+/**
+ * @file Configuration.h
+ * @brief Host replacement for Configurations/Configuration.h (no pin map)
+ */
+
+#ifndef CONFIGURATION_H
+#define CONFIGURATION_H
+
+#include "ConfigurationIsr.h"
+
+#define IFX_CFG_STM_TICKS_PER_MS    (100000)                /* Value of the system timer in ticks per millisecond   */
+
+#define CPU_WHICH_SERVICE_ETHERNET  1                       /* Same deployment as on target, see HostGateway_step() */
+#define CPU_WHICH_SERVICE_APP       0
+#define CPU_WHICH_SERVICE_FLASH     0
+#define CPU_WHICH_SERVICE_LOG       0
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * @file IfxCpu.h
+ * @brief Host replacement for the iLLD CPU driver (no interrupts)
+ * @details One host thread plays all cores: HostGateway_step() sets
+ *          g_HostCpu_coreIndex before running each core's share of the loop.
+ */
+
+#ifndef IFXCPU_H
+#define IFXCPU_H
+
+#include "Ifx_Types.h"
+
+typedef volatile uint32 IfxCpu_syncEvent;
+
+extern uint32 g_HostCpu_coreIndex;
+
+IFX_INLINE boolean IfxCpu_disableInterrupts(void)
+{
+    return TRUE;
+}
+
+IFX_INLINE void IfxCpu_restoreInterrupts(boolean enabled)
+{
+    (void)enabled;
+}
+
+IFX_INLINE void IfxCpu_enableInterrupts(void)
+{
+}
+
+IFX_INLINE uint32 IfxCpu_getCoreIndex(void)
+{
+    return g_HostCpu_coreIndex;
+}
+
+IFX_INLINE void IfxCpu_emitEvent(IfxCpu_syncEvent *event)
+{
+    (void)event;
+}
+
+IFX_INLINE boolean IfxCpu_waitEvent(IfxCpu_syncEvent *event, uint32 timeoutMilliSec)
+{
+    (void)event;
+    (void)timeoutMilliSec;
+    return FALSE;
+}
+
+#endif /* IFXCPU_H */
@@ -0,0 +1,19 @@
+/**
+ * @file IfxGeth_Eth.h
+ * @brief Host replacement for the iLLD GETH driver types used by Ifx_Lwip.h
+ */
+
+#ifndef IFXGETH_ETH_H
+#define IFXGETH_ETH_H
+
+#include "Ifx_Types.h"
+
+#define IFXGETH_MAX_TX_DESCRIPTORS  8
+#define IFXGETH_MAX_RX_DESCRIPTORS  8
+
+typedef struct
+{
+    void *gethSFR;
+} IfxGeth_Eth;
+
+#endif /* IFXGETH_ETH_H */
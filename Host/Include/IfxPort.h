@@ -0,0 +1,12 @@
+/**
+ * @file IfxPort.h
+ * @brief Host replacement for the iLLD port driver
+ * @details Only included through Flash4_Driver.h; the host has no pins.
+ */
+
+#ifndef IFXPORT_H
+#define IFXPORT_H
+
+#include "Ifx_Types.h"
+
+#endif /* IFXPORT_H */
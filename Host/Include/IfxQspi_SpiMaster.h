@@ -0,0 +1,13 @@
+/**
+ * @file IfxQspi_SpiMaster.h
+ * @brief Host replacement for the iLLD QSPI SPI master driver
+ * @details Only included through Flash4_Driver.h; the host Flash4 model
+ *          (HostFlash4.c) needs none of its types.
+ */
+
+#ifndef IFXQSPI_SPIMASTER_H
+#define IFXQSPI_SPIMASTER_H
+
+#include "Ifx_Types.h"
+
+#endif /* IFXQSPI_SPIMASTER_H */
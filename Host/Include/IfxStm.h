@@ -0,0 +1,46 @@
+/**
+ * @file IfxStm.h
+ * @brief Host replacement for the iLLD STM driver
+ * @details The STM0 counter runs at 100 MHz (IFX_CFG_STM_TICKS_PER_MS) and is
+ *          derived from CLOCK_MONOTONIC plus an offset that the harness can
+ *          advance with HostStm_skipMs() to fast-forward protocol timeouts.
+ */
+
+#ifndef IFXSTM_H
+#define IFXSTM_H
+
+#include "Ifx_Types.h"
+
+#define HOST_STM_TICKS_PER_MS       100000
+
+typedef struct
+{
+    uint32 reserved;
+} Ifx_STM;
+
+IFX_EXTERN Ifx_STM MODULE_STM0;
+
+uint64 IfxStm_get(Ifx_STM *stm);
+void   IfxStm_waitTicks(Ifx_STM *stm, uint32 ticks);
+
+/* Host only: advance the STM counter without waiting */
+void   HostStm_skipMs(uint32 ms);
+
+IFX_INLINE uint32 IfxStm_getLower(Ifx_STM *stm)
+{
+    return (uint32)IfxStm_get(stm);
+}
+
+IFX_INLINE Ifx_TickTime IfxStm_getTicksFromMilliseconds(Ifx_STM *stm, uint32 ms)
+{
+    (void)stm;
+    return (Ifx_TickTime)ms * HOST_STM_TICKS_PER_MS;
+}
+
+IFX_INLINE Ifx_TickTime IfxStm_getTicksFromMicroseconds(Ifx_STM *stm, uint32 us)
+{
+    (void)stm;
+    return (Ifx_TickTime)us * (HOST_STM_TICKS_PER_MS / 1000);
+}
+
+#endif /* IFXSTM_H */
@@ -0,0 +1,55 @@
+/**
+ * @file Ifx_Types.h
+ * @brief Host replacement for the iLLD base types (Cpu/Std/Ifx_Types.h)
+ */
+
+#ifndef IFX_TYPES_H
+#define IFX_TYPES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned char       boolean;
+typedef uint8_t             uint8;
+typedef uint16_t            uint16;
+typedef uint32_t            uint32;
+typedef uint64_t            uint64;
+typedef int8_t              sint8;
+typedef int16_t             sint16;
+typedef int32_t             sint32;
+typedef int64_t             sint64;
+typedef float               float32;
+typedef double              float64;
+
+#ifndef TRUE
+#define TRUE                1
+#endif
+#ifndef FALSE
+#define FALSE               0
+#endif
+
+#ifndef NULL_PTR
+#define NULL_PTR            ((void *)0)
+#endif
+
+typedef sint64              Ifx_TickTime;
+#define TIME_INFINITE       ((Ifx_TickTime)0x7FFFFFFFFFFFFFFFLL)
+#define TIME_NULL           ((Ifx_TickTime)0x0000000000000000LL)
+
+typedef sint32              Ifx_SizeT;
+
+#define IFX_EXTERN          extern
+#define IFX_INLINE          static inline
+#define IFX_ALIGN(n)        __attribute__ ((aligned(n)))
+
+/* TriCore intrinsics */
+#define __dsync()           __sync_synchronize()
+#define __cmpAndSwap(address, value, condition) __sync_val_compare_and_swap((address), (condition), (value))
+#define __disable()
+#define __enable()
+#define __wait()
+
+/* ISRs become plain functions; the host harness calls them directly */
+#define IFX_INTERRUPT(isr, vectabNum, prio) void isr(void)
+
+#endif /* IFX_TYPES_H */
@@ -0,0 +1,36 @@
+/**
+ * @file cc.h
+ * @brief Host (LP64) compiler/architecture definitions for lwIP
+ * @details Replaces port/include/arch/cc.h, whose 32-bit mem_ptr_t and
+ *          TriCore packing rules do not hold on a Linux host.
+ */
+
+#ifndef HOST_LWIP_CC_H
+#define HOST_LWIP_CC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Ifx_Types.h"
+#include "lwipopts.h"
+
+#define LWIP_ERRNO_STDINCLUDE   1
+
+#define PACK_STRUCT_BEGIN
+#define PACK_STRUCT_STRUCT      __attribute__ ((__packed__))
+#define PACK_STRUCT_END
+#define PACK_STRUCT_FIELD(x)    x
+
+#ifdef LWIP_DEBUG
+signed char Ifx_Lwip_printf(const char *s, ...);
+#define LWIP_PLATFORM_ASSERT(msg)                                                           \
+    do {                                                                                    \
+        fprintf(stderr, "Assertion \"%s\" failed at line %d in %s\n", msg, __LINE__, __FILE__); \
+        abort();                                                                            \
+    } while (0)
+#define LWIP_PLATFORM_DIAG(msg)   Ifx_Lwip_printf msg
+#else
+#define LWIP_PLATFORM_ASSERT(msg) ((void)0)
+#define LWIP_PLATFORM_DIAG(msg)   ((void)0)
+#endif
+
+#endif /* HOST_LWIP_CC_H */
@@ -0,0 +1,33 @@
+/**
+ * @file lwipopts.h
+ * @brief Host lwIP options: the target configuration plus host-only hooks
+ */
+
+#ifndef HOST_LWIPOPTS_H
+#define HOST_LWIPOPTS_H
+
+#include "../../Configurations/lwipopts.h"
+
+#include <stddef.h>
+
+struct ip4_addr;
+struct netif *HostNetif_routeSrc(const struct ip4_addr *src, const struct ip4_addr *dest);
+void *HostNetif_memcpy(void *dst, const void *src, size_t len);
+
+/* Frames sourced from the simulated VMG leave through the peer netif */
+#define LWIP_HOOK_IP4_ROUTE_SRC(src, dest)  HostNetif_routeSrc(src, dest)
+
+/* The simulated VMG and testers are connection ends in the same lwIP instance */
+#undef MEMP_NUM_TCP_PCB
+#define MEMP_NUM_TCP_PCB                    16
+#undef MEMP_NUM_TCP_SEG
+#define MEMP_NUM_TCP_SEG                    64
+
+/* Pointers in pools and pbufs are 8 bytes on a 64-bit host, the target's 4 would misalign them */
+#undef MEM_ALIGNMENT
+#define MEM_ALIGNMENT                       8
+
+/* Count every payload copy lwIP performs (tcp_write COPY, pbuf_copy_partial, ...) */
+#define MEMCPY(dst, src, len)               HostNetif_memcpy(dst, src, len)
+
+#endif /* HOST_LWIPOPTS_H */
@@ -33,8 +33,9 @@ typedef struct
 void DoIP_Client_Init(const DoIP_ClientConfig *config);
 
 /**
- * @brief Poll DoIP Client (call periodically from main loop)
- * Must be called every few milliseconds
+ * @brief Poll DoIP Client (Ethernet core output task, after every receive or timer run)
+ * Handles the connect and error events of the lwIP callbacks; reconnect and
+ * timeouts run from the Ethernet core's timer wheel
  */
 void DoIP_Client_Poll(void);
 
@@ -53,7 +54,8 @@ boolean DoIP_Client_IsActive(void);
 /**
  * @brief Send ECU Health Status Report
  * @param ecu_count Number of ECUs
- * @param health_data Array of DoIP_HealthStatus_Info structures
+ * @param health_data Array of DoIP_HealthStatus_Info structures, sent in place
+ *        and referenced until the VMG acknowledges it
  * @return TRUE if sent successfully, FALSE otherwise
  */
 boolean DoIP_Client_SendHealthStatusReport(uint8 ecu_count, const DoIP_HealthStatus_Info *health_data);
@@ -61,16 +63,51 @@ boolean DoIP_Client_SendHealthStatusReport(uint8 ecu_count, const DoIP_HealthSta
 /**
  * @brief Send VCI (Vehicle Configuration Information) Report to VMG
  * @param vci_count Number of ECUs in VCI report
- * @param vci_database Array of VCI_Info structures
+ * @param vci_database Array of VCI_Info structures, sent in place and
+ *        referenced until the VMG acknowledges it (DoIP_Client_VciReportBusy)
  * @return TRUE if sent successfully, FALSE otherwise
  */
 boolean DoIP_Client_SendVCIReport(uint8 vci_count, const DoIP_VCI_Info *vci_database);
 
+/**
+ * @brief Check if a VCI report still references its records
+ * @details The records are sent in place, the database must not change
+ *          until the VMG has acknowledged them (or the connection is gone).
+ * @return TRUE while the VCI database is in use
+ */
+boolean DoIP_Client_VciReportBusy(void);
+
 /**
  * @brief Close DoIP connection
  */
 void DoIP_Client_Close(void);
 
+/**
+ * @brief Send a complete DoIP message to the VMG
+ * @details On the Ethernet core the message is queued on the TCP connection,
+ *          on any other core it is posted to the app-to-net mailbox.
+ * @param buffer DoIP message (header + payload)
+ * @param length Message length
+ * @return TRUE if written or queued, FALSE otherwise
+ */
+boolean DoIP_Client_Send(const uint8 *buffer, uint16 length);
+
+/**
+ * @brief Send a DoIP message made of a copied head and a streamed body
+ * @details The body is not copied: it is written into the TCP segments
+ *          straight from its location as send buffer space becomes free, so
+ *          it must be static and stay valid until written. Off the Ethernet
+ *          core the head (at most DOIP_TX_HEAD_SIZE) and a reference to the
+ *          body are posted to the app-to-net mailbox.
+ *          Sent on the VMG connection; see DoIP_Connection_Send().
+ * @param head DoIP header and the first payload bytes
+ * @param head_length Length of head
+ * @param body Remaining payload, NULL_PTR if none
+ * @param body_length Length of body
+ * @return TRUE if written or queued, FALSE otherwise
+ */
+boolean DoIP_Client_SendMessage(const uint8 *head, uint16 head_length, const uint8 *body, uint16 body_length);
+
 /*******************************************************************************
  * UDS-based VCI/Health Request Functions (New)
  ******************************************************************************/
@@ -0,0 +1,345 @@
+/**
+ * @file doip_connection.c
+ * @brief DoIP TCP Connection Contexts Implementation
+ */
+
+#include "doip_connection.h"
+#include "doip_message.h"
+#include "uds_handler.h"
+#include "uds_transaction.h"
+#include "Ipc_Mailbox.h"
+#include "UART_Log.h"
+#include <string.h>
+
+#if DOIP_MAX_PAYLOAD_SIZE > IPC_MAILBOX_SLOT_SIZE
+#error "A DoIP payload must fit an IPC mailbox slot"
+#endif
+
+/* IPC_MSG_DOIP_STREAM: a DoIP_TxBodyRef (at most 24 bytes) followed by the head */
+#if (DOIP_TX_HEAD_SIZE + 24) > IPC_MAILBOX_SLOT_SIZE
+#error "A streamed message head must fit an IPC mailbox slot"
+#endif
+
+typedef struct
+{
+    const uint8 *body;              /* Static data, read by the Ethernet core through its global address */
+    DoIP_TxHold *hold;              /* Referenced until acknowledged, NULL_PTR to copy */
+    uint16 bodyLength;
+    
+} DoIP_TxBodyRef;
+
+/*******************************************************************************
+ * Connection Pool
+ ******************************************************************************/
+
+static DoIP_Connection g_connections[DOIP_CONNECTION_COUNT];
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static uint8 IndexOf(const DoIP_Connection *conn)
+{
+    return (uint8)(conn - g_connections);
+}
+
+static boolean SendMessage(uint8 handle, const uint8 *head, uint16 head_length, const uint8 *body,
+                           uint16 body_length, DoIP_TxHold *hold)
+{
+    /* lwIP belongs to the Ethernet core, everybody else goes through the mailbox */
+    if (!Ipc_onNetCore())
+    {
+        if (body == NULL_PTR)
+        {
+            return Ipc_Mailbox_postChannel(&g_Ipc_appToNet, IPC_MSG_DOIP_SEND, handle, head, head_length);
+        }
+    
+        if (head_length > DOIP_TX_HEAD_SIZE)
+        {
+            return FALSE;
+        }
+    
+        /* The body stays where it is, the Ethernet core streams it from there; the rest is built in the slot */
+        Ipc_Message *msg = Ipc_Mailbox_reserve(&g_Ipc_appToNet);
+        DoIP_TxBodyRef ref;
+    
+        if (msg == NULL_PTR)
+        {
+            return FALSE;
+        }
+    
+        ref.body = body;
+        ref.hold = hold;
+        ref.bodyLength = body_length;
+        memcpy(msg->data, &ref, sizeof(ref));
+        memcpy(&msg->data[sizeof(ref)], head, head_length);
+    
+        msg->type = IPC_MSG_DOIP_STREAM;
+        msg->channel = handle;
+        msg->length = (uint16)(sizeof(ref) + head_length);
+        Ipc_Mailbox_commit(&g_Ipc_appToNet, msg);
+        return TRUE;
+    }
+    
+    DoIP_Connection *conn = DoIP_Connection_FromHandle(handle);
+    
+    if ((conn == NULL) ||
+        !DoIP_TxStream_Send(&conn->tx, conn->pcb, head, head_length, body, body_length, hold))
+    {
+        return FALSE;
+    }
+    
+    conn->output = TRUE;
+    return TRUE;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+DoIP_Connection *DoIP_Connection_At(uint8 index)
+{
+    return (index < DOIP_CONNECTION_COUNT) ? &g_connections[index] : NULL;
+}
+
+DoIP_Connection *DoIP_Connection_FromHandle(uint8 handle)
+{
+    DoIP_Connection *conn = DoIP_Connection_At(handle & DOIP_HANDLE_INDEX_MASK);
+    
+    if ((conn == NULL) || (conn->handle != handle) || (conn->state == DOIP_CONN_FREE) || (conn->pcb == NULL))
+    {
+        return NULL;
+    }
+    
+    return conn;
+}
+
+void DoIP_Connection_Open(DoIP_Connection *conn, struct tcp_pcb *pcb)
+{
+    /* A new generation: handles of the previous connection on this slot no longer match */
+    uint8 generation = (uint8)((conn->handle >> DOIP_HANDLE_INDEX_BITS) + 1);
+    
+    conn->handle = (uint8)((generation << DOIP_HANDLE_INDEX_BITS) | IndexOf(conn));
+    conn->pcb = pcb;
+    conn->state = DOIP_CONN_OPEN;
+    conn->output = FALSE;
+    conn->alive_check = FALSE;
+    conn->tester_address = 0;
+    conn->last_activity = Timer_nowMs();
+    conn->alive_sent = conn->last_activity;
+    DoIP_Reassembly_Reset(&conn->rx);
+    DoIP_TxStream_Reset(&conn->tx);
+    
+    tcp_arg(pcb, conn);
+}
+
+err_t DoIP_Connection_Close(DoIP_Connection *conn, boolean abort)
+{
+    err_t result = ERR_OK;
+    struct tcp_pcb *pcb = conn->pcb;
+    
+    conn->pcb = NULL;
+    conn->state = DOIP_CONN_FREE;
+    conn->alive_check = FALSE;
+    Timer_stop(&conn->timer);
+    DoIP_Reassembly_Reset(&conn->rx);
+    
+    /* A closing PCB would go on sending from bodies whose holds are released below */
+    if ((pcb != NULL) && DoIP_TxStream_Holding(&conn->tx))
+    {
+        abort = TRUE;
+    }
+    
+    DoIP_TxStream_Reset(&conn->tx);
+    
+    if (pcb != NULL)
+    {
+        /* No more callbacks into a freed slot */
+        tcp_arg(pcb, NULL);
+        tcp_recv(pcb, NULL);
+        tcp_sent(pcb, NULL);
+        tcp_err(pcb, NULL);
+    
+        if (abort || (tcp_close(pcb) != ERR_OK))
+        {
+            tcp_abort(pcb);
+            result = ERR_ABRT;
+        }
+    }
+    
+    return result;
+}
+
+void DoIP_Connection_Receive(DoIP_Connection *conn, const struct pbuf *p, DoIP_MessageHandler handler)
+{
+    DoIP_Header header;
+    const uint8 *payload;
+    uint8 nack_code;
+    DoIP_RxResult result;
+    uint16 offset = 0;
+    
+    conn->last_activity = Timer_nowMs();
+    
+    /* Append to the receive ring, processing messages whenever it fills up */
+    while (offset < p->tot_len)
+    {
+        uint16 appended = DoIP_Reassembly_Append(&conn->rx, p, offset);
+        offset += appended;
+    
+        while ((result = DoIP_Reassembly_Next(&conn->rx, &header, &payload, &nack_code)) != DOIP_RX_NEED_DATA)
+        {
+            if (result == DOIP_RX_NACK)
+            {
+                /* Invalid pattern or oversized message - report, the stream continues */
+                uint8 nack_buffer[DOIP_HEADER_SIZE + 1];
+                uint16 len = DoIP_CreateGenericNack(nack_buffer, nack_code);
+                DoIP_Connection_Send(conn->handle, nack_buffer, len, NULL_PTR, 0);
+                LOG_TRACE(DOIP, WARN, TRACE_DOIP_NACK, nack_code);
+                continue;
+            }
+    
+            handler(conn, &header, payload);
+        }
+    
+        if (appended == 0)
+        {
+            break;  /* Cannot happen: the ring holds the largest message */
+        }
+    }
+}
+
+boolean DoIP_Connection_Send(uint8 handle, const uint8 *head, uint16 head_length, const uint8 *body,
+                             uint16 body_length)
+{
+    return DoIP_Connection_SendHeld(handle, head, head_length, body, body_length, NULL_PTR);
+}
+
+boolean DoIP_Connection_SendHeld(uint8 handle, const uint8 *head, uint16 head_length, const uint8 *body,
+                                 uint16 body_length, DoIP_TxHold *hold)
+{
+    boolean sent;
+    
+    if ((body == NULL_PTR) || (body_length == 0))
+    {
+        hold = NULL_PTR;
+    }
+    
+    /* Counted before the Ethernet core can release it, taken back if nothing was sent */
+    if (hold != NULL_PTR)
+    {
+        hold->queued++;
+    }
+    
+    sent = SendMessage(handle, head, head_length, body, body_length, hold);
+    
+    if (!sent && (hold != NULL_PTR))
+    {
+        hold->queued--;
+    }
+    
+    return sent;
+}
+
+boolean DoIP_Connection_SendPosted(uint8 handle, const uint8 *data, uint16 length)
+{
+    DoIP_TxBodyRef ref;
+    
+    if (length < sizeof(ref))
+    {
+        return FALSE;
+    }
+    
+    /* The slot is only 2-byte aligned, copy the descriptor out */
+    memcpy(&ref, data, sizeof(ref));
+    
+    /* Already counted in the hold by the sender */
+    if (!SendMessage(handle, &data[sizeof(ref)], (uint16)(length - sizeof(ref)), ref.body, ref.bodyLength,
+                     ref.hold))
+    {
+        if (ref.hold != NULL_PTR)
+        {
+            ref.hold->released++;   /* Connection gone: the message is dropped */
+        }
+        return FALSE;
+    }
+    
+    return TRUE;
+}
+
+boolean DoIP_Connection_TxReady(uint8 handle)
+{
+    const DoIP_Connection *conn = DoIP_Connection_FromHandle(handle);
+    
+    return ((conn == NULL) || DoIP_TxStream_Ready(&conn->tx)) ? TRUE : FALSE;
+}
+
+void DoIP_Connection_Flush(void)
+{
+    /* Off the Ethernet core the mailbox consumer flushes after draining */
+    if (!Ipc_onNetCore())
+    {
+        return;
+    }
+    
+    for (uint8 i = 0; i < DOIP_CONNECTION_COUNT; i++)
+    {
+        DoIP_Connection *conn = &g_connections[i];
+    
+        if (conn->pcb == NULL)
+        {
+            continue;
+        }
+    
+        /* tcp_write() may have run out of pbufs with nothing in flight to trigger tcp_sent */
+        if (DoIP_TxStream_Resume(&conn->tx, conn->pcb))
+        {
+            conn->output = TRUE;
+        }
+    
+        if (conn->output)
+        {
+            conn->output = FALSE;
+            tcp_output(conn->pcb);
+        }
+    }
+}
+
+boolean DoIP_Connection_ForwardDiagnostic(const DoIP_Connection *conn, const uint8 *payload, uint16 payload_len)
+{
+#if IPC_SPLIT_CORES
+    /* UDS runs on the application core */
+    if (!Ipc_Mailbox_postChannel(&g_Ipc_netToApp, IPC_MSG_DIAG_REQUEST, conn->handle, payload, payload_len))
+    {
+        LOG_MSG(DOIP, WARN, "[DoIP] RX: Mailbox full, request dropped\r\n", 42);
+        return FALSE;
+    }
+#else
+    DoIP_Connection_HandleDiagnostic(conn->handle, payload, payload_len);
+#endif
+    
+    return TRUE;
+}
+
+void DoIP_Connection_HandleDiagnostic(uint8 handle, const uint8 *payload, uint32 payload_len)
+{
+    /* Request, response and frame come from the pool, not from the 2 KB user stack */
+    UDS_Transaction *transaction = UDS_Transaction_Alloc();
+    if (transaction == NULL)
+    {
+        LOG_MSG(UDS, WARN, "[UDS] Transaction pool exhausted, request dropped\r\n", 51);
+        return;
+    }
+    
+    transaction->connection = handle;
+    
+    /* Parse UDS request from DoIP payload */
+    if (UDS_ParseDoIPDiagnostic(payload, payload_len, &transaction->request) &&
+        UDS_HandleRequest(&transaction->request, &transaction->response))
+    {
+        /* Send the response now, or keep the transaction for a deferred job */
+        UDS_Transaction_Complete(transaction);
+        return;
+    }
+    
+    UDS_Transaction_Free(transaction);
+}
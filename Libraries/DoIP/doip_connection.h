@@ -0,0 +1,176 @@
+/**
+ * @file doip_connection.h
+ * @brief DoIP TCP Connection Contexts
+ * @details Every DoIP connection, the client connection to the VMG and each
+ *          tester socket of the server, is a DoIP_Connection from one static
+ *          pool: its PCB, receive reassembly, transmit stream, routing state
+ *          and inactivity timer. Connections are used on the Ethernet core.
+ *
+ *          The application core names a connection by its handle, the pool
+ *          index with a generation count that changes whenever the slot is
+ *          reopened. Requests are tagged with the handle of the connection
+ *          they came in on and their responses are sent back to it; a
+ *          response for a connection that has since closed is dropped
+ *          instead of reaching the next tester on the same slot.
+ */
+
+#ifndef DOIP_CONNECTION_H
+#define DOIP_CONNECTION_H
+
+#include "doip_types.h"
+#include "doip_reassembly.h"
+#include "doip_tx_stream.h"
+#include "lwip/tcp.h"
+#include "Timer_Wheel.h"
+
+/*******************************************************************************
+ * Configuration
+ ******************************************************************************/
+
+#define DOIP_CONNECTION_VMG         0       /* Pool index of the client connection to the VMG */
+#define DOIP_CONNECTION_COUNT       (1 + DOIP_SERVER_MAX_CONNECTIONS)
+
+#define DOIP_HANDLE_INDEX_BITS      4
+#define DOIP_HANDLE_INDEX_MASK      ((1U << DOIP_HANDLE_INDEX_BITS) - 1)
+
+#if DOIP_CONNECTION_COUNT > (1 << DOIP_HANDLE_INDEX_BITS)
+#error "DOIP_SERVER_MAX_CONNECTIONS does not fit the connection handle"
+#endif
+
+/*******************************************************************************
+ * Types
+ ******************************************************************************/
+
+typedef enum
+{
+    DOIP_CONN_FREE = 0,             /* No TCP connection */
+    DOIP_CONN_OPEN,                 /* TCP connected, routing not activated */
+    DOIP_CONN_PENDING,              /* Routing activation waits for the alive check of another socket */
+    DOIP_CONN_ACTIVE,               /* Routing activated */
+    DOIP_CONN_CLOSING               /* Final response written, closed once the current receive returns */
+    
+} DoIP_ConnectionState;
+
+typedef struct
+{
+    struct tcp_pcb  *pcb;           /* NULL once closed or freed by lwIP */
+    uint8            handle;        /* Pool index | generation << DOIP_HANDLE_INDEX_BITS */
+    uint8            state;         /* DoIP_ConnectionState */
+    boolean          output;        /* Data written since the last tcp_output() */
+    boolean          alive_check;   /* Alive check request sent, no response yet */
+    uint16           tester_address;    /* Routed (or requested, while pending) source address */
+    uint32           last_activity;     /* Timer_nowMs() of the last message received */
+    uint32           alive_sent;        /* Timer_nowMs() of the alive check request */
+    Timer_Entry      timer;             /* Next inactivity or alive check deadline (server sockets) */
+    DoIP_Reassembly  rx;
+    DoIP_TxStream    tx;
+    
+} DoIP_Connection;
+
+/* Called for every complete message received on a connection */
+typedef void (*DoIP_MessageHandler)(DoIP_Connection *conn, const DoIP_Header *header, const uint8 *payload);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Connection slot by pool index
+ */
+DoIP_Connection *DoIP_Connection_At(uint8 index);
+
+/**
+ * @brief Open connection with this handle
+ * @return NULL if the connection was closed (or its slot reopened) since
+ */
+DoIP_Connection *DoIP_Connection_FromHandle(uint8 handle);
+
+/**
+ * @brief Start a new connection on a slot
+ * @details Starts a new generation, clears both streams and makes the
+ *          connection the PCB's callback argument.
+ */
+void DoIP_Connection_Open(DoIP_Connection *conn, struct tcp_pcb *pcb);
+
+/**
+ * @brief Release the PCB (if lwIP has not freed it) and free the slot
+ * @details Also stops the connection's timer.
+ * @param conn Connection
+ * @param abort TRUE to reset the TCP connection instead of closing it
+ * @return ERR_ABRT if the PCB was aborted (return it from the lwIP callback), ERR_OK otherwise
+ */
+err_t DoIP_Connection_Close(DoIP_Connection *conn, boolean abort);
+
+/**
+ * @brief Handle received data
+ * @details Appends p to the connection's reassembly and calls handler for
+ *          every complete message; generic header NACKs are sent here.
+ *          Also restarts the inactivity timer.
+ */
+void DoIP_Connection_Receive(DoIP_Connection *conn, const struct pbuf *p, DoIP_MessageHandler handler);
+
+/**
+ * @brief Send a DoIP message made of a copied head and a streamed body
+ * @details The body is not copied: it is written into the TCP segments
+ *          straight from its location as send buffer space becomes free, so
+ *          it must be static and stay valid until written. Off the Ethernet
+ *          core the head (at most DOIP_TX_HEAD_SIZE) and a reference to the
+ *          body are posted to the app-to-net mailbox with the handle.
+ * @param handle Connection handle
+ * @param head DoIP header and the first payload bytes
+ * @param head_length Length of head
+ * @param body Remaining payload, NULL_PTR if none
+ * @param body_length Length of body
+ * @return TRUE if written or queued, FALSE otherwise
+ */
+boolean DoIP_Connection_Send(uint8 handle, const uint8 *head, uint16 head_length, const uint8 *body,
+                             uint16 body_length);
+
+/**
+ * @brief Send a DoIP message whose body is referenced until acknowledged
+ * @details Like DoIP_Connection_Send(), but the body is handed to lwIP by
+ *          reference instead of being copied into the send buffer, so it must
+ *          not change until the peer has acknowledged it: hold counts the
+ *          message from this call until then (or until it is dropped), and
+ *          the owner of the body leaves it alone while DoIP_TxHold_Busy().
+ * @param hold Hold of the body, NULL_PTR to copy it as DoIP_Connection_Send()
+ * @return TRUE if written or queued, FALSE otherwise (hold unchanged)
+ */
+boolean DoIP_Connection_SendHeld(uint8 handle, const uint8 *head, uint16 head_length, const uint8 *body,
+                                 uint16 body_length, DoIP_TxHold *hold);
+
+/**
+ * @brief Send a message posted with IPC_MSG_DOIP_STREAM (Ethernet core)
+ */
+boolean DoIP_Connection_SendPosted(uint8 handle, const uint8 *data, uint16 length);
+
+/**
+ * @brief TRUE if the connection can take another message (Ethernet core)
+ * @details Also TRUE for a closed connection: its messages are dropped.
+ */
+boolean DoIP_Connection_TxReady(uint8 handle);
+
+/**
+ * @brief Write what waits for send buffer space and push written data out
+ * @details Ethernet core: every connection; elsewhere the mailbox consumer
+ *          flushes after draining, so this does nothing.
+ */
+void DoIP_Connection_Flush(void);
+
+/**
+ * @brief Pass a diagnostic message to UDS on the application core
+ * @details Posted to the net-to-app mailbox when UDS runs on another core.
+ * @return FALSE if the mailbox is full
+ */
+boolean DoIP_Connection_ForwardDiagnostic(const DoIP_Connection *conn, const uint8 *payload, uint16 payload_len);
+
+/**
+ * @brief Run a DoIP diagnostic message through UDS and send the response
+ * @details Called on the application core.
+ * @param handle Connection the request came in on, the response goes there
+ * @param payload DoIP diagnostic message payload (after DoIP header)
+ * @param payload_len Length of payload
+ */
+void DoIP_Connection_HandleDiagnostic(uint8 handle, const uint8 *payload, uint32 payload_len);
+
+#endif /* DOIP_CONNECTION_H */
@@ -47,6 +47,13 @@ void DoIP_CreateHeader(uint8 *buffer, uint16 payloadType, uint32 payloadLength)
     writeUint32BE(&buffer[4], payloadLength);
 }
 
+uint16 DoIP_EmitHeader(uint8 *buffer, const DoIP_HeaderTemplate *tpl, uint32 payloadLength)
+{
+    memcpy(buffer, tpl->bytes, DOIP_HEADER_SIZE - 4);
+    writeUint32BE(&buffer[4], payloadLength);
+    return DOIP_HEADER_SIZE;
+}
+
 boolean DoIP_ParseHeader(const uint8 *buffer, DoIP_Header *header)
 {
     /* Validate protocol version */
@@ -91,6 +98,60 @@ boolean DoIP_ParseRoutingActivationResponse(const uint8 *payload, uint32 payload
     return TRUE;
 }
 
+boolean DoIP_ParseRoutingActivationRequest(const uint8 *payload, uint32 payloadLength, uint16 *sourceAddress,
+                                           uint8 *activationType)
+{
+    /* Minimum payload: Source (2) + Activation Type (1) + Reserved (4) = 7 bytes, OEM specific (4) optional */
+    if (payloadLength < 7)
+    {
+        return FALSE;
+    }
+    
+    *sourceAddress = readUint16BE(&payload[0]);
+    *activationType = payload[2];
+    
+    return TRUE;
+}
+
+uint16 DoIP_CreateRoutingActivationResponse(uint8 *buffer, uint16 testerAddress, uint16 entityAddress,
+                                            uint8 responseCode)
+{
+    /* Create header */
+    uint32 payloadLength = 9;  /* Tester (2) + Entity (2) + Response Code (1) + Reserved (4) */
+    DoIP_CreateHeader(buffer, DOIP_ROUTING_ACTIVATION_RES, payloadLength);
+    
+    /* Create payload */
+    writeUint16BE(&buffer[8], testerAddress);
+    writeUint16BE(&buffer[10], entityAddress);
+    buffer[12] = responseCode;
+    writeUint32BE(&buffer[13], 0x00000000);     /* Reserved */
+    
+    return DOIP_HEADER_SIZE + (uint16)payloadLength;
+}
+
+uint16 DoIP_CreateAliveCheckRequest(uint8 *buffer)
+{
+    /* Header only */
+    DoIP_CreateHeader(buffer, DOIP_ALIVE_CHECK_REQ, 0);
+    
+    return DOIP_HEADER_SIZE;
+}
+
+uint16 DoIP_CreateDiagnosticAck(uint8 *buffer, uint16 sourceAddress, uint16 targetAddress, uint8 nackCode)
+{
+    /* Create header */
+    uint32 payloadLength = 5;  /* Source (2) + Target (2) + ACK/NACK Code (1), no previous message echoed */
+    DoIP_CreateHeader(buffer, (nackCode == 0x00) ? DOIP_DIAGNOSTIC_MESSAGE_ACK : DOIP_DIAGNOSTIC_MESSAGE_NACK,
+                      payloadLength);
+    
+    /* Create payload */
+    writeUint16BE(&buffer[8], sourceAddress);
+    writeUint16BE(&buffer[10], targetAddress);
+    buffer[12] = nackCode;
+    
+    return DOIP_HEADER_SIZE + (uint16)payloadLength;
+}
+
 uint16 DoIP_CreateAliveCheckResponse(uint8 *buffer, uint16 sourceAddress)
 {
     /* Create header */
@@ -103,6 +164,18 @@ uint16 DoIP_CreateAliveCheckResponse(uint8 *buffer, uint16 sourceAddress)
     return DOIP_HEADER_SIZE + (uint16)payloadLength;
 }
 
+uint16 DoIP_CreateGenericNack(uint8 *buffer, uint8 nackCode)
+{
+    /* Create header */
+    uint32 payloadLength = 1;  /* NACK Code (1) */
+    DoIP_CreateHeader(buffer, DOIP_GENERIC_NACK, payloadLength);
+    
+    /* Create payload */
+    buffer[8] = nackCode;
+    
+    return DOIP_HEADER_SIZE + (uint16)payloadLength;
+}
+
 /* Legacy function - No longer used (replaced by DoIP_Client_SendHealthStatusReport) */
 uint16 DoIP_CreateZoneStatusReport(uint8 *buffer, uint8 zoneCount, const uint8 *zoneData)
 {
@@ -8,6 +8,21 @@
 
 #include "doip_types.h"
 
+/*******************************************************************************
+ * Types
+ ******************************************************************************/
+
+/* Pre-serialized DoIP header of one payload type, only the payload length varies */
+typedef struct
+{
+    uint8 bytes[DOIP_HEADER_SIZE];
+    
+} DoIP_HeaderTemplate;
+
+#define DOIP_HEADER_TEMPLATE(payloadType) \
+    { { DOIP_PROTOCOL_VERSION, DOIP_INVERSE_VERSION, \
+        (uint8)(((payloadType) >> 8) & 0xFF), (uint8)((payloadType) & 0xFF), 0, 0, 0, 0 } }
+
 /*******************************************************************************
  * Function Prototypes
  ******************************************************************************/
@@ -28,6 +43,15 @@ void DoIP_CreateHeader(uint8 *buffer, uint16 payloadType, uint32 payloadLength);
  */
 boolean DoIP_ParseHeader(const uint8 *buffer, DoIP_Header *header);
 
+/**
+ * @brief Emit a DoIP header from a template
+ * @param buffer Output buffer (min 8 bytes)
+ * @param tpl Header template of the payload type (DOIP_HEADER_TEMPLATE)
+ * @param payloadLength Payload length
+ * @return Header length
+ */
+uint16 DoIP_EmitHeader(uint8 *buffer, const DoIP_HeaderTemplate *tpl, uint32 payloadLength);
+
 /**
  * @brief Create Routing Activation Request
  * @param buffer Output buffer
@@ -45,6 +69,45 @@ uint16 DoIP_CreateRoutingActivationRequest(uint8 *buffer, uint16 sourceAddress);
  */
 boolean DoIP_ParseRoutingActivationResponse(const uint8 *payload, uint32 payloadLength, uint8 *responseCode);
 
+/**
+ * @brief Parse Routing Activation Request (server)
+ * @param payload Payload data (without header)
+ * @param payloadLength Payload length
+ * @param sourceAddress Output tester source address
+ * @param activationType Output activation type
+ * @return TRUE if successful, FALSE if the payload is too short
+ */
+boolean DoIP_ParseRoutingActivationRequest(const uint8 *payload, uint32 payloadLength, uint16 *sourceAddress,
+                                           uint8 *activationType);
+
+/**
+ * @brief Create Routing Activation Response (server)
+ * @param buffer Output buffer (min 17 bytes)
+ * @param testerAddress Tester source address of the request
+ * @param entityAddress Logical address of this DoIP entity
+ * @param responseCode Response code (DoIP_RoutingActivationResponse)
+ * @return Message length
+ */
+uint16 DoIP_CreateRoutingActivationResponse(uint8 *buffer, uint16 testerAddress, uint16 entityAddress,
+                                            uint8 responseCode);
+
+/**
+ * @brief Create Alive Check Request (server)
+ * @param buffer Output buffer (min 8 bytes)
+ * @return Message length
+ */
+uint16 DoIP_CreateAliveCheckRequest(uint8 *buffer);
+
+/**
+ * @brief Create Diagnostic Message Positive/Negative Acknowledge (server)
+ * @param buffer Output buffer (min 13 bytes)
+ * @param sourceAddress Logical address of this DoIP entity
+ * @param targetAddress Tester address
+ * @param nackCode 0x00 for a positive acknowledge, DoIP_DiagnosticNackCode otherwise
+ * @return Message length
+ */
+uint16 DoIP_CreateDiagnosticAck(uint8 *buffer, uint16 sourceAddress, uint16 targetAddress, uint8 nackCode);
+
 /**
  * @brief Create Alive Check Response
  * @param buffer Output buffer
@@ -53,6 +116,14 @@ boolean DoIP_ParseRoutingActivationResponse(const uint8 *payload, uint32 payload
  */
 uint16 DoIP_CreateAliveCheckResponse(uint8 *buffer, uint16 sourceAddress);
 
+/**
+ * @brief Create Generic DoIP Header Negative Acknowledge
+ * @param buffer Output buffer (min 9 bytes)
+ * @param nackCode NACK code (DoIP_GenericNackCode)
+ * @return Message length
+ */
+uint16 DoIP_CreateGenericNack(uint8 *buffer, uint8 nackCode);
+
 /**
  * @brief Create Zone Status Report
  * @param buffer Output buffer
@@ -0,0 +1,155 @@
+/**
+ * @file doip_reassembly.c
+ * @brief DoIP TCP Stream Reassembly Implementation
+ */
+
+#include "doip_reassembly.h"
+#include "doip_message.h"
+#include <string.h>
+
+#define DOIP_RX_MASK    (DOIP_RX_BUFFER_SIZE - 1)
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static uint8 PeekByte(const DoIP_Reassembly *rx, uint32 position)
+{
+    return rx->ring[position & DOIP_RX_MASK];
+}
+
+/* Copy bytes out of the ring, handling the wrap at the ring end */
+static void CopyOut(const DoIP_Reassembly *rx, uint32 position, uint8 *dest, uint32 length)
+{
+    uint32 offset = position & DOIP_RX_MASK;
+    uint32 first = DOIP_RX_BUFFER_SIZE - offset;
+    
+    if (first > length)
+    {
+        first = length;
+    }
+    
+    memcpy(dest, &rx->ring[offset], first);
+    memcpy(&dest[first], rx->ring, length - first);
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_Reassembly_Reset(DoIP_Reassembly *rx)
+{
+    rx->head = 0;
+    rx->tail = 0;
+    rx->skip = 0;
+    rx->resync = FALSE;
+}
+
+uint16 DoIP_Reassembly_Append(DoIP_Reassembly *rx, const struct pbuf *p, uint16 offset)
+{
+    uint32 space = DOIP_RX_BUFFER_SIZE - (rx->head - rx->tail);
+    uint32 length = (uint32)(p->tot_len - offset);
+    uint32 position = rx->head & DOIP_RX_MASK;
+    uint32 first;
+    
+    if (length > space)
+    {
+        length = space;
+    }
+    
+    first = DOIP_RX_BUFFER_SIZE - position;
+    if (first > length)
+    {
+        first = length;
+    }
+    
+    pbuf_copy_partial(p, &rx->ring[position], (u16_t)first, offset);
+    if (length > first)
+    {
+        pbuf_copy_partial(p, rx->ring, (u16_t)(length - first), (u16_t)(offset + first));
+    }
+    
+    rx->head += length;
+    return (uint16)length;
+}
+
+DoIP_RxResult DoIP_Reassembly_Next(DoIP_Reassembly *rx, DoIP_Header *header, const uint8 **payload,
+                                   uint8 *nackCode)
+{
+    uint8  bytes[DOIP_HEADER_SIZE];
+    uint32 position;
+    
+    /* Drop the payload of a rejected message as it streams in */
+    if (rx->skip != 0)
+    {
+        uint32 available = rx->head - rx->tail;
+        uint32 count = (rx->skip < available) ? rx->skip : available;
+        
+        rx->tail += count;
+        rx->skip -= count;
+        
+        if (rx->skip != 0)
+        {
+            return DOIP_RX_NEED_DATA;
+        }
+    }
+    
+    /* Resynchronize on the next version pattern; every byte is inspected once */
+    while ((rx->head - rx->tail) >= 2)
+    {
+        if (PeekByte(rx, rx->tail) == DOIP_PROTOCOL_VERSION &&
+            PeekByte(rx, rx->tail + 1) == DOIP_INVERSE_VERSION)
+        {
+            break;
+        }
+        
+        rx->tail++;
+        
+        /* One NACK per corrupted run, not per byte */
+        if (!rx->resync)
+        {
+            rx->resync = TRUE;
+            *nackCode = DOIP_NACK_INCORRECT_PATTERN;
+            return DOIP_RX_NACK;
+        }
+    }
+    
+    if ((rx->head - rx->tail) < DOIP_HEADER_SIZE)
+    {
+        return DOIP_RX_NEED_DATA;
+    }
+    
+    /* Parse header in place (pattern already checked) */
+    CopyOut(rx, rx->tail, bytes, DOIP_HEADER_SIZE);
+    (void)DoIP_ParseHeader(bytes, header);
+    rx->resync = FALSE;
+    
+    if (header->payloadLength > DOIP_MAX_PAYLOAD_SIZE)
+    {
+        /* Too large to buffer: skip it without losing the stream position */
+        rx->tail += DOIP_HEADER_SIZE;
+        rx->skip = header->payloadLength;
+        *nackCode = DOIP_NACK_MESSAGE_TOO_LARGE;
+        return DOIP_RX_NACK;
+    }
+    
+    if ((rx->head - rx->tail) < (DOIP_HEADER_SIZE + header->payloadLength))
+    {
+        return DOIP_RX_NEED_DATA;
+    }
+    
+    /* Payload in place unless it wraps around the ring end */
+    position = rx->tail + DOIP_HEADER_SIZE;
+    if (((position & DOIP_RX_MASK) + header->payloadLength) <= DOIP_RX_BUFFER_SIZE)
+    {
+        *payload = &rx->ring[position & DOIP_RX_MASK];
+    }
+    else
+    {
+        CopyOut(rx, position, rx->linear, header->payloadLength);
+        *payload = rx->linear;
+    }
+    
+    rx->tail = position + header->payloadLength;
+    return DOIP_RX_MESSAGE;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file doip_reassembly.h
+ * @brief DoIP TCP Stream Reassembly
+ * @details Received TCP data is appended to a circular buffer and DoIP
+ *          messages are parsed in place, so consumed bytes are never moved.
+ *          A corrupted stream is resynchronized on the next header pattern
+ *          with every byte inspected once, and a message whose payload
+ *          exceeds DOIP_MAX_PAYLOAD_SIZE is skipped while it streams in and
+ *          reported for a generic header NACK.
+ */
+
+#ifndef DOIP_REASSEMBLY_H
+#define DOIP_REASSEMBLY_H
+
+#include "doip_types.h"
+#include "lwip/pbuf.h"
+
+#if (DOIP_RX_BUFFER_SIZE & (DOIP_RX_BUFFER_SIZE - 1)) != 0
+#error "DOIP_RX_BUFFER_SIZE must be a power of two"
+#endif
+
+#if DOIP_RX_BUFFER_SIZE < (DOIP_HEADER_SIZE + DOIP_MAX_PAYLOAD_SIZE)
+#error "DOIP_RX_BUFFER_SIZE must hold a header and the largest payload"
+#endif
+
+/*******************************************************************************
+ * Types
+ ******************************************************************************/
+
+typedef enum
+{
+    DOIP_RX_NEED_DATA = 0,          /* No complete message buffered */
+    DOIP_RX_MESSAGE,                /* A complete message was returned */
+    DOIP_RX_NACK                    /* Send a generic header NACK with the returned code */
+    
+} DoIP_RxResult;
+
+typedef struct
+{
+    uint32 head;                    /* Bytes appended */
+    uint32 tail;                    /* Bytes consumed */
+    uint32 skip;                    /* Payload bytes of a rejected message still to discard */
+    boolean resync;                 /* Searching for a header, NACK already reported */
+    uint8  ring[DOIP_RX_BUFFER_SIZE];
+    uint8  linear[DOIP_MAX_PAYLOAD_SIZE];   /* Payloads that wrap around the ring end */
+    
+} DoIP_Reassembly;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Discard all buffered data
+ */
+void DoIP_Reassembly_Reset(DoIP_Reassembly *rx);
+
+/**
+ * @brief Append received data from a pbuf chain
+ * @param rx Reassembly state
+ * @param p Received pbuf chain
+ * @param offset First byte of p to append
+ * @return Bytes appended; less than remaining when the ring is full, call
+ *         DoIP_Reassembly_Next() until it returns DOIP_RX_NEED_DATA and retry
+ */
+uint16 DoIP_Reassembly_Append(DoIP_Reassembly *rx, const struct pbuf *p, uint16 offset);
+
+/**
+ * @brief Take the next complete message or NACK event
+ * @param rx Reassembly state
+ * @param header Output header (DOIP_RX_MESSAGE)
+ * @param payload Output payload pointer (DOIP_RX_MESSAGE), valid until the
+ *        next DoIP_Reassembly_Append()
+ * @param nackCode Output generic NACK code (DOIP_RX_NACK)
+ * @return Event type
+ */
+DoIP_RxResult DoIP_Reassembly_Next(DoIP_Reassembly *rx, DoIP_Header *header, const uint8 **payload,
+                                   uint8 *nackCode);
+
+#endif /* DOIP_REASSEMBLY_H */
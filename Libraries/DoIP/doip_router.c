@@ -0,0 +1,641 @@
+/**
+ * @file doip_router.c
+ * @brief DoIP Diagnostic Routing Implementation
+ */
+
+#include "doip_router.h"
+#include "doip_message.h"
+#include "uds_handler.h"
+#include "AppConfig.h"
+#include "Ifx_Lwip.h"
+#include "IfxStm.h"
+#include "Timer_Wheel.h"
+#include "UART_Log.h"
+#include "lwip/udp.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Routing Table
+ ******************************************************************************/
+
+/* Binary searched: keep it sorted by logical address (checked by DoIP_Router_Init) */
+static const DoIP_Route g_route_table[] = {
+    /* Logical address          Transport               Endpoint */
+    { DOIP_ZONE_ECU_ADDRESS,    DOIP_TRANSPORT_UDP,     { ZONE_ECU_IP_ADDR_0, ZONE_ECU_IP_ADDR_1, ZONE_ECU_IP_ADDR_2,
+                                                          ZONE_ECU_IP_ADDR_3 }, ZONE_ECU_DOIP_PORT },
+    { DOIP_ZONAL_GW_ADDRESS,    DOIP_TRANSPORT_LOCAL,   { 0, 0, 0, 0 }, 0 },
+    { DOIP_FUNCTIONAL_ADDRESS,  DOIP_TRANSPORT_FUNCTIONAL, { 0, 0, 0, 0 }, 0 },
+};
+
+#define ROUTE_TABLE_COUNT (sizeof(g_route_table) / sizeof(g_route_table[0]))
+
+/* One bit per table entry: the zone ECUs a functional request waits for */
+#define ROUTE_BITMAP_WORDS ((ROUTE_TABLE_COUNT + 31U) / 32U)
+
+/*******************************************************************************
+ * Router State Variables
+ ******************************************************************************/
+
+typedef struct
+{
+    boolean in_use;
+    uint8   connection;             /* Handle of the tester's connection */
+    uint16  ecu_address;            /* Target of the request, source of the response */
+    uint16  tester_address;         /* Source of the request, target of the response */
+    uint32  sequence;               /* Forwarding order, the oldest request is answered first */
+    uint32  sent;                   /* STM0 tick of the request or the last 0x78 */
+    
+} DoIP_RouterPending;
+
+typedef struct
+{
+    boolean in_use;
+    boolean suppressed;             /* suppressPosRspMsgIndicationBit set: silence is an answer */
+    uint8   connection;             /* Handle of the tester's connection */
+    uint16  tester_address;         /* Source of the request, target of the responses */
+    uint32  sequence;               /* Shares the order of the physical requests */
+    uint32  sent;                   /* STM0 tick of the request */
+    uint32  outstanding[ROUTE_BITMAP_WORDS];    /* ECUs still to answer */
+    uint32  pending[ROUTE_BITMAP_WORDS];        /* ... of which answered 0x78, each due P2* after its extended */
+    uint32  extended[ROUTE_TABLE_COUNT];        /* STM0 tick of each ECU's last 0x78 */
+    
+} DoIP_RouterFanout;
+
+static DoIP_RouterPending g_pending[DOIP_ROUTER_MAX_PENDING];
+static DoIP_RouterFanout  g_fanouts[DOIP_ROUTER_MAX_FANOUTS];
+static uint32             g_sequence;
+static uint32             g_timeout_ticks;
+static uint32             g_fanout_ticks;
+static DoIP_RouterStats   g_stats;
+static Timer_Entry        g_timer;      /* Deadline checks, runs while a slot is in use */
+
+static boolean UdpSend(const DoIP_Route *route, const uint8 *payload, uint16 payload_len);
+
+static DoIP_TransportSend g_transports[DOIP_TRANSPORT_COUNT] = {
+    [DOIP_TRANSPORT_LOCAL] = NULL,
+    [DOIP_TRANSPORT_UDP]   = UdpSend,
+};
+
+static struct udp_pcb *g_udp_pcb = NULL;
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static uint16 ReadUint16BE(const uint8 *buffer)
+{
+    return (uint16)(((uint16)buffer[0] << 8) | buffer[1]);
+}
+
+/* Oldest request of this tester to this ECU, NULL if none */
+static DoIP_RouterPending *FindPending(uint16 ecu_address, uint16 tester_address)
+{
+    DoIP_RouterPending *oldest = NULL;
+    
+    for (uint8 i = 0; i < DOIP_ROUTER_MAX_PENDING; i++)
+    {
+        DoIP_RouterPending *entry = &g_pending[i];
+    
+        if (entry->in_use && (entry->ecu_address == ecu_address) && (entry->tester_address == tester_address) &&
+            ((oldest == NULL) || ((sint32)(entry->sequence - oldest->sequence) < 0)))
+        {
+            oldest = entry;
+        }
+    }
+    
+    return oldest;
+}
+
+static DoIP_RouterPending *AllocPending(void)
+{
+    for (uint8 i = 0; i < DOIP_ROUTER_MAX_PENDING; i++)
+    {
+        if (!g_pending[i].in_use)
+        {
+            return &g_pending[i];
+        }
+    }
+    
+    return NULL;
+}
+
+static void FreePending(DoIP_RouterPending *entry)
+{
+    entry->in_use = FALSE;
+    g_stats.in_flight--;
+}
+
+static boolean BitTest(const uint32 *bitmap, uint16 index)
+{
+    return ((bitmap[index / 32U] & (1UL << (index % 32U))) != 0) ? TRUE : FALSE;
+}
+
+static void BitSet(uint32 *bitmap, uint16 index)
+{
+    bitmap[index / 32U] |= (1UL << (index % 32U));
+}
+
+static void BitClear(uint32 *bitmap, uint16 index)
+{
+    bitmap[index / 32U] &= ~(1UL << (index % 32U));
+}
+
+/* Zone ECUs of the table answer functional requests; the gateway itself and the functional entry do not */
+static boolean IsZoneEcu(const DoIP_Route *route)
+{
+    return (route->transport > DOIP_TRANSPORT_FUNCTIONAL) ? TRUE : FALSE;
+}
+
+/* Oldest functional request of this tester still waiting for the ECU of table entry index, NULL if none */
+static DoIP_RouterFanout *FindFanout(uint16 index, uint16 tester_address)
+{
+    DoIP_RouterFanout *oldest = NULL;
+    
+    for (uint8 i = 0; i < DOIP_ROUTER_MAX_FANOUTS; i++)
+    {
+        DoIP_RouterFanout *fanout = &g_fanouts[i];
+    
+        if (fanout->in_use && (fanout->tester_address == tester_address) && BitTest(fanout->outstanding, index) &&
+            ((oldest == NULL) || ((sint32)(fanout->sequence - oldest->sequence) < 0)))
+        {
+            oldest = fanout;
+        }
+    }
+    
+    return oldest;
+}
+
+/* Free the functional request once no ECU is left to answer */
+static boolean FinishFanout(DoIP_RouterFanout *fanout)
+{
+    for (uint16 word = 0; word < ROUTE_BITMAP_WORDS; word++)
+    {
+        if (fanout->outstanding[word] != 0)
+        {
+            return FALSE;
+        }
+    }
+    
+    fanout->in_use = FALSE;
+    return TRUE;
+}
+
+/* Stop waiting for the ECUs in expired (a subset of outstanding) */
+static void ExpireFanout(DoIP_RouterFanout *fanout, const uint32 *expired)
+{
+    for (uint16 index = 0; index < ROUTE_TABLE_COUNT; index++)
+    {
+        if (BitTest(expired, index))
+        {
+            BitClear(fanout->outstanding, index);
+            BitClear(fanout->pending, index);
+    
+            if (!fanout->suppressed)
+            {
+                LOG_TRACE(DOIP, WARN, TRACE_DOIP_ROUTE_TIMEOUT, g_route_table[index].logical_address,
+                          fanout->tester_address);
+                g_stats.silent++;
+            }
+        }
+    }
+    
+    FinishFanout(fanout);
+}
+
+/* Free pending slots and complete functional requests whose deadline passed */
+static void OnRouterTimer(void *arg)
+{
+    uint32 now = IfxStm_getLower(&MODULE_STM0);
+    boolean busy = FALSE;
+    
+    (void)arg;
+    
+    for (uint8 i = 0; i < DOIP_ROUTER_MAX_PENDING; i++)
+    {
+        DoIP_RouterPending *entry = &g_pending[i];
+    
+        if (entry->in_use && ((now - entry->sent) >= g_timeout_ticks))
+        {
+            LOG_TRACE(DOIP, WARN, TRACE_DOIP_ROUTE_TIMEOUT, entry->ecu_address, entry->tester_address);
+            FreePending(entry);
+            g_stats.timeouts++;
+        }
+    }
+    
+    for (uint8 i = 0; i < DOIP_ROUTER_MAX_FANOUTS; i++)
+    {
+        DoIP_RouterFanout *fanout = &g_fanouts[i];
+        uint32 expired[ROUTE_BITMAP_WORDS];
+        boolean any = FALSE;
+    
+        if (!fanout->in_use)
+        {
+            continue;
+        }
+    
+        /* Silent since the request, or since its own last 0x78 for longer than P2* */
+        boolean p2_expired = ((now - fanout->sent) >= g_fanout_ticks) ? TRUE : FALSE;
+    
+        for (uint16 word = 0; word < ROUTE_BITMAP_WORDS; word++)
+        {
+            expired[word] = p2_expired ? (fanout->outstanding[word] & ~fanout->pending[word]) : 0U;
+        }
+    
+        for (uint16 index = 0; index < ROUTE_TABLE_COUNT; index++)
+        {
+            if (BitTest(fanout->pending, index) && ((now - fanout->extended[index]) >= g_timeout_ticks))
+            {
+                BitSet(expired, index);
+            }
+        }
+    
+        for (uint16 word = 0; word < ROUTE_BITMAP_WORDS; word++)
+        {
+            any = any || (expired[word] != 0);
+        }
+    
+        if (any)
+        {
+            ExpireFanout(fanout, expired);
+        }
+    
+        busy = busy || fanout->in_use;
+    }
+    
+    /* Nothing left to time out: the Ethernet core need not wake up for the router */
+    if (!busy && (g_stats.in_flight == 0))
+    {
+        Timer_stop(&g_timer);
+    }
+}
+
+static void StartTimer(void)
+{
+    if (!Timer_isRunning(&g_timer))
+    {
+        Timer_start(&g_Timer_net, &g_timer, DOIP_ROUTER_POLL_MS, DOIP_ROUTER_POLL_MS);
+    }
+}
+
+/* ISO 14229-1: with bit 7 of the sub-function set, ECUs only answer negatively, if at all */
+static boolean SuppressesResponse(const uint8 *payload, uint16 payload_len)
+{
+    if (payload_len < 6)
+    {
+        return FALSE;
+    }
+    
+    switch (payload[4])
+    {
+        case UDS_SID_DIAGNOSTIC_SESSION_CONTROL:
+        case UDS_SID_ECU_RESET:
+        case UDS_SID_COMMUNICATION_CONTROL:
+        case UDS_SID_TESTER_PRESENT:
+        case UDS_SID_CONTROL_DTC_SETTING:
+        {
+            return ((payload[5] & 0x80) != 0) ? TRUE : FALSE;
+        }
+    
+        default:
+        {
+            return FALSE;
+        }
+    }
+}
+
+/* Send one functional request to every zone ECU of the table */
+static uint8 Fanout(const DoIP_Connection *conn, const uint8 *payload, uint16 payload_len)
+{
+    DoIP_RouterFanout *fanout = NULL;
+    boolean sent = FALSE;
+    
+    for (uint8 i = 0; i < DOIP_ROUTER_MAX_FANOUTS; i++)
+    {
+        if (!g_fanouts[i].in_use)
+        {
+            fanout = &g_fanouts[i];
+            break;
+        }
+    }
+    
+    if (fanout == NULL)
+    {
+        g_stats.refused++;
+        return DOIP_DIAG_NACK_OUT_OF_MEMORY;
+    }
+    
+    memset(fanout->outstanding, 0, sizeof(fanout->outstanding));
+    memset(fanout->pending, 0, sizeof(fanout->pending));
+    
+    /* All requests leave before the first response is awaited */
+    for (uint16 index = 0; index < ROUTE_TABLE_COUNT; index++)
+    {
+        const DoIP_Route *route = &g_route_table[index];
+        DoIP_TransportSend send = IsZoneEcu(route) ? g_transports[route->transport] : NULL;
+    
+        if (send == NULL)
+        {
+            continue;
+        }
+    
+        if (send(route, payload, payload_len))
+        {
+            BitSet(fanout->outstanding, index);
+            sent = TRUE;
+        }
+        else
+        {
+            g_stats.send_errors++;
+        }
+    }
+    
+    if (!sent)
+    {
+        return DOIP_DIAG_NACK_TARGET_UNREACHABLE;
+    }
+    
+    fanout->in_use = TRUE;
+    fanout->suppressed = SuppressesResponse(payload, payload_len);
+    fanout->connection = conn->handle;
+    fanout->tester_address = ReadUint16BE(&payload[0]);
+    fanout->sequence = g_sequence++;
+    fanout->sent = IfxStm_getLower(&MODULE_STM0);
+    g_stats.functional++;
+    StartTimer();
+    
+    return 0x00;
+}
+
+/*******************************************************************************
+ * UDP Transport
+ ******************************************************************************/
+
+static boolean UdpSend(const DoIP_Route *route, const uint8 *payload, uint16 payload_len)
+{
+    if (g_udp_pcb == NULL)
+    {
+        return FALSE;
+    }
+    
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)(DOIP_HEADER_SIZE + payload_len), PBUF_RAM);
+    if (p == NULL)
+    {
+        return FALSE;
+    }
+    
+    /* PBUF_RAM is one contiguous buffer: header and payload go straight in */
+    uint8 *message = (uint8 *)p->payload;
+    DoIP_CreateHeader(message, DOIP_DIAGNOSTIC_MESSAGE, payload_len);
+    memcpy(&message[DOIP_HEADER_SIZE], payload, payload_len);
+    
+    ip_addr_t ecu_ip;
+    IP4_ADDR(&ecu_ip, route->ip[0], route->ip[1], route->ip[2], route->ip[3]);
+    
+    err_t err = udp_sendto(g_udp_pcb, p, &ecu_ip, route->port);
+    pbuf_free(p);
+    
+    return (err == ERR_OK) ? TRUE : FALSE;
+}
+
+static void UdpReceive(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    uint8 message[DOIP_HEADER_SIZE + DOIP_MAX_PAYLOAD_SIZE];
+    DoIP_Header header;
+    
+    (void)arg;
+    (void)upcb;
+    (void)addr;
+    (void)port;
+    
+    if (p == NULL)
+    {
+        return;
+    }
+    
+    /* One datagram, one DoIP message: anything else is not a zone ECU response */
+    if ((p->tot_len >= DOIP_HEADER_SIZE) && (p->tot_len <= sizeof(message)) &&
+        (pbuf_copy_partial(p, message, p->tot_len, 0) == p->tot_len) &&
+        DoIP_ParseHeader(message, &header) && (header.payloadType == DOIP_DIAGNOSTIC_MESSAGE) &&
+        (header.payloadLength == (uint32)(p->tot_len - DOIP_HEADER_SIZE)))
+    {
+        DoIP_Router_HandleResponse(&message[DOIP_HEADER_SIZE], (uint16)header.payloadLength);
+    }
+    else
+    {
+        g_stats.unmatched++;
+    }
+    
+    pbuf_free(p);
+}
+
+static void UdpInit(void)
+{
+    if (g_udp_pcb != NULL)
+    {
+        return;
+    }
+    
+    g_udp_pcb = udp_new();
+    if (g_udp_pcb == NULL)
+    {
+        LOG_MSG(DOIP, ERROR, "[DoIP] Router: UDP PCB creation failed\r\n", 40);
+        return;
+    }
+    
+    /* Port 13400 stays with the VCI exchange: diagnostics to and from the zone ECUs use this one */
+    if (udp_bind(g_udp_pcb, netif_ip_addr4(Ifx_Lwip_getNetIf()), DOIP_ROUTER_UDP_PORT) != ERR_OK)
+    {
+        LOG_MSG(DOIP, ERROR, "[DoIP] Router: UDP bind failed\r\n", 32);
+        udp_remove(g_udp_pcb);
+        g_udp_pcb = NULL;
+        return;
+    }
+    
+    udp_recv(g_udp_pcb, UdpReceive, NULL);
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_Router_Init(void)
+{
+    memset(g_pending, 0, sizeof(g_pending));
+    memset(g_fanouts, 0, sizeof(g_fanouts));
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_sequence = 0;
+    g_timeout_ticks = (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, DOIP_ROUTER_TIMEOUT_MS);
+    g_fanout_ticks = (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, DOIP_ROUTER_FANOUT_TIMEOUT_MS);
+    Timer_init(&g_timer, OnRouterTimer, NULL_PTR);
+    
+    /* The table is binary searched: an unsorted entry would hide addresses */
+    for (uint16 i = 1; i < ROUTE_TABLE_COUNT; i++)
+    {
+        if (g_route_table[i].logical_address <= g_route_table[i - 1].logical_address)
+        {
+            LOG_MSG(DOIP, ERROR, "[DoIP] Router: route table not sorted\r\n", 39);
+            break;
+        }
+    }
+    
+    UdpInit();
+}
+
+const DoIP_Route *DoIP_Router_Lookup(uint16 logical_address)
+{
+    uint16 low = 0;
+    uint16 high = ROUTE_TABLE_COUNT;
+    
+    while (low < high)
+    {
+        uint16 mid = (uint16)((low + high) / 2);
+    
+        if (g_route_table[mid].logical_address < logical_address)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    
+    return ((low < ROUTE_TABLE_COUNT) && (g_route_table[low].logical_address == logical_address)) ?
+           &g_route_table[low] : NULL;
+}
+
+void DoIP_Router_RegisterTransport(uint8 transport, DoIP_TransportSend send)
+{
+    /* The local transport is UDS itself, the functional one the zone ECUs' own */
+    if ((transport > DOIP_TRANSPORT_FUNCTIONAL) && (transport < DOIP_TRANSPORT_COUNT))
+    {
+        g_transports[transport] = send;
+    }
+}
+
+uint8 DoIP_Router_Forward(const DoIP_Connection *conn, const DoIP_Route *route, const uint8 *payload,
+                          uint16 payload_len)
+{
+    if (route->transport == DOIP_TRANSPORT_FUNCTIONAL)
+    {
+        return Fanout(conn, payload, payload_len);
+    }
+    
+    DoIP_TransportSend send = (route->transport < DOIP_TRANSPORT_COUNT) ? g_transports[route->transport] : NULL;
+    
+    if (send == NULL)
+    {
+        g_stats.send_errors++;
+        return DOIP_DIAG_NACK_TARGET_UNREACHABLE;
+    }
+    
+    DoIP_RouterPending *entry = AllocPending();
+    if (entry == NULL)
+    {
+        g_stats.refused++;
+        return DOIP_DIAG_NACK_OUT_OF_MEMORY;
+    }
+    
+    if (!send(route, payload, payload_len))
+    {
+        g_stats.send_errors++;
+        return DOIP_DIAG_NACK_TARGET_UNREACHABLE;
+    }
+    
+    entry->in_use = TRUE;
+    entry->connection = conn->handle;
+    entry->ecu_address = route->logical_address;
+    entry->tester_address = ReadUint16BE(&payload[0]);
+    entry->sequence = g_sequence++;
+    entry->sent = IfxStm_getLower(&MODULE_STM0);
+    StartTimer();
+    
+    g_stats.forwarded++;
+    g_stats.in_flight++;
+    if (g_stats.in_flight > g_stats.high_water)
+    {
+        g_stats.high_water = g_stats.in_flight;
+    }
+    
+    return 0x00;
+}
+
+void DoIP_Router_HandleResponse(const uint8 *payload, uint16 payload_len)
+{
+    uint8 message[DOIP_TX_BUFFER_SIZE];
+    
+    /* Source (2) + Target (2) + at least the SID */
+    if ((payload_len < 5) || (payload_len > (sizeof(message) - DOIP_HEADER_SIZE)))
+    {
+        g_stats.unmatched++;
+        return;
+    }
+    
+    uint16 ecu_address = ReadUint16BE(&payload[0]);
+    uint16 tester_address = ReadUint16BE(&payload[2]);
+    const DoIP_Route *route = DoIP_Router_Lookup(ecu_address);
+    DoIP_RouterPending *entry = FindPending(ecu_address, tester_address);
+    DoIP_RouterFanout *fanout = (route != NULL) ? FindFanout((uint16)(route - g_route_table), tester_address) : NULL;
+    
+    /* 0x7F <SID> 0x78: the ECU needs longer, the request stays pending with a fresh timer */
+    boolean response_pending = ((payload_len == 7) && (payload[4] == UDS_SID_NEGATIVE_RESPONSE) &&
+                                (payload[6] == UDS_NRC_REQUEST_CORRECTLY_RECEIVED)) ? TRUE : FALSE;
+    uint32 now = IfxStm_getLower(&MODULE_STM0);
+    uint8 connection;
+    
+    /* Physical and functional requests of a tester are answered in the order they were sent */
+    if ((fanout != NULL) && ((entry == NULL) || ((sint32)(fanout->sequence - entry->sequence) < 0)))
+    {
+        uint16 index = (uint16)(route - g_route_table);
+    
+        connection = fanout->connection;
+    
+        if (response_pending)
+        {
+            BitSet(fanout->pending, index);
+            fanout->extended[index] = now;
+            g_stats.pending++;
+        }
+        else
+        {
+            BitClear(fanout->outstanding, index);
+            BitClear(fanout->pending, index);
+            g_stats.responses++;
+    
+            if (FinishFanout(fanout))
+            {
+                g_stats.fanouts_complete++;
+            }
+        }
+    }
+    else if (entry != NULL)
+    {
+        connection = entry->connection;
+    
+        if (response_pending)
+        {
+            entry->sent = now;
+            g_stats.pending++;
+        }
+        else
+        {
+            FreePending(entry);
+            g_stats.responses++;
+        }
+    }
+    else
+    {
+        g_stats.unmatched++;
+        return;
+    }
+    
+    /* A tester that has since disconnected no longer matches the handle: dropped */
+    DoIP_CreateHeader(message, DOIP_DIAGNOSTIC_MESSAGE, payload_len);
+    memcpy(&message[DOIP_HEADER_SIZE], payload, payload_len);
+    DoIP_Connection_Send(connection, message, (uint16)(DOIP_HEADER_SIZE + payload_len), NULL_PTR, 0);
+}
+
+const DoIP_RouterStats *DoIP_Router_GetStats(void)
+{
+    return &g_stats;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file doip_router.h
+ * @brief DoIP Diagnostic Routing to Zone ECUs
+ * @details Diagnostic messages are routed by their target logical address.
+ *          A const table, sorted by address, maps every address the gateway
+ *          answers for to a transport and an endpoint: the gateway itself
+ *          (local UDS), or a zone ECU reached over UDP or any transport
+ *          registered with DoIP_Router_RegisterTransport().
+ *
+ *          Messages for a zone ECU are forwarded on the Ethernet core as
+ *          they arrive, without the hop to the application core, and each is
+ *          remembered in a pending slot with the handle of its connection.
+ *          A response from the ECU goes to the oldest pending request of the
+ *          same tester for the same ECU, so any number of requests (up to
+ *          DOIP_ROUTER_MAX_PENDING in total) can be in flight per ECU. A
+ *          0x78 response pending is passed on and keeps the slot.
+ *
+ *          A request to DOIP_FUNCTIONAL_ADDRESS fans out to every zone ECU of
+ *          the table at once. The ECUs still to answer are a bitmap indexed
+ *          like the table; their responses stream back to the tester as they
+ *          arrive, and the request completes when the bitmap is empty or its
+ *          deadline has passed: DOIP_ROUTER_FANOUT_TIMEOUT_MS, or P2* for an
+ *          ECU that answered 0x78. A read from N ECUs thus costs one round
+ *          trip, not N. Deadlines are checked every DOIP_ROUTER_POLL_MS by a
+ *          timer of the Ethernet core's wheel, which only runs while a
+ *          pending slot or functional request is in use.
+ *
+ *          The UDP transport carries the DoIP diagnostic message (header,
+ *          SA, TA, UDS) unchanged in one datagram in both directions.
+ */
+
+#ifndef DOIP_ROUTER_H
+#define DOIP_ROUTER_H
+
+#include "doip_types.h"
+#include "doip_connection.h"
+#include "Ifx_Types.h"
+
+/*******************************************************************************
+ * Configuration
+ ******************************************************************************/
+
+#define DOIP_ROUTER_MAX_PENDING     16      /* Forwarded requests awaiting a response, all ECUs together */
+#define DOIP_ROUTER_TIMEOUT_MS      6000    /* Pending slot freed after P2*server (5 s) plus margin */
+#define DOIP_ROUTER_UDP_PORT        13401   /* Local port of the UDP transport, ECU responses come back here */
+#define DOIP_ROUTER_MAX_FANOUTS     16      /* Functional requests awaiting responses, all testers together */
+#define DOIP_ROUTER_FANOUT_TIMEOUT_MS   200 /* Per ECU: P2server (50 ms) plus the zone network */
+#define DOIP_ROUTER_POLL_MS         10      /* Deadline check period while requests are in flight */
+
+/*******************************************************************************
+ * Types
+ ******************************************************************************/
+
+typedef enum
+{
+    DOIP_TRANSPORT_LOCAL = 0,       /* The gateway's own UDS server */
+    DOIP_TRANSPORT_FUNCTIONAL,      /* Every zone ECU of the routing table */
+    DOIP_TRANSPORT_UDP,             /* DoIP diagnostic message in a UDP datagram */
+    DOIP_TRANSPORT_COUNT
+    
+} DoIP_TransportId;
+
+typedef struct
+{
+    uint16 logical_address;         /* Target address of the diagnostic message */
+    uint8  transport;               /* DoIP_TransportId */
+    uint8  ip[4];                   /* Endpoint IPv4 address (UDP) */
+    uint16 port;                    /* Endpoint port (UDP) */
+    
+} DoIP_Route;
+
+/**
+ * @brief Deliver a diagnostic message payload (SA, TA, UDS) to a zone ECU
+ * @details The transport frames it as its link needs; responses are handed
+ *          to DoIP_Router_HandleResponse() on the Ethernet core.
+ * @return TRUE if sent
+ */
+typedef boolean (*DoIP_TransportSend)(const DoIP_Route *route, const uint8 *payload, uint16 payload_len);
+
+typedef struct
+{
+    uint32 forwarded;               /* Requests sent to a zone ECU */
+    uint32 responses;               /* Final responses passed back to a tester */
+    uint32 pending;                 /* 0x78 responses passed back */
+    uint32 unmatched;               /* ECU messages without a pending request, dropped */
+    uint32 timeouts;                /* Pending slots freed unanswered */
+    uint32 refused;                 /* Requests refused, all pending slots in use */
+    uint32 send_errors;             /* Transport could not send */
+    uint32 functional;              /* Functional requests fanned out */
+    uint32 fanouts_complete;        /* Functional requests answered by every ECU */
+    uint32 silent;                  /* ECUs that let a functional request time out */
+    uint8  in_flight;               /* Pending slots in use */
+    uint8  high_water;              /* Most pending slots in use at once */
+    
+} DoIP_RouterStats;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Check the routing table, clear the pending slots, open the UDP transport
+ */
+void DoIP_Router_Init(void);
+
+/**
+ * @brief Route of a logical address
+ * @return NULL if the gateway does not route the address
+ */
+const DoIP_Route *DoIP_Router_Lookup(uint16 logical_address);
+
+/**
+ * @brief Replace the transport of a DoIP_TransportId (e.g. CAN instead of UDP)
+ */
+void DoIP_Router_RegisterTransport(uint8 transport, DoIP_TransportSend send);
+
+/**
+ * @brief Forward a diagnostic message to the zone ECU of its route
+ * @param conn Connection the message came in on, the response goes there
+ * @param route Route of the target address (not DOIP_TRANSPORT_LOCAL), or the
+ *              functional route to send it to every zone ECU
+ * @param payload DoIP diagnostic message payload (SA, TA, UDS)
+ * @param payload_len Length of payload
+ * @return 0x00 if forwarded, else the DoIP_DiagnosticNackCode for the tester
+ */
+uint8 DoIP_Router_Forward(const DoIP_Connection *conn, const DoIP_Route *route, const uint8 *payload,
+                          uint16 payload_len);
+
+/**
+ * @brief Pass a diagnostic message received from a zone ECU to its tester
+ * @details Called by transports on the Ethernet core.
+ * @param payload DoIP diagnostic message payload (SA = ECU, TA = tester, UDS)
+ * @param payload_len Length of payload
+ */
+void DoIP_Router_HandleResponse(const uint8 *payload, uint16 payload_len);
+
+/**
+ * @brief Forwarding counters
+ */
+const DoIP_RouterStats *DoIP_Router_GetStats(void);
+
+#endif /* DOIP_ROUTER_H */
@@ -0,0 +1,553 @@
+/**
+ * @file doip_server.c
+ * @brief DoIP Server Implementation
+ */
+
+#include "doip_server.h"
+#include "doip_connection.h"
+#include "doip_message.h"
+#include "doip_router.h"
+#include "Ifx_Lwip.h"
+#include "Ipc_Mailbox.h"
+#include "UART_Log.h"
+
+/* Reasons reported by TRACE_DOIP_CLOSE */
+typedef enum
+{
+    DOIP_CLOSE_REMOTE = 0,          /* Closed or reset by the tester */
+    DOIP_CLOSE_INITIAL_INACTIVITY,  /* No routing activation in time */
+    DOIP_CLOSE_GENERAL_INACTIVITY,  /* Activated, but silent for too long */
+    DOIP_CLOSE_DENIED,              /* Routing activation denied */
+    DOIP_CLOSE_REPLACED             /* Did not answer the alive check for a new socket */
+    
+} DoIP_CloseReason;
+
+/*******************************************************************************
+ * Server State Variables
+ ******************************************************************************/
+
+static struct tcp_pcb  *g_listen_pcb = NULL;
+static uint16           g_entity_address;
+static DoIP_ServerStats g_stats;
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+/* Run the socket's timer until limit_ms after start, FALSE if that has already passed */
+static boolean ArmDeadline(DoIP_Connection *conn, uint32 start, uint32 limit_ms)
+{
+    uint32 elapsed = Timer_nowMs() - start;
+    
+    if (elapsed >= limit_ms)
+    {
+        return FALSE;
+    }
+    
+    Timer_start(&g_Timer_net, &conn->timer, limit_ms - elapsed, 0);
+    return TRUE;
+}
+
+static uint16 ReadUint16BE(const uint8 *buffer)
+{
+    return (uint16)(((uint16)buffer[0] << 8) | buffer[1]);
+}
+
+static boolean IsTesterAddress(uint16 address)
+{
+    return ((address >= DOIP_TESTER_ADDRESS_MIN) && (address <= DOIP_TESTER_ADDRESS_MAX)) ||
+           (address == DOIP_VMG_ADDRESS);
+}
+
+/* Tester socket other than conn with this source address activated, NULL if none */
+static DoIP_Connection *FindActive(uint16 tester_address, const DoIP_Connection *conn)
+{
+    for (uint8 i = DOIP_CONNECTION_VMG + 1; i < DOIP_CONNECTION_COUNT; i++)
+    {
+        DoIP_Connection *other = DoIP_Connection_At(i);
+    
+        if ((other != conn) && (other->state == DOIP_CONN_ACTIVE) && (other->tester_address == tester_address))
+        {
+            return other;
+        }
+    }
+    
+    return NULL;
+}
+
+static void ResolvePending(DoIP_Connection *conn);
+static void ResolveWaiting(uint16 tester_address);
+
+static err_t CloseSocket(DoIP_Connection *conn, DoIP_CloseReason reason)
+{
+    boolean routed = (conn->state == DOIP_CONN_ACTIVE);
+    err_t result;
+    
+    LOG_TRACE(DOIP, INFO, TRACE_DOIP_CLOSE, conn->handle & DOIP_HANDLE_INDEX_MASK, reason);
+    g_stats.open--;
+    result = DoIP_Connection_Close(conn, FALSE);
+    
+    /* Its address is free: activations waiting for it are granted */
+    if (routed)
+    {
+        ResolveWaiting(conn->tester_address);
+    }
+    
+    return result;
+}
+
+static void SendRoutingResponse(DoIP_Connection *conn, uint16 tester_address, uint8 code)
+{
+    uint8 buffer[DOIP_HEADER_SIZE + 9];
+    uint16 len = DoIP_CreateRoutingActivationResponse(buffer, tester_address, g_entity_address, code);
+    
+    DoIP_Connection_Send(conn->handle, buffer, len, NULL_PTR, 0);
+    LOG_TRACE(DOIP, INFO, TRACE_DOIP_ROUTING, tester_address, conn->handle & DOIP_HANDLE_INDEX_MASK, code);
+}
+
+static void GrantRouting(DoIP_Connection *conn, uint16 tester_address)
+{
+    conn->tester_address = tester_address;
+    conn->state = DOIP_CONN_ACTIVE;
+    g_stats.activations++;
+    ArmDeadline(conn, conn->last_activity, DOIP_TIMEOUT_GENERAL_INACTIVITY);
+    SendRoutingResponse(conn, tester_address, DOIP_RA_RES_SUCCESS);
+}
+
+/* Answer and close the socket, once the receive callback returns */
+static void DenyRouting(DoIP_Connection *conn, uint16 tester_address, uint8 code)
+{
+    conn->state = DOIP_CONN_CLOSING;
+    g_stats.denied++;
+    SendRoutingResponse(conn, tester_address, code);
+}
+
+static void SendDiagnosticAck(DoIP_Connection *conn, uint16 source_address, uint16 target_address, uint8 code)
+{
+    uint8 buffer[DOIP_HEADER_SIZE + 5];
+    uint16 len = DoIP_CreateDiagnosticAck(buffer, source_address, target_address, code);
+    
+    DoIP_Connection_Send(conn->handle, buffer, len, NULL_PTR, 0);
+}
+
+/*******************************************************************************
+ * Message Processing
+ ******************************************************************************/
+
+static void HandleRoutingActivation(DoIP_Connection *conn, const DoIP_Header *header, const uint8 *payload)
+{
+    uint16 tester_address;
+    uint8 activation_type;
+    
+    if (!DoIP_ParseRoutingActivationRequest(payload, header->payloadLength, &tester_address, &activation_type))
+    {
+        uint8 nack_buffer[DOIP_HEADER_SIZE + 1];
+        uint16 len = DoIP_CreateGenericNack(nack_buffer, DOIP_NACK_INVALID_PAYLOAD_LEN);
+        DoIP_Connection_Send(conn->handle, nack_buffer, len, NULL_PTR, 0);
+        return;
+    }
+    
+    if (!IsTesterAddress(tester_address))
+    {
+        DenyRouting(conn, tester_address, DOIP_RA_RES_DENIED_UNKNOWN_SA);
+        return;
+    }
+    
+    /* Default and WWH-OBD activation, no central security */
+    if (activation_type > 0x01)
+    {
+        DenyRouting(conn, tester_address, DOIP_RA_RES_DENIED_TYPE);
+        return;
+    }
+    
+    if (conn->state == DOIP_CONN_ACTIVE)
+    {
+        /* Repeated activation: confirm the same address, refuse a second one */
+        if (tester_address == conn->tester_address)
+        {
+            SendRoutingResponse(conn, tester_address, DOIP_RA_RES_SUCCESS);
+        }
+        else
+        {
+            DenyRouting(conn, tester_address, DOIP_RA_RES_DENIED_SA_DIFF);
+        }
+        return;
+    }
+    
+    DoIP_Connection *other = FindActive(tester_address, conn);
+    
+    if (other == NULL)
+    {
+        GrantRouting(conn, tester_address);
+        return;
+    }
+    
+    /* The address is routed on another socket: keep it only if that tester is still there */
+    if (!other->alive_check)
+    {
+        uint8 buffer[DOIP_HEADER_SIZE];
+        uint16 len = DoIP_CreateAliveCheckRequest(buffer);
+    
+        other->alive_check = TRUE;
+        other->alive_sent = Timer_nowMs();
+        DoIP_Connection_Send(other->handle, buffer, len, NULL_PTR, 0);
+        g_stats.alive_checks++;
+    }
+    
+    conn->tester_address = tester_address;
+    conn->state = DOIP_CONN_PENDING;
+    
+    /* An earlier alive check may already have run out */
+    if (!ArmDeadline(conn, other->alive_sent, DOIP_TIMEOUT_ALIVE_CHECK))
+    {
+        ResolvePending(conn);
+    }
+}
+
+static void HandleDiagnosticMessage(DoIP_Connection *conn, const DoIP_Header *header, const uint8 *payload)
+{
+    /* Source (2) + Target (2) + at least the SID */
+    if (header->payloadLength < 5)
+    {
+        uint8 nack_buffer[DOIP_HEADER_SIZE + 1];
+        uint16 len = DoIP_CreateGenericNack(nack_buffer, DOIP_NACK_INVALID_PAYLOAD_LEN);
+        DoIP_Connection_Send(conn->handle, nack_buffer, len, NULL_PTR, 0);
+        return;
+    }
+    
+    uint16 source_address = ReadUint16BE(&payload[0]);
+    uint16 target_address = ReadUint16BE(&payload[2]);
+    
+    if ((conn->state != DOIP_CONN_ACTIVE) || (source_address != conn->tester_address))
+    {
+        SendDiagnosticAck(conn, target_address, source_address, DOIP_DIAG_NACK_INVALID_SA);
+        return;
+    }
+    
+    const DoIP_Route *route = DoIP_Router_Lookup(target_address);
+    if (route == NULL)
+    {
+        SendDiagnosticAck(conn, target_address, source_address, DOIP_DIAG_NACK_UNKNOWN_TA);
+        return;
+    }
+    
+    /* A zone ECU: forwarded here on the Ethernet core, its response follows the acknowledge */
+    if (route->transport != DOIP_TRANSPORT_LOCAL)
+    {
+        SendDiagnosticAck(conn, target_address, source_address,
+                          DoIP_Router_Forward(conn, route, payload, (uint16)header->payloadLength));
+        return;
+    }
+    
+    /* The acknowledge must precede the diagnostic response */
+#if IPC_SPLIT_CORES
+    /* The response comes back through the app-to-net mailbox, after this callback returns */
+    if (DoIP_Connection_ForwardDiagnostic(conn, payload, (uint16)header->payloadLength))
+    {
+        SendDiagnosticAck(conn, target_address, source_address, 0x00);
+    }
+    else
+    {
+        SendDiagnosticAck(conn, target_address, source_address, DOIP_DIAG_NACK_OUT_OF_MEMORY);
+    }
+#else
+    /* The response is sent from within ForwardDiagnostic() */
+    SendDiagnosticAck(conn, target_address, source_address, 0x00);
+    DoIP_Connection_ForwardDiagnostic(conn, payload, (uint16)header->payloadLength);
+#endif
+}
+
+static void HandleTesterMessage(DoIP_Connection *conn, const DoIP_Header *header, const uint8 *payload)
+{
+    /* Whatever follows a denied activation is dropped with the socket */
+    if (conn->state == DOIP_CONN_CLOSING)
+    {
+        return;
+    }
+    
+    switch (header->payloadType)
+    {
+        case DOIP_ROUTING_ACTIVATION_REQ:
+        {
+            /* A pending activation is answered by ResolvePending() */
+            if (conn->state != DOIP_CONN_PENDING)
+            {
+                HandleRoutingActivation(conn, header, payload);
+            }
+            break;
+        }
+    
+        case DOIP_ALIVE_CHECK_REQ:
+        {
+            uint8 response_buffer[DOIP_HEADER_SIZE + 2];
+            uint16 len = DoIP_CreateAliveCheckResponse(response_buffer, g_entity_address);
+            DoIP_Connection_Send(conn->handle, response_buffer, len, NULL_PTR, 0);
+            break;
+        }
+    
+        case DOIP_ALIVE_CHECK_RES:
+        {
+            if (conn->alive_check)
+            {
+                conn->alive_check = FALSE;
+                ResolveWaiting(conn->tester_address);
+            }
+            break;
+        }
+    
+        case DOIP_DIAGNOSTIC_MESSAGE:
+        {
+            HandleDiagnosticMessage(conn, header, payload);
+            break;
+        }
+    
+        default:
+        {
+            uint8 nack_buffer[DOIP_HEADER_SIZE + 1];
+            uint16 len = DoIP_CreateGenericNack(nack_buffer, DOIP_NACK_UNKNOWN_PAYLOAD_TYPE);
+            DoIP_Connection_Send(conn->handle, nack_buffer, len, NULL_PTR, 0);
+            LOG_TRACE(DOIP, WARN, TRACE_DOIP_NACK, DOIP_NACK_UNKNOWN_PAYLOAD_TYPE);
+            break;
+        }
+    }
+}
+
+/* Settle an activation waiting for the alive check of the socket holding its address */
+static void ResolvePending(DoIP_Connection *conn)
+{
+    DoIP_Connection *other = FindActive(conn->tester_address, conn);
+    
+    if ((other != NULL) && other->alive_check)
+    {
+        if (ArmDeadline(conn, other->alive_sent, DOIP_TIMEOUT_ALIVE_CHECK))
+        {
+            return;  /* Still waiting */
+        }
+    
+        /* The registered tester is gone: the new socket takes over, closing it grants the activation */
+        CloseSocket(other, DOIP_CLOSE_REPLACED);
+        return;
+    }
+    
+    if (other == NULL)
+    {
+        GrantRouting(conn, conn->tester_address);
+    }
+    else
+    {
+        /* The registered tester answered */
+        g_stats.denied++;
+        SendRoutingResponse(conn, conn->tester_address, DOIP_RA_RES_DENIED_SA_IN_USE);
+        CloseSocket(conn, DOIP_CLOSE_DENIED);
+    }
+}
+
+/* The alive check of the socket routing tester_address has been settled */
+static void ResolveWaiting(uint16 tester_address)
+{
+    for (uint8 i = DOIP_CONNECTION_VMG + 1; i < DOIP_CONNECTION_COUNT; i++)
+    {
+        DoIP_Connection *conn = DoIP_Connection_At(i);
+    
+        if ((conn->state == DOIP_CONN_PENDING) && (conn->tester_address == tester_address))
+        {
+            ResolvePending(conn);
+        }
+    }
+}
+
+/* Inactivity and alive check deadlines: checked when the socket's timer expires, re-armed if it saw traffic since */
+static void OnSocketTimer(void *arg)
+{
+    DoIP_Connection *conn = (DoIP_Connection *)arg;
+    
+    switch (conn->state)
+    {
+        case DOIP_CONN_OPEN:
+        {
+            if (!ArmDeadline(conn, conn->last_activity, DOIP_TIMEOUT_INITIAL_INACTIVITY))
+            {
+                g_stats.inactivity_closes++;
+                CloseSocket(conn, DOIP_CLOSE_INITIAL_INACTIVITY);
+            }
+            break;
+        }
+    
+        case DOIP_CONN_PENDING:
+        {
+            ResolvePending(conn);
+            break;
+        }
+    
+        case DOIP_CONN_ACTIVE:
+        {
+            if (!ArmDeadline(conn, conn->last_activity, DOIP_TIMEOUT_GENERAL_INACTIVITY))
+            {
+                g_stats.inactivity_closes++;
+                CloseSocket(conn, DOIP_CLOSE_GENERAL_INACTIVITY);
+            }
+            break;
+        }
+    
+        default:
+        {
+            break;
+        }
+    }
+}
+
+/*******************************************************************************
+ * lwIP Callback Functions
+ ******************************************************************************/
+
+static void doip_server_error_callback(void *arg, err_t err)
+{
+    DoIP_Connection *conn = (DoIP_Connection *)arg;
+    (void)err;
+    
+    if (conn != NULL)
+    {
+        conn->pcb = NULL;  /* lwIP already freed the PCB */
+        CloseSocket(conn, DOIP_CLOSE_REMOTE);
+    }
+}
+
+static err_t doip_server_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+    DoIP_Connection *conn = (DoIP_Connection *)arg;
+    (void)len;
+    
+    /* Acknowledged: bodies sent by reference are released, send buffer space is free again -
+       continue the queued messages, tcp_input() outputs them */
+    if (conn != NULL)
+    {
+        DoIP_TxStream_Acked(&conn->tx, tpcb);
+        DoIP_TxStream_Resume(&conn->tx, tpcb);
+    }
+    
+    return ERR_OK;
+}
+
+static err_t doip_server_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+    DoIP_Connection *conn = (DoIP_Connection *)arg;
+    
+    if (p == NULL)
+    {
+        /* Connection closed by the tester */
+        return CloseSocket(conn, DOIP_CLOSE_REMOTE);
+    }
+    
+    if (err != ERR_OK)
+    {
+        pbuf_free(p);
+        return err;
+    }
+    
+    LOG_TRACE(DOIP, DEBUG, TRACE_DOIP_RX, p->tot_len);
+    
+    DoIP_Connection_Receive(conn, p, HandleTesterMessage);
+    
+    /* Acknowledge received data */
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+    
+    if (conn->state == DOIP_CONN_CLOSING)
+    {
+        /* tcp_close() sends what was written, the routing activation response, before the FIN */
+        return CloseSocket(conn, DOIP_CLOSE_DENIED);
+    }
+    
+    return ERR_OK;
+}
+
+static err_t doip_server_accept_callback(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+    (void)arg;
+    
+    if ((err != ERR_OK) || (newpcb == NULL))
+    {
+        return ERR_VAL;
+    }
+    
+    for (uint8 i = DOIP_CONNECTION_VMG + 1; i < DOIP_CONNECTION_COUNT; i++)
+    {
+        DoIP_Connection *conn = DoIP_Connection_At(i);
+    
+        if (conn->state == DOIP_CONN_FREE)
+        {
+            DoIP_Connection_Open(conn, newpcb);
+            tcp_recv(newpcb, doip_server_recv_callback);
+            tcp_sent(newpcb, doip_server_sent_callback);
+            tcp_err(newpcb, doip_server_error_callback);
+    
+            ArmDeadline(conn, conn->last_activity, DOIP_TIMEOUT_INITIAL_INACTIVITY);
+    
+            g_stats.open++;
+            g_stats.accepted++;
+            LOG_TRACE(DOIP, INFO, TRACE_DOIP_ACCEPT, i, g_stats.open);
+            return ERR_OK;
+        }
+    }
+    
+    /* All tester sockets in use */
+    g_stats.rejected++;
+    tcp_abort(newpcb);
+    return ERR_ABRT;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_Server_Init(uint16 entity_address)
+{
+    g_entity_address = entity_address;
+    
+    g_stats.open = 0;
+    g_stats.accepted = 0;
+    g_stats.rejected = 0;
+    g_stats.activations = 0;
+    g_stats.denied = 0;
+    g_stats.alive_checks = 0;
+    g_stats.inactivity_closes = 0;
+    
+    for (uint8 i = DOIP_CONNECTION_VMG + 1; i < DOIP_CONNECTION_COUNT; i++)
+    {
+        DoIP_Connection *conn = DoIP_Connection_At(i);
+    
+        DoIP_Connection_Close(conn, TRUE);
+        Timer_init(&conn->timer, OnSocketTimer, conn);
+    }
+    
+    struct tcp_pcb *pcb = tcp_new();
+    if (pcb == NULL)
+    {
+        LOG_MSG(DOIP, ERROR, "[DoIP] Server: PCB creation failed\r\n", 36);
+        return;
+    }
+    
+    /* The gateway's own address: the port stays free on any other interface */
+    if (tcp_bind(pcb, netif_ip_addr4(Ifx_Lwip_getNetIf()), DOIP_TCP_DATA_PORT) != ERR_OK)
+    {
+        LOG_MSG(DOIP, ERROR, "[DoIP] Server: bind failed\r\n", 28);
+        tcp_close(pcb);
+        return;
+    }
+    
+    g_listen_pcb = tcp_listen(pcb);
+    if (g_listen_pcb == NULL)
+    {
+        LOG_MSG(DOIP, ERROR, "[DoIP] Server: listen failed\r\n", 30);
+        tcp_close(pcb);
+        return;
+    }
+    
+    tcp_accept(g_listen_pcb, doip_server_accept_callback);
+    LOG_MSG(DOIP, INFO, "[DoIP] Server listening on port 13400\r\n", 39);
+}
+
+const DoIP_ServerStats *DoIP_Server_GetStats(void)
+{
+    return &g_stats;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file doip_server.h
+ * @brief DoIP Server (TCP_DATA) for External Test Equipment
+ * @details Listens on DOIP_TCP_DATA_PORT next to the client connection to the
+ *          VMG and serves up to DOIP_SERVER_MAX_CONNECTIONS tester sockets at
+ *          once, each a DoIP_Connection with its own reassembly, routing
+ *          activation and inactivity timer. Diagnostic messages of an
+ *          activated tester are acknowledged and passed to UDS like those of
+ *          the VMG, or to the zone ECU of their target address (doip_router.h);
+ *          the response goes back to the socket of the request.
+ *
+ *          A routing activation for a source address already active on
+ *          another socket alive-checks that socket first: it is replaced if
+ *          it does not answer within DOIP_TIMEOUT_ALIVE_CHECK. Runs on the
+ *          Ethernet core; the inactivity and alive check deadlines are timers
+ *          of its wheel, g_Timer_net.
+ */
+
+#ifndef DOIP_SERVER_H
+#define DOIP_SERVER_H
+
+#include "doip_types.h"
+#include "Ifx_Types.h"
+
+/*******************************************************************************
+ * Types
+ ******************************************************************************/
+
+typedef struct
+{
+    uint8  open;                    /* Tester sockets currently open */
+    uint32 accepted;                /* Tester connections accepted */
+    uint32 rejected;                /* Connections refused, all sockets in use */
+    uint32 activations;             /* Routing activations granted */
+    uint32 denied;                  /* Routing activations denied */
+    uint32 alive_checks;            /* Alive check requests sent */
+    uint32 inactivity_closes;       /* Sockets closed by the initial or general inactivity timer */
+    
+} DoIP_ServerStats;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Start listening for testers
+ * @param entity_address Logical address of the gateway (routing activation and diagnostic target)
+ */
+void DoIP_Server_Init(uint16 entity_address);
+
+/**
+ * @brief Connection and routing activation counters
+ */
+const DoIP_ServerStats *DoIP_Server_GetStats(void);
+
+#endif /* DOIP_SERVER_H */
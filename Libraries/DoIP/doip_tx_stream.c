@@ -0,0 +1,232 @@
+/**
+ * @file doip_tx_stream.c
+ * @brief DoIP TCP Transmit Stream Implementation
+ */
+
+#include "doip_tx_stream.h"
+#include <string.h>
+
+#define DOIP_TX_MASK    (DOIP_TX_QUEUE_DEPTH - 1)
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+/* Write from *offset on as far as the send buffer allows; TRUE once the whole message is written */
+static boolean WriteMessage(DoIP_TxStream *tx, struct tcp_pcb *pcb, const uint8 *head, uint16 headLength,
+                            const uint8 *body, uint16 bodyLength, DoIP_TxHold *hold, uint32 *offset)
+{
+    uint32 total = (uint32)headLength + bodyLength;
+    
+    while (*offset < total)
+    {
+        const uint8 *data;
+        uint32 length;
+        uint32 space = tcp_sndbuf(pcb);
+        u8_t flags = TCP_WRITE_FLAG_COPY;
+        boolean byReference = FALSE;
+    
+        if (*offset < headLength)
+        {
+            data = &head[*offset];
+            length = headLength - *offset;
+        }
+        else
+        {
+            data = &body[*offset - headLength];
+            length = total - *offset;
+    
+            /* The first body byte decides: referenced if there is a slot to track it, copied otherwise */
+            if ((hold != NULL_PTR) && (*offset == headLength) && !tx->heldOpen &&
+                ((tx->heldHead - tx->heldTail) < DOIP_TX_QUEUE_DEPTH))
+            {
+                tx->held[tx->heldHead & DOIP_TX_MASK] = hold;
+                tx->heldHead++;
+                tx->heldOpen = TRUE;
+            }
+    
+            if ((hold != NULL_PTR) && tx->heldOpen)
+            {
+                byReference = TRUE;
+                flags = 0;
+            }
+        }
+    
+        if (length > space)
+        {
+            length = space;
+        }
+    
+        if (length == 0)
+        {
+            return FALSE;   /* Send buffer full: resumed from tcp_sent */
+        }
+    
+        /* PSH only on the last segment of the message */
+        if ((*offset + length) < total)
+        {
+            flags |= TCP_WRITE_FLAG_MORE;
+        }
+    
+        if (tcp_write(pcb, data, (u16_t)length, flags) != ERR_OK)
+        {
+            return FALSE;   /* Out of segments or pbufs: retried later */
+        }
+    
+        *offset += length;
+    
+        if (byReference)
+        {
+            tx->heldEnd[(tx->heldHead - 1) & DOIP_TX_MASK] = pcb->snd_lbb;
+        }
+    }
+    
+    if (hold != NULL_PTR)
+    {
+        if (tx->heldOpen)
+        {
+            tx->heldOpen = FALSE;   /* Released by DoIP_TxStream_Acked() */
+        }
+        else
+        {
+            hold->released++;       /* Copied: nothing left to reference */
+        }
+    }
+    
+    return TRUE;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_TxStream_Reset(DoIP_TxStream *tx)
+{
+    /* Queued messages that never reached the send buffer by reference */
+    for (uint32 i = tx->tail; i != tx->head; i++)
+    {
+        DoIP_TxHold *hold = tx->queue[i & DOIP_TX_MASK].hold;
+    
+        if ((hold != NULL_PTR) && !((i == tx->tail) && tx->heldOpen))
+        {
+            hold->released++;
+        }
+    }
+    
+    /* Bodies lwIP referenced: the segments are gone with the PCB */
+    for (uint32 i = tx->heldTail; i != tx->heldHead; i++)
+    {
+        tx->held[i & DOIP_TX_MASK]->released++;
+    }
+    
+    tx->heldHead = 0;
+    tx->heldTail = 0;
+    tx->heldOpen = FALSE;
+    tx->head = 0;
+    tx->tail = 0;
+    tx->offset = 0;
+}
+
+boolean DoIP_TxStream_Send(DoIP_TxStream *tx, struct tcp_pcb *pcb, const uint8 *head, uint16 headLength,
+                           const uint8 *body, uint16 bodyLength, DoIP_TxHold *hold)
+{
+    DoIP_TxMessage *msg;
+    uint32 offset = 0;
+    
+    if (!DoIP_TxStream_Ready(tx) || (headLength > DOIP_TX_BUFFER_SIZE))
+    {
+        return FALSE;
+    }
+    
+    /* Nothing waiting: write straight from the caller's buffers */
+    if (tx->head == tx->tail)
+    {
+        if (WriteMessage(tx, pcb, head, headLength, body, bodyLength, hold, &offset))
+        {
+            return TRUE;
+        }
+    }
+    
+    /* Queue the rest, only the unwritten part of the head is copied */
+    msg = &tx->queue[tx->head & DOIP_TX_MASK];
+    
+    if (offset < headLength)
+    {
+        msg->headLength = (uint16)(headLength - offset);
+        memcpy(msg->head, &head[offset], msg->headLength);
+        msg->body = body;
+        msg->bodyLength = bodyLength;
+    }
+    else
+    {
+        msg->headLength = 0;
+        msg->body = &body[offset - headLength];
+        msg->bodyLength = (uint16)(bodyLength - (offset - headLength));
+    }
+    
+    msg->hold = hold;
+    tx->head++;
+    
+    return TRUE;
+}
+
+boolean DoIP_TxStream_Resume(DoIP_TxStream *tx, struct tcp_pcb *pcb)
+{
+    boolean written = FALSE;
+    
+    while (tx->tail != tx->head)
+    {
+        DoIP_TxMessage *msg = &tx->queue[tx->tail & DOIP_TX_MASK];
+        uint32 start = tx->offset;
+        boolean complete = WriteMessage(tx, pcb, msg->head, msg->headLength, msg->body, msg->bodyLength, msg->hold,
+                                        &tx->offset);
+    
+        if (tx->offset != start)
+        {
+            written = TRUE;
+        }
+    
+        if (!complete)
+        {
+            break;
+        }
+    
+        tx->tail++;
+        tx->offset = 0;
+    }
+    
+    return written;
+}
+
+void DoIP_TxStream_Acked(DoIP_TxStream *tx, const struct tcp_pcb *pcb)
+{
+    while (tx->heldTail != tx->heldHead)
+    {
+        uint32 slot = tx->heldTail & DOIP_TX_MASK;
+    
+        /* A body still being written is not released, however much of it is acknowledged */
+        if ((tx->heldOpen && ((tx->heldTail + 1) == tx->heldHead)) ||
+            ((sint32)(pcb->lastack - tx->heldEnd[slot]) < 0))
+        {
+            break;
+        }
+    
+        tx->held[slot]->released++;
+        tx->heldTail++;
+    }
+}
+
+boolean DoIP_TxStream_Holding(const DoIP_TxStream *tx)
+{
+    return (tx->heldTail != tx->heldHead) ? TRUE : FALSE;
+}
+
+boolean DoIP_TxStream_Ready(const DoIP_TxStream *tx)
+{
+    return ((tx->head - tx->tail) < DOIP_TX_QUEUE_DEPTH) ? TRUE : FALSE;
+}
+
+boolean DoIP_TxHold_Busy(const DoIP_TxHold *hold)
+{
+    return (hold->queued != hold->released) ? TRUE : FALSE;
+}
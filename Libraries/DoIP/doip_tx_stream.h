@@ -0,0 +1,126 @@
+/**
+ * @file doip_tx_stream.h
+ * @brief DoIP TCP Transmit Stream
+ * @details Outgoing DoIP messages are written straight into lwIP send
+ *          segments, never more than tcp_sndbuf() accepts. A message is a
+ *          short head (DoIP header, routing, SID, ...) followed by an optional
+ *          body that is read from its static location, so large responses
+ *          need no intermediate buffer. Whatever does not fit is queued in
+ *          order and resumed from the tcp_sent callback.
+ *
+ *          A body sent with a DoIP_TxHold is not even copied into the send
+ *          buffer: lwIP references it until the peer acknowledges it. The
+ *          hold counts the messages still referencing the body, so the owner
+ *          can wait before changing it (reports from the VCI database and
+ *          the health data). Bodies without a hold, e.g. the flash read-ahead
+ *          buffers that are reused as soon as they are written, are copied.
+ */
+
+#ifndef DOIP_TX_STREAM_H
+#define DOIP_TX_STREAM_H
+
+#include "doip_types.h"
+#include "lwip/tcp.h"
+
+#define DOIP_TX_QUEUE_DEPTH         8       /* Messages waiting for send buffer space, power of two */
+
+#if (DOIP_TX_QUEUE_DEPTH & (DOIP_TX_QUEUE_DEPTH - 1)) != 0
+#error "DOIP_TX_QUEUE_DEPTH must be a power of two"
+#endif
+
+/*******************************************************************************
+ * Types
+ ******************************************************************************/
+
+/* Owner's view of a body sent by reference; one writer per counter, so it works across cores */
+typedef struct
+{
+    volatile uint32 queued;         /* Messages handed over with this hold, counted by the sender */
+    volatile uint32 released;       /* Messages whose body lwIP no longer references (Ethernet core) */
+    
+} DoIP_TxHold;
+
+typedef struct
+{
+    const uint8 *body;              /* Written after head[], must stay valid until written */
+    DoIP_TxHold *hold;              /* Body referenced until acknowledged, NULL if copied */
+    uint16 headLength;              /* Valid bytes in head[] */
+    uint16 bodyLength;              /* Bytes at body */
+    uint8  head[DOIP_TX_BUFFER_SIZE];
+    
+} DoIP_TxMessage;
+
+typedef struct
+{
+    uint32 head;                    /* Messages queued */
+    uint32 tail;                    /* Messages completely written */
+    uint32 offset;                  /* Bytes of the tail message already written */
+    uint32 heldHead;                /* Bodies written by reference */
+    uint32 heldTail;                /* ... and acknowledged */
+    boolean heldOpen;               /* The newest one is still being written */
+    DoIP_TxHold *held[DOIP_TX_QUEUE_DEPTH];
+    uint32 heldEnd[DOIP_TX_QUEUE_DEPTH];    /* Sequence number after the body */
+    DoIP_TxMessage queue[DOIP_TX_QUEUE_DEPTH];
+    
+} DoIP_TxStream;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Discard all queued messages
+ * @details Releases every hold: call once lwIP has freed the connection's
+ *          segments (aborted, or reported an error).
+ */
+void DoIP_TxStream_Reset(DoIP_TxStream *tx);
+
+/**
+ * @brief Write a message, queueing the part the send buffer cannot take
+ * @param tx Transmit stream
+ * @param pcb Connection
+ * @param head First part of the message, copied
+ * @param headLength Length of head (at most DOIP_TX_BUFFER_SIZE)
+ * @param body Rest of the message, NULL_PTR if none; read in place, so it
+ *        must stay valid until the message is written
+ * @param bodyLength Length of body
+ * @param hold NULL_PTR to copy the body into the send buffer, otherwise the
+ *        body is referenced and hold->released counts it once acknowledged
+ *        (the caller has counted it in hold->queued)
+ * @return FALSE if the queue is full, nothing was written
+ */
+boolean DoIP_TxStream_Send(DoIP_TxStream *tx, struct tcp_pcb *pcb, const uint8 *head, uint16 headLength,
+                           const uint8 *body, uint16 bodyLength, DoIP_TxHold *hold);
+
+/**
+ * @brief Write queued messages while the send buffer has space
+ * @details Call from the tcp_sent callback and periodically (tcp_write()
+ *          may also fail for lack of pbufs with nothing in flight).
+ * @return TRUE if anything was written, call tcp_output()
+ */
+boolean DoIP_TxStream_Resume(DoIP_TxStream *tx, struct tcp_pcb *pcb);
+
+/**
+ * @brief Release the holds of the bodies the peer has acknowledged
+ * @details Call from the tcp_sent callback.
+ */
+void DoIP_TxStream_Acked(DoIP_TxStream *tx, const struct tcp_pcb *pcb);
+
+/**
+ * @brief TRUE if lwIP still references a body of this stream
+ * @details Such a connection must be aborted rather than closed: a closing
+ *          PCB keeps sending from the body after the holds are released.
+ */
+boolean DoIP_TxStream_Holding(const DoIP_TxStream *tx);
+
+/**
+ * @brief TRUE if another message can be accepted
+ */
+boolean DoIP_TxStream_Ready(const DoIP_TxStream *tx);
+
+/**
+ * @brief TRUE while a message sent with this hold may still reference its body
+ */
+boolean DoIP_TxHold_Busy(const DoIP_TxHold *hold);
+
+#endif /* DOIP_TX_STREAM_H */
@@ -44,6 +44,20 @@ typedef enum
     
 } DoIP_PayloadType;
 
+/*******************************************************************************
+ * DoIP Generic Header Negative Acknowledge Codes
+ ******************************************************************************/
+
+typedef enum
+{
+    DOIP_NACK_INCORRECT_PATTERN     = 0x00,     /* Incorrect pattern format */
+    DOIP_NACK_UNKNOWN_PAYLOAD_TYPE  = 0x01,     /* Unknown payload type */
+    DOIP_NACK_MESSAGE_TOO_LARGE     = 0x02,     /* Message too large */
+    DOIP_NACK_OUT_OF_MEMORY         = 0x03,     /* Out of memory */
+    DOIP_NACK_INVALID_PAYLOAD_LEN   = 0x04      /* Invalid payload length */
+    
+} DoIP_GenericNackCode;
+
 /*******************************************************************************
  * DoIP Routing Activation Response Codes
  ******************************************************************************/
@@ -55,14 +69,27 @@ typedef enum
     DOIP_RA_RES_CONFIRMATION_REQ    = 0x11,     /* Confirmation required */
     DOIP_RA_RES_DENIED_UNKNOWN_SA   = 0x00,     /* Denied - unknown source address */
     DOIP_RA_RES_DENIED_NO_SOCKET    = 0x01,     /* Denied - no socket available */
-    DOIP_RA_RES_DENIED_SA_IN_USE    = 0x02,     /* Denied - source address already in use */
-    DOIP_RA_RES_DENIED_SA_DIFF      = 0x03,     /* Denied - source address different */
-    DOIP_RA_RES_DENIED_ACTIVE       = 0x04,     /* Denied - already active */
-    DOIP_RA_RES_DENIED_AUTH_MISSING = 0x05,     /* Denied - authentication missing */
-    DOIP_RA_RES_DENIED_CONFIRM_REJ  = 0x06      /* Denied - confirmation rejected */
+    DOIP_RA_RES_DENIED_SA_DIFF      = 0x02,     /* Denied - another source address is active on this socket */
+    DOIP_RA_RES_DENIED_SA_IN_USE    = 0x03,     /* Denied - source address active on another socket */
+    DOIP_RA_RES_DENIED_AUTH_MISSING = 0x04,     /* Denied - authentication missing */
+    DOIP_RA_RES_DENIED_CONFIRM_REJ  = 0x05,     /* Denied - confirmation rejected */
+    DOIP_RA_RES_DENIED_TYPE         = 0x06      /* Denied - unsupported routing activation type */
     
 } DoIP_RoutingActivationResponse;
 
+/*******************************************************************************
+ * DoIP Diagnostic Message Negative Acknowledge Codes
+ ******************************************************************************/
+
+typedef enum
+{
+    DOIP_DIAG_NACK_INVALID_SA       = 0x02,     /* Source address not routed on this socket */
+    DOIP_DIAG_NACK_UNKNOWN_TA       = 0x03,     /* Unknown target address */
+    DOIP_DIAG_NACK_OUT_OF_MEMORY    = 0x05,     /* No room to process the message */
+    DOIP_DIAG_NACK_TARGET_UNREACHABLE = 0x06    /* Target unreachable */
+    
+} DoIP_DiagnosticNackCode;
+
 /*******************************************************************************
  * DoIP Client States
  ******************************************************************************/
@@ -103,14 +130,27 @@ typedef struct
 /* Alive Check Configuration */
 #define DOIP_ALIVE_CHECK_INTERVAL   5000    /* Alive check interval: 5 seconds */
 
+/* Server (DoIP entity) Configuration */
+#define DOIP_TCP_DATA_PORT          13400   /* TCP_DATA port the gateway accepts testers on */
+#define DOIP_SERVER_MAX_CONNECTIONS 4       /* Tester sockets served at once */
+#define DOIP_TIMEOUT_INITIAL_INACTIVITY 2000    /* T_TCP_Initial_Inactivity: connect to routing activation */
+#define DOIP_TIMEOUT_GENERAL_INACTIVITY 300000  /* T_TCP_General_Inactivity: 5 minutes without a message */
+#define DOIP_TESTER_ADDRESS_MIN     0x0E00  /* External test equipment source addresses */
+#define DOIP_TESTER_ADDRESS_MAX     0x0FFF
+
 /* Buffer Sizes */
 #define DOIP_MAX_MESSAGE_SIZE       256     /* Maximum DoIP message size */
-#define DOIP_TX_BUFFER_SIZE         256     /* Transmit buffer size */
-#define DOIP_RX_BUFFER_SIZE         256     /* Receive buffer size */
+#define DOIP_TX_BUFFER_SIZE         256     /* Largest copied part of a transmitted message */
+#define DOIP_TX_HEAD_SIZE           224     /* Copied part of a streamed response: header, routing, SID, short data */
+#define DOIP_MAX_PAYLOAD_SIZE       256     /* Largest payload accepted, larger ones get a generic NACK */
+#define DOIP_MAX_TX_PAYLOAD_SIZE    4096    /* Largest payload sent: streamed bodies are not bound by the mailbox */
+#define DOIP_RX_BUFFER_SIZE         512     /* Receive ring size, power of two >= header + max payload */
 
 /* Logical Addresses */
 #define DOIP_ZONAL_GW_ADDRESS       0x0100  /* Zonal Gateway logical address */
 #define DOIP_VMG_ADDRESS            0x0200  /* VMG logical address */
+#define DOIP_ZONE_ECU_ADDRESS       0x0011  /* ECU_011 logical address, reached through the gateway */
+#define DOIP_FUNCTIONAL_ADDRESS     0xE400  /* Functional address: every zone ECU behind the gateway */
 
 /* Address Aliases for compatibility */
 #define ZGW_ADDRESS                 DOIP_ZONAL_GW_ADDRESS
@@ -0,0 +1,779 @@
+/*******************************************************************************
+ * @file    uds_download.c
+ * @brief   UDS Download/Upload Services Implementation
+ ******************************************************************************/
+
+#include "uds_download.h"
+#include "uds_transaction.h"
+#include "IfxStm.h"
+#include "UART_Log.h"
+#include <string.h>
+
+#if (UDS_DOWNLOAD_REGION_START % FLASH4_SECTOR_SIZE) != 0
+#error "UDS_DOWNLOAD_REGION_START must be sector aligned"
+#endif
+
+/*******************************************************************************
+ * Private Types
+ ******************************************************************************/
+
+typedef enum
+{
+    ERASE_NONE = 0,             /* No erase started, or the last one completed */
+    ERASE_RUNNING,
+    ERASE_SUSPENDING,           /* Suspend issued, WIP still set */
+    ERASE_SUSPENDED
+} EraseState;
+
+typedef struct
+{
+    uint8 frame[FLASH4_PROGRAM_HEADER_SIZE + FLASH4_MAX_PAGE_SIZE];  /* Command room, then the page data */
+} PageBuffer;
+
+typedef struct
+{
+    uint8 frame[FLASH4_READ_HEADER_SIZE + UDS_UPLOAD_BLOCK_DATA];    /* Command room, then the block data */
+} BlockBuffer;
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static PageBuffer        g_pages[UDS_DOWNLOAD_PAGE_BUFFERS];
+static BlockBuffer       g_blocks[UDS_UPLOAD_BLOCK_BUFFERS];
+static UDS_DownloadStats g_stats;
+
+/* Pipeline state, offsets are relative to g_stats.address */
+static uint32     g_erased;             /* Bytes covered by erased sectors */
+static uint16     g_program_len;        /* Length of the page being programmed, 0 if none */
+static EraseState g_erase;
+static uint32     g_op_start;           /* STM0 tick the program started or the erase last (re)started */
+static uint32     g_erase_ticks;        /* Ticks the current erase ran before its last suspend */
+static uint32     g_started;            /* STM0 tick of the 0x34 or 0x35 */
+static uint32     g_last_block;         /* STM0 tick of the last 0x36 */
+static uint8      g_next_bsc;           /* blockSequenceCounter expected next */
+static boolean    g_block_waiting;      /* A 0x36 is deferred until a page buffer frees */
+static boolean    g_complete;           /* Every byte is programmed (download) or sent (upload) */
+
+/* Upload read-ahead, in blocks of UDS_UPLOAD_BLOCK_DATA */
+static uint32     g_blocks_sent;        /* Blocks answered, the last one is held until the next is requested */
+static uint32     g_blocks_read;        /* Blocks whose read was started */
+static boolean    g_reading;            /* The read of the last started block is still running */
+
+static uint32 g_ticks_per_ms;
+static uint32 g_program_timeout_ticks;
+static uint32 g_erase_timeout_ticks;
+static uint32 g_resume_ticks;
+static uint32 g_idle_timeout_ticks;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static uint32 Now(void)
+{
+    return IfxStm_getLower(&MODULE_STM0);
+}
+
+/* Page buffer holding the download offset, pages cycle through the ring */
+static PageBuffer *PageAt(uint32 offset)
+{
+    return &g_pages[(offset / FLASH4_MAX_PAGE_SIZE) % UDS_DOWNLOAD_PAGE_BUFFERS];
+}
+
+/* Length of the page starting at offset, the last one may be short */
+static uint16 PageLength(uint32 offset)
+{
+    uint32 rest = g_stats.size - offset;
+    
+    return (uint16)((rest < FLASH4_MAX_PAGE_SIZE) ? rest : FLASH4_MAX_PAGE_SIZE);
+}
+
+/* TRUE if the next page is completely buffered and its sector erased */
+static boolean PageReady(void)
+{
+    uint32 offset = g_stats.programmed;
+    
+    if ((g_program_len != 0) || (offset >= g_stats.size))
+    {
+        return FALSE;
+    }
+    
+    uint32 end = offset + PageLength(offset);
+    
+    return ((g_stats.received >= end) && (g_erased >= end)) ? TRUE : FALSE;
+}
+
+/* Copy a block into the page buffers; FALSE (nothing copied) if they cannot take it all */
+static boolean BufferBlock(const uint8 *data, uint16 length)
+{
+    uint32 room = (UDS_DOWNLOAD_PAGE_BUFFERS * FLASH4_MAX_PAGE_SIZE) - (g_stats.received - g_stats.programmed);
+    
+    if (length > room)
+    {
+        return FALSE;
+    }
+    
+    while (length > 0)
+    {
+        uint32 in_page = g_stats.received % FLASH4_MAX_PAGE_SIZE;
+        uint16 chunk = (uint16)(FLASH4_MAX_PAGE_SIZE - in_page);
+    
+        if (chunk > length)
+        {
+            chunk = length;
+        }
+    
+        memcpy(&PageAt(g_stats.received)->frame[FLASH4_PROGRAM_HEADER_SIZE + in_page], data, chunk);
+        g_stats.received += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+    
+    g_next_bsc++;
+    return TRUE;
+}
+
+/* Block buffer holding upload block n, blocks cycle through the ring */
+static BlockBuffer *BlockAt(uint32 block)
+{
+    return &g_blocks[block % UDS_UPLOAD_BLOCK_BUFFERS];
+}
+
+/* Data length of upload block n, the last one may be short */
+static uint16 BlockLength(uint32 block)
+{
+    uint32 rest = g_stats.size - (block * UDS_UPLOAD_BLOCK_DATA);
+    
+    return (uint16)((rest < UDS_UPLOAD_BLOCK_DATA) ? rest : UDS_UPLOAD_BLOCK_DATA);
+}
+
+/* Start reading the next block if the SPI is free and a block buffer is no longer needed */
+static void ReadAhead(void)
+{
+    uint32 held = (g_blocks_sent > 0) ? (g_blocks_sent - 1) : 0;
+    
+    if (g_reading || ((g_blocks_read * UDS_UPLOAD_BLOCK_DATA) >= g_stats.size) ||
+        ((g_blocks_read - held) >= UDS_UPLOAD_BLOCK_BUFFERS))
+    {
+        return;
+    }
+    
+    Flash4_ReadStart(g_stats.address + (g_blocks_read * UDS_UPLOAD_BLOCK_DATA), BlockAt(g_blocks_read)->frame,
+                     BlockLength(g_blocks_read));
+    g_reading = TRUE;
+    g_blocks_read++;
+}
+
+/* Positive 0x36 response streaming block n from its buffer */
+static void SetBlockResponse(UDS_Response *response, uint32 block, uint8 bsc)
+{
+    response->data[0] = bsc;
+    response->data_len = 1;
+    response->body = &BlockAt(block)->frame[FLASH4_READ_HEADER_SIZE];
+    response->body_len = BlockLength(block);
+}
+
+static void Fail(void)
+{
+    /* Let a suspended erase finish so the device is idle for the next download */
+    if (g_erase == ERASE_SUSPENDED)
+    {
+        Flash4_EraseResume();
+    }
+    
+    g_erase = ERASE_NONE;
+    g_program_len = 0;
+    g_stats.state = UDS_DOWNLOAD_FAILED;
+    LOG_MSG(FLASH, ERROR, "[Flash] Download failed: erase/program error\r\n", 46);
+}
+
+static void Finish(uint32 now)
+{
+    uint32 ms = (now - g_started) / g_ticks_per_ms;
+    
+    if (ms == 0)
+    {
+        ms = 1;
+    }
+    
+    g_complete = TRUE;
+    g_stats.duration_ms = ms;
+    g_stats.kbps = (uint16)(((uint64)g_stats.size * 1000U) / ((uint64)ms * 1024U));
+    
+    if (g_stats.state == UDS_DOWNLOAD_UPLOAD)
+    {
+        LOG_TRACE(FLASH, INFO, TRACE_FLASH_UPLOAD, g_stats.size, ms, g_stats.kbps);
+    }
+    else
+    {
+        LOG_TRACE(FLASH, INFO, TRACE_FLASH_DOWNLOAD, g_stats.size, ms, g_stats.kbps);
+    }
+}
+
+/* Answer the next upload block if its read is done; FALSE (response untouched) if not yet */
+static boolean SendNextBlock(UDS_Response *response)
+{
+    if ((g_blocks_read <= g_blocks_sent) || (g_reading && (g_blocks_read == (g_blocks_sent + 1))))
+    {
+        return FALSE;
+    }
+    
+    SetBlockResponse(response, g_blocks_sent, g_next_bsc);
+    g_stats.received += response->body_len;
+    g_blocks_sent++;
+    g_next_bsc++;
+    
+    /* The buffer of the previous block is free now: the tester asked for this one after receiving it */
+    ReadAhead();
+    
+    if (g_stats.received == g_stats.size)
+    {
+        Finish(Now());
+    }
+    
+    return TRUE;
+}
+
+/* Finish the request from UDS_Transaction_Poll(), 0x78 keeps the tester waiting meanwhile */
+static void DeferJob(const UDS_Request *request, UDS_Response *response, UDS_JobStep job)
+{
+    if (!UDS_Transaction_Defer(response, job))
+    {
+        /* Only pooled transactions can wait */
+        UDS_CreateNegativeResponse(request, UDS_NRC_CONDITIONS_NOT_CORRECT, response);
+    }
+}
+
+/* 0x36 job: buffer the block once the programming freed enough room */
+static UDS_JobStatus Job_TransferData(const UDS_Request *request, UDS_Response *response)
+{
+    if (g_stats.state != UDS_DOWNLOAD_TRANSFER)
+    {
+        g_block_waiting = FALSE;
+        g_stats.state = UDS_DOWNLOAD_IDLE;
+        UDS_CreateNegativeResponse(request, UDS_NRC_GENERAL_PROGRAMMING_FAILURE, response);
+        return UDS_JOB_DONE;
+    }
+    
+    if (!BufferBlock(&request->data[1], (uint16)(request->data_len - 1)))
+    {
+        return UDS_JOB_PENDING;
+    }
+    
+    g_block_waiting = FALSE;
+    g_last_block = Now();
+    return UDS_JOB_DONE;
+}
+
+/* 0x36 upload job: answer once the read-ahead caught up */
+static UDS_JobStatus Job_UploadData(const UDS_Request *request, UDS_Response *response)
+{
+    if (g_stats.state != UDS_DOWNLOAD_UPLOAD)
+    {
+        g_block_waiting = FALSE;
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_SEQUENCE_ERROR, response);
+        return UDS_JOB_DONE;
+    }
+    
+    if (!SendNextBlock(response))
+    {
+        return UDS_JOB_PENDING;
+    }
+    
+    g_block_waiting = FALSE;
+    g_last_block = Now();
+    return UDS_JOB_DONE;
+}
+
+/* 0x37 job: answer once the last page is programmed */
+static UDS_JobStatus Job_TransferExit(const UDS_Request *request, UDS_Response *response)
+{
+    if ((g_stats.state != UDS_DOWNLOAD_TRANSFER) && (g_stats.state != UDS_DOWNLOAD_UPLOAD))
+    {
+        g_stats.state = UDS_DOWNLOAD_IDLE;
+        UDS_CreateNegativeResponse(request, UDS_NRC_GENERAL_PROGRAMMING_FAILURE, response);
+        return UDS_JOB_DONE;
+    }
+    
+    if (!g_complete)
+    {
+        return UDS_JOB_PENDING;
+    }
+    
+    /* transferResponseParameterRecord: [KB/s (2)][duration ms (4)] */
+    response->data[0] = (g_stats.kbps >> 8) & 0xFF;
+    response->data[1] = g_stats.kbps & 0xFF;
+    response->data[2] = (g_stats.duration_ms >> 24) & 0xFF;
+    response->data[3] = (g_stats.duration_ms >> 16) & 0xFF;
+    response->data[4] = (g_stats.duration_ms >> 8) & 0xFF;
+    response->data[5] = g_stats.duration_ms & 0xFF;
+    response->data_len = 6;
+    
+    g_stats.state = UDS_DOWNLOAD_IDLE;
+    return UDS_JOB_DONE;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void UDS_Download_Init(void)
+{
+    g_ticks_per_ms = (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, 1);
+    g_program_timeout_ticks = (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, FLASH4_PAGE_PROGRAM_TIMEOUT_MS);
+    g_erase_timeout_ticks = (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, FLASH4_SECTOR_ERASE_TIMEOUT_MS);
+    g_resume_ticks = (uint32)IfxStm_getTicksFromMicroseconds(&MODULE_STM0, FLASH4_RESUME_TO_SUSPEND_US);
+    g_idle_timeout_ticks = (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_DOWNLOAD_IDLE_TIMEOUT_MS);
+    
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_erase = ERASE_NONE;
+    g_program_len = 0;
+    g_block_waiting = FALSE;
+    g_complete = FALSE;
+    g_reading = FALSE;
+}
+
+/* Upload: retire a finished read and start the next */
+static void UploadPoll(uint32 now)
+{
+    if (g_reading && !Flash4_ReadBusy())
+    {
+        g_reading = FALSE;
+    }
+    
+    ReadAhead();
+    
+    if (!g_block_waiting && !g_reading && ((now - g_last_block) >= g_idle_timeout_ticks))
+    {
+        g_stats.state = UDS_DOWNLOAD_IDLE;
+        LOG_MSG(FLASH, WARN, "[Flash] Upload abandoned: no TransferData\r\n", 43);
+    }
+}
+
+void UDS_Download_Poll(void)
+{
+    if (g_stats.state == UDS_DOWNLOAD_UPLOAD)
+    {
+        UploadPoll(Now());
+        return;
+    }
+    
+    if (g_stats.state != UDS_DOWNLOAD_TRANSFER)
+    {
+        return;
+    }
+    
+    uint32 now = Now();
+    
+    /* A tester that went away must not block the next download forever */
+    if (!g_block_waiting && (g_program_len == 0) && (g_erase == ERASE_NONE) &&
+        ((now - g_last_block) >= g_idle_timeout_ticks))
+    {
+        g_stats.state = UDS_DOWNLOAD_IDLE;
+        LOG_MSG(FLASH, WARN, "[Flash] Download abandoned: no TransferData\r\n", 45);
+        return;
+    }
+    
+    uint8 status = Flash4_ReadStatusReg();
+    
+    if ((status & (FLASH4_SR1_E_ERR | FLASH4_SR1_P_ERR)) != 0)
+    {
+        Flash4_ClearStatus();
+        Fail();
+        return;
+    }
+    
+    if ((status & FLASH4_SR1_WIP) != 0)
+    {
+        if (g_program_len != 0)
+        {
+            if ((now - g_op_start) > g_program_timeout_ticks)
+            {
+                Fail();
+            }
+        }
+        else if (g_erase == ERASE_RUNNING)
+        {
+            uint32 ran = now - g_op_start;
+    
+            if ((g_erase_ticks + ran) > g_erase_timeout_ticks)
+            {
+                Fail();
+            }
+            else if (PageReady() && (ran >= g_resume_ticks))
+            {
+                /* A page is waiting in an erased sector: program it before the erase goes on */
+                Flash4_EraseSuspend();
+                g_erase = ERASE_SUSPENDING;
+                g_erase_ticks += ran;
+                g_stats.erase_suspends++;
+            }
+        }
+        return;
+    }
+    
+    /* Device idle: retire what just finished */
+    if (g_program_len != 0)
+    {
+        g_stats.programmed += g_program_len;
+        g_program_len = 0;
+    }
+    
+    if (g_erase == ERASE_RUNNING)
+    {
+        g_erased += FLASH4_SECTOR_SIZE;
+        g_erase = ERASE_NONE;
+    }
+    else if (g_erase == ERASE_SUSPENDING)
+    {
+        /* The erase may have completed before the suspend took effect */
+        if ((Flash4_ReadStatusReg2() & FLASH4_SR2_ES) != 0)
+        {
+            g_erase = ERASE_SUSPENDED;
+        }
+        else
+        {
+            g_erased += FLASH4_SECTOR_SIZE;
+            g_erase = ERASE_NONE;
+        }
+    }
+    
+    /* Next operation: programming first, then the erase ahead */
+    if (PageReady())
+    {
+        g_program_len = PageLength(g_stats.programmed);
+        Flash4_PageProgramStart(g_stats.address + g_stats.programmed, PageAt(g_stats.programmed)->frame, g_program_len);
+        g_op_start = now;
+    }
+    else if (g_erase == ERASE_SUSPENDED)
+    {
+        Flash4_EraseResume();
+        g_erase = ERASE_RUNNING;
+        g_op_start = now;
+    }
+    else if ((g_erase == ERASE_NONE) && (g_erased < g_stats.size))
+    {
+        Flash4_SectorErase(g_stats.address + g_erased);
+        g_erase = ERASE_RUNNING;
+        g_erase_ticks = 0;
+        g_op_start = now;
+    }
+    else if (!g_complete && (g_stats.programmed == g_stats.size))
+    {
+        Finish(now);
+    }
+}
+
+const UDS_DownloadStats *UDS_Download_GetStats(void)
+{
+    return &g_stats;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x34 Request Download / 0x35 Request Upload
+ ******************************************************************************/
+
+/* Shared 0x34/0x35 request check; FALSE with the negative response set */
+static boolean ParseTransferRequest(const UDS_Request *request, UDS_Response *response, uint32 *address, uint32 *size)
+{
+    /* [dataFormatIdentifier][addressAndLengthFormatIdentifier][memoryAddress][memorySize] */
+    if (request->data_len < 2)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return FALSE;
+    }
+    
+    uint8 address_len = request->data[1] & 0x0F;
+    uint8 size_len = (request->data[1] >> 4) & 0x0F;
+    
+    /* Plain data only, address and size of 1..4 bytes */
+    if ((request->data[0] != 0x00) || (address_len == 0) || (address_len > 4) || (size_len == 0) || (size_len > 4))
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return FALSE;
+    }
+    
+    if (request->data_len != (2 + address_len + size_len))
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return FALSE;
+    }
+    
+    /* One transfer at a time, and the device must have finished the previous one */
+    if ((g_stats.state == UDS_DOWNLOAD_TRANSFER) || (g_stats.state == UDS_DOWNLOAD_UPLOAD) || Flash4_CheckWIP())
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_CONDITIONS_NOT_CORRECT, response);
+        return FALSE;
+    }
+    
+    uint8 i;
+    
+    *address = 0;
+    *size = 0;
+    for (i = 0; i < address_len; i++)
+    {
+        *address = (*address << 8) | request->data[2 + i];
+    }
+    for (i = 0; i < size_len; i++)
+    {
+        *size = (*size << 8) | request->data[2 + address_len + i];
+    }
+    
+    return TRUE;
+}
+
+boolean UDS_Service_RequestDownload(const UDS_Request *request, UDS_Response *response)
+{
+    uint32 address;
+    uint32 size;
+    
+    if (!ParseTransferRequest(request, response, &address, &size))
+    {
+        return TRUE;
+    }
+    
+    /* Whole sectors are erased ahead, so the download must start on a sector */
+    if ((size == 0) || ((address % FLASH4_SECTOR_SIZE) != 0) || (address < UDS_DOWNLOAD_REGION_START) ||
+        (address >= UDS_DOWNLOAD_REGION_END) || (size > (UDS_DOWNLOAD_REGION_END - address)))
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+    
+    g_stats.state = UDS_DOWNLOAD_TRANSFER;
+    g_stats.address = address;
+    g_stats.size = size;
+    g_stats.received = 0;
+    g_stats.programmed = 0;
+    g_erased = 0;
+    g_program_len = 0;
+    g_erase = ERASE_NONE;
+    g_next_bsc = 1;
+    g_block_waiting = FALSE;
+    g_complete = FALSE;
+    g_started = Now();
+    g_last_block = g_started;
+    
+    /* First sector erase starts now, blocks are buffered meanwhile */
+    UDS_Download_Poll();
+    
+    /* Response: [lengthFormatIdentifier][maxNumberOfBlockLength (2)] */
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = 0x20;
+    response->data[1] = (UDS_DOWNLOAD_MAX_BLOCK_LENGTH >> 8) & 0xFF;
+    response->data[2] = UDS_DOWNLOAD_MAX_BLOCK_LENGTH & 0xFF;
+    response->data_len = 3;
+    
+    LOG_MSG(FLASH, INFO, "[Flash] Download started\r\n", 26);
+    return TRUE;
+}
+
+boolean UDS_Service_RequestUpload(const UDS_Request *request, UDS_Response *response)
+{
+    uint32 address;
+    uint32 size;
+    
+    if (!ParseTransferRequest(request, response, &address, &size))
+    {
+        return TRUE;
+    }
+    
+    if ((size == 0) || (address >= FLASH4_DEVICE_SIZE) || (size > (FLASH4_DEVICE_SIZE - address)))
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+    
+    g_stats.state = UDS_DOWNLOAD_UPLOAD;
+    g_stats.address = address;
+    g_stats.size = size;
+    g_stats.received = 0;
+    g_stats.programmed = 0;
+    g_blocks_sent = 0;
+    g_blocks_read = 0;
+    g_reading = FALSE;
+    g_next_bsc = 1;
+    g_block_waiting = FALSE;
+    g_complete = FALSE;
+    g_started = Now();
+    g_last_block = g_started;
+    
+    /* The first block is read while the tester receives this response */
+    ReadAhead();
+    
+    /* Response: [lengthFormatIdentifier][maxNumberOfBlockLength (2)] */
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = 0x20;
+    response->data[1] = (UDS_UPLOAD_MAX_BLOCK_LENGTH >> 8) & 0xFF;
+    response->data[2] = UDS_UPLOAD_MAX_BLOCK_LENGTH & 0xFF;
+    response->data_len = 3;
+    
+    LOG_MSG(FLASH, INFO, "[Flash] Upload started\r\n", 24);
+    return TRUE;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x36 Transfer Data
+ ******************************************************************************/
+
+/* 0x36 during an upload: [blockSequenceCounter] only */
+static boolean UploadTransferData(const UDS_Request *request, UDS_Response *response)
+{
+    if (request->data_len != 1)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
+    }
+    
+    if (g_block_waiting)
+    {
+        /* The previous block is still waiting for its read */
+        UDS_CreateNegativeResponse(request, UDS_NRC_BUSY_REPEAT_REQUEST, response);
+        return TRUE;
+    }
+    
+    uint8 bsc = request->data[0];
+    
+    UDS_CreatePositiveResponse(request, response);
+    
+    /* A repeated block (lost response) is sent again from the buffer still holding it */
+    if ((g_blocks_sent > 0) && (bsc == (uint8)(g_next_bsc - 1)))
+    {
+        SetBlockResponse(response, g_blocks_sent - 1, bsc);
+        return TRUE;
+    }
+    
+    if (bsc != g_next_bsc)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_WRONG_BLOCK_SEQUENCE_COUNTER, response);
+        return TRUE;
+    }
+    
+    if (g_stats.received >= g_stats.size)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_SEQUENCE_ERROR, response);
+        return TRUE;
+    }
+    
+    g_last_block = Now();
+    
+    /* Normally read ahead while the previous block was in flight */
+    if (!SendNextBlock(response))
+    {
+        DeferJob(request, response, Job_UploadData);
+        if (response->is_positive)
+        {
+            g_block_waiting = TRUE;
+            g_stats.blocks_deferred++;
+        }
+    }
+    
+    return TRUE;
+}
+
+boolean UDS_Service_TransferData(const UDS_Request *request, UDS_Response *response)
+{
+    if (g_stats.state == UDS_DOWNLOAD_UPLOAD)
+    {
+        return UploadTransferData(request, response);
+    }
+    
+    /* [blockSequenceCounter][data], at most maxNumberOfBlockLength with the SID */
+    if ((request->data_len < 2) || (request->data_len > (UDS_DOWNLOAD_MAX_BLOCK_LENGTH - 1)))
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
+    }
+    
+    if (g_stats.state == UDS_DOWNLOAD_FAILED)
+    {
+        g_stats.state = UDS_DOWNLOAD_IDLE;
+        UDS_CreateNegativeResponse(request, UDS_NRC_GENERAL_PROGRAMMING_FAILURE, response);
+        return TRUE;
+    }
+    
+    if (g_stats.state != UDS_DOWNLOAD_TRANSFER)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_SEQUENCE_ERROR, response);
+        return TRUE;
+    }
+    
+    if (g_block_waiting)
+    {
+        /* The previous block is still waiting for a page buffer */
+        UDS_CreateNegativeResponse(request, UDS_NRC_BUSY_REPEAT_REQUEST, response);
+        return TRUE;
+    }
+    
+    uint8 bsc = request->data[0];
+    uint16 length = (uint16)(request->data_len - 1);
+    
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = bsc;
+    response->data_len = 1;
+    
+    /* A repeated block (lost response) is acknowledged again without storing it twice */
+    if ((g_stats.received > 0) && (bsc == (uint8)(g_next_bsc - 1)))
+    {
+        return TRUE;
+    }
+    
+    if (bsc != g_next_bsc)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_WRONG_BLOCK_SEQUENCE_COUNTER, response);
+        return TRUE;
+    }
+    
+    if (length > (g_stats.size - g_stats.received))
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_TRANSFER_DATA_SUSPENDED, response);
+        return TRUE;
+    }
+    
+    g_last_block = Now();
+    
+    /* Acknowledged as soon as it is buffered, the flash catches up behind */
+    if (!BufferBlock(&request->data[1], length))
+    {
+        DeferJob(request, response, Job_TransferData);
+        if (response->is_positive)
+        {
+            g_block_waiting = TRUE;
+            g_stats.blocks_deferred++;
+        }
+    }
+    
+    return TRUE;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x37 Request Transfer Exit
+ ******************************************************************************/
+
+boolean UDS_Service_RequestTransferExit(const UDS_Request *request, UDS_Response *response)
+{
+    if (g_stats.state == UDS_DOWNLOAD_FAILED)
+    {
+        g_stats.state = UDS_DOWNLOAD_IDLE;
+        UDS_CreateNegativeResponse(request, UDS_NRC_GENERAL_PROGRAMMING_FAILURE, response);
+        return TRUE;
+    }
+    
+    /* Only after the whole memorySize was transferred */
+    if (((g_stats.state != UDS_DOWNLOAD_TRANSFER) && (g_stats.state != UDS_DOWNLOAD_UPLOAD)) || g_block_waiting ||
+        (g_stats.received != g_stats.size))
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_SEQUENCE_ERROR, response);
+        return TRUE;
+    }
+    
+    UDS_CreatePositiveResponse(request, response);
+    
+    if (Job_TransferExit(request, response) == UDS_JOB_PENDING)
+    {
+        DeferJob(request, response, Job_TransferExit);
+    }
+    
+    return TRUE;
+}
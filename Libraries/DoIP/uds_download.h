@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * @file    uds_download.h
+ * @brief   UDS Download/Upload Services (0x34/0x35/0x36/0x37) on the Flash4 NOR Flash
+ * @details TransferData blocks are copied into a ring of page buffers and
+ *          acknowledged at once; UDS_Download_Poll() programs full pages
+ *          behind the transfer. The sectors of the download are erased ahead
+ *          in the background: the erase is suspended whenever a page of an
+ *          already erased sector is ready and resumed once it is programmed,
+ *          so erase time overlaps with both transfer and programming.
+ *
+ *          A block that finds all page buffers full, and the transfer exit,
+ *          are finished as deferred jobs (uds_transaction.h), so the tester
+ *          sees 0x78 instead of a timeout while the flash catches up.
+ *
+ *          An upload reads ahead: while one block is on its way to the
+ *          tester, the next is read into the other block buffer by a
+ *          non-blocking QSPI transfer, and each 0x36 answers straight from
+ *          that buffer as a streamed response body (no copy). The block
+ *          buffer of a response is only reused once the tester asked for
+ *          the following block, i.e. after it received the whole response.
+ ******************************************************************************/
+
+#ifndef UDS_DOWNLOAD_H
+#define UDS_DOWNLOAD_H
+
+#include "Ifx_Types.h"
+#include "uds_handler.h"
+#include "Flash4_Driver.h"
+
+/*******************************************************************************
+ * Configuration
+ ******************************************************************************/
+
+#define UDS_DOWNLOAD_PAGE_BUFFERS               2       /* Flash pages buffered ahead of programming */
+#define UDS_DOWNLOAD_MAX_BLOCK_LENGTH           (DOIP_MAX_PAYLOAD_SIZE - 4)  /* SID + BSC + data in one DoIP payload */
+#define UDS_DOWNLOAD_REGION_START               FLASH4_SECTOR_SIZE  /* Sector 0 is left to the Flash4 self test */
+#define UDS_DOWNLOAD_REGION_END                 FLASH4_DEVICE_SIZE
+#define UDS_DOWNLOAD_IDLE_TIMEOUT_MS            10000   /* A transfer without blocks for this long is abandoned */
+
+#define UDS_UPLOAD_BLOCK_BUFFERS                2       /* Block on its way to the tester + block read ahead */
+#define UDS_UPLOAD_MAX_BLOCK_LENGTH             (DOIP_MAX_TX_PAYLOAD_SIZE - 4)  /* SID + BSC + data in one DoIP payload */
+#define UDS_UPLOAD_BLOCK_DATA                   (UDS_UPLOAD_MAX_BLOCK_LENGTH - 2)
+
+/*******************************************************************************
+ * Types
+ ******************************************************************************/
+
+typedef enum
+{
+    UDS_DOWNLOAD_IDLE = 0,      /* No download, or the last one was exited */
+    UDS_DOWNLOAD_TRANSFER,      /* Between 0x34 and a successful 0x37 */
+    UDS_DOWNLOAD_UPLOAD,        /* Between 0x35 and a successful 0x37 */
+    UDS_DOWNLOAD_FAILED         /* Erase/program error, reported by the next 0x36/0x37 */
+} UDS_DownloadState;
+
+typedef struct
+{
+    uint8  state;               /* UDS_DownloadState */
+    uint32 address;             /* Flash4 address of the transfer */
+    uint32 size;                /* memorySize of the transfer */
+    uint32 received;            /* Bytes buffered and acknowledged (download) or sent (upload) */
+    uint32 programmed;          /* Bytes written to flash */
+    uint32 duration_ms;         /* 0x34/0x35 to last page programmed or block sent, of the last complete transfer */
+    uint16 kbps;                /* Sustained KB/s of the last complete transfer */
+    uint16 erase_suspends;      /* Erases suspended to program a page */
+    uint16 blocks_deferred;     /* Blocks that waited for a page buffer or the read-ahead (0x78) */
+} UDS_DownloadStats;
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+/**
+ * @brief Forget any transfer in progress and clear the counters
+ */
+void UDS_Download_Init(void);
+
+/**
+ * @brief Advance the erase/program pipeline, or the upload read-ahead
+ * @details Call from the application core's UDS task, before
+ *          UDS_Transaction_Poll() so that waiting blocks see the freed buffers.
+ */
+void UDS_Download_Poll(void);
+
+/**
+ * @brief Transfer progress and throughput counters
+ */
+const UDS_DownloadStats *UDS_Download_GetStats(void);
+
+/**
+ * @brief Handle 0x34 Request Download
+ * @details dataFormatIdentifier 0x00 only; the address must be sector aligned
+ *          inside the download region. Erasing starts immediately.
+ * @param request UDS request
+ * @param response UDS response (output)
+ * @return TRUE if handled, FALSE otherwise
+ */
+boolean UDS_Service_RequestDownload(const UDS_Request *request, UDS_Response *response);
+
+/**
+ * @brief Handle 0x35 Request Upload
+ * @details dataFormatIdentifier 0x00 only; any range inside the device.
+ *          maxNumberOfBlockLength is UDS_UPLOAD_MAX_BLOCK_LENGTH, the
+ *          largest DoIP diagnostic message the gateway sends. The first
+ *          blocks are read immediately.
+ * @param request UDS request
+ * @param response UDS response (output)
+ * @return TRUE if handled, FALSE otherwise
+ */
+boolean UDS_Service_RequestUpload(const UDS_Request *request, UDS_Response *response);
+
+/**
+ * @brief Handle 0x36 Transfer Data
+ * @details During an upload the request carries the blockSequenceCounter
+ *          only and the block data is streamed from its block buffer.
+ * @param request UDS request
+ * @param response UDS response (output), pooled if the block may have to wait
+ * @return TRUE if handled, FALSE otherwise
+ */
+boolean UDS_Service_TransferData(const UDS_Request *request, UDS_Response *response);
+
+/**
+ * @brief Handle 0x37 Request Transfer Exit
+ * @details Answers once every page is programmed, or every block was sent:
+ *          [KB/s (2)][duration ms (4)] as transferResponseParameterRecord.
+ * @param request UDS request
+ * @param response UDS response (output), must be pooled
+ * @return TRUE if handled, FALSE otherwise
+ */
+boolean UDS_Service_RequestTransferExit(const UDS_Request *request, UDS_Response *response);
+
+#endif /* UDS_DOWNLOAD_H */
@@ -8,9 +8,12 @@
  ******************************************************************************/
 
 #include "uds_handler.h"
+#include "uds_transaction.h"
+#include "uds_download.h"
 #include "doip_types.h"
 #include "doip_client.h"
 #include "vci_manager.h"
+#include "UART_Log.h"
 #include <string.h>
 
 /*******************************************************************************
@@ -28,21 +31,78 @@ extern DoIP_VCI_Info g_zgw_vci;
 /* Health Status Database */
 extern DoIP_HealthStatus_Info g_health_data[MAX_ZONE_ECUS + 1];
 
+/*******************************************************************************
+ * DID Accessors (defined with the 0x22/0x2E services)
+ ******************************************************************************/
+
+static boolean Did_ReadZgwVci(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len);
+/* Records of record_size that fit the inline data after the DID and a count byte */
+static uint8 DidRecordsFitting(uint8 count, uint16 record_size)
+{
+    uint16 fitting = (UDS_MAX_RESPONSE_SIZE - 3) / record_size;
+    
+    return (count > fitting) ? (uint8)fitting : count;
+}
+
+static boolean Did_ReadConsolidatedVci(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len);
+static boolean Did_ReadHealthStatus(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len);
+static boolean Did_ReadLogMask(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len);
+static uint8   Did_WriteLogMask(const uint8 *data, uint16 data_len);
+static boolean Did_ReadTransactionPool(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len);
+static boolean Did_ReadDownloadStatus(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len);
+
 /*******************************************************************************
  * Private Variables
  ******************************************************************************/
 
-/* UDS Service Handler Table */
-static const struct {
-    uint8 service_id;
-    UDS_ServiceHandler handler;
-} g_service_handlers[] = {
-    { UDS_SID_READ_DATA_BY_IDENTIFIER, UDS_Service_ReadDataByIdentifier },
-    { UDS_SID_ROUTINE_CONTROL, UDS_Service_RoutineControl },
+/* UDS Service Jump Table, indexed by SID (const: lives in flash) */
+static const UDS_ServiceHandler g_service_table[256] = {
+    [UDS_SID_READ_DATA_BY_IDENTIFIER]  = UDS_Service_ReadDataByIdentifier,
+    [UDS_SID_WRITE_DATA_BY_IDENTIFIER] = UDS_Service_WriteDataByIdentifier,
+    [UDS_SID_ROUTINE_CONTROL]          = UDS_Service_RoutineControl,
+    [UDS_SID_REQUEST_DOWNLOAD]         = UDS_Service_RequestDownload,
+    [UDS_SID_REQUEST_UPLOAD]           = UDS_Service_RequestUpload,
+    [UDS_SID_TRANSFER_DATA]            = UDS_Service_TransferData,
+    [UDS_SID_REQUEST_TRANSFER_EXIT]    = UDS_Service_RequestTransferExit,
     /* Add more service handlers here as needed */
 };
 
-#define SERVICE_HANDLER_COUNT (sizeof(g_service_handlers) / sizeof(g_service_handlers[0]))
+/* DID Registry, binary searched: keep it sorted by DID (checked by UDS_Init) */
+static const UDS_DidEntry g_did_table[] = {
+    /* DID                          Length                  Access                  Reader                   Writer */
+    { UDS_DID_VCI_ECU_ID,           sizeof(DoIP_VCI_Info),  UDS_ACCESS_ALL_SESSIONS, Did_ReadZgwVci,          NULL },
+    { UDS_DID_VCI_CONSOLIDATED,     0,                      UDS_ACCESS_ALL_SESSIONS, Did_ReadConsolidatedVci, NULL },
+    { UDS_DID_HEALTH_STATUS,        0,                      UDS_ACCESS_ALL_SESSIONS, Did_ReadHealthStatus,    NULL },
+    { UDS_DID_LOG_MASK,             LOG_MODULE_COUNT,       UDS_ACCESS_ALL_SESSIONS, Did_ReadLogMask,         Did_WriteLogMask },
+    { UDS_DID_TRANSACTION_POOL,     5,                      UDS_ACCESS_ALL_SESSIONS, Did_ReadTransactionPool, NULL },
+    { UDS_DID_DOWNLOAD_STATUS,      15,                     UDS_ACCESS_ALL_SESSIONS, Did_ReadDownloadStatus,  NULL },
+};
+
+#define DID_TABLE_COUNT (sizeof(g_did_table) / sizeof(g_did_table[0]))
+
+/* Active diagnostic session and security state, checked against UDS_DidEntry.access */
+static uint8   g_session = UDS_SESSION_DEFAULT;
+static boolean g_security_unlocked = FALSE;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+/* 0 if the DID may be accessed in the current session and security state, otherwise the NRC */
+static uint8 CheckDidAccess(const UDS_DidEntry *entry)
+{
+    if ((entry->access & UDS_ACCESS_SESSION(g_session)) == 0)
+    {
+        return UDS_NRC_REQUEST_OUT_OF_RANGE;
+    }
+    
+    if (((entry->access & UDS_ACCESS_SECURED) != 0) && !g_security_unlocked)
+    {
+        return UDS_NRC_SECURITY_ACCESS_DENIED;
+    }
+    
+    return 0;
+}
 
 /*******************************************************************************
  * Public Functions
@@ -50,8 +110,44 @@ static const struct {
 
 void UDS_Init(void)
 {
-    /* Initialize UDS handler */
-    /* Currently no initialization needed */
+    /* Return all transactions to the pool */
+    UDS_Transaction_Init();
+    UDS_Download_Init();
+    
+    g_session = UDS_SESSION_DEFAULT;
+    g_security_unlocked = FALSE;
+    
+    /* The registry is binary searched: an unsorted entry would hide DIDs */
+    for (uint16 i = 1; i < DID_TABLE_COUNT; i++)
+    {
+        if (g_did_table[i].did <= g_did_table[i - 1].did)
+        {
+            LOG_MSG(UDS, ERROR, "[UDS] DID table not sorted\r\n", 29);
+            break;
+        }
+    }
+}
+
+const UDS_DidEntry *UDS_FindDID(uint16 did)
+{
+    uint16 low = 0;
+    uint16 high = DID_TABLE_COUNT;
+    
+    while (low < high)
+    {
+        uint16 mid = (uint16)((low + high) / 2);
+        
+        if (g_did_table[mid].did < did)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    
+    return ((low < DID_TABLE_COUNT) && (g_did_table[low].did == did)) ? &g_did_table[low] : NULL;
 }
 
 boolean UDS_HandleRequest(const UDS_Request *request, UDS_Response *response)
@@ -61,19 +157,16 @@ boolean UDS_HandleRequest(const UDS_Request *request, UDS_Response *response)
         return FALSE;
     }
     
-    /* Initialize response */
-    memset(response, 0, sizeof(UDS_Response));
+    /* Initialize response header, handlers write data[] up to data_len */
+    UDS_ResetResponse(response);
     response->source_address = request->target_address;  /* Swap addresses */
     response->target_address = request->source_address;
     
-    /* Find service handler */
-    for (uint8 i = 0; i < SERVICE_HANDLER_COUNT; i++)
+    /* Look up service handler */
+    UDS_ServiceHandler handler = g_service_table[request->service_id];
+    if (handler != NULL)
     {
-        if (g_service_handlers[i].service_id == request->service_id)
-        {
-            /* Call service handler */
-            return g_service_handlers[i].handler(request, response);
-        }
+        return handler(request, response);
     }
     
     /* Service not supported */
@@ -101,25 +194,9 @@ boolean UDS_ParseDoIPDiagnostic(const uint8 *doip_payload, uint32 payload_len, U
         memcpy(request->data, &doip_payload[5], request->data_len);
     }
     
-    /* Debug: Log received UDS request */
-    char log_msg[128];
-    sprintf(log_msg, "[UDS] RX: SID=0x%02X, SA=0x%04X, TA=0x%04X, Len=%d\r\n",
-            request->service_id, request->source_address, request->target_address, request->data_len);
-    sendUARTMessage(log_msg, strlen(log_msg));
-    
-    /* Hex dump of UDS data */
-    if (request->data_len > 0 && request->data_len <= 8)
-    {
-        sprintf(log_msg, "[UDS] Data: ");
-        uint16 len = strlen(log_msg);
-        for (uint16 i = 0; i < request->data_len; i++)
-        {
-            sprintf(log_msg + len, "%02X ", request->data[i]);
-            len += 3;
-        }
-        sprintf(log_msg + len, "\r\n");
-        sendUARTMessage(log_msg, strlen(log_msg));
-    }
+    /* Debug: Trace received UDS request with the first data bytes */
+    LOG_TRACE_DATA(UDS, DEBUG, TRACE_UDS_RX, request->data, (request->data_len <= 8) ? request->data_len : 8,
+                   request->service_id, request->source_address, request->target_address, request->data_len);
     
     return TRUE;
 }
@@ -131,11 +208,11 @@ uint16 UDS_BuildDoIPDiagnostic(const UDS_Response *response, uint8 *buffer, uint
         return 0;
     }
     
-    /* Calculate required size */
-    uint32 payload_len = 4 + 1 + response->data_len;  /* Routing + SID + data */
-    uint16 total_len = DOIP_HEADER_SIZE + payload_len;
+    /* Calculate required size, the body follows the head on the wire */
+    uint32 payload_len = 4 + 1 + response->data_len + response->body_len;  /* Routing + SID + data + body */
+    uint16 head_len = DOIP_HEADER_SIZE + 4 + 1 + response->data_len;
     
-    if (total_len > buffer_size)
+    if (head_len > buffer_size)
     {
         return 0;  /* Buffer too small */
     }
@@ -170,34 +247,47 @@ uint16 UDS_BuildDoIPDiagnostic(const UDS_Response *response, uint8 *buffer, uint
         offset += response->data_len;
     }
     
-    /* Debug: Log sent UDS response */
-    char log_msg[128];
-    sprintf(log_msg, "[UDS] TX: SID=0x%02X, SA=0x%04X, TA=0x%04X, Total=%d bytes\r\n",
-            response->service_id, response->source_address, response->target_address, total_len);
-    sendUARTMessage(log_msg, strlen(log_msg));
+    /* Debug: Trace sent UDS response with the first 16 bytes */
+    LOG_TRACE_DATA(UDS, DEBUG, TRACE_UDS_TX, buffer, head_len,
+                   response->service_id, response->source_address, response->target_address,
+                   DOIP_HEADER_SIZE + payload_len);
     
-    /* Hex dump of first 16 bytes */
-    if (total_len > 0)
+    return head_len;
+}
+
+uint16 UDS_BuildResponsePending(const UDS_Request *request, uint8 *buffer, uint16 buffer_size)
+{
+    uint32 payload_len = 4 + 3;  /* Routing + 0x7F SID 0x78 */
+    uint16 total_len = DOIP_HEADER_SIZE + payload_len;
+    
+    if (request == NULL || buffer == NULL || total_len > buffer_size)
     {
-        uint16 dump_len = (total_len > 16) ? 16 : total_len;
-        sprintf(log_msg, "[UDS] TX Data: ");
-        uint16 len = strlen(log_msg);
-        for (uint16 i = 0; i < dump_len; i++)
-        {
-            sprintf(log_msg + len, "%02X ", buffer[i]);
-            len += 3;
-            if (len >= 110)  /* Prevent buffer overflow */
-                break;
-        }
-        if (total_len > 16)
-        {
-            sprintf(log_msg + len, "...");
-            len += 3;
-        }
-        sprintf(log_msg + len, "\r\n");
-        sendUARTMessage(log_msg, strlen(log_msg));
+        return 0;
     }
     
+    uint16 offset = 0;
+    
+    /* DoIP Header (8 bytes) */
+    buffer[offset++] = DOIP_PROTOCOL_VERSION;
+    buffer[offset++] = DOIP_INVERSE_VERSION;
+    buffer[offset++] = (DOIP_DIAGNOSTIC_MESSAGE >> 8) & 0xFF;
+    buffer[offset++] = DOIP_DIAGNOSTIC_MESSAGE & 0xFF;
+    buffer[offset++] = (payload_len >> 24) & 0xFF;
+    buffer[offset++] = (payload_len >> 16) & 0xFF;
+    buffer[offset++] = (payload_len >> 8) & 0xFF;
+    buffer[offset++] = payload_len & 0xFF;
+    
+    /* DoIP Routing (4 bytes), addresses swapped */
+    buffer[offset++] = (request->target_address >> 8) & 0xFF;
+    buffer[offset++] = request->target_address & 0xFF;
+    buffer[offset++] = (request->source_address >> 8) & 0xFF;
+    buffer[offset++] = request->source_address & 0xFF;
+    
+    /* UDS Negative Response: requestCorrectlyReceived-ResponsePending */
+    buffer[offset++] = UDS_SID_NEGATIVE_RESPONSE;
+    buffer[offset++] = request->service_id;
+    buffer[offset++] = UDS_NRC_REQUEST_CORRECTLY_RECEIVED;
+    
     return total_len;
 }
 
@@ -217,6 +307,21 @@ boolean UDS_Service_ReadDataByIdentifier(const UDS_Request *request, UDS_Respons
     /* Parse DID */
     uint16 did = ((uint16)request->data[0] << 8) | request->data[1];
     
+    const UDS_DidEntry *entry = UDS_FindDID(did);
+    if (entry == NULL || entry->read == NULL)
+    {
+        /* DID not supported */
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+    
+    uint8 nrc = CheckDidAccess(entry);
+    if (nrc != 0)
+    {
+        UDS_CreateNegativeResponse(request, nrc, response);
+        return TRUE;
+    }
+    
     /* Prepare positive response */
     UDS_CreatePositiveResponse(request, response);
     
@@ -225,72 +330,187 @@ boolean UDS_Service_ReadDataByIdentifier(const UDS_Request *request, UDS_Respons
     response->data[1] = request->data[1];
     response->data_len = 2;
     
-    /* Handle DID */
+    /* Read DID */
     uint16 did_data_len = 0;
-    if (UDS_ReadDID_VCI(did, &response->data[2], &did_data_len))
+    if (entry->read(&response->data[2], &did_data_len, &response->body, &response->body_len))
     {
         response->data_len += did_data_len;
         return TRUE;
     }
     
-    /* DID not supported */
+    /* No data available */
     UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
     return TRUE;
 }
 
-boolean UDS_ReadDID_VCI(uint16 did, uint8 *data, uint16 *data_len)
+boolean UDS_ReadDID_VCI(uint16 did, uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len)
 {
-    if (data == NULL || data_len == NULL)
+    if (data == NULL || data_len == NULL || body == NULL || body_len == NULL)
     {
         return FALSE;
     }
     
-    switch (did)
+    const UDS_DidEntry *entry = UDS_FindDID(did);
+    if (entry == NULL || entry->read == NULL)
     {
-        case UDS_DID_VCI_ECU_ID:  /* 0xF194 - Individual ECU VCI */
-        {
-            /* Return ZGW's own VCI */
-            memcpy(data, &g_zgw_vci, sizeof(DoIP_VCI_Info));
-            *data_len = sizeof(DoIP_VCI_Info);
-            return TRUE;
-        }
-        
-        case UDS_DID_VCI_CONSOLIDATED:  /* 0xF195 - Consolidated VCI */
-        {
-            /* This triggers VCI collection from Zone ECUs */
-            DoIP_VCI_Info vci_array[MAX_ZONE_ECUS + 1];
-            uint8 vci_count = 0;
-            
-            if (UDS_ReadConsolidatedVCI(vci_array, &vci_count))
-            {
-                /* Build response: [Count][VCI_1][VCI_2]... */
-                data[0] = vci_count;
-                memcpy(&data[1], vci_array, vci_count * sizeof(DoIP_VCI_Info));
-                *data_len = 1 + (vci_count * sizeof(DoIP_VCI_Info));
-                return TRUE;
-            }
-            return FALSE;
-        }
-        
-        case UDS_DID_HEALTH_STATUS:  /* 0xF1A0 - Health Status */
-        {
-            DoIP_HealthStatus_Info health_array[MAX_ZONE_ECUS + 1];
-            uint8 health_count = 0;
-            
-            if (UDS_ReadHealthStatus(health_array, &health_count))
-            {
-                /* Build response: [Count][Health_1][Health_2]... */
-                data[0] = health_count;
-                memcpy(&data[1], health_array, health_count * sizeof(DoIP_HealthStatus_Info));
-                *data_len = 1 + (health_count * sizeof(DoIP_HealthStatus_Info));
-                return TRUE;
-            }
-            return FALSE;
-        }
-        
-        default:
-            return FALSE;  /* DID not supported */
+        return FALSE;  /* DID not supported */
+    }
+    
+    return entry->read(data, data_len, body, body_len);
+}
+
+static boolean Did_ReadZgwVci(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len)
+{
+    /* 0xF194 - Individual ECU VCI: ZGW's own VCI, streamed from the record */
+    (void)data;
+    *data_len = 0;
+    *body = (const uint8 *)&g_zgw_vci;
+    *body_len = sizeof(DoIP_VCI_Info);
+    return TRUE;
+}
+
+static boolean Did_ReadConsolidatedVci(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len)
+{
+    /* 0xF195 - Consolidated VCI, this triggers VCI collection from Zone ECUs */
+    const DoIP_VCI_Info *vci_array;
+    uint8 vci_count = 0;
+    (void)body;
+    (void)body_len;
+    
+    if (UDS_ReadConsolidatedVCI(&vci_array, &vci_count))
+    {
+        /* Build response: [Count][VCI_1][VCI_2]... copied, a collection may rewrite the database while it is queued */
+        vci_count = DidRecordsFitting(vci_count, sizeof(DoIP_VCI_Info));
+        data[0] = vci_count;
+        memcpy(&data[1], vci_array, vci_count * sizeof(DoIP_VCI_Info));
+        *data_len = (uint16)(1 + (vci_count * sizeof(DoIP_VCI_Info)));
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static boolean Did_ReadHealthStatus(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len)
+{
+    /* 0xF1A0 - Health Status */
+    const DoIP_HealthStatus_Info *health_array;
+    uint8 health_count = 0;
+    (void)body;
+    (void)body_len;
+    
+    if (UDS_ReadHealthStatus(&health_array, &health_count))
+    {
+        /* Build response: [Count][Health_1][Health_2]... copied like the consolidated VCI */
+        health_count = DidRecordsFitting(health_count, sizeof(DoIP_HealthStatus_Info));
+        data[0] = health_count;
+        memcpy(&data[1], health_array, health_count * sizeof(DoIP_HealthStatus_Info));
+        *data_len = (uint16)(1 + (health_count * sizeof(DoIP_HealthStatus_Info)));
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static boolean Did_ReadLogMask(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len)
+{
+    /* 0xF1C0 - Log level masks: [DoIP][UDS][VCI][Flash][netif] */
+    (void)body;
+    (void)body_len;
+    Log_GetMasks(data);
+    *data_len = LOG_MODULE_COUNT;
+    return TRUE;
+}
+
+static uint8 Did_WriteLogMask(const uint8 *data, uint16 data_len)
+{
+    /* 0xF1C0 - one byte per module, length checked against the registry */
+    (void)data_len;
+    Log_SetMasks(data);
+    return 0;
+}
+
+static boolean Did_ReadTransactionPool(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len)
+{
+    /* 0xF1C1 - [In use][High water][Pool size][Exhausted (2)] */
+    const UDS_TransactionStats *stats = UDS_Transaction_GetStats();
+    (void)body;
+    (void)body_len;
+    data[0] = stats->in_use;
+    data[1] = stats->high_water;
+    data[2] = UDS_TRANSACTION_POOL_SIZE;
+    data[3] = (stats->exhausted >> 8) & 0xFF;
+    data[4] = stats->exhausted & 0xFF;
+    *data_len = 5;
+    return TRUE;
+}
+
+static boolean Did_ReadDownloadStatus(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len)
+{
+    /* 0xF1C2 - [State][Received or sent (4)][Programmed (4)][KB/s (2)][Erase suspends (2)][Blocks deferred (2)] */
+    const UDS_DownloadStats *stats = UDS_Download_GetStats();
+    (void)body;
+    (void)body_len;
+    data[0] = stats->state;
+    data[1] = (stats->received >> 24) & 0xFF;
+    data[2] = (stats->received >> 16) & 0xFF;
+    data[3] = (stats->received >> 8) & 0xFF;
+    data[4] = stats->received & 0xFF;
+    data[5] = (stats->programmed >> 24) & 0xFF;
+    data[6] = (stats->programmed >> 16) & 0xFF;
+    data[7] = (stats->programmed >> 8) & 0xFF;
+    data[8] = stats->programmed & 0xFF;
+    data[9] = (stats->kbps >> 8) & 0xFF;
+    data[10] = stats->kbps & 0xFF;
+    data[11] = (stats->erase_suspends >> 8) & 0xFF;
+    data[12] = stats->erase_suspends & 0xFF;
+    data[13] = (stats->blocks_deferred >> 8) & 0xFF;
+    data[14] = stats->blocks_deferred & 0xFF;
+    *data_len = 15;
+    return TRUE;
+}
+
+boolean UDS_Service_WriteDataByIdentifier(const UDS_Request *request, UDS_Response *response)
+{
+    /* 0x2E Write Data By Identifier requires the DID and at least one data byte */
+    if (request->data_len < 3)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
+    }
+    
+    /* Parse DID */
+    uint16 did = ((uint16)request->data[0] << 8) | request->data[1];
+    
+    const UDS_DidEntry *entry = UDS_FindDID(did);
+    if (entry == NULL || entry->write == NULL)
+    {
+        /* DID not supported or read-only */
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+    
+    /* ISO 14229-1 order: session and security, then the length, then the writer */
+    uint8 nrc = CheckDidAccess(entry);
+    if ((nrc == 0) && (entry->length != 0) && (request->data_len != (2 + entry->length)))
+    {
+        nrc = UDS_NRC_INCORRECT_MESSAGE_LENGTH;  /* Fixed-length DIDs must be written completely */
+    }
+    
+    if (nrc == 0)
+    {
+        nrc = entry->write(&request->data[2], (uint16)(request->data_len - 2));
     }
+    
+    if (nrc != 0)
+    {
+        UDS_CreateNegativeResponse(request, nrc, response);
+        return TRUE;
+    }
+    
+    /* Positive response echoes the DID */
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = request->data[0];
+    response->data[1] = request->data[1];
+    response->data_len = 2;
+    return TRUE;
 }
 
 boolean UDS_ReadIndividualVCI(uint16 ecu_address, DoIP_VCI_Info *vci_info)
@@ -306,7 +526,7 @@ boolean UDS_ReadIndividualVCI(uint16 ecu_address, DoIP_VCI_Info *vci_info)
     return FALSE;
 }
 
-boolean UDS_ReadConsolidatedVCI(DoIP_VCI_Info *vci_array, uint8 *vci_count)
+boolean UDS_ReadConsolidatedVCI(const DoIP_VCI_Info **vci_array, uint8 *vci_count)
 {
     if (vci_array == NULL || vci_count == NULL)
     {
@@ -317,7 +537,7 @@ boolean UDS_ReadConsolidatedVCI(DoIP_VCI_Info *vci_array, uint8 *vci_count)
     if (!g_vci_collection_complete)
     {
         /* VCI collection not ready - return only ZGW VCI */
-        memcpy(&vci_array[0], &g_zgw_vci, sizeof(DoIP_VCI_Info));
+        *vci_array = &g_zgw_vci;
         *vci_count = 1;
         return TRUE;
     }
@@ -330,13 +550,13 @@ boolean UDS_ReadConsolidatedVCI(DoIP_VCI_Info *vci_array, uint8 *vci_count)
         total_count = MAX_ZONE_ECUS + 1;
     }
     
-    memcpy(vci_array, g_vci_database, total_count * sizeof(DoIP_VCI_Info));
+    *vci_array = g_vci_database;
     *vci_count = total_count;
     
     return TRUE;
 }
 
-boolean UDS_ReadHealthStatus(DoIP_HealthStatus_Info *health_array, uint8 *health_count)
+boolean UDS_ReadHealthStatus(const DoIP_HealthStatus_Info **health_array, uint8 *health_count)
 {
     if (health_array == NULL || health_count == NULL)
     {
@@ -351,7 +571,7 @@ boolean UDS_ReadHealthStatus(DoIP_HealthStatus_Info *health_array, uint8 *health
         total_count = MAX_ZONE_ECUS + 1;
     }
     
-    memcpy(health_array, g_health_data, total_count * sizeof(DoIP_HealthStatus_Info));
+    *health_array = g_health_data;
     *health_count = total_count;
     
     return TRUE;
@@ -369,6 +589,20 @@ void UDS_CreateNegativeResponse(const UDS_Request *request, uint8 nrc, UDS_Respo
     response->data_len = 2;
     response->data[0] = request->service_id;  /* Rejected Service ID */
     response->data[1] = nrc;                  /* Negative Response Code */
+    response->body = NULL;
+    response->body_len = 0;
+}
+
+void UDS_ResetResponse(UDS_Response *response)
+{
+    response->source_address = 0;
+    response->target_address = 0;
+    response->is_positive = FALSE;
+    response->service_id = 0;
+    response->nrc = 0;
+    response->data_len = 0;
+    response->body = NULL;
+    response->body_len = 0;
 }
 
 void UDS_CreatePositiveResponse(const UDS_Request *request, UDS_Response *response)
@@ -377,12 +611,78 @@ void UDS_CreatePositiveResponse(const UDS_Request *request, UDS_Response *respon
     response->service_id = request->service_id + UDS_POSITIVE_RESPONSE_OFFSET;
     response->nrc = 0;
     response->data_len = 0;
+    response->body = NULL;
+    response->body_len = 0;
 }
 
 /*******************************************************************************
  * UDS Service: 0x31 Routine Control
  ******************************************************************************/
 
+/* Finish a routine from UDS_Transaction_Poll(), 0x78 keeps the tester waiting meanwhile */
+static boolean DeferRoutine(const UDS_Request *request, UDS_Response *response, UDS_JobStep job)
+{
+    if (!UDS_Transaction_Defer(response, job))
+    {
+        /* Only pooled transactions can wait */
+        UDS_CreateNegativeResponse(request, UDS_NRC_CONDITIONS_NOT_CORRECT, response);
+    }
+    
+    return TRUE;
+}
+
+/* 0xF001 job: final response once the collection completed or timed out */
+static UDS_JobStatus Job_VciCollection(const UDS_Request *request, UDS_Response *response)
+{
+    (void)request;
+    
+    if (!g_vci_collection_complete)
+    {
+        return UDS_JOB_PENDING;
+    }
+    
+    /* Response: [sub][RID_H][RID_L][status=0x00=success][count] */
+    response->data[3] = 0x00;  /* Success */
+    response->data[4] = g_zone_ecu_count + 1;  /* Zone ECUs + ZGW */
+    response->data_len = 5;
+    
+    return UDS_JOB_DONE;
+}
+
+/* 0xF002 job: the report waits for room on the way to the VMG instead of failing */
+static UDS_JobStatus Job_SendVciReport(const UDS_Request *request, UDS_Response *response)
+{
+    (void)request;
+    
+    /* Check if DoIP is active */
+    if (!DoIP_Client_IsActive())
+    {
+        /* Connection not ready */
+        response->data[3] = 0x01;  /* Failure: Not connected */
+        response->data_len = 4;
+        LOG_MSG(UDS, ERROR, "[UDS] VCI send failed: DoIP not active\r\n", 41);
+        return UDS_JOB_DONE;
+    }
+    
+    /* Send consolidated VCI report */
+    uint8 total_vci_count = g_zone_ecu_count + 1;  /* Zone ECUs + ZGW */
+    
+    if (DoIP_Client_SendVCIReport(total_vci_count, g_vci_database))
+    {
+        /* Response: [sub][RID_H][RID_L][status=0x00=success][count] */
+        response->data[3] = 0x00;  /* Success */
+        response->data[4] = total_vci_count;
+        response->data_len = 5;
+        
+        LOG_TRACE(UDS, INFO, TRACE_UDS_VCI_REPORT, total_vci_count);
+        
+        return UDS_JOB_DONE;
+    }
+    
+    /* Mailbox or TX queue full: retried on the next poll */
+    return UDS_JOB_PENDING;
+}
+
 boolean UDS_Service_RoutineControl(const UDS_Request *request, UDS_Response *response)
 {
     /* 0x31 Routine Control requires at least 3 bytes: [sub-function][RID_high][RID_low] */
@@ -416,52 +716,14 @@ boolean UDS_Service_RoutineControl(const UDS_Request *request, UDS_Response *res
     {
         case UDS_RID_VCI_COLLECTION_START:  /* 0xF001 - Start VCI Collection */
         {
-            /* Start VCI collection with UDP broadcast */
+            /* Start VCI collection with UDP broadcast, answer once it completes */
             VCI_StartCollection();
-            
-            /* Response: [sub][RID_H][RID_L][status=0x00=success] */
-            response->data[3] = 0x00;  /* Success */
-            response->data_len = 4;
-            
-            return TRUE;
+            return DeferRoutine(request, response, Job_VciCollection);
         }
         
         case UDS_RID_VCI_SEND_REPORT:  /* 0xF002 - Send VCI Report */
         {
-            /* Check if DoIP is active */
-            if (!DoIP_Client_IsActive())
-            {
-                /* Connection not ready */
-                response->data[3] = 0x01;  /* Failure: Not connected */
-                response->data_len = 4;
-                sendUARTMessage("[UDS] VCI send failed: DoIP not active\r\n", 41);
-                return TRUE;
-            }
-            
-            /* Send consolidated VCI report */
-            uint8 total_vci_count = g_zone_ecu_count + 1;  /* Zone ECUs + ZGW */
-            
-            if (DoIP_Client_SendVCIReport(total_vci_count, g_vci_database))
-            {
-                /* Response: [sub][RID_H][RID_L][status=0x00=success][count] */
-                response->data[3] = 0x00;  /* Success */
-                response->data[4] = total_vci_count;
-                response->data_len = 5;
-                
-                char log_msg[64];
-                sprintf(log_msg, "[UDS] VCI report sent (%d ECUs)\r\n", total_vci_count);
-                sendUARTMessage(log_msg, strlen(log_msg));
-                
-                return TRUE;
-            }
-            else
-            {
-                /* Send failed */
-                response->data[3] = 0x02;  /* Failure: Send error */
-                response->data_len = 4;
-                sendUARTMessage("[UDS] VCI send failed: TCP error\r\n", 35);
-                return TRUE;
-            }
+            return DeferRoutine(request, response, Job_SendVciReport);
         }
         
         default:
@@ -472,4 +734,3 @@ boolean UDS_Service_RoutineControl(const UDS_Request *request, UDS_Response *res
         }
     }
 }
-
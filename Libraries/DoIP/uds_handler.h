@@ -44,6 +44,11 @@
 /* Routine Control */
 #define UDS_SID_ROUTINE_CONTROL                 0x31
 
+/* Diagnostic Session Control Sub-functions */
+#define UDS_SESSION_DEFAULT                     0x01
+#define UDS_SESSION_PROGRAMMING                 0x02
+#define UDS_SESSION_EXTENDED                    0x03
+
 /* Routine Control Sub-functions */
 #define UDS_RC_START_ROUTINE                    0x01
 #define UDS_RC_STOP_ROUTINE                     0x02
@@ -79,6 +84,7 @@
 #define UDS_NRC_INCORRECT_MESSAGE_LENGTH        0x13
 #define UDS_NRC_RESPONSE_TOO_LONG               0x14
 
+#define UDS_NRC_BUSY_REPEAT_REQUEST             0x21
 #define UDS_NRC_CONDITIONS_NOT_CORRECT          0x22
 #define UDS_NRC_REQUEST_SEQUENCE_ERROR          0x24
 #define UDS_NRC_REQUEST_OUT_OF_RANGE            0x31
@@ -126,14 +132,25 @@
 #define UDS_DID_BATTERY_VOLTAGE                 0xF1B1  /* Battery Voltage */
 #define UDS_DID_ECU_TEMPERATURE                 0xF1B2  /* ECU Temperature */
 
+/* Logging DIDs */
+#define UDS_DID_LOG_MASK                        0xF1C0  /* Log level mask per module (UART_Log.h), read/write */
+#define UDS_DID_TRANSACTION_POOL                0xF1C1  /* UDS transaction pool occupancy (uds_transaction.h) */
+#define UDS_DID_DOWNLOAD_STATUS                 0xF1C2  /* Flash download progress and KB/s (uds_download.h) */
+
 /*******************************************************************************
  * UDS Handler Configuration
  ******************************************************************************/
 
 #define UDS_MAX_REQUEST_SIZE                    256     /* Max UDS request size */
-#define UDS_MAX_RESPONSE_SIZE                   4096    /* Max UDS response size */
+#define UDS_MAX_RESPONSE_SIZE                   (DOIP_TX_HEAD_SIZE - DOIP_HEADER_SIZE - 5)  /* Max inline response data, bulk data is streamed (body) */
 #define UDS_TIMEOUT_MS                          5000    /* UDS timeout: 5 seconds */
 
+/* Response timing (ISO 14229-2) for asynchronous services */
+#define UDS_P2_SERVER_MS                        50      /* First response due after the request */
+#define UDS_P2_STAR_SERVER_MS                   5000    /* Next response due after a 0x78 */
+#define UDS_PENDING_LEAD_MS                     20      /* 0x78 is sent this long before P2/P2* expire */
+#define UDS_JOB_TIMEOUT_MS                      30000   /* A job still pending after this is rejected (0x10) */
+
 /*******************************************************************************
  * UDS Request/Response Structures
  ******************************************************************************/
@@ -158,6 +175,8 @@ typedef struct
     uint8  nrc;                 /* Negative Response Code (if negative) */
     uint16 data_len;            /* Length of data[] */
     uint8  data[UDS_MAX_RESPONSE_SIZE];  /* Response data */
+    const uint8 *body;          /* Bulk data sent after data[] from its static location, NULL if none */
+    uint16 body_len;            /* Length of body */
 } UDS_Response;
 
 /*******************************************************************************
@@ -167,6 +186,43 @@ typedef struct
 /* UDS Service Handler Function Type */
 typedef boolean (*UDS_ServiceHandler)(const UDS_Request *request, UDS_Response *response);
 
+/* Asynchronous Job Step: completes the response or asks to be called again */
+typedef enum
+{
+    UDS_JOB_PENDING = 0,        /* Not finished, 0x78 keeps the tester waiting */
+    UDS_JOB_DONE                /* Response is final */
+} UDS_JobStatus;
+
+typedef UDS_JobStatus (*UDS_JobStep)(const UDS_Request *request, UDS_Response *response);
+
+/* DID Reader: fills data (inline) and optionally points body at static bulk data */
+typedef boolean (*UDS_DidReader)(uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len);
+
+/* DID Writer: returns 0 on success or the Negative Response Code */
+typedef uint8 (*UDS_DidWriter)(const uint8 *data, uint16 data_len);
+
+/*******************************************************************************
+ * DID Registry
+ ******************************************************************************/
+
+/* Access mask: sessions in which a DID is available, plus the security flag */
+#define UDS_ACCESS_SESSION(session)             (1U << ((session) - 1))
+#define UDS_ACCESS_DEFAULT                      UDS_ACCESS_SESSION(UDS_SESSION_DEFAULT)
+#define UDS_ACCESS_PROGRAMMING                  UDS_ACCESS_SESSION(UDS_SESSION_PROGRAMMING)
+#define UDS_ACCESS_EXTENDED                     UDS_ACCESS_SESSION(UDS_SESSION_EXTENDED)
+#define UDS_ACCESS_ALL_SESSIONS                 (UDS_ACCESS_DEFAULT | UDS_ACCESS_PROGRAMMING | UDS_ACCESS_EXTENDED)
+#define UDS_ACCESS_SECURED                      0x80    /* Security access must be unlocked */
+
+/* DID Registry Entry */
+typedef struct
+{
+    uint16        did;          /* Data Identifier, the table is sorted by it */
+    uint16        length;       /* Data length for writes, 0 = variable */
+    uint8         access;       /* UDS_ACCESS_* mask */
+    UDS_DidReader read;         /* NULL if not readable */
+    UDS_DidWriter write;        /* NULL if not writable */
+} UDS_DidEntry;
+
 /*******************************************************************************
  * Public Functions
  ******************************************************************************/
@@ -195,13 +251,24 @@ boolean UDS_ParseDoIPDiagnostic(const uint8 *doip_payload, uint32 payload_len, U
 
 /**
  * @brief Build DoIP Diagnostic Message from UDS Response
+ * @details The header length covers response->body, which is not copied:
+ *          send it after the returned bytes (DoIP_Connection_Send()).
  * @param response UDS response structure
- * @param buffer Output buffer for DoIP message
+ * @param buffer Output buffer for the DoIP message head
  * @param buffer_size Size of output buffer
- * @return Length of DoIP message, or 0 on error
+ * @return Length of the DoIP message head, or 0 on error
  */
 uint16 UDS_BuildDoIPDiagnostic(const UDS_Response *response, uint8 *buffer, uint16 buffer_size);
 
+/**
+ * @brief Build the DoIP message of a 0x7F <SID> 0x78 response pending
+ * @param request Request being answered
+ * @param buffer Output buffer for the DoIP message
+ * @param buffer_size Size of output buffer
+ * @return Length of DoIP message, or 0 on error
+ */
+uint16 UDS_BuildResponsePending(const UDS_Request *request, uint8 *buffer, uint16 buffer_size);
+
 /*******************************************************************************
  * UDS Service Handlers (0x22 Read Data By Identifier)
  ******************************************************************************/
@@ -214,6 +281,14 @@ uint16 UDS_BuildDoIPDiagnostic(const UDS_Response *response, uint8 *buffer, uint
  */
 boolean UDS_Service_ReadDataByIdentifier(const UDS_Request *request, UDS_Response *response);
 
+/**
+ * @brief Handle 0x2E Write Data By Identifier
+ * @param request UDS request
+ * @param response UDS response (output)
+ * @return TRUE if handled, FALSE otherwise
+ */
+boolean UDS_Service_WriteDataByIdentifier(const UDS_Request *request, UDS_Response *response);
+
 /**
  * @brief Handle 0x31 Routine Control
  * @param request UDS request
@@ -222,14 +297,23 @@ boolean UDS_Service_ReadDataByIdentifier(const UDS_Request *request, UDS_Respons
  */
 boolean UDS_Service_RoutineControl(const UDS_Request *request, UDS_Response *response);
 
+/**
+ * @brief Look up a DID in the registry (binary search)
+ * @param did Data Identifier
+ * @return Registry entry, or NULL if the DID is not supported
+ */
+const UDS_DidEntry *UDS_FindDID(uint16 did);
+
 /**
  * @brief Read VCI Data for a specific DID
  * @param did Data Identifier
  * @param data Output buffer for DID data
  * @param data_len Output length of DID data
+ * @param body Output static data following data, streamed without a copy
+ * @param body_len Output length of body (0 if none)
  * @return TRUE if DID is supported and data is available, FALSE otherwise
  */
-boolean UDS_ReadDID_VCI(uint16 did, uint8 *data, uint16 *data_len);
+boolean UDS_ReadDID_VCI(uint16 did, uint8 *data, uint16 *data_len, const uint8 **body, uint16 *body_len);
 
 /**
  * @brief Read Individual ECU VCI (DID 0xF194)
@@ -241,19 +325,19 @@ boolean UDS_ReadIndividualVCI(uint16 ecu_address, DoIP_VCI_Info *vci_info);
 
 /**
  * @brief Read Consolidated VCI (DID 0xF195)
- * @param vci_array Output array of VCI information
+ * @param vci_array Output pointer to the VCI database (not copied)
  * @param vci_count Output count of VCI entries
  * @return TRUE if successful, FALSE otherwise
  */
-boolean UDS_ReadConsolidatedVCI(DoIP_VCI_Info *vci_array, uint8 *vci_count);
+boolean UDS_ReadConsolidatedVCI(const DoIP_VCI_Info **vci_array, uint8 *vci_count);
 
 /**
  * @brief Read Health Status (DID 0xF1A0)
- * @param health_array Output array of health status
+ * @param health_array Output pointer to the health database (not copied)
  * @param health_count Output count of health entries
  * @return TRUE if successful, FALSE otherwise
  */
-boolean UDS_ReadHealthStatus(DoIP_HealthStatus_Info *health_array, uint8 *health_count);
+boolean UDS_ReadHealthStatus(const DoIP_HealthStatus_Info **health_array, uint8 *health_count);
 
 /*******************************************************************************
  * Helper Functions
@@ -267,6 +351,13 @@ boolean UDS_ReadHealthStatus(DoIP_HealthStatus_Info *health_array, uint8 *health
  */
 void UDS_CreateNegativeResponse(const UDS_Request *request, uint8 nrc, UDS_Response *response);
 
+/**
+ * @brief Reset the response header fields
+ * @details data[] is not cleared: handlers write it up to data_len.
+ * @param response Response structure
+ */
+void UDS_ResetResponse(UDS_Response *response);
+
 /**
  * @brief Create Positive Response
  * @param request Original request
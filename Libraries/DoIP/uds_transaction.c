@@ -0,0 +1,237 @@
+/*******************************************************************************
+ * @file    uds_transaction.c
+ * @brief   UDS Transaction Pool Implementation
+ ******************************************************************************/
+
+#include "uds_transaction.h"
+#include "doip_connection.h"
+#include "IfxStm.h"
+#include "UART_Log.h"
+#include <stddef.h>
+
+#if UDS_TRANSACTION_POOL_SIZE > 32
+#error "UDS_TRANSACTION_POOL_SIZE is limited by the 32-bit allocation mask"
+#endif
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static UDS_Transaction      g_transactions[UDS_TRANSACTION_POOL_SIZE];
+static uint32               g_allocated_mask = 0;   /* Bit n set: g_transactions[n] in use */
+static UDS_TransactionStats g_stats;
+
+/* Response timing in STM0 ticks */
+static uint32 g_p2_ticks;               /* First 0x78, UDS_PENDING_LEAD_MS before P2server */
+static uint32 g_p2_star_ticks;          /* Following 0x78, UDS_PENDING_LEAD_MS before P2*server */
+static uint32 g_job_timeout_ticks;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static uint32 Now(void)
+{
+    return IfxStm_getLower(&MODULE_STM0);
+}
+
+/* Index of a pooled transaction, UDS_TRANSACTION_POOL_SIZE for a foreign pointer */
+static uint32 IndexOf(const UDS_Transaction *transaction)
+{
+    if (transaction < &g_transactions[0] || transaction >= &g_transactions[UDS_TRANSACTION_POOL_SIZE])
+    {
+        return UDS_TRANSACTION_POOL_SIZE;
+    }
+    
+    return (uint32)(transaction - g_transactions);
+}
+
+/* Build the final response into the frame and send it, the body is streamed from its static location */
+static void SendResponse(UDS_Transaction *transaction)
+{
+    UDS_Response *response = &transaction->response;
+    uint16 response_len = UDS_BuildDoIPDiagnostic(response, transaction->frame, sizeof(transaction->frame));
+    
+    if (response_len == 0)
+    {
+        /* Inline data does not fit the head: answer responseTooLong instead of staying silent */
+        UDS_CreateNegativeResponse(&transaction->request, UDS_NRC_RESPONSE_TOO_LONG, response);
+        response_len = UDS_BuildDoIPDiagnostic(response, transaction->frame, sizeof(transaction->frame));
+    }
+    
+    if (response_len > 0)
+    {
+        if (DoIP_Connection_Send(transaction->connection, transaction->frame, response_len, response->body,
+                                 response->body_len))
+        {
+            DoIP_Connection_Flush();  /* Flush immediately */
+            LOG_MSG(DOIP, DEBUG, "[DoIP] TX: Diagnostic Response sent\r\n", 39);
+        }
+        else
+        {
+            LOG_MSG(DOIP, ERROR, "[DoIP] TX: Failed to send response\r\n", 38);
+        }
+    }
+}
+
+/* Tell the tester the final response is still being prepared, FALSE if it could not be sent */
+static boolean SendResponsePending(UDS_Transaction *transaction)
+{
+    /* The frame is free until the final response is built */
+    uint16 len = UDS_BuildResponsePending(&transaction->request, transaction->frame, sizeof(transaction->frame));
+    
+    if (len > 0 && DoIP_Connection_Send(transaction->connection, transaction->frame, len, NULL_PTR, 0))
+    {
+        DoIP_Connection_Flush();
+        g_stats.pending_sent++;
+        return TRUE;
+    }
+    
+    return FALSE;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void UDS_Transaction_Init(void)
+{
+    g_p2_ticks = (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_P2_SERVER_MS - UDS_PENDING_LEAD_MS);
+    g_p2_star_ticks = (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0,
+                                                              UDS_P2_STAR_SERVER_MS - UDS_PENDING_LEAD_MS);
+    g_job_timeout_ticks = (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_JOB_TIMEOUT_MS);
+    
+    for (uint8 i = 0; i < UDS_TRANSACTION_POOL_SIZE; i++)
+    {
+        g_transactions[i].job = NULL;
+    }
+    
+    g_allocated_mask = 0;
+    g_stats.in_use = 0;
+    g_stats.high_water = 0;
+    g_stats.exhausted = 0;
+    g_stats.allocated = 0;
+    g_stats.deferred = 0;
+    g_stats.pending_sent = 0;
+    g_stats.job_timeouts = 0;
+}
+
+UDS_Transaction *UDS_Transaction_Alloc(void)
+{
+    for (uint8 i = 0; i < UDS_TRANSACTION_POOL_SIZE; i++)
+    {
+        if ((g_allocated_mask & (1UL << i)) == 0)
+        {
+            UDS_Transaction *transaction = &g_transactions[i];
+    
+            g_allocated_mask |= (1UL << i);
+            g_stats.in_use++;
+            g_stats.allocated++;
+            if (g_stats.in_use > g_stats.high_water)
+            {
+                g_stats.high_water = g_stats.in_use;
+            }
+    
+            UDS_ResetResponse(&transaction->response);
+            transaction->job = NULL;
+            return transaction;
+        }
+    }
+    
+    g_stats.exhausted++;
+    return NULL;
+}
+
+void UDS_Transaction_Free(UDS_Transaction *transaction)
+{
+    uint32 index = IndexOf(transaction);
+    
+    /* Ignore a foreign pointer or a double free instead of corrupting the counters */
+    if ((index < UDS_TRANSACTION_POOL_SIZE) && ((g_allocated_mask & (1UL << index)) != 0))
+    {
+        transaction->job = NULL;
+        g_allocated_mask &= ~(1UL << index);
+        g_stats.in_use--;
+    }
+}
+
+boolean UDS_Transaction_Defer(UDS_Response *response, UDS_JobStep job)
+{
+    /* The response is embedded in its transaction */
+    UDS_Transaction *transaction = (UDS_Transaction *)((uint8 *)response - offsetof(UDS_Transaction, response));
+    uint32 index = IndexOf(transaction);
+    
+    if ((index >= UDS_TRANSACTION_POOL_SIZE) || ((g_allocated_mask & (1UL << index)) == 0) || (job == NULL))
+    {
+        return FALSE;
+    }
+    
+    transaction->job = job;
+    transaction->started = Now();
+    transaction->pending_due = transaction->started + g_p2_ticks;
+    g_stats.deferred++;
+    
+    return TRUE;
+}
+
+void UDS_Transaction_Complete(UDS_Transaction *transaction)
+{
+    /* A deferred job answers from UDS_Transaction_Poll() */
+    if (transaction->job != NULL)
+    {
+        return;
+    }
+    
+    SendResponse(transaction);
+    UDS_Transaction_Free(transaction);
+}
+
+void UDS_Transaction_Poll(void)
+{
+    if (g_stats.in_use == 0)
+    {
+        return;
+    }
+    
+    for (uint8 i = 0; i < UDS_TRANSACTION_POOL_SIZE; i++)
+    {
+        UDS_Transaction *transaction = &g_transactions[i];
+        
+        if (((g_allocated_mask & (1UL << i)) == 0) || (transaction->job == NULL))
+        {
+            continue;
+        }
+        
+        uint32 now = Now();
+        
+        if (transaction->job(&transaction->request, &transaction->response) == UDS_JOB_DONE)
+        {
+            transaction->job = NULL;
+        }
+        else if ((now - transaction->started) >= g_job_timeout_ticks)
+        {
+            /* Give up instead of holding the transaction and the tester forever */
+            transaction->job = NULL;
+            UDS_CreateNegativeResponse(&transaction->request, UDS_NRC_GENERAL_REJECT, &transaction->response);
+            g_stats.job_timeouts++;
+        }
+        else
+        {
+            /* Still running: 0x78 before the tester's P2 (first) or P2* (repeated) timer runs out,
+             * a 0x78 that found no send buffer space is retried on the next poll */
+            if (((sint32)(now - transaction->pending_due) >= 0) && SendResponsePending(transaction))
+            {
+                transaction->pending_due = now + g_p2_star_ticks;
+            }
+            continue;
+        }
+        
+        SendResponse(transaction);
+        UDS_Transaction_Free(transaction);
+    }
+}
+
+const UDS_TransactionStats *UDS_Transaction_GetStats(void)
+{
+    return &g_stats;
+}
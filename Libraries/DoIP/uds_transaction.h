@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * @file    uds_transaction.h
+ * @brief   UDS Transaction Pool
+ * @details Pre-allocated request/response/frame objects for diagnostic
+ *          requests, so a request costs no stack and no allocation. A
+ *          transaction is owned from UDS_Transaction_Alloc() until
+ *          UDS_Transaction_Free(); the pool is used on the application
+ *          core only.
+ *
+ *          A service that cannot answer at once defers a job step with
+ *          UDS_Transaction_Defer(). UDS_Transaction_Poll() runs it from the
+ *          UDS task, keeps the tester waiting with 0x78 responses before
+ *          P2 and every P2* expires, and sends the final response.
+ ******************************************************************************/
+
+#ifndef UDS_TRANSACTION_H
+#define UDS_TRANSACTION_H
+
+#include "Ifx_Types.h"
+#include "uds_handler.h"
+
+/*******************************************************************************
+ * Configuration
+ ******************************************************************************/
+
+#define UDS_TRANSACTION_POOL_SIZE               4       /* Diagnostic requests in progress at once */
+
+/*******************************************************************************
+ * Types
+ ******************************************************************************/
+
+typedef struct
+{
+    UDS_Request  request;
+    UDS_Response response;
+    uint8        frame[DOIP_TX_HEAD_SIZE];  /* DoIP message head built from the response */
+    UDS_JobStep  job;                       /* Deferred completion, NULL once the response is final */
+    uint8        connection;                /* Handle of the DoIP connection the request came in on */
+    uint32       started;                   /* STM0 tick when the job was deferred */
+    uint32       pending_due;               /* STM0 tick at which the next 0x78 is sent */
+} UDS_Transaction;
+
+typedef struct
+{
+    uint8  in_use;              /* Transactions currently allocated */
+    uint8  high_water;          /* Most transactions allocated at once */
+    uint16 exhausted;           /* Allocations refused because the pool was empty */
+    uint32 allocated;           /* Allocations since start-up */
+    uint32 deferred;            /* Jobs deferred to UDS_Transaction_Poll() */
+    uint32 pending_sent;        /* 0x78 response pending messages sent */
+    uint16 job_timeouts;        /* Jobs rejected after UDS_JOB_TIMEOUT_MS */
+} UDS_TransactionStats;
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+/**
+ * @brief Return all transactions to the pool and clear the counters
+ */
+void UDS_Transaction_Init(void);
+
+/**
+ * @brief Take a transaction from the pool
+ * @details Only the response header fields are reset (UDS_ResetResponse()),
+ *          the data areas keep whatever the previous owner left.
+ * @return Transaction, or NULL if all are in use
+ */
+UDS_Transaction *UDS_Transaction_Alloc(void);
+
+/**
+ * @brief Give a transaction back to the pool
+ */
+void UDS_Transaction_Free(UDS_Transaction *transaction);
+
+/**
+ * @brief Finish a response later from UDS_Transaction_Poll()
+ * @details Called by a service handler; the transaction stays allocated
+ *          until the job returns UDS_JOB_DONE.
+ * @param response Response of a pooled transaction
+ * @param job Step function, called once per poll
+ * @return FALSE if the response does not belong to a pooled transaction
+ */
+boolean UDS_Transaction_Defer(UDS_Response *response, UDS_JobStep job);
+
+/**
+ * @brief Send the response of a transaction handled synchronously or deferred
+ * @details Frees the transaction unless a job was deferred.
+ */
+void UDS_Transaction_Complete(UDS_Transaction *transaction);
+
+/**
+ * @brief Step the deferred jobs, send 0x78 when due and the final responses
+ * @details Call from the application core's UDS task, which runs again
+ *          while a transaction is allocated.
+ */
+void UDS_Transaction_Poll(void);
+
+/**
+ * @brief Pool occupancy counters
+ */
+const UDS_TransactionStats *UDS_Transaction_GetStats(void);
+
+#endif /* UDS_TRANSACTION_H */
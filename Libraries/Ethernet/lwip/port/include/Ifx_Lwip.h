@@ -64,6 +64,7 @@
 #include "netif/etharp.h"
 #include "netif/ppp/pppoe.h"
 #include "IfxGeth_Eth.h"
+#include "Sched.h"
 
 //________________________________________________________________________________________
 // HELPER MACROS
@@ -76,6 +77,60 @@
     (ptr)->addr[4] = e;                 \
     (ptr)->addr[5] = f;
 
+/* GETH queues (one RX and one TX DMA channel each), polled in this order */
+#ifndef IFX_NETIF_QUEUES
+#define IFX_NETIF_QUEUES 1
+#endif
+#if (IFX_NETIF_QUEUES < 1) || (IFX_NETIF_QUEUES > 2)
+#error "IFX_NETIF_QUEUES must be 1 or 2"
+#endif
+
+#define IFX_NETIF_QUEUE_DIAG 0                  // DoIP diagnostics: TCP IFX_NETIF_DIAG_PORT, untagged unicast
+#if IFX_NETIF_QUEUES > 1
+#define IFX_NETIF_QUEUE_BEST_EFFORT 1           // broadcast/multicast (ARP, VCI), everything else
+#else
+#define IFX_NETIF_QUEUE_BEST_EFFORT 0
+#endif
+
+#ifndef IFX_NETIF_DIAG_PORT
+#define IFX_NETIF_DIAG_PORT 13400
+#endif
+#ifndef IFX_NETIF_DIAG_VLAN_PRIORITIES
+#define IFX_NETIF_DIAG_VLAN_PRIORITIES 0xE0     // PCP bitmask
+#endif
+
+/* per queue: descriptor ring lengths (at most IFXGETH_MAX_xX_DESCRIPTORS) and
+ * poll weight, which is also the queue's weight in the MTL TX scheduler */
+#ifndef IFX_NETIF_DIAG_RX_DESCRIPTORS
+#define IFX_NETIF_DIAG_RX_DESCRIPTORS IFXGETH_MAX_RX_DESCRIPTORS
+#endif
+#ifndef IFX_NETIF_DIAG_TX_DESCRIPTORS
+#define IFX_NETIF_DIAG_TX_DESCRIPTORS IFXGETH_MAX_TX_DESCRIPTORS
+#endif
+#ifndef IFX_NETIF_DIAG_WEIGHT
+#define IFX_NETIF_DIAG_WEIGHT 6
+#endif
+#ifndef IFX_NETIF_BE_RX_DESCRIPTORS
+#define IFX_NETIF_BE_RX_DESCRIPTORS 4
+#endif
+#ifndef IFX_NETIF_BE_TX_DESCRIPTORS
+#define IFX_NETIF_BE_TX_DESCRIPTORS 4
+#endif
+#ifndef IFX_NETIF_BE_WEIGHT
+#define IFX_NETIF_BE_WEIGHT 2
+#endif
+
+#if (IFX_NETIF_DIAG_RX_DESCRIPTORS > IFXGETH_MAX_RX_DESCRIPTORS) || (IFX_NETIF_BE_RX_DESCRIPTORS > IFXGETH_MAX_RX_DESCRIPTORS) \
+    || (IFX_NETIF_DIAG_TX_DESCRIPTORS > IFXGETH_MAX_TX_DESCRIPTORS) || (IFX_NETIF_BE_TX_DESCRIPTORS > IFXGETH_MAX_TX_DESCRIPTORS)
+#error "GETH queue ring longer than the iLLD descriptor list"
+#endif
+
+#if IFX_NETIF_QUEUES > 1
+#define IFX_NETIF_RX_DESCRIPTORS (IFX_NETIF_DIAG_RX_DESCRIPTORS + IFX_NETIF_BE_RX_DESCRIPTORS)
+#else
+#define IFX_NETIF_RX_DESCRIPTORS IFX_NETIF_DIAG_RX_DESCRIPTORS
+#endif
+
 //________________________________________________________________________________________
 // TYPEDEFS
 
@@ -92,6 +147,19 @@ typedef struct tcp_pcb  tcp_pcb_t;
 //________________________________________________________________________________________
 // DATA STRUCTURES
 
+/** \brief RX batching statistics, see Ifx_Lwip_pollReceiveFlags() */
+typedef struct
+{
+    uint32 polls;               /**< \brief Polls that had RX work pending */
+    uint32 frames;              /**< \brief Frames passed to lwIP */
+    uint32 budgetHits;          /**< \brief Polls that stopped at the budget with frames left */
+    uint32 drops;               /**< \brief Frames dropped by the netif (errored or no buffer) */
+    uint16 maxFramesPerPoll;    /**< \brief Largest batch drained by a single poll */
+    uint16 ringHighWater;       /**< \brief Most filled RX descriptors seen at the start of a poll */
+    uint32 queueFrames[IFX_NETIF_QUEUES];   /**< \brief Frames passed to lwIP per GETH queue */
+    uint32 weightHits[IFX_NETIF_QUEUES];    /**< \brief Polls that left a queue at its weight with frames left */
+} Ifx_Lwip_RxStats;
+
 /** \brief Runtime structure of the AURIX LWIP stack */
 typedef struct
 {
@@ -100,19 +168,11 @@ typedef struct
     dhcp_t     dhcp;
 #endif
     eth_addr_t eth_addr;
-    struct
-    {
-        uint16 arp;
-#if LWIP_DHCP
-        uint16 dhcp_coarse;
-        uint16 dhcp_fine;
-#endif
-        uint16 tcp_fast;
-        uint16 tcp_slow;
-        uint16 link;
-    }               timer;
-
-    volatile uint16 timerFlags;
+    volatile uint32 rxPending;  /**< \brief RX interrupts not yet served by Ifx_Lwip_pollReceiveFlags() */
+    Sched_Event     event;      /**< \brief Posted by the GETH RX and TX interrupts */
+    uint16          rxBudget;   /**< \brief Max. frames passed to lwIP per poll */
+    uint16          rxWeight[IFX_NETIF_QUEUES]; /**< \brief Max. frames taken from each GETH queue per poll */
+    Ifx_Lwip_RxStats rxStats;
 } Ifx_Lwip;
 
 /** \brief Configuration structure for the AURIX LWIP stack */
@@ -124,17 +184,27 @@ typedef struct
     eth_addr_t ethAddr;     /**< \brief Ethernet (MAC) address, e.g. : {0x10, 0x20, 0x30, 0x40, 0x50, 0x60} */
 } Ifx_Lwip_Config;
 
+#ifndef IFX_LWIP_RX_BUDGET
+#define IFX_LWIP_RX_BUDGET 8    // frames per Ifx_Lwip_pollReceiveFlags() call
+#endif
+
 #define IFXGETH_HEADER_LENGTH 14 // words
 #define IFXGETH_MAX_TX_BUFFER_SIZE (2560+IFXGETH_HEADER_LENGTH+2) // bytes
 #define IFXGETH_MAX_RX_BUFFER_SIZE (2560+IFXGETH_HEADER_LENGTH+2) // bytes
 
+/* RX DMA buffers: one per descriptor of all queues, plus spares to refill descriptors while lwIP holds zero-copy frames */
+#if IFX_NETIF_RX_ZERO_COPY
+#define IFX_NETIF_RX_BUFFER_COUNT (IFX_NETIF_RX_DESCRIPTORS + IFX_NETIF_RX_SPARE_BUFFERS)
+#else
+#define IFX_NETIF_RX_BUFFER_COUNT IFX_NETIF_RX_DESCRIPTORS
+#endif
+
 //________________________________________________________________________________________
 // GLOBAL VARIABLES
-IFX_EXTERN volatile uint32 g_TickCount_1ms;
 IFX_EXTERN Ifx_Lwip g_Lwip;
 IFX_EXTERN IfxGeth_Eth g_IfxGeth;
 IFX_EXTERN uint8 channel0TxBuffer1[IFXGETH_MAX_TX_DESCRIPTORS][IFXGETH_MAX_TX_BUFFER_SIZE];
-IFX_EXTERN uint8 channel0RxBuffer1[IFXGETH_MAX_RX_DESCRIPTORS][IFXGETH_MAX_RX_BUFFER_SIZE];
+IFX_EXTERN uint8 channel0RxBuffer1[IFX_NETIF_RX_BUFFER_COUNT][IFXGETH_MAX_RX_BUFFER_SIZE];
 
 //________________________________________________________________________________________
 // FUNCTION PROTOTYPES
@@ -142,12 +212,16 @@ IFX_EXTERN uint8 channel0RxBuffer1[IFXGETH_MAX_RX_DESCRIPTORS][IFXGETH_MAX_RX_BU
 /** \addtogroup lib_lwIP
  * \{ */
 IFX_EXTERN void     Ifx_Lwip_init(eth_addr_t ethAddr);
-IFX_EXTERN void     Ifx_Lwip_onTimerTick(void);
-IFX_EXTERN void     Ifx_Lwip_pollTimerFlags(void);
+IFX_EXTERN void     Ifx_Lwip_pollTimeouts(void);
 IFX_EXTERN void     Ifx_Lwip_pollReceiveFlags(void);
+IFX_EXTERN void     Ifx_Lwip_setRxBudget(uint16 budget);
+IFX_EXTERN void     Ifx_Lwip_setRxWeight(uint8 queue, uint16 weight);
+IFX_EXTERN const Ifx_Lwip_RxStats *Ifx_Lwip_getRxStats(void);
+IFX_EXTERN void     Ifx_Lwip_resetRxStats(void);
 IFX_INLINE netif_t *Ifx_Lwip_getNetIf(void);
 IFX_INLINE uint8   *Ifx_Lwip_getIpAddrPtr(void);
 IFX_INLINE uint8   *Ifx_Lwip_getHwAddrPtr(void);
+IFX_INLINE uint8    Ifx_Lwip_getTxQueue(const pbuf_t *p);
 
 /* This function is used to get the low-level driver */
 IFX_INLINE IfxGeth_Eth *IfxGeth_get(void);
@@ -183,4 +257,47 @@ IFX_INLINE IfxGeth_Eth *IfxGeth_get(void)
 }
 
 
+/** \brief Returns the GETH queue a frame is sent on
+ *
+ * TCP segments from or to IFX_NETIF_DIAG_PORT go to the diagnostic queue,
+ * everything else to the best-effort queue. Only the first pbuf is parsed,
+ * lwIP builds the Ethernet, IP and TCP headers in one piece.
+ */
+IFX_INLINE uint8 Ifx_Lwip_getTxQueue(const pbuf_t *p)
+{
+#if IFX_NETIF_QUEUES > 1
+    const uint8          *frame = (const uint8 *)p->payload + ETH_PAD_SIZE;
+    const struct eth_hdr *ethhdr = (const struct eth_hdr *)frame;
+    const struct ip_hdr  *iphdr  = (const struct ip_hdr *)&frame[SIZEOF_ETH_HDR];
+    const struct tcp_hdr *tcphdr;
+    uint16                hlen;
+
+    if ((p->len < (ETH_PAD_SIZE + SIZEOF_ETH_HDR + IP_HLEN)) || (ethhdr->type != PP_HTONS(ETHTYPE_IP))
+        || (IPH_PROTO(iphdr) != IP_PROTO_TCP) || ((IPH_OFFSET(iphdr) & PP_HTONS(IP_OFFMASK)) != 0))
+    {
+        return IFX_NETIF_QUEUE_BEST_EFFORT;
+    }
+
+    hlen = IPH_HL_BYTES(iphdr);
+
+    if (p->len < (ETH_PAD_SIZE + SIZEOF_ETH_HDR + hlen + TCP_HLEN))
+    {
+        return IFX_NETIF_QUEUE_BEST_EFFORT;
+    }
+
+    tcphdr = (const struct tcp_hdr *)&frame[SIZEOF_ETH_HDR + hlen];
+
+    if ((tcphdr->src == PP_HTONS(IFX_NETIF_DIAG_PORT)) || (tcphdr->dest == PP_HTONS(IFX_NETIF_DIAG_PORT)))
+    {
+        return IFX_NETIF_QUEUE_DIAG;
+    }
+
+    return IFX_NETIF_QUEUE_BEST_EFFORT;
+#else
+    (void)p;
+    return IFX_NETIF_QUEUE_DIAG;
+#endif
+}
+
+
 #endif /* __IFX_LWIP_H__ */
@@ -46,6 +46,10 @@
 #define IFX_LWIP_NETIF_H
 
 err_t ifx_netif_init(struct netif *netif);
-err_t ifx_netif_input(struct netif *netif);
+err_t ifx_netif_input(struct netif *netif, u8_t queue);
+void  ifx_netif_txComplete(struct netif *netif, u8_t queue);
+void  ifx_netif_txRelease(struct netif *netif);
+u32_t ifx_netif_rxAvailable(struct netif *netif, u8_t queue);
+u32_t ifx_netif_rxDrops(struct netif *netif);
 
 #endif
@@ -55,27 +55,15 @@
 #include "Configuration.h"
 #include <string.h>
 #include <stdarg.h>
-#include <UART_Logging.h>
+#include <UART_Log.h>
+#include "Timer_Wheel.h"
+#include "lwip/timeouts.h"
 
 
 /******************************************************************************/
 /*-----------------------------------Macros-----------------------------------*/
 /******************************************************************************/
-#define IFX_LWIP_TIMER_TICK_MS      (1U)    // number of timer ticks per millisecond
-
-#define IFX_LWIP_ARP_PERIOD         (ARP_TMR_INTERVAL / IFX_LWIP_TIMER_TICK_MS)
-#define IFX_LWIP_TCP_FAST_PERIOD    (TCP_FAST_INTERVAL / IFX_LWIP_TIMER_TICK_MS)
-#define IFX_LWIP_TCP_SLOW_PERIOD    (TCP_SLOW_INTERVAL / IFX_LWIP_TIMER_TICK_MS)
-#define IFX_LWIP_DHCP_COARSE_PERIOD (DHCP_COARSE_TIMER_MSECS / IFX_LWIP_TIMER_TICK_MS)
-#define IFX_LWIP_DHCP_FINE_PERIOD   (DHCP_FINE_TIMER_MSECS / IFX_LWIP_TIMER_TICK_MS)
-#define IFX_LWIP_LINK_PERIOD        (100U / IFX_LWIP_TIMER_TICK_MS) /* 100 ms */
-
-#define IFX_LWIP_FLAG_ARP           (1U << 1)
-#define IFX_LWIP_FLAG_TCP_FAST      (1U << 2)
-#define IFX_LWIP_FLAG_TCP_SLOW      (1U << 3)
-#define IFX_LWIP_FLAG_LINK          (1U << 4)
-#define IFX_LWIP_FLAG_DHCP_COARSE   (1U << 5)
-#define IFX_LWIP_FLAG_DHCP_FINE     (1U << 6)
+#define IFX_LWIP_LINK_PERIOD        (100U)  // PHY link check, ms
 
 /******************************************************************************/
 /*--------------------------------Enumerations--------------------------------*/
@@ -206,13 +194,12 @@
 #error "Set CPU_WHICH_SERVICE_ETHERNET to a valid value!"
 #endif
 
-volatile uint32 g_TickCount_1ms;
 Ifx_Lwip    g_Lwip;
 IfxGeth_Eth g_IfxGeth;
 uint32 isrTxCount=0;
 uint32 isrRxCount=0;
 uint8 channel0TxBuffer1[IFXGETH_MAX_TX_DESCRIPTORS][IFXGETH_MAX_TX_BUFFER_SIZE];
-uint8 channel0RxBuffer1[IFXGETH_MAX_RX_DESCRIPTORS][IFXGETH_MAX_RX_BUFFER_SIZE];
+uint8 channel0RxBuffer1[IFX_NETIF_RX_BUFFER_COUNT][IFXGETH_MAX_RX_BUFFER_SIZE];
 
 
 /******************************************************************************/
@@ -230,130 +217,203 @@ uint8 channel0RxBuffer1[IFXGETH_MAX_RX_DESCRIPTORS][IFXGETH_MAX_RX_BUFFER_SIZE];
 /*-------------------------Function Implementations---------------------------*/
 /******************************************************************************/
 
-#define Ifx_Lwip_timerIncr(var, PERIOD, FLAG) \
-    {                                         \
-        var += 1;                             \
-        if (var >= PERIOD)                    \
-        {                                     \
-            var         = 0;                  \
-            timerFlags |= FLAG;               \
-        }                                     \
-    }
+/** \brief Follows the PHY link state and mode */
+static void Ifx_Lwip_checkLink(void)
+{
+	Ifx_GETH_MAC_PHYIF_CONTROL_STATUS ctrl_status;
+	ctrl_status.U = IfxGeth_Eth_Phy_Dp83825i_link_status();
+	if (ctrl_status.B.LNKSTS == 0)
+		netif_set_link_down(&g_Lwip.netif);
+	else {
+		IfxGeth_Eth *ethernetif = g_Lwip.netif.state;
+		// we set the correct duplexMode
+		if (ctrl_status.B.LNKMOD == 1)
+			IfxGeth_mac_setDuplexMode(ethernetif->gethSFR, IfxGeth_DuplexMode_fullDuplex);
+		else
+			IfxGeth_mac_setDuplexMode(ethernetif->gethSFR, IfxGeth_DuplexMode_halfDuplex);
+		// we set the correct speed
+		if (ctrl_status.B.LNKSPEED == 0)
+			// 10MBit speed
+			IfxGeth_mac_setLineSpeed(ethernetif->gethSFR, IfxGeth_LineSpeed_10Mbps);
+		else
+    		if (ctrl_status.B.LNKSPEED == 1)
+    			// 100MBit speed
+    			IfxGeth_mac_setLineSpeed(ethernetif->gethSFR, IfxGeth_LineSpeed_100Mbps);
+    		else
+    			// 1000MBit speed
+    			IfxGeth_mac_setLineSpeed(ethernetif->gethSFR, IfxGeth_LineSpeed_1000Mbps);
+		netif_set_link_up(&g_Lwip.netif);
+	}
+}
+
 
-/** \brief Timer interrupt callback */
-void Ifx_Lwip_onTimerTick(void)
+static Timer_Entry g_linkTimer;       /* PHY link check, periodic */
+static Timer_Entry g_timeoutsTimer;   /* next deadline of the lwIP timeouts (sys_timeout()) */
+static uint32      g_timeoutsDeadline;
+
+
+/** \brief Timer wheel callback of the PHY link check */
+static void Ifx_Lwip_onLinkTimer(void *arg)
 {
-    Ifx_Lwip *lwip       = &g_Lwip;
-    uint16    timerFlags = lwip->timerFlags;
+    (void)arg;
+    Ifx_Lwip_checkLink();
+}
 
-    Ifx_Lwip_timerIncr(lwip->timer.arp, IFX_LWIP_ARP_PERIOD, IFX_LWIP_FLAG_ARP);
 
-    Ifx_Lwip_timerIncr(lwip->timer.tcp_fast, IFX_LWIP_TCP_FAST_PERIOD, IFX_LWIP_FLAG_TCP_FAST);
-    Ifx_Lwip_timerIncr(lwip->timer.tcp_slow, IFX_LWIP_TCP_SLOW_PERIOD, IFX_LWIP_FLAG_TCP_SLOW);
+/** \brief Timer wheel callback of the lwIP timeouts: runs the ones due, then follows the next */
+static void Ifx_Lwip_onTimeoutsTimer(void *arg)
+{
+    (void)arg;
+    sys_check_timeouts();
+    Ifx_Lwip_pollTimeouts();
+}
 
-#if LWIP_DHCP
-    Ifx_Lwip_timerIncr(lwip->timer.dhcp_coarse, IFX_LWIP_DHCP_COARSE_PERIOD, IFX_LWIP_FLAG_DHCP_COARSE);
-    Ifx_Lwip_timerIncr(lwip->timer.dhcp_fine, IFX_LWIP_DHCP_FINE_PERIOD, IFX_LWIP_FLAG_DHCP_FINE);
-#endif
 
-    Ifx_Lwip_timerIncr(lwip->timer.link, IFX_LWIP_LINK_PERIOD, IFX_LWIP_FLAG_LINK);
+/** \brief Follows the next lwIP timeout with the wheel timer
+ *
+ * lwIP keeps its timers (TCP, ARP, IP reassembly, DHCP, ...) in its own sorted timeout list, and only
+ * those it needs: the TCP timer runs while there are active or TIME-WAIT PCBs. Only the head of the list
+ * is put on the wheel, so the STM0 comparator is programmed for the next real lwIP deadline and an idle
+ * stack causes no interrupts. Call after anything that may have started an lwIP timeout.
+ */
+void Ifx_Lwip_pollTimeouts(void)
+{
+    u32_t sleepMs = sys_timeouts_sleeptime();
 
-    lwip->timerFlags = timerFlags;
+    if (sleepMs == SYS_TIMEOUTS_SLEEPTIME_INFINITE)
+    {
+        Timer_stop(&g_timeoutsTimer);
+        return;
+    }
+
+    /* O(1) unless the head of the list changed */
+    if (!Timer_isRunning(&g_timeoutsTimer) || (g_timeoutsDeadline != (sys_now() + sleepMs)))
+    {
+        g_timeoutsDeadline = sys_now() + sleepMs;
+        Timer_start(&g_Timer_net, &g_timeoutsTimer, sleepMs, 0);
+    }
 }
 
 
-/** \brief Polling the timer event flags */
-void Ifx_Lwip_pollTimerFlags(void)
+/** \brief Polling the ETH receive event flags
+ *
+ * Serves the RX interrupts counted by the GETH RX ISRs: drains the queues in
+ * priority order (diagnostics first), taking at most rxWeight[q] frames from
+ * queue q and at most rxBudget frames in total, so neither a burst nor a bulk
+ * transfer on one queue can hold the main loop or starve the other queue.
+ * Frames left over keep the request pending for the next call.
+ */
+void Ifx_Lwip_pollReceiveFlags(void)
 {
     Ifx_Lwip *lwip = &g_Lwip;
-    uint16    timerFlags;
+    uint32    pending;
+    uint32    available = 0;
+    uint32    frames    = 0;
+    uint32    queueFrames;
+    boolean   left      = FALSE;
+    uint8     queue;
 
     /* disable interrupts */
     boolean interruptState = IfxCpu_disableInterrupts();
 
-    timerFlags       = lwip->timerFlags;
-    lwip->timerFlags = 0;
+    pending         = lwip->rxPending;
+    lwip->rxPending = 0;
 
     /* enable interrupts again */
     IfxCpu_restoreInterrupts(interruptState);
 
-#if LWIP_DHCP
-    if (timerFlags & IFX_LWIP_FLAG_DHCP_COARSE)
+    if (pending != 0)
     {
-    	/* only if we have a link we will check the dhcp */
-    	if (g_Lwip.netif.flags & NETIF_FLAG_LINK_UP)
-    		dhcp_coarse_tmr();
+        for (queue = 0; queue < IFX_NETIF_QUEUES; queue++)
+        {
+            available += ifx_netif_rxAvailable(&lwip->netif, queue);
+        }
+
+        if (available > lwip->rxStats.ringHighWater)
+        {
+            lwip->rxStats.ringHighWater = (uint16)available;
+        }
+
+        for (queue = 0; queue < IFX_NETIF_QUEUES; queue++)
+        {
+            queueFrames = 0;
+
+            while ((queueFrames < lwip->rxWeight[queue]) && (frames < lwip->rxBudget)
+                   && (ifx_netif_rxAvailable(&lwip->netif, queue) != 0))
+            {
+                ifx_netif_input(&lwip->netif, queue);
+                queueFrames++;
+                frames++;
+            }
+
+            lwip->rxStats.queueFrames[queue] += queueFrames;
+
+            if (ifx_netif_rxAvailable(&lwip->netif, queue) != 0)
+            {
+                if (queueFrames >= lwip->rxWeight[queue])
+                {
+                    lwip->rxStats.weightHits[queue]++;
+                }
+
+                left = TRUE;
+            }
+        }
+
+        lwip->rxStats.polls++;
+        lwip->rxStats.frames += frames;
+
+        if (frames > lwip->rxStats.maxFramesPerPoll)
+        {
+            lwip->rxStats.maxFramesPerPoll = (uint16)frames;
+        }
+
+        if (left != FALSE)
+        {
+            if (frames >= lwip->rxBudget)
+            {
+                lwip->rxStats.budgetHits++;
+            }
+
+            interruptState = IfxCpu_disableInterrupts();
+            lwip->rxPending++;
+            IfxCpu_restoreInterrupts(interruptState);
+        }
     }
 
-    if (timerFlags & IFX_LWIP_FLAG_DHCP_FINE)
-    {
-    	/* only if we have a link we will check the dhcp */
-    	if (g_Lwip.netif.flags & NETIF_FLAG_LINK_UP)
-    		dhcp_fine_tmr();
-    }
-#endif
+    /* free the pbufs of frames the GETH TX ISRs reported as sent */
+    ifx_netif_txRelease(&lwip->netif);
+}
 
-    if (timerFlags & IFX_LWIP_FLAG_TCP_FAST)
-    {
-    	/* only if we have a link we will check the tcp */
-    	if (g_Lwip.netif.flags & NETIF_FLAG_LINK_UP)
-    		tcp_fasttmr();
-    }
 
-    if (timerFlags & IFX_LWIP_FLAG_TCP_SLOW)
-    {
-    	/* only if we have a link we will check the tcp */
-    	if (g_Lwip.netif.flags & NETIF_FLAG_LINK_UP)
-    		tcp_slowtmr();
-    }
+/** \brief Sets the max. number of frames Ifx_Lwip_pollReceiveFlags() passes to lwIP per call */
+void Ifx_Lwip_setRxBudget(uint16 budget)
+{
+    g_Lwip.rxBudget = (budget != 0) ? budget : 1;
+}
 
-    if (timerFlags & IFX_LWIP_FLAG_ARP)
-    {
-    	/* only if we have a link we will check the arp */
-    	if (g_Lwip.netif.flags & NETIF_FLAG_LINK_UP)
-    		etharp_tmr();
-    }
 
-    if (timerFlags & IFX_LWIP_FLAG_LINK)
+/** \brief Sets the max. number of frames Ifx_Lwip_pollReceiveFlags() takes from one GETH queue per call */
+void Ifx_Lwip_setRxWeight(uint8 queue, uint16 weight)
+{
+    if (queue < IFX_NETIF_QUEUES)
     {
-        Ifx_GETH_MAC_PHYIF_CONTROL_STATUS ctrl_status;
-		ctrl_status.U = IfxGeth_Eth_Phy_Dp83825i_link_status();
-    	if (ctrl_status.B.LNKSTS == 0)
-    		netif_set_link_down(&g_Lwip.netif);
-    	else {
-    		IfxGeth_Eth *ethernetif = g_Lwip.netif.state;
-    		// we set the correct duplexMode
-    		if (ctrl_status.B.LNKMOD == 1)
-    			IfxGeth_mac_setDuplexMode(ethernetif->gethSFR, IfxGeth_DuplexMode_fullDuplex);
-    		else
-    			IfxGeth_mac_setDuplexMode(ethernetif->gethSFR, IfxGeth_DuplexMode_halfDuplex);
-    		// we set the correct speed
-    		if (ctrl_status.B.LNKSPEED == 0)
-    			// 10MBit speed
-    			IfxGeth_mac_setLineSpeed(ethernetif->gethSFR, IfxGeth_LineSpeed_10Mbps);
-    		else
-        		if (ctrl_status.B.LNKSPEED == 1)
-        			// 100MBit speed
-        			IfxGeth_mac_setLineSpeed(ethernetif->gethSFR, IfxGeth_LineSpeed_100Mbps);
-        		else
-        			// 1000MBit speed
-        			IfxGeth_mac_setLineSpeed(ethernetif->gethSFR, IfxGeth_LineSpeed_1000Mbps);
-    		netif_set_link_up(&g_Lwip.netif);
-    	}
+        g_Lwip.rxWeight[queue] = (weight != 0) ? weight : 1;
     }
 }
 
 
-/** \brief Polling the ETH receive event flags */
-void Ifx_Lwip_pollReceiveFlags(void)
+/** \brief Returns the RX batching statistics */
+const Ifx_Lwip_RxStats *Ifx_Lwip_getRxStats(void)
 {
-    /**
-     * We are assuming that the only interrupt source is an incoming packet
-     */
-    //while (ethernetif_tc29x_timerFlags_interrupt())
-    {
-        ifx_netif_input(&g_Lwip.netif);
-    }
+    g_Lwip.rxStats.drops = ifx_netif_rxDrops(&g_Lwip.netif);
+    return &g_Lwip.rxStats;
+}
+
+
+/** \brief Clears the RX batching statistics (the netif drop counter keeps running) */
+void Ifx_Lwip_resetRxStats(void)
+{
+    memset(&g_Lwip.rxStats, 0, sizeof(g_Lwip.rxStats));
 }
 
 #if LWIP_NETIF_EXT_STATUS_CALLBACK
@@ -394,6 +454,21 @@ void Ifx_Lwip_init(eth_addr_t ethAddr)
     /** - initialise LWIP (lwip_init()) */
     lwip_init();
 
+    /** - follow the lwIP timeouts and the PHY link on the Ethernet core's timer wheel */
+    Timer_init(&g_timeoutsTimer, Ifx_Lwip_onTimeoutsTimer, NULL_PTR);
+    Timer_init(&g_linkTimer, Ifx_Lwip_onLinkTimer, NULL_PTR);
+    Timer_start(&g_Timer_net, &g_linkTimer, IFX_LWIP_LINK_PERIOD, IFX_LWIP_LINK_PERIOD);
+    Ifx_Lwip_pollTimeouts();
+
+    /* serve frames that arrive before the first RX interrupt */
+    g_Lwip.rxBudget  = IFX_LWIP_RX_BUDGET;
+    g_Lwip.rxWeight[IFX_NETIF_QUEUE_DIAG] = IFX_NETIF_DIAG_WEIGHT;
+#if IFX_NETIF_QUEUES > 1
+    g_Lwip.rxWeight[IFX_NETIF_QUEUE_BEST_EFFORT] = IFX_NETIF_BE_WEIGHT;
+#endif
+    g_Lwip.rxPending = 1;
+    Sched_signal(&g_Lwip.event);
+
     /** - initialise and add a \ref netif */
     g_Lwip.eth_addr = ethAddr;
     netif_add(&g_Lwip.netif, &default_ipaddr, &default_netmask, &default_gw,
@@ -423,7 +498,15 @@ void Ifx_Lwip_init(eth_addr_t ethAddr)
  * may be the same as sys_jiffies or at least based on it. */
 inline u32_t sys_now(void)
 {
-	return g_TickCount_1ms;
+	return Timer_nowMs();
+}
+
+/** \brief Acknowledges a DMA channel interrupt, the channel raises no new service request while it is set */
+static void Ifx_Lwip_clearDmaInterrupt(uint8 queue, IfxGeth_DmaInterruptFlag flag)
+{
+    IfxGeth_dma_clearInterruptFlag(g_IfxGeth.gethSFR, (IfxGeth_DmaChannel)queue, flag);
+    IfxGeth_dma_clearInterruptFlag(g_IfxGeth.gethSFR, (IfxGeth_DmaChannel)queue,
+                                   IfxGeth_DmaInterruptFlag_normalInterruptSummary);
 }
 
 /**
@@ -435,7 +518,12 @@ inline u32_t sys_now(void)
  */
 IFX_INTERRUPT(ISR_Geth_Tx, CPU_WHICH_SERVICE_ETHERNET, ISR_PRIORITY_GETH_TX)
 {
+    Ifx_Lwip_clearDmaInterrupt(IFX_NETIF_QUEUE_DIAG, IfxGeth_DmaInterruptFlag_transmitInterrupt);
     isrTxCount++;
+
+    /* reclaim finished TX descriptors, the pbufs are freed by the netif task */
+    ifx_netif_txComplete(&g_Lwip.netif, IFX_NETIF_QUEUE_DIAG);
+    Sched_signal(&g_Lwip.event);
 }
 
 /**
@@ -447,9 +535,48 @@ IFX_INTERRUPT(ISR_Geth_Tx, CPU_WHICH_SERVICE_ETHERNET, ISR_PRIORITY_GETH_TX)
  */
 IFX_INTERRUPT(ISR_Geth_Rx, CPU_WHICH_SERVICE_ETHERNET, ISR_PRIORITY_GETH_RX)
 {
+    Ifx_Lwip_clearDmaInterrupt(IFX_NETIF_QUEUE_DIAG, IfxGeth_DmaInterruptFlag_receiveInterrupt);
     isrRxCount++;
+
+    /* the frames are passed to lwIP by Ifx_Lwip_pollReceiveFlags() in the netif task */
+    g_Lwip.rxPending++;
+    Sched_signal(&g_Lwip.event);
 }
 
+#if IFX_NETIF_QUEUES > 1
+/**
+ * TX interrupt of the best-effort queue (DMA channel 1).
+ *
+ * \isrProvider \ref ISR_PROVIDER_ETH
+ * \isrPriority \ref ISR_PRIORITY_GETH_TX1
+ *
+ */
+IFX_INTERRUPT(ISR_Geth_Tx1, CPU_WHICH_SERVICE_ETHERNET, ISR_PRIORITY_GETH_TX1)
+{
+    Ifx_Lwip_clearDmaInterrupt(IFX_NETIF_QUEUE_BEST_EFFORT, IfxGeth_DmaInterruptFlag_transmitInterrupt);
+    isrTxCount++;
+
+    ifx_netif_txComplete(&g_Lwip.netif, IFX_NETIF_QUEUE_BEST_EFFORT);
+    Sched_signal(&g_Lwip.event);
+}
+
+/**
+ * RX interrupt of the best-effort queue (DMA channel 1).
+ *
+ * \isrProvider \ref ISR_PROVIDER_ETH
+ * \isrPriority \ref ISR_PRIORITY_GETH_RX1
+ *
+ */
+IFX_INTERRUPT(ISR_Geth_Rx1, CPU_WHICH_SERVICE_ETHERNET, ISR_PRIORITY_GETH_RX1)
+{
+    Ifx_Lwip_clearDmaInterrupt(IFX_NETIF_QUEUE_BEST_EFFORT, IfxGeth_DmaInterruptFlag_receiveInterrupt);
+    isrRxCount++;
+
+    g_Lwip.rxPending++;
+    Sched_signal(&g_Lwip.event);
+}
+#endif
+
 //________________________________________________________________________________________
 // DEBUGGING FUNCTIONS
 #include "Configuration.h"
@@ -464,16 +591,20 @@ s8_t Ifx_Lwip_printf(const char *format, ...)
     char    str[MAXCHARS + 4];
     s8_t    result = ERR_CONN;
 
-    va_list args;
-    va_start(args, format);
-    vsnprintf(str, MAXCHARS, format, args);
-    va_end(args);
+    /* lwIP diagnostics are netif state messages */
+    if (LOG_ENABLED(NETIF, INFO))
     {
-        Ifx_SizeT cnt = 0;
-        while(str[cnt]!=0)
-            cnt++;
-        sendUARTMessage(str, cnt);
-        sendUARTMessage("\r\n", 2);
+        va_list args;
+        va_start(args, format);
+        vsnprintf(str, MAXCHARS, format, args);
+        va_end(args);
+        {
+            Ifx_SizeT cnt = 0;
+            while(str[cnt]!=0)
+                cnt++;
+            sendUARTMessage(str, cnt);
+            sendUARTMessage("\r\n", 2);
+        }
     }
 #endif
     return result;
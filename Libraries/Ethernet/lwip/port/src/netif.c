@@ -91,6 +91,7 @@
 #include "netif/etharp.h"
 #include "netif/ppp/pppoe.h"
 
+#include "IfxCpu.h"
 #include "IfxGeth_Eth.h"
 #include "Ifx_Lwip.h"
 #include "Ifx_Netif.h"
@@ -114,6 +115,84 @@ struct ethernetif
     /* Add whatever per-interface state that is needed here. */
 };
 
+static u32_t g_rxDrops;   /* frames dropped in low_level_input() */
+
+#if IFX_NETIF_QUEUES > 1
+#define IFX_NETIF_MTL_QUEUE_SIZE IfxGeth_QueueSize_2048Bytes  /* the MTL FIFOs are split between the queues */
+#else
+#define IFX_NETIF_MTL_QUEUE_SIZE IfxGeth_QueueSize_2560Bytes
+#endif
+
+#if !IFX_NETIF_TX_ZERO_COPY && (IFX_NETIF_DIAG_TX_DESCRIPTORS != IFXGETH_MAX_TX_DESCRIPTORS)
+#error "the copying TX path uses the iLLD ring handling, which needs the full descriptor list"
+#endif
+
+/**
+ * Static configuration of a GETH queue. Queue q uses RX and TX DMA channel q
+ * and MTL queue q.
+ */
+typedef struct
+{
+    uint8 rxDescriptors;    /* RX ring length */
+    uint8 txDescriptors;    /* TX ring length */
+    uint8 weight;           /* weight in the MTL TX scheduler */
+    uint8 vlanPriorities;   /* VLAN PCPs received on this queue */
+    uint8 firstSlot;        /* first buffer of the RX ring in channel0RxBuffer1 */
+} Ifx_Netif_QueueConfig;
+
+static const Ifx_Netif_QueueConfig g_queueConfig[IFX_NETIF_QUEUES] = {
+    {IFX_NETIF_DIAG_RX_DESCRIPTORS, IFX_NETIF_DIAG_TX_DESCRIPTORS, IFX_NETIF_DIAG_WEIGHT,
+     IFX_NETIF_DIAG_VLAN_PRIORITIES, 0},
+#if IFX_NETIF_QUEUES > 1
+    {IFX_NETIF_BE_RX_DESCRIPTORS, IFX_NETIF_BE_TX_DESCRIPTORS, IFX_NETIF_BE_WEIGHT,
+     (uint8)~IFX_NETIF_DIAG_VLAN_PRIORITIES, IFX_NETIF_DIAG_RX_DESCRIPTORS},
+#endif
+};
+
+/**
+ * Runtime state of a GETH queue. The port keeps its own ring indices, the
+ * rings may be shorter than the iLLD descriptor lists.
+ */
+typedef struct
+{
+    uint8            rxIndex;                                  /* RX descriptor read next */
+    uint8            rxDescrSlot[IFXGETH_MAX_RX_DESCRIPTORS];  /* buffer slot armed in each RX descriptor */
+#if IFX_NETIF_TX_ZERO_COPY
+    /*
+     * TX descriptor ring, indices run freely and are taken modulo the ring size:
+     *   txTail <= txDone <= txHead
+     * [txTail, txDone) finished by the DMA, pbufs not yet released
+     * [txDone, txHead) owned by the DMA
+     */
+    pbuf_t          *txPbuf[IFXGETH_MAX_TX_DESCRIPTORS];       /* frame held until its last descriptor completes */
+    volatile uint32  txHead;                                   /* written by low_level_output(), read in the ISR */
+    volatile uint32  txDone;                                   /* written by ifx_netif_txComplete() (ISR) */
+    uint32           txTail;                                   /* written by ifx_netif_txRelease() */
+#endif
+} Ifx_Netif_Queue;
+
+static Ifx_Netif_Queue g_queue[IFX_NETIF_QUEUES];
+
+#if IFX_NETIF_RX_ZERO_COPY
+#if ETH_PAD_SIZE
+#error "IFX_NETIF_RX_ZERO_COPY requires ETH_PAD_SIZE 0, the DMA writes the frame at the start of the buffer"
+#endif
+
+/**
+ * RX DMA buffer passed to lwIP without copying. The pbuf_custom has to be the
+ * first member, lwIP hands it back to rx_pbuf_free() when the frame is freed.
+ */
+typedef struct
+{
+    struct pbuf_custom pbuf;
+    uint8              slot;    /* index into channel0RxBuffer1 */
+} Ifx_Netif_RxPbuf;
+
+static Ifx_Netif_RxPbuf g_rxPbuf[IFX_NETIF_RX_BUFFER_COUNT];
+static uint8            g_rxFreeSlot[IFX_NETIF_RX_BUFFER_COUNT];   /* slots owned neither by the DMA nor by lwIP */
+static uint8            g_rxFreeCount;
+#endif
+
 /* pin configuration DP83825I*/
 const IfxGeth_Eth_RmiiPins rmii_pins = {
                                    .crsDiv = &ETH_CRSDIV_PIN,   /* CRSDIV */
@@ -127,6 +206,102 @@ const IfxGeth_Eth_RmiiPins rmii_pins = {
                                    .txEn = &ETH_TXEN_PIN        /* TXEN */
 };
 
+#if IFX_NETIF_RX_ZERO_COPY
+/**
+ * Called by lwIP when the last reference to a zero-copy RX frame is dropped.
+ * The buffer goes back to the free list and is re-armed in the next
+ * descriptor that delivers a frame.
+ */
+static void rx_pbuf_free(struct pbuf *p)
+{
+    Ifx_Netif_RxPbuf *rx = (Ifx_Netif_RxPbuf *)p;
+
+    g_rxFreeSlot[g_rxFreeCount++] = rx->slot;
+}
+
+
+/**
+ * The RX buffers beyond the descriptor rings start on the free list.
+ */
+static void low_level_init_rx_pool(void)
+{
+    uint8 i;
+
+    for (i = 0; i < IFX_NETIF_RX_BUFFER_COUNT; i++)
+    {
+        g_rxPbuf[i].pbuf.custom_free_function = rx_pbuf_free;
+        g_rxPbuf[i].slot                      = i;
+    }
+
+    g_rxFreeCount = 0;
+
+    for (i = IFX_NETIF_RX_DESCRIPTORS; i < IFX_NETIF_RX_BUFFER_COUNT; i++)
+    {
+        g_rxFreeSlot[g_rxFreeCount++] = i;
+    }
+}
+#endif
+
+
+/**
+ * Cuts the iLLD descriptor lists down to the ring length of each queue and
+ * records the buffer slots IfxGeth_Eth_initReceiveDescriptors() armed, then
+ * sets up the receive steering and the TX scheduler weights.
+ *
+ * The TC37x MAC has no L3/L4 filters, so DoIP cannot be told apart by port
+ * on receive: tagged frames are steered by VLAN priority, broadcasts and
+ * multicasts (ARP requests, VCI announcements) go to the best-effort queue
+ * and the remaining untagged unicast, i.e. the DoIP connection, to the
+ * diagnostic queue. On transmit Ifx_Lwip_getTxQueue() classifies by port.
+ *
+ * @param ethernetif the initialized GETH driver handle
+ */
+static void low_level_init_queues(IfxGeth_Eth *ethernetif)
+{
+    Ifx_GETH                 *gethSFR = ethernetif->gethSFR;
+    volatile IfxGeth_RxDescr *rxBase;
+    uint8                     q;
+    uint8                     i;
+
+    for (q = 0; q < IFX_NETIF_QUEUES; q++)
+    {
+        const Ifx_Netif_QueueConfig *config = &g_queueConfig[q];
+
+        rxBase             = IfxGeth_Eth_getBaseRxDescriptor(ethernetif, (IfxGeth_RxDmaChannel)q);
+        g_queue[q].rxIndex = 0;
+
+        for (i = 0; i < IFXGETH_MAX_RX_DESCRIPTORS; i++)
+        {
+            if (i < config->rxDescriptors)
+            {
+                g_queue[q].rxDescrSlot[i] = (uint8)(config->firstSlot + i);
+            }
+            else
+            {
+                rxBase[i].RDES3.U = 0;  /* outside the ring, never handed to the DMA */
+            }
+        }
+
+        IfxGeth_dma_setRxDescriptorRingLength(gethSFR, (IfxGeth_RxDmaChannel)q, config->rxDescriptors - 1);
+        IfxGeth_dma_setRxDescriptorTailPointer(gethSFR, (IfxGeth_RxDmaChannel)q, (uint32)&rxBase[config->rxDescriptors]);
+        IfxGeth_dma_setTxDescriptorRingLength(gethSFR, (IfxGeth_TxDmaChannel)q, config->txDescriptors - 1);
+    }
+
+#if IFX_NETIF_QUEUES > 1
+    for (q = 0; q < IFX_NETIF_QUEUES; q++)
+    {
+        IfxGeth_mac_setVlanPriorityQueueRouting(gethSFR, (IfxGeth_RxDmaChannel)q, g_queueConfig[q].vlanPriorities);
+    }
+
+    gethSFR->MAC_RXQ_CTRL1.B.UPQ     = IFX_NETIF_QUEUE_DIAG;
+    gethSFR->MAC_RXQ_CTRL1.B.MCBCQ   = IFX_NETIF_QUEUE_BEST_EFFORT;
+    gethSFR->MAC_RXQ_CTRL1.B.MCBCQEN = 1;
+
+    gethSFR->MTL_TXQ0.QUANTUM_WEIGHT.B.ISCQW = g_queueConfig[0].weight;
+    gethSFR->MTL_TXQ1.QUANTUM_WEIGHT.B.ISCQW = g_queueConfig[1].weight;
+#endif
+}
+
 /**
  * In this function, the hardware should be initialized.
  * Called from ethernetif_init().
@@ -138,6 +313,7 @@ static void low_level_init(netif_t *netif)
 {
     IfxGeth_Eth *ethernetif = netif->state;
     int     i;
+    uint8   q;
 
     /* set MAC hardware address length */
     netif->hwaddr_len = ETHARP_HWADDR_LEN;
@@ -174,38 +350,49 @@ static void low_level_init(netif_t *netif)
         GethConfig.mac.macAddress[4] = netif->hwaddr[4];
         GethConfig.mac.macAddress[5] = netif->hwaddr[5];
 
-        // MTL configuration
-        GethConfig.mtl.numOfTxQueues = 1;
-        GethConfig.mtl.numOfRxQueues = 1;
-        GethConfig.mtl.txQueue[0].txQueueSize = IfxGeth_QueueSize_2560Bytes;
-        GethConfig.mtl.txQueue[0].storeAndForward = TRUE;
-        GethConfig.mtl.rxQueue[0].rxQueueSize = IfxGeth_QueueSize_2560Bytes;
-        GethConfig.mtl.rxQueue[0].rxDmaChannelMap = IfxGeth_RxDmaChannel_0;
-        GethConfig.mtl.rxQueue[0].storeAndForward = TRUE;
-
-        GethConfig.dma.numOfTxChannels = 1;
-        GethConfig.dma.numOfRxChannels = 1;
-        GethConfig.dma.txChannel[0].channelId = IfxGeth_TxDmaChannel_0;
-        GethConfig.dma.txChannel[0].txDescrList = (IfxGeth_TxDescrList *)&IfxGeth_Eth_txDescrList[0];
-        GethConfig.dma.txChannel[0].txBuffer1StartAddress = (uint32 *)&channel0TxBuffer1[0][0]; // user buffer
-        GethConfig.dma.txChannel[0].txBuffer1Size = IFXGETH_MAX_TX_BUFFER_SIZE; // used to calculate the next descriptor  buffer offset
-
-        GethConfig.dma.rxChannel[0].channelId = IfxGeth_RxDmaChannel_0;
-        GethConfig.dma.rxChannel[0].rxDescrList = (IfxGeth_RxDescrList *)&IfxGeth_Eth_rxDescrList[0];
-        GethConfig.dma.rxChannel[0].rxBuffer1StartAddress = (uint32 *)&channel0RxBuffer1[0][0]; // user buffer
-        GethConfig.dma.rxChannel[0].rxBuffer1Size = IFXGETH_MAX_RX_BUFFER_SIZE; // user defined variable
+        // MTL and DMA configuration: GETH queue q uses MTL queue q and DMA channel q
+        GethConfig.mtl.numOfTxQueues = IFX_NETIF_QUEUES;
+        GethConfig.mtl.numOfRxQueues = IFX_NETIF_QUEUES;
+        GethConfig.mtl.txSchedulingAlgorithm = IfxGeth_TxSchedulingAlgorithm_wrr;     // weights set in low_level_init_queues()
+        GethConfig.mtl.rxArbitrationAlgorithm = IfxGeth_RxArbitrationAlgorithm_sp;    // queue 0 (diagnostics) first
+
+        GethConfig.dma.numOfTxChannels = IFX_NETIF_QUEUES;
+        GethConfig.dma.numOfRxChannels = IFX_NETIF_QUEUES;
 
         IfxSrc_Tos gethIsrProvider;
 
         if (CPU_WHICH_SERVICE_ETHERNET) gethIsrProvider = (IfxSrc_Tos)(CPU_WHICH_SERVICE_ETHERNET+1);
         else  gethIsrProvider = (IfxSrc_Tos)CPU_WHICH_SERVICE_ETHERNET;
 
-        GethConfig.dma.txInterrupt[0].channelId = IfxGeth_DmaChannel_0;
-        GethConfig.dma.txInterrupt[0].priority = ISR_PRIORITY_GETH_TX;    // priority
-        GethConfig.dma.txInterrupt[0].provider = gethIsrProvider;
-        GethConfig.dma.rxInterrupt[0].channelId = IfxGeth_DmaChannel_0;
-        GethConfig.dma.rxInterrupt[0].priority = ISR_PRIORITY_GETH_RX;    // priority
-        GethConfig.dma.rxInterrupt[0].provider = gethIsrProvider;
+        for (q = 0; q < IFX_NETIF_QUEUES; q++)
+        {
+            GethConfig.mtl.txQueue[q].queueEnable = TRUE;
+            GethConfig.mtl.txQueue[q].txQueueSize = IFX_NETIF_MTL_QUEUE_SIZE;
+            GethConfig.mtl.txQueue[q].storeAndForward = TRUE;
+            GethConfig.mtl.rxQueue[q].queueEnable = TRUE;
+            GethConfig.mtl.rxQueue[q].rxQueueSize = IFX_NETIF_MTL_QUEUE_SIZE;
+            GethConfig.mtl.rxQueue[q].rxDmaChannelMap = (IfxGeth_RxDmaChannel)q;
+            GethConfig.mtl.rxQueue[q].storeAndForward = TRUE;
+
+            GethConfig.dma.txChannel[q].channelEnable = TRUE;
+            GethConfig.dma.txChannel[q].channelId = (IfxGeth_TxDmaChannel)q;
+            GethConfig.dma.txChannel[q].txDescrList = (IfxGeth_TxDescrList *)&IfxGeth_Eth_txDescrList[0][q];
+            GethConfig.dma.txChannel[q].txBuffer1StartAddress = (uint32 *)&channel0TxBuffer1[0][0]; // only used by the copying TX path, on queue 0
+            GethConfig.dma.txChannel[q].txBuffer1Size = IFXGETH_MAX_TX_BUFFER_SIZE; // used to calculate the next descriptor  buffer offset
+
+            GethConfig.dma.rxChannel[q].channelEnable = TRUE;
+            GethConfig.dma.rxChannel[q].channelId = (IfxGeth_RxDmaChannel)q;
+            GethConfig.dma.rxChannel[q].rxDescrList = (IfxGeth_RxDescrList *)&IfxGeth_Eth_rxDescrList[0][q];
+            GethConfig.dma.rxChannel[q].rxBuffer1StartAddress = (uint32 *)&channel0RxBuffer1[g_queueConfig[q].firstSlot][0]; // user buffer
+            GethConfig.dma.rxChannel[q].rxBuffer1Size = IFXGETH_MAX_RX_BUFFER_SIZE; // user defined variable
+
+            GethConfig.dma.txInterrupt[q].channelId = (IfxGeth_DmaChannel)q;
+            GethConfig.dma.txInterrupt[q].priority = (q == 0) ? ISR_PRIORITY_GETH_TX : ISR_PRIORITY_GETH_TX1;    // priority
+            GethConfig.dma.txInterrupt[q].provider = gethIsrProvider;
+            GethConfig.dma.rxInterrupt[q].channelId = (IfxGeth_DmaChannel)q;
+            GethConfig.dma.rxInterrupt[q].priority = (q == 0) ? ISR_PRIORITY_GETH_RX : ISR_PRIORITY_GETH_RX1;    // priority
+            GethConfig.dma.rxInterrupt[q].provider = gethIsrProvider;
+        }
 
         // initialize the module
         // make sure that the connected phy is also in the selected mode
@@ -214,6 +401,11 @@ static void low_level_init(netif_t *netif)
         // we was doing this in our main function where we get the ID's to detect the phy
         IfxGeth_Eth_initModule(ethernetif, &GethConfig);
 
+        low_level_init_queues(ethernetif);
+#if IFX_NETIF_RX_ZERO_COPY
+        low_level_init_rx_pool();
+#endif
+
         /* We get the ID of Ethernet Phy do determine the board version, also needed for SCR */
         IfxPort_setPinModeOutput(ETH_MDC_PIN.pin.port, ETH_MDC_PIN.pin.pinIndex, IfxPort_OutputMode_pushPull, ETH_MDC_PIN.select);
         GETH_GPCTL.B.ALTI0  = ETH_MDIO_PIN.inSelect;
@@ -222,8 +414,8 @@ static void low_level_init(netif_t *netif)
         IfxGeth_Eth_Phy_Dp83825i_init();
 
         // and enable transmitter/receiver
-        IfxGeth_Eth_startTransmitters(ethernetif, 1);
-        IfxGeth_Eth_startReceivers(ethernetif, 1);
+        IfxGeth_Eth_startTransmitters(ethernetif, IFX_NETIF_QUEUES);
+        IfxGeth_Eth_startReceivers(ethernetif, IFX_NETIF_QUEUES);
 
         // The ETH is ready for use now!
         /* we set the LINK_UP flag if we have a valid link */
@@ -251,6 +443,189 @@ static void low_level_init(netif_t *netif)
     }
 }
 
+#if IFX_NETIF_TX_ZERO_COPY
+/**
+ * Queues the pbuf chain on the TX ring of its queue (see
+ * Ifx_Lwip_getTxQueue()) without copying: every segment gets its own
+ * descriptor pointing at the segment payload, and the chain is referenced
+ * until the TX interrupt reports the last descriptor complete.
+ *
+ * Never waits for the MAC. If the ring has no room the frame is dropped
+ * (TCP retransmits it), and chains longer than the whole ring are
+ * flattened into a single PBUF_RAM first.
+ *
+ * @note pbuf payloads must not be in a cached segment, the DMA reads them
+ *       directly. DSPR addresses are translated to their global alias.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
+ * @return ERR_OK if the packet was queued
+ *         ERR_MEM if there were no free descriptors
+ */
+static err_t low_level_output(netif_t *netif, pbuf_t *p)
+{
+    IfxGeth_Eth              *ethernetif = netif->state;
+    uint8                     queue      = Ifx_Lwip_getTxQueue(p);
+    Ifx_Netif_Queue          *txq        = &g_queue[queue];
+    uint32                    ring       = g_queueConfig[queue].txDescriptors;
+    volatile IfxGeth_TxDescr *base       = IfxGeth_Eth_getBaseTxDescriptor(ethernetif, (IfxGeth_TxDmaChannel)queue);
+    volatile IfxGeth_TxDescr *first;
+    volatile IfxGeth_TxDescr *descr;
+    IfxGeth_TxDescr2          tdes2;
+    IfxGeth_TxDescr3          tdes3;
+    pbuf_t                   *frame = p;
+    pbuf_t                   *q;
+    uint32                    segments;
+    uint32                    i;
+    err_t                     result = ERR_OK;
+
+    LWIP_DEBUGF(NETIF_DEBUG | LWIP_DBG_TRACE, ("low_level_output (p=%#x)\n", p));
+
+    /* make room from frames the DMA has finished meanwhile */
+    ifx_netif_txRelease(netif);
+
+#if ETH_PAD_SIZE
+    pbuf_header(p, -ETH_PAD_SIZE); /* drop the padding word */
+#endif
+
+    segments = pbuf_clen(p);
+
+    if (segments > ring)
+    {
+        frame    = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+        segments = 1;
+    }
+    else
+    {
+        pbuf_ref(frame);
+    }
+
+    if ((frame == NULL) || (segments > (ring - (txq->txHead - txq->txTail))))
+    {
+        if (frame != NULL)
+        {
+            pbuf_free(frame);
+        }
+
+        LINK_STATS_INC(link.memerr);
+        LINK_STATS_INC(link.drop);
+        result = ERR_MEM;
+    }
+    else
+    {
+        first = &base[txq->txHead % ring];
+
+        for (q = frame, i = 0; q != NULL; q = q->next, i++)
+        {
+            descr = &base[(txq->txHead + i) % ring];
+
+            tdes2.U       = 0;
+            tdes2.R.B1L   = q->len;
+            tdes2.R.IOC   = (q->next == NULL) ? 1 : 0;  /* interrupt on the last descriptor of the frame */
+
+            tdes3.U       = 0;
+            tdes3.R.FL_TPL  = frame->tot_len;
+            tdes3.R.CIC_TPL = 3;                         /* IP header and payload checksum insertion */
+            tdes3.R.FD    = (i == 0) ? 1 : 0;
+            tdes3.R.LD    = (q->next == NULL) ? 1 : 0;
+            tdes3.R.OWN   = (i == 0) ? 0 : 1;            /* first descriptor is released last */
+
+            descr->TDES0.U = (uint32)IFXCPU_GLB_ADDR_DSPR(IfxCpu_getCoreId(), q->payload);
+            descr->TDES1.U = 0;
+            descr->TDES2.U = tdes2.U;
+            descr->TDES3.U = tdes3.U;
+
+            txq->txPbuf[(txq->txHead + i) % ring] = (q->next == NULL) ? frame : NULL;
+        }
+
+        /* the whole chain is set up, hand it to the DMA */
+        __dsync();
+        first->TDES3.R.OWN = 1;
+        __dsync();
+
+        txq->txHead += segments;
+
+        IfxGeth_dma_setTxDescriptorTailPointer(ethernetif->gethSFR, (IfxGeth_TxDmaChannel)queue,
+                                               (uint32)&base[txq->txHead % ring]);
+        IfxGeth_Eth_wakeupTransmitter(ethernetif, (IfxGeth_TxDmaChannel)queue);
+
+        LWIP_DEBUGF(NETIF_DEBUG | LWIP_DBG_TRACE, ("low_level_output: queue %d, %d segments, length %d\n", queue, segments, frame->tot_len));
+        LINK_STATS_INC(link.xmit);
+    }
+
+#if ETH_PAD_SIZE
+    pbuf_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
+#endif
+
+    return result;
+}
+
+
+/**
+ * Called from the TX interrupt of the queue: advances over the descriptors
+ * the DMA has handed back. The pbufs are released later by
+ * ifx_netif_txRelease(), lwIP may not be entered from interrupt context.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param queue the GETH queue whose DMA channel raised the interrupt
+ */
+void ifx_netif_txComplete(netif_t *netif, u8_t queue)
+{
+    IfxGeth_Eth              *ethernetif = netif->state;
+    Ifx_Netif_Queue          *txq        = &g_queue[queue];
+    uint32                    ring       = g_queueConfig[queue].txDescriptors;
+    volatile IfxGeth_TxDescr *base       = IfxGeth_Eth_getBaseTxDescriptor(ethernetif, (IfxGeth_TxDmaChannel)queue);
+    uint32                    done       = txq->txDone;
+    uint32                    head       = txq->txHead;
+
+    while ((done != head) && (base[done % ring].TDES3.R.OWN == 0))
+    {
+        done++;
+    }
+
+    txq->txDone = done;
+}
+
+
+/**
+ * Releases the pbufs of all completed TX frames on every queue. Called from
+ * the main loop.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ */
+void ifx_netif_txRelease(netif_t *netif)
+{
+    Ifx_Netif_Queue *txq;
+    uint32           ring;
+    uint32           done;
+    pbuf_t          *frame;
+    uint8            queue;
+
+    (void)netif;
+
+    for (queue = 0; queue < IFX_NETIF_QUEUES; queue++)
+    {
+        txq  = &g_queue[queue];
+        ring = g_queueConfig[queue].txDescriptors;
+        done = txq->txDone;
+
+        while (txq->txTail != done)
+        {
+            frame = txq->txPbuf[txq->txTail % ring];
+
+            if (frame != NULL)
+            {
+                txq->txPbuf[txq->txTail % ring] = NULL;
+                pbuf_free(frame);
+            }
+
+            txq->txTail++;
+        }
+    }
+}
+
+
+#else
 /**
  * This function should do the actual transmission of the packet. The packet is
  * contained in the pbuf that is passed to the function. This pbuf
@@ -264,7 +639,8 @@ static void low_level_init(netif_t *netif)
  * @note Returning ERR_MEM here if a DMA queue of your MAC is full can lead to
  *       strange results. You might consider waiting for space in the DMA queue
  *       to become availale since the stack doesn't retry to send a packet
- *       dropped because of memory failure (except for the TCP timers).
+ *       dropped because of memory failure (except for the TCP timers). *
+ * @note All frames are sent on queue 0, this path keeps the iLLD ring handling.
  */
 static err_t low_level_output(netif_t *netif, pbuf_t *p)
 {
@@ -321,6 +697,20 @@ static err_t low_level_output(netif_t *netif, pbuf_t *p)
     return ERR_OK;
 }
 
+
+void ifx_netif_txComplete(netif_t *netif, u8_t queue)
+{
+    (void)netif;
+    (void)queue;
+}
+
+
+void ifx_netif_txRelease(netif_t *netif)
+{
+    (void)netif;
+}
+#endif
+
 static uint16 GetRxFrameSize(IfxGeth_RxDescr *descr)
 {
   uint16 len;
@@ -344,28 +734,135 @@ static uint16 GetRxFrameSize(IfxGeth_RxDescr *descr)
   return len;
 }
 
+/**
+ * @return the RX descriptor of the queue low_level_input() reads next
+ */
+static volatile IfxGeth_RxDescr *rx_actual(IfxGeth_Eth *ethernetif, uint8 queue)
+{
+    return &IfxGeth_Eth_getBaseRxDescriptor(ethernetif, (IfxGeth_RxDmaChannel)queue)[g_queue[queue].rxIndex];
+}
+
+
+/**
+ * Gives the actual RX descriptor of the queue back to the DMA, armed with
+ * the buffer slot recorded for it, and moves on to the next descriptor.
+ */
+static void rx_release(IfxGeth_Eth *ethernetif, uint8 queue, volatile IfxGeth_RxDescr *descr)
+{
+    Ifx_Netif_Queue *rxq = &g_queue[queue];
+    IfxGeth_RxDescr3 rdes3;
+
+    descr->RDES0.U = (uint32)&channel0RxBuffer1[rxq->rxDescrSlot[rxq->rxIndex]][0];
+    descr->RDES1.U = 0;
+    descr->RDES2.U = 0;     /* buffer2 not used */
+
+    rdes3.U       = 0;
+    rdes3.R.BUF1V = 1;      /* buffer 1 valid */
+    rdes3.R.IOC   = 1;      /* interrupt enabled */
+    rdes3.R.OWN   = 1;      /* owned by DMA */
+    __dsync();
+    descr->RDES3.U = rdes3.U;
+
+    rxq->rxIndex = (uint8)((rxq->rxIndex + 1) % g_queueConfig[queue].rxDescriptors);
+
+    IfxGeth_Eth_wakeupReceiver(ethernetif, (IfxGeth_RxDmaChannel)queue);
+}
+
+
+#if IFX_NETIF_RX_ZERO_COPY
+/**
+ * Hands the DMA buffer of the actual RX descriptor to lwIP as a PBUF_CUSTOM
+ * and re-arms the descriptor with a buffer from the free list, so the frame
+ * is never copied.
+ *
+ * If lwIP still holds every spare buffer the frame is dropped and the
+ * descriptor keeps its buffer, so reception never stalls on a dry pool.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param queue the GETH queue to read from
+ * @return a pbuf referencing the received packet (including MAC header)
+ *         NULL if no frame is available or the frame was dropped
+ */
+static pbuf_t *low_level_input(netif_t *netif, uint8 queue)
+{
+    IfxGeth_Eth              *ethernetif = netif->state;
+    Ifx_Netif_Queue          *rxq        = &g_queue[queue];
+    volatile IfxGeth_RxDescr *descr      = rx_actual(ethernetif, queue);
+    Ifx_Netif_RxPbuf         *rx;
+    pbuf_t                   *p = (pbuf_t *)0;
+    u16_t                     len;
+
+    if (descr->RDES3.R.OWN != 0)
+    {
+        return (pbuf_t *)0;
+    }
+
+    len = GetRxFrameSize((IfxGeth_RxDescr *)descr);
+
+    if (len == 0xFFFFU)
+    {
+        /* errored frame, re-arm the same buffer */
+        LINK_STATS_INC(link.err);
+        LINK_STATS_INC(link.drop);
+        g_rxDrops++;
+    }
+    else if (g_rxFreeCount == 0)
+    {
+        /* no buffer to swap in, drop the frame and re-arm the same buffer */
+        LINK_STATS_INC(link.memerr);
+        LINK_STATS_INC(link.drop);
+        g_rxDrops++;
+    }
+    else
+    {
+        rx = &g_rxPbuf[rxq->rxDescrSlot[rxq->rxIndex]];
+
+        rxq->rxDescrSlot[rxq->rxIndex] = g_rxFreeSlot[--g_rxFreeCount];
+
+        p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &rx->pbuf,
+                                &channel0RxBuffer1[rx->slot][0], IFXGETH_MAX_RX_BUFFER_SIZE);
+
+        LWIP_DEBUGF(NETIF_DEBUG | LWIP_DBG_TRACE, ("low_level_input: queue=%d, slot=%d, len=%d\n", queue, rx->slot, len));
+        LINK_STATS_INC(link.recv);
+    }
+
+    //give the descriptor back to the DMA
+    rx_release(ethernetif, queue, descr);
+
+    return p;
+}
+
+
+#else
 /**
  * Should allocate a pbuf and transfer the bytes of the incoming
  * packet from the interface into the pbuf.
  *
  * @param netif the lwip network interface structure for this ethernetif
+ * @param queue the GETH queue to read from
  * @return a pbuf filled with the received packet (including MAC header)
  *         NULL on memory error
  */
-static pbuf_t *low_level_input(netif_t *netif)
+static pbuf_t *low_level_input(netif_t *netif, uint8 queue)
 {
-    IfxGeth_Eth *ethernetif = netif->state;
+    IfxGeth_Eth              *ethernetif = netif->state;
+    volatile IfxGeth_RxDescr *descr      = rx_actual(ethernetif, queue);
     pbuf_t *p, *q;
     u16_t   len;
 
-    len = 0;
-    if (IfxGeth_Eth_isRxDataAvailable(ethernetif, IfxGeth_RxDmaChannel_0) != FALSE)
+    if (descr->RDES3.R.OWN != 0)
     {
-        len = GetRxFrameSize((IfxGeth_RxDescr *)IfxGeth_Eth_getActualRxDescriptor(ethernetif, IfxGeth_RxDmaChannel_0));
+        return (pbuf_t *)0;
     }
 
-    if (len == 0)
+    len = GetRxFrameSize((IfxGeth_RxDescr *)descr);
+
+    if (len == 0xFFFFU)
     {
+        LINK_STATS_INC(link.err);
+        LINK_STATS_INC(link.drop);
+        g_rxDrops++;
+        rx_release(ethernetif, queue, descr);
         return (pbuf_t *)0;
     }
 
@@ -382,7 +879,7 @@ static pbuf_t *low_level_input(netif_t *netif)
         pbuf_header(p, -ETH_PAD_SIZE); /* drop the padding word */
 #endif
 
-        u8_t *src = IfxGeth_Eth_getReceiveBuffer(ethernetif, IfxGeth_RxDmaChannel_0);
+        u8_t *src = &channel0RxBuffer1[g_queue[queue].rxDescrSlot[g_queue[queue].rxIndex]][0];
 
         /* We iterate over the pbuf chain until we have read the entire
          * packet into the pbuf. */
@@ -403,9 +900,6 @@ static pbuf_t *low_level_input(netif_t *netif)
             LWIP_DEBUGF(NETIF_DEBUG | LWIP_DBG_TRACE, ("low_level_input: payload=0x%x, len=%d\n", q->payload, q->len));
         }
 
-        //acknowledge that packet has been read();
-        IfxGeth_Eth_freeReceiveBuffer(ethernetif, IfxGeth_RxDmaChannel_0);
-
 #if ETH_PAD_SIZE
         pbuf_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
 #endif
@@ -414,13 +908,53 @@ static pbuf_t *low_level_input(netif_t *netif)
     }
     else
     {
-        //TODO: drop packet();
         LINK_STATS_INC(link.memerr);
         LINK_STATS_INC(link.drop);
+        g_rxDrops++;
     }
 
+    //acknowledge that packet has been read();
+    rx_release(ethernetif, queue, descr);
+
     return p;
 }
+#endif
+
+
+/**
+ * Counts the received frames waiting in the RX descriptor ring of the
+ * queue, starting at the descriptor low_level_input() reads next.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param queue the GETH queue
+ * @return number of descriptors handed back by the DMA
+ */
+u32_t ifx_netif_rxAvailable(netif_t *netif, u8_t queue)
+{
+    IfxGeth_Eth              *ethernetif = netif->state;
+    volatile IfxGeth_RxDescr *base       = IfxGeth_Eth_getBaseRxDescriptor(ethernetif, (IfxGeth_RxDmaChannel)queue);
+    uint32                    ring       = g_queueConfig[queue].rxDescriptors;
+    uint32                    index      = g_queue[queue].rxIndex;
+    u32_t                     count      = 0;
+
+    while ((count < ring) && (base[(index + count) % ring].RDES3.R.OWN == 0))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+
+/**
+ * @param netif the lwip network interface structure for this ethernetif
+ * @return number of received frames dropped since start-up
+ */
+u32_t ifx_netif_rxDrops(netif_t *netif)
+{
+    (void)netif;
+    return g_rxDrops;
+}
 
 
 /**
@@ -431,15 +965,16 @@ static pbuf_t *low_level_input(netif_t *netif)
  * the appropriate input function is called.
  *
  * @param netif the lwip network interface structure for this ethernetif
+ * @param queue the GETH queue to read from
  */
-err_t ifx_netif_input(netif_t *netif)
+err_t ifx_netif_input(netif_t *netif, u8_t queue)
 {
     //Ifx_GETH *ethernetif = netif->state;
     eth_hdr_t *ethhdr;
     pbuf_t    *p;
 
     /* move received packet into a new pbuf */
-    p = low_level_input(netif);
+    p = low_level_input(netif, queue);
 
     /* no packet could be read, silently ignore this */
     if (p == NULL)
@@ -9,25 +9,42 @@
 #include "Configuration.h"
 #include "IfxStm.h"
 #include "Ifx_Lwip.h"
+#include "Timer_Wheel.h"
 
-extern volatile uint32 g_TickCount_1ms;
+/* Longest comparator delay, well inside the 42 s wrap of the 32-bit compare at 100 MHz */
+#define LWIP_ISR_MAX_DELAY_MS   10000U
 
 /**
- * @brief lwIP Timer ISR (1ms period)
+ * @brief Program STM0 Compare 0 to the next expiry of the Ethernet core's timer wheel
  * 
- * This ISR is called every 1ms by STM0 Compare 0
- * Updates lwIP stack timers for ARP, TCP, DHCP, etc.
+ * Compare hook of g_Timer_net, called by Timer_Wheel_poll() whenever the next expiry changes and by
+ * Timer_start() for a timer due earlier.
  */
-IFX_INTERRUPT(updateLwIPStackISR, 0, ISR_PRIORITY_OS_TICK);
-void updateLwIPStackISR(void)
+void LwipIsr_armCompare(uint32 delayMs)
 {
-    /* Configure STM to generate next interrupt in 1ms */
-    IfxStm_increaseCompare(&MODULE_STM0, IfxStm_Comparator_0, IFX_CFG_STM_TICKS_PER_MS);
-    
-    /* Increase lwIP system time */
-    g_TickCount_1ms++;
+    if (delayMs > LWIP_ISR_MAX_DELAY_MS)
+    {
+        delayMs = LWIP_ISR_MAX_DELAY_MS;    /* also TIMER_WHEEL_IDLE */
+    }
+    else if (delayMs == 0)
+    {
+        delayMs = 1;
+    }
     
-    /* Update lwIP timers for all enabled protocols (ARP, TCP, DHCP, LINK) */
-    Ifx_Lwip_onTimerTick();
+    IfxStm_updateCompare(&MODULE_STM0, IfxStm_Comparator_0,
+                         IfxStm_getLower(&MODULE_STM0) + (delayMs * IFX_CFG_STM_TICKS_PER_MS));
 }
 
+/**
+ * @brief lwIP Timer ISR (next timer wheel expiry)
+ * 
+ * This ISR is called by STM0 Compare 0 when the first timer of g_Timer_net expires.
+ * The timers run from the Ethernet core's timer task; the interrupt only posts it.
+ */
+IFX_INTERRUPT(updateLwIPStackISR, CPU_WHICH_SERVICE_ETHERNET, ISR_PRIORITY_OS_TICK);
+void updateLwIPStackISR(void)
+{
+    /* Not due again before the next poll reprograms it */
+    IfxStm_increaseCompare(&MODULE_STM0, IfxStm_Comparator_0, LWIP_ISR_MAX_DELAY_MS * IFX_CFG_STM_TICKS_PER_MS);
+    Sched_signal(&g_Timer_net.expired);
+}
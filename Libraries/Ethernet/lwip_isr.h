@@ -13,5 +13,8 @@
 /* ISR Declaration (called from vector table) */
 void updateLwIPStackISR(void);
 
+/* Compare hook of g_Timer_net: next interrupt in delayMs */
+void LwipIsr_armCompare(uint32 delayMs);
+
 #endif /* LWIP_ISR_H_ */
 
@@ -10,27 +10,39 @@
 #include "IfxStm.h"
 #include "IfxScuWdt.h"
 #include "IfxCpu.h"
+#include "IfxCpu_Irq.h"
+#include "Configuration.h"
+#include "UART_Log.h"
 #include <string.h>
 #include <stdio.h>
 
-extern void sendUARTMessage(const char *msg, uint32 len);
 
 static IfxQspi_SpiMaster g_qspiFlash;
 static IfxQspi_SpiMaster_Channel g_qspiFlashChannel;
 
-IFX_INTERRUPT(qspi2TxISR, 0, IFX_INTPRIO_QSPI2_TX)
+/* Command byte and 32-bit address, FLASH4_COMMAND_HEADER_SIZE bytes */
+static void Flash4_PutCommand(uint8 *frame, uint8 cmd, uint32 address)
+{
+    frame[0] = cmd;
+    frame[1] = (uint8)((address >> 24) & 0xFF);
+    frame[2] = (uint8)((address >> 16) & 0xFF);
+    frame[3] = (uint8)((address >> 8) & 0xFF);
+    frame[4] = (uint8)(address & 0xFF);
+}
+
+IFX_INTERRUPT(qspi2TxISR, CPU_WHICH_SERVICE_FLASH, IFX_INTPRIO_QSPI2_TX)
 {
     IfxCpu_enableInterrupts();
     IfxQspi_SpiMaster_isrTransmit(&g_qspiFlash);
 }
 
-IFX_INTERRUPT(qspi2RxISR, 0, IFX_INTPRIO_QSPI2_RX)
+IFX_INTERRUPT(qspi2RxISR, CPU_WHICH_SERVICE_FLASH, IFX_INTPRIO_QSPI2_RX)
 {
     IfxCpu_enableInterrupts();
     IfxQspi_SpiMaster_isrReceive(&g_qspiFlash);
 }
 
-IFX_INTERRUPT(qspi2ErISR, 0, IFX_INTPRIO_QSPI2_ER)
+IFX_INTERRUPT(qspi2ErISR, CPU_WHICH_SERVICE_FLASH, IFX_INTPRIO_QSPI2_ER)
 {
     IfxCpu_enableInterrupts();
     IfxQspi_SpiMaster_isrError(&g_qspiFlash);
@@ -40,11 +52,11 @@ void Flash4_Init(void)
 {
     char msg[128];
     
-    sendUARTMessage("\r\n========================================\r\n", 43);
-    sendUARTMessage("Flash4_Init: Start (QSPI2)\r\n", 29);
-    sendUARTMessage("========================================\r\n", 41);
+    LOG_MSG(FLASH, INFO, "\r\n========================================\r\n", 43);
+    LOG_MSG(FLASH, INFO, "Flash4_Init: Start (QSPI2)\r\n", 29);
+    LOG_MSG(FLASH, INFO, "========================================\r\n", 41);
     
-    sendUARTMessage("Flash4_Init: Configuring control pins (RESET#, WP#, HOLD#)...\r\n", 63);
+    LOG_MSG(FLASH, INFO, "Flash4_Init: Configuring control pins (RESET#, WP#, HOLD#)...\r\n", 63);
     
     IfxPort_setPinModeOutput(&MODULE_P10, 6, IfxPort_OutputMode_pushPull, IfxPort_OutputIdx_general);
     IfxPort_setPinPadDriver(&MODULE_P10, 6, IfxPort_PadDriver_cmosAutomotiveSpeed4);
@@ -60,7 +72,7 @@ void Flash4_Init(void)
     
     IfxStm_waitTicks(&MODULE_STM0, IfxStm_getTicksFromMilliseconds(&MODULE_STM0, 50));
     
-    sendUARTMessage("Flash4_Init: Control pins ready\r\n", 34);
+    LOG_MSG(FLASH, INFO, "Flash4_Init: Control pins ready\r\n", 34);
     
     IfxQspi_SpiMaster_Config spiMasterConfig;
     IfxQspi_SpiMaster_initModuleConfig(&spiMasterConfig, &MODULE_QSPI2);
@@ -68,7 +80,7 @@ void Flash4_Init(void)
     spiMasterConfig.txPriority = IFX_INTPRIO_QSPI2_TX;
     spiMasterConfig.rxPriority = IFX_INTPRIO_QSPI2_RX;
     spiMasterConfig.erPriority = IFX_INTPRIO_QSPI2_ER;
-    spiMasterConfig.isrProvider = IfxSrc_Tos_cpu0;
+    spiMasterConfig.isrProvider = IfxCpu_Irq_getTos((IfxCpu_ResourceCpu)CPU_WHICH_SERVICE_FLASH);
     
     const IfxQspi_SpiMaster_Pins pins = {
         &IfxQspi2_SCLK_P15_8_OUT,
@@ -81,11 +93,11 @@ void Flash4_Init(void)
     };
     spiMasterConfig.pins = &pins;
     
-    sendUARTMessage("Flash4_Init: Initializing QSPI2 module...\r\n", 44);
+    LOG_MSG(FLASH, INFO, "Flash4_Init: Initializing QSPI2 module...\r\n", 44);
     
     IfxQspi_SpiMaster_initModule(&g_qspiFlash, &spiMasterConfig);
     
-    sendUARTMessage("Flash4_Init: QSPI2 module initialized (MRIS=RouteB)\r\n", 54);
+    LOG_MSG(FLASH, INFO, "Flash4_Init: QSPI2 module initialized (MRIS=RouteB)\r\n", 54);
     
     IfxQspi_SpiMaster_ChannelConfig spiMasterChannelConfig;
     IfxQspi_SpiMaster_initChannelConfig(&spiMasterChannelConfig, &g_qspiFlash);
@@ -107,15 +119,15 @@ void Flash4_Init(void)
     };
     spiMasterChannelConfig.sls.output = slsOutput;
     
-    sendUARTMessage("Flash4_Init: Initializing QSPI2 channel...\r\n", 45);
+    LOG_MSG(FLASH, INFO, "Flash4_Init: Initializing QSPI2 channel...\r\n", 45);
     
     IfxQspi_SpiMaster_initChannel(&g_qspiFlashChannel, &spiMasterChannelConfig);
     
     MODULE_QSPI2.PISEL.B.MRIS = 1;
     
-    sendUARTMessage("Flash4_Init: QSPI2 channel initialized (Hardware CS - SLSO4)\r\n", 63);
+    LOG_MSG(FLASH, INFO, "Flash4_Init: QSPI2 channel initialized (Hardware CS - SLSO4)\r\n", 63);
     
-    sendUARTMessage("Flash4_Init: Sending Software Reset...\r\n", 41);
+    LOG_MSG(FLASH, INFO, "Flash4_Init: Sending Software Reset...\r\n", 41);
     
     uint8 resetEnableCmd = FLASH4_CMD_RESET_ENABLE;
     IfxQspi_SpiMaster_exchange(&g_qspiFlashChannel, &resetEnableCmd, NULL_PTR, 1);
@@ -129,11 +141,11 @@ void Flash4_Init(void)
     
     IfxStm_waitTicks(&MODULE_STM0, IfxStm_getTicksFromMicroseconds(&MODULE_STM0, 100));
     
-    sendUARTMessage("Flash4_Init: Reset complete\r\n\r\n", 32);
+    LOG_MSG(FLASH, INFO, "Flash4_Init: Reset complete\r\n\r\n", 32);
     
-    sendUARTMessage("========================================\r\n", 41);
-    sendUARTMessage("Flash4: Reading JEDEC ID (0x9F)...\r\n", 36);
-    sendUARTMessage("========================================\r\n", 41);
+    LOG_MSG(FLASH, INFO, "========================================\r\n", 41);
+    LOG_MSG(FLASH, INFO, "Flash4: Reading JEDEC ID (0x9F)...\r\n", 36);
+    LOG_MSG(FLASH, INFO, "========================================\r\n", 41);
     
     uint8 tx[4] = {0x9F, 0x00, 0x00, 0x00};
     uint8 rx[4] = {0xAA, 0xAA, 0xAA, 0xAA};
@@ -141,21 +153,24 @@ void Flash4_Init(void)
     IfxQspi_SpiMaster_exchange(&g_qspiFlashChannel, tx, rx, 4);
     while (IfxQspi_SpiMaster_getStatus(&g_qspiFlashChannel) == IfxQspi_Status_busy);
     
-    sprintf(msg, "  JEDEC ID: 0x%02X 0x%02X 0x%02X\r\n", rx[1], rx[2], rx[3]);
-    sendUARTMessage(msg, strlen(msg));
+    if (LOG_ENABLED(FLASH, INFO))
+    {
+        sprintf(msg, "  JEDEC ID: 0x%02X 0x%02X 0x%02X\r\n", rx[1], rx[2], rx[3]);
+        sendUARTMessage(msg, strlen(msg));
+    }
     
     if (rx[1] == FLASH4_MANUFACTURER_ID && 
         rx[2] == FLASH4_DEVICE_ID_MSB && 
         rx[3] == FLASH4_DEVICE_ID_LSB)
     {
-        sendUARTMessage("Flash4_Init: Complete! S25FL512S detected (64MB)\r\n", 52);
+        LOG_MSG(FLASH, INFO, "Flash4_Init: Complete! S25FL512S detected (64MB)\r\n", 52);
     }
     else
     {
-        sendUARTMessage("Flash4_Init: WARNING - Unexpected JEDEC ID!\r\n", 46);
+        LOG_MSG(FLASH, WARN, "Flash4_Init: WARNING - Unexpected JEDEC ID!\r\n", 46);
     }
     
-    sendUARTMessage("========================================\r\n\r\n", 43);
+    LOG_MSG(FLASH, INFO, "========================================\r\n\r\n", 43);
 }
 
 void Flash4_WriteCommand(uint8 cmd)
@@ -173,41 +188,35 @@ void Flash4_WriteEnable(void)
 
 void Flash4_SectorErase(uint32 address)
 {
-    uint8 txData[4];
+    uint8 txData[FLASH4_COMMAND_HEADER_SIZE];
     
     Flash4_WriteEnable();
     
-    txData[0] = FLASH4_CMD_SECTOR_ERASE;
-    txData[1] = (uint8)((address >> 16) & 0xFF);
-    txData[2] = (uint8)((address >> 8) & 0xFF);
-    txData[3] = (uint8)(address & 0xFF);
+    Flash4_PutCommand(txData, FLASH4_CMD_SECTOR_ERASE, address);
     
-    IfxQspi_SpiMaster_exchange(&g_qspiFlashChannel, txData, NULL_PTR, 4);
+    IfxQspi_SpiMaster_exchange(&g_qspiFlashChannel, txData, NULL_PTR, FLASH4_COMMAND_HEADER_SIZE);
     while (IfxQspi_SpiMaster_getStatus(&g_qspiFlashChannel) == IfxQspi_Status_busy);
 }
 
 void Flash4_PageProgram(uint32 address, const uint8 *data, uint16 length)
 {
-    uint8 txBuffer[516];
+    uint8 txBuffer[FLASH4_PROGRAM_HEADER_SIZE + FLASH4_MAX_PAGE_SIZE];
     uint16 i;
-    uint16 pageSize = 512;
+    uint16 pageSize = FLASH4_MAX_PAGE_SIZE;
     uint16 offset = 0;
     
     while (offset < length)
     {
         uint16 chunkSize = (length - offset) > pageSize ? pageSize : (length - offset);
-        uint16 totalLength = 4 + chunkSize;
+        uint16 totalLength = FLASH4_PROGRAM_HEADER_SIZE + chunkSize;
         
         Flash4_WriteEnable();
         
-        txBuffer[0] = FLASH4_CMD_PAGE_PROGRAM;
-        txBuffer[1] = (uint8)(((address + offset) >> 16) & 0xFF);
-        txBuffer[2] = (uint8)(((address + offset) >> 8) & 0xFF);
-        txBuffer[3] = (uint8)((address + offset) & 0xFF);
+        Flash4_PutCommand(txBuffer, FLASH4_CMD_PAGE_PROGRAM, address + offset);
         
         for (i = 0; i < chunkSize; i++)
         {
-            txBuffer[4 + i] = data[offset + i];
+            txBuffer[FLASH4_PROGRAM_HEADER_SIZE + i] = data[offset + i];
         }
         
         IfxQspi_SpiMaster_exchange(&g_qspiFlashChannel, txBuffer, NULL_PTR, totalLength);
@@ -219,25 +228,50 @@ void Flash4_PageProgram(uint32 address, const uint8 *data, uint16 length)
     }
 }
 
+/* Start programming one page without waiting for WIP: frame holds FLASH4_PROGRAM_HEADER_SIZE spare bytes
+ * followed by the data, so the command is sent from the caller's buffer without a copy */
+void Flash4_PageProgramStart(uint32 address, uint8 *frame, uint16 length)
+{
+    Flash4_WriteEnable();
+    
+    Flash4_PutCommand(frame, FLASH4_CMD_PAGE_PROGRAM, address);
+    
+    IfxQspi_SpiMaster_exchange(&g_qspiFlashChannel, frame, NULL_PTR, FLASH4_PROGRAM_HEADER_SIZE + length);
+    while (IfxQspi_SpiMaster_getStatus(&g_qspiFlashChannel) == IfxQspi_Status_busy);
+}
+
+/* WIP drops once the erase is suspended (tSL); pages outside the erased sector may then be programmed */
+void Flash4_EraseSuspend(void)
+{
+    Flash4_WriteCommand(FLASH4_CMD_ERASE_SUSPEND);
+}
+
+void Flash4_EraseResume(void)
+{
+    Flash4_WriteCommand(FLASH4_CMD_ERASE_RESUME);
+}
+
+void Flash4_ClearStatus(void)
+{
+    Flash4_WriteCommand(FLASH4_CMD_CLEAR_STATUS_REG);
+}
+
 void Flash4_ReadFlash4(uint32 address, uint8 *outData, uint16 nData)
 {
-    uint8 txBuffer[516];
-    uint8 rxBuffer[516];
+    uint8 txBuffer[FLASH4_READ_HEADER_SIZE + FLASH4_MAX_PAGE_SIZE];
+    uint8 rxBuffer[FLASH4_READ_HEADER_SIZE + FLASH4_MAX_PAGE_SIZE];
     uint16 i;
-    uint16 chunkSize = 512;
+    uint16 chunkSize = FLASH4_MAX_PAGE_SIZE;
     uint16 offset = 0;
     
     while (offset < nData)
     {
         uint16 readSize = (nData - offset) > chunkSize ? chunkSize : (nData - offset);
-        uint16 totalLength = 4 + readSize;
+        uint16 totalLength = FLASH4_READ_HEADER_SIZE + readSize;
         
-        txBuffer[0] = FLASH4_CMD_READ_FLASH;
-        txBuffer[1] = (uint8)(((address + offset) >> 16) & 0xFF);
-        txBuffer[2] = (uint8)(((address + offset) >> 8) & 0xFF);
-        txBuffer[3] = (uint8)((address + offset) & 0xFF);
+        Flash4_PutCommand(txBuffer, FLASH4_CMD_READ_FLASH, address + offset);
         
-        for (i = 4; i < totalLength; i++)
+        for (i = FLASH4_READ_HEADER_SIZE; i < totalLength; i++)
         {
             txBuffer[i] = 0xFF;
         }
@@ -247,13 +281,28 @@ void Flash4_ReadFlash4(uint32 address, uint8 *outData, uint16 nData)
         
         for (i = 0; i < readSize; i++)
         {
-            outData[offset + i] = rxBuffer[4 + i];
+            outData[offset + i] = rxBuffer[FLASH4_READ_HEADER_SIZE + i];
         }
         
         offset += readSize;
     }
 }
 
+/* Start reading without waiting: frame holds FLASH4_READ_HEADER_SIZE spare bytes followed by room for the data.
+ * The exchange runs in place from the QSPI interrupts (TX always leads RX); no other Flash4 call may be made
+ * until Flash4_ReadBusy() returns FALSE. */
+void Flash4_ReadStart(uint32 address, uint8 *frame, uint16 length)
+{
+    Flash4_PutCommand(frame, FLASH4_CMD_READ_FLASH, address);
+    
+    IfxQspi_SpiMaster_exchange(&g_qspiFlashChannel, frame, frame, FLASH4_READ_HEADER_SIZE + length);
+}
+
+boolean Flash4_ReadBusy(void)
+{
+    return (IfxQspi_SpiMaster_getStatus(&g_qspiFlashChannel) == IfxQspi_Status_busy) ? TRUE : FALSE;
+}
+
 void Flash4_ReadManufacturerId(uint8 *deviceId)
 {
     uint8 txData[4] = {FLASH4_CMD_READ_IDENTIFICATION, 0x00, 0x00, 0x00};
@@ -278,6 +327,17 @@ uint8 Flash4_ReadStatusReg(void)
     return rxData[1];
 }
 
+uint8 Flash4_ReadStatusReg2(void)
+{
+    uint8 txData[2] = {FLASH4_CMD_READ_STATUS_REG_2, 0x00};
+    uint8 rxData[2] = {0xAA, 0xAA};
+    
+    IfxQspi_SpiMaster_exchange(&g_qspiFlashChannel, txData, rxData, 2);
+    while (IfxQspi_SpiMaster_getStatus(&g_qspiFlashChannel) == IfxQspi_Status_busy);
+    
+    return rxData[1];
+}
+
 boolean Flash4_CheckWIP(void)
 {
     uint8 status = Flash4_ReadStatusReg();
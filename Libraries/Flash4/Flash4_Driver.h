@@ -16,9 +16,13 @@
 #define FLASH4_CMD_READ_STATUS_REG_1             0x05
 #define FLASH4_CMD_WRITE_ENABLE_WREN             0x06
 #define FLASH4_CMD_WRITE_DISABLE_WRDI            0x04
-#define FLASH4_CMD_READ_FLASH                    0x03
-#define FLASH4_CMD_PAGE_PROGRAM                  0x02
-#define FLASH4_CMD_SECTOR_ERASE                  0xD8
+#define FLASH4_CMD_READ_FLASH                    0x13    /* 4-byte address: 3-byte commands reach only 16 MB */
+#define FLASH4_CMD_PAGE_PROGRAM                  0x12    /* 4-byte address */
+#define FLASH4_CMD_SECTOR_ERASE                  0xDC    /* 4-byte address */
+#define FLASH4_CMD_READ_STATUS_REG_2             0x07
+#define FLASH4_CMD_CLEAR_STATUS_REG              0x30
+#define FLASH4_CMD_ERASE_SUSPEND                 0x75
+#define FLASH4_CMD_ERASE_RESUME                  0x7A
 #define FLASH4_CMD_RESET_ENABLE                  0x66
 #define FLASH4_CMD_RESET                         0x99
 
@@ -27,8 +31,24 @@
 #define FLASH4_DEVICE_ID_MSB                     0x02
 #define FLASH4_DEVICE_ID_LSB                     0x20
 
+/* Status Register 1 / 2 Bits */
+#define FLASH4_SR1_WIP                           0x01    /* Write (program/erase) in progress */
+#define FLASH4_SR1_E_ERR                         0x20    /* Erase error, cleared by CLSR */
+#define FLASH4_SR1_P_ERR                         0x40    /* Program error, cleared by CLSR */
+#define FLASH4_SR2_ES                            0x02    /* Erase suspended */
+
 /* Configuration */
 #define FLASH4_MAX_PAGE_SIZE                     512
+#define FLASH4_SECTOR_SIZE                       0x40000UL   /* 256 KB uniform sectors */
+#define FLASH4_DEVICE_SIZE                       0x4000000UL /* 64 MB */
+#define FLASH4_COMMAND_HEADER_SIZE               5       /* Command + 32-bit address in front of the data */
+#define FLASH4_PROGRAM_HEADER_SIZE               FLASH4_COMMAND_HEADER_SIZE
+#define FLASH4_READ_HEADER_SIZE                  FLASH4_COMMAND_HEADER_SIZE
+
+/* Timing (S25FL512S datasheet, maximum values) */
+#define FLASH4_PAGE_PROGRAM_TIMEOUT_MS           10
+#define FLASH4_SECTOR_ERASE_TIMEOUT_MS           3000
+#define FLASH4_RESUME_TO_SUSPEND_US              100     /* tRS: erase must run this long between suspends */
 
 /* Return Values */
 #define FLASH4_OK                                0
@@ -39,11 +59,18 @@ void Flash4_Init(void);
 void Flash4_WriteCommand(uint8 cmd);
 void Flash4_ReadManufacturerId(uint8 *deviceId);
 void Flash4_ReadFlash4(uint32 address, uint8 *outData, uint16 nData);
+void Flash4_ReadStart(uint32 address, uint8 *frame, uint16 length);
+boolean Flash4_ReadBusy(void);
 void Flash4_PageProgram(uint32 address, const uint8 *data, uint16 length);
 void Flash4_SectorErase(uint32 address);
+void Flash4_PageProgramStart(uint32 address, uint8 *frame, uint16 length);
+void Flash4_EraseSuspend(void);
+void Flash4_EraseResume(void);
+void Flash4_ClearStatus(void);
 void Flash4_WriteEnable(void);
 boolean Flash4_CheckWIP(void);
 uint8 Flash4_ReadStatusReg(void);
+uint8 Flash4_ReadStatusReg2(void);
 uint8 Flash4_WaitReady(uint32 timeoutMs);
 
 #endif /* FLASH4_DRIVER_H_ */
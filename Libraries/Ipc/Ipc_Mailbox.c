@@ -0,0 +1,96 @@
+/**********************************************************************************************************************
+ * \file Ipc_Mailbox.c
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Inter-core Mailbox Implementation
+ *********************************************************************************************************************/
+
+#include "Ipc_Mailbox.h"
+#include <string.h>
+
+#if (IPC_MAILBOX_SLOTS & (IPC_MAILBOX_SLOTS - 1)) != 0
+#error "IPC_MAILBOX_SLOTS must be a power of two"
+#endif
+
+/* Both mailboxes live in the default data section (CPU0 DSPR). The other core reaches it through its global
+ * address, which is not cached, so no cache maintenance is needed. */
+Ipc_Mailbox g_Ipc_netToApp;
+Ipc_Mailbox g_Ipc_appToNet;
+
+/**
+ * @brief Empty both mailboxes, before either core posts or binds their events
+ */
+void Ipc_Mailbox_init(void)
+{
+    Ipc_Queue_init(&g_Ipc_netToApp.queue, g_Ipc_netToApp.storage, IPC_MAILBOX_SLOTS, sizeof(Ipc_Message),
+                   IPC_QUEUE_SPSC);
+    Ipc_Queue_init(&g_Ipc_appToNet.queue, g_Ipc_appToNet.storage, IPC_MAILBOX_SLOTS, sizeof(Ipc_Message),
+                   IPC_QUEUE_SPSC);
+}
+
+/**
+ * @brief Next free slot, to be filled in place and committed (producer side)
+ * @return NULL_PTR if the mailbox is full
+ */
+Ipc_Message *Ipc_Mailbox_reserve(Ipc_Mailbox *mbox)
+{
+    return (Ipc_Message *)Ipc_Queue_reserve(&mbox->queue);
+}
+
+/**
+ * @brief Hand a reserved slot to the consumer (producer side)
+ */
+void Ipc_Mailbox_commit(Ipc_Mailbox *mbox, Ipc_Message *msg)
+{
+    Ipc_Queue_commit(&mbox->queue, msg);
+}
+
+/**
+ * @brief Copy a message into the next free slot (producer side)
+ * @return FALSE if the mailbox is full or the message does not fit a slot
+ */
+boolean Ipc_Mailbox_postChannel(Ipc_Mailbox *mbox, Ipc_MessageType type, uint8 channel, const void *data,
+                                uint16 length)
+{
+    Ipc_Message *msg;
+
+    if (length > IPC_MAILBOX_SLOT_SIZE)
+    {
+        return FALSE;
+    }
+
+    msg = Ipc_Mailbox_reserve(mbox);
+
+    if (msg == NULL_PTR)
+    {
+        return FALSE;
+    }
+
+    msg->type    = (uint8)type;
+    msg->channel = channel;
+    msg->length  = length;
+
+    if (length != 0)
+    {
+        memcpy(msg->data, data, length);
+    }
+
+    Ipc_Mailbox_commit(mbox, msg);
+    return TRUE;
+}
+
+/**
+ * @brief Oldest posted message, or NULL_PTR if the mailbox is empty (consumer side)
+ */
+const Ipc_Message *Ipc_Mailbox_peek(Ipc_Mailbox *mbox)
+{
+    return (const Ipc_Message *)Ipc_Queue_peek(&mbox->queue);
+}
+
+/**
+ * @brief Hand the slot returned by Ipc_Mailbox_peek() back to the producer
+ */
+void Ipc_Mailbox_release(Ipc_Mailbox *mbox)
+{
+    Ipc_Queue_release(&mbox->queue);
+}
@@ -0,0 +1,79 @@
+/**********************************************************************************************************************
+ * \file Ipc_Mailbox.h
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Inter-core Mailbox - Interface
+ *
+ * Single-producer/single-consumer message rings between the core running lwIP (CPU_WHICH_SERVICE_ETHERNET) and the
+ * application core (CPU_WHICH_SERVICE_APP). They carry every call between the two: the transport forwards diagnostic
+ * requests and VCI records, the application sends responses and broadcasts. Each mailbox is an SPSC Ipc_Queue of
+ * Ipc_Message slots: exactly one writer and one reader, so no lock is needed. A message is either copied in by a post
+ * or built in its slot between reserve and commit. Every post signals the mailbox's event, which makes the consumer's
+ * task ready and wakes its core.
+ *********************************************************************************************************************/
+
+#ifndef IPC_MAILBOX_H_
+#define IPC_MAILBOX_H_
+
+#include "Ifx_Types.h"
+#include "IfxCpu.h"
+#include "Configuration.h"
+#include "Ipc_Queue.h"
+
+/* Configuration */
+#define IPC_MAILBOX_SLOTS          8            /* Messages per mailbox, power of two                       */
+#define IPC_MAILBOX_SLOT_SIZE      256          /* Largest message: a DoIP payload or TX message   */
+
+/* lwIP and the application run on different cores */
+#define IPC_SPLIT_CORES            (CPU_WHICH_SERVICE_ETHERNET != CPU_WHICH_SERVICE_APP)
+
+/* Message Types */
+typedef enum
+{
+    IPC_MSG_DOIP_SEND = 0,      /* app -> net: DoIP message to write on connection channel  */
+    IPC_MSG_DOIP_STREAM,        /* app -> net: DoIP message head, its static body streamed  */
+    IPC_MSG_VCI_REQUEST,        /* app -> net: broadcast the VCI collection request         */
+    IPC_MSG_DIAG_REQUEST,       /* net -> app: DoIP diagnostic message payload              */
+    IPC_MSG_VCI_RECORD          /* net -> app: VCI record received from a Zone ECU          */
+} Ipc_MessageType;
+
+typedef struct
+{
+    uint8  type;                /* Ipc_MessageType */
+    uint8  channel;             /* DoIP connection handle of DoIP and diagnostic messages */
+    uint16 length;              /* Valid bytes in data[] */
+    uint8  data[IPC_MAILBOX_SLOT_SIZE];
+} Ipc_Message;
+
+typedef struct
+{
+    Ipc_Queue       queue;      /* queue.posted is signalled for every message, posts the consumer */
+    uint32          storage[IPC_QUEUE_WORDS(IPC_MAILBOX_SLOTS, sizeof(Ipc_Message))];
+} Ipc_Mailbox;
+
+/* Mailboxes */
+extern Ipc_Mailbox g_Ipc_netToApp;
+extern Ipc_Mailbox g_Ipc_appToNet;
+
+/* Function Prototypes */
+void Ipc_Mailbox_init(void);
+Ipc_Message *Ipc_Mailbox_reserve(Ipc_Mailbox *mbox);
+void Ipc_Mailbox_commit(Ipc_Mailbox *mbox, Ipc_Message *msg);
+boolean Ipc_Mailbox_postChannel(Ipc_Mailbox *mbox, Ipc_MessageType type, uint8 channel, const void *data,
+                                uint16 length);
+const Ipc_Message *Ipc_Mailbox_peek(Ipc_Mailbox *mbox);
+void Ipc_Mailbox_release(Ipc_Mailbox *mbox);
+
+/* Message without a channel */
+IFX_INLINE boolean Ipc_Mailbox_post(Ipc_Mailbox *mbox, Ipc_MessageType type, const void *data, uint16 length)
+{
+    return Ipc_Mailbox_postChannel(mbox, type, 0, data, length);
+}
+
+/* TRUE when called on the core that owns lwIP */
+IFX_INLINE boolean Ipc_onNetCore(void)
+{
+    return (IfxCpu_getCoreIndex() == CPU_WHICH_SERVICE_ETHERNET) ? TRUE : FALSE;
+}
+
+#endif /* IPC_MAILBOX_H_ */
@@ -0,0 +1,171 @@
+/**********************************************************************************************************************
+ * \file Ipc_Queue.c
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Lock-free Inter-core Queue Implementation
+ *********************************************************************************************************************/
+
+#include "Ipc_Queue.h"
+#include <string.h>
+
+#define IPC_QUEUE_HEADER    sizeof(uint32)      /* Sequence word in front of each message */
+
+static volatile uint32 *Sequence(const Ipc_Queue *queue, uint32 position)
+{
+    return (volatile uint32 *)&queue->slot[(position & queue->mask) * queue->stride];
+}
+
+/* A full queue is rare: count it atomically, producers of an MPSC queue may race on it */
+static void CountFull(Ipc_Queue *queue)
+{
+    uint32 full;
+
+    do
+    {
+        full = queue->full;
+    } while (__cmpAndSwap((unsigned int *)&queue->full, full + 1, full) != full);
+}
+
+/**
+ * @brief Lay out a queue on its storage, empty
+ * @param storage IPC_QUEUE_WORDS(slots, size) words
+ * @param slots Messages the queue holds, a power of two
+ * @param size Largest message in bytes
+ */
+void Ipc_Queue_init(Ipc_Queue *queue, uint32 *storage, uint32 slots, uint32 size, Ipc_QueueMode mode)
+{
+    uint32 i;
+
+    memset(queue, 0, sizeof(*queue));
+
+    queue->slot   = (uint8 *)storage;
+    queue->stride = IPC_QUEUE_HEADER + ((size + 3) & ~3UL);
+    queue->mask   = slots - 1;
+    queue->size   = size;
+    queue->mode   = (uint8)mode;
+
+    /* slot i is free for position i */
+    for (i = 0; i < slots; i++)
+    {
+        *Sequence(queue, i) = i;
+    }
+}
+
+/**
+ * @brief Claim the next slot for a message (producer side)
+ * @return Room for a message of up to the size given to Ipc_Queue_init(), NULL_PTR if the queue is full; a reserved
+ *         slot must be committed, the consumer stops at it until then
+ */
+void *Ipc_Queue_reserve(Ipc_Queue *queue)
+{
+    uint32           head;
+    uint32           turn;
+    volatile uint32 *sequence;
+
+    while (1)
+    {
+        head     = queue->head;
+        sequence = Sequence(queue, head);
+        turn     = *sequence;
+
+        if (turn != head)
+        {
+            /* a lap behind: the consumer has not released the slot yet */
+            if ((sint32)(turn - head) < 0)
+            {
+                CountFull(queue);
+                return NULL_PTR;
+            }
+
+            continue;   /* another producer claimed it, head has moved on */
+        }
+
+        if (queue->mode == IPC_QUEUE_SPSC)
+        {
+            queue->head = head + 1;
+            break;
+        }
+
+        if (__cmpAndSwap((unsigned int *)&queue->head, head + 1, head) == head)
+        {
+            break;
+        }
+    }
+
+    return (void *)((uint8 *)sequence + IPC_QUEUE_HEADER);
+}
+
+/**
+ * @brief Hand a reserved slot to the consumer and post it (producer side, any order)
+ */
+void Ipc_Queue_commit(Ipc_Queue *queue, void *message)
+{
+    volatile uint32 *sequence = (volatile uint32 *)((uint8 *)message - IPC_QUEUE_HEADER);
+
+    /* the message must be visible to the consumer before its sequence */
+    __dsync();
+    *sequence = *sequence + 1;
+
+    Sched_signal(&queue->posted);
+}
+
+/**
+ * @brief Copy a message into the next slot and commit it (producer side)
+ * @return FALSE if the queue is full or the message is larger than a slot
+ */
+boolean Ipc_Queue_push(Ipc_Queue *queue, const void *data, uint32 length)
+{
+    void *message;
+
+    if (length > queue->size)
+    {
+        return FALSE;
+    }
+
+    message = Ipc_Queue_reserve(queue);
+
+    if (message == NULL_PTR)
+    {
+        return FALSE;
+    }
+
+    memcpy(message, data, length);
+    Ipc_Queue_commit(queue, message);
+    return TRUE;
+}
+
+/**
+ * @brief Oldest message, or NULL_PTR if it is not committed yet (consumer side)
+ */
+void *Ipc_Queue_peek(Ipc_Queue *queue)
+{
+    uint32           tail     = queue->tail;
+    volatile uint32 *sequence = Sequence(queue, tail);
+    uint32           depth;
+
+    if (*sequence != (tail + 1))
+    {
+        return NULL_PTR;
+    }
+
+    depth = queue->head - tail;
+    if (depth > queue->maxDepth)
+    {
+        queue->maxDepth = depth;
+    }
+
+    return (void *)((uint8 *)sequence + IPC_QUEUE_HEADER);
+}
+
+/**
+ * @brief Hand the slot returned by Ipc_Queue_peek() back to the producers
+ */
+void Ipc_Queue_release(Ipc_Queue *queue)
+{
+    uint32 tail = queue->tail;
+
+    /* finish reading the slot before a producer may reserve it again, a lap later */
+    __dsync();
+    *Sequence(queue, tail) = tail + queue->mask + 1;
+    queue->tail = tail + 1;
+}
@@ -0,0 +1,66 @@
+/**********************************************************************************************************************
+ * \file Ipc_Queue.h
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Lock-free Inter-core Queue - Interface
+ *
+ * Bounded ring of fixed-size slots for messages between cores, with one consumer and either one producer (SPSC) or
+ * any number of producers on any cores and in interrupts (MPSC). Messages are built in place: a producer reserves a
+ * slot, writes the message into it and commits it; the consumer peeks at the oldest committed slot, reads it in place
+ * and releases it. Nothing is copied by the queue and no lock is taken.
+ *
+ * Every slot starts with a sequence word that says whose turn it is: equal to the position when the slot is free for
+ * the producer reserving that position, one more once that message is committed, and a lap further once the consumer
+ * has released it. Only an MPSC reserve needs an atomic operation, the compare-and-swap (cmpswap.w) that claims the
+ * position; commits and releases are plain stores by the one owner of the slot. Producers of an MPSC queue commit in
+ * any order, the consumer still reads the messages in the order of their reservation.
+ *
+ * Every commit signals the queue's event, which makes the consumer's task ready and, from another core, raises the
+ * consumer core's software interrupt (Sched_post()). The storage belongs in a DSPR: another core reaches it through
+ * the global address, which is not cached, so no cache maintenance is needed.
+ *********************************************************************************************************************/
+
+#ifndef IPC_QUEUE_H_
+#define IPC_QUEUE_H_
+
+#include "Ifx_Types.h"
+#include "Sched.h"
+
+/* uint32 words of storage for a queue of slots messages of up to size bytes each */
+#define IPC_QUEUE_WORDS(slots, size)    ((slots) * (1 + (((size) + 3) / 4)))
+
+typedef enum
+{
+    IPC_QUEUE_SPSC = 0,         /* One producer: reserve is a plain store                   */
+    IPC_QUEUE_MPSC              /* Producers on several cores or interrupts: reserve by CAS */
+} Ipc_QueueMode;
+
+typedef struct
+{
+    volatile uint32  head;      /* Positions reserved, advanced by the producers            */
+    volatile uint32  tail;      /* Positions released, advanced by the consumer only        */
+    uint8           *slot;      /* Sequence word and message of each slot                   */
+    uint32           stride;    /* Bytes per slot                                           */
+    uint32           mask;      /* Slots - 1, a power of two                                */
+    uint32           size;      /* Largest message                                          */
+    uint8            mode;      /* Ipc_QueueMode                                            */
+    volatile uint32  full;      /* Reserves refused because every slot was taken            */
+    uint32           maxDepth;  /* Most messages waiting at a peek, seen by the consumer    */
+    Sched_Event      posted;    /* Signalled for every commit, posts the consumer           */
+} Ipc_Queue;
+
+/* Function Prototypes */
+void    Ipc_Queue_init(Ipc_Queue *queue, uint32 *storage, uint32 slots, uint32 size, Ipc_QueueMode mode);
+void   *Ipc_Queue_reserve(Ipc_Queue *queue);
+void    Ipc_Queue_commit(Ipc_Queue *queue, void *message);
+boolean Ipc_Queue_push(Ipc_Queue *queue, const void *data, uint32 length);
+void   *Ipc_Queue_peek(Ipc_Queue *queue);
+void    Ipc_Queue_release(Ipc_Queue *queue);
+
+/* Messages committed or in the making, not yet released */
+IFX_INLINE uint32 Ipc_Queue_depth(const Ipc_Queue *queue)
+{
+    return queue->head - queue->tail;
+}
+
+#endif /* IPC_QUEUE_H_ */
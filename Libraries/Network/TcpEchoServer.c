@@ -7,11 +7,10 @@
 
 #include "TcpEchoServer.h"
 #include "AppConfig.h"
-#include "UART_Logging.h"
+#include "UART_Log.h"
 #include "lwip/tcp.h"
 #include "lwip/pbuf.h"
 #include <string.h>
-#include <stdio.h>
 
 extern struct tcp_pcb *g_tcp_server_pcb;
 
@@ -21,7 +20,7 @@ static err_t tcp_echo_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf
     
     if (p == NULL)
     {
-        sendUARTMessage("TCP Client Disconnected\r\n", 26);
+        LOG_MSG(NETIF, INFO, "TCP Client Disconnected\r\n", 26);
         tcp_close(tpcb);
         return ERR_OK;
     }
@@ -32,9 +31,7 @@ static err_t tcp_echo_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf
     if (ret_err == ERR_OK)
     {
         tcp_output(tpcb);
-        char log[64];
-        sprintf(log, "TCP Echo: %d bytes\r\n", p->tot_len);
-        sendUARTMessage(log, strlen(log));
+        LOG_TRACE(NETIF, DEBUG, TRACE_TCP_ECHO, p->tot_len);
     }
     
     pbuf_free(p);
@@ -43,12 +40,12 @@ static err_t tcp_echo_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf
 
 static void tcp_echo_error_callback(void *arg, err_t err)
 {
-    sendUARTMessage("TCP Error\r\n", 11);
+    LOG_MSG(NETIF, ERROR, "TCP Error\r\n", 11);
 }
 
 static err_t tcp_echo_accept_callback(void *arg, struct tcp_pcb *newpcb, err_t err)
 {
-    sendUARTMessage("TCP Client Connected\r\n", 22);
+    LOG_MSG(NETIF, INFO, "TCP Client Connected\r\n", 22);
     tcp_recv(newpcb, tcp_echo_recv_callback);
     tcp_err(newpcb, tcp_echo_error_callback);
     return ERR_OK;
@@ -61,14 +58,14 @@ void tcp_echo_server_init(void)
     g_tcp_server_pcb = tcp_new();
     if (g_tcp_server_pcb == NULL)
     {
-        sendUARTMessage("TCP PCB creation failed\r\n", 26);
+        LOG_MSG(NETIF, ERROR, "TCP PCB creation failed\r\n", 26);
         return;
     }
     
     err = tcp_bind(g_tcp_server_pcb, IP_ADDR_ANY, TCP_ECHO_PORT);
     if (err != ERR_OK)
     {
-        sendUARTMessage("TCP Bind failed\r\n", 17);
+        LOG_MSG(NETIF, ERROR, "TCP Bind failed\r\n", 17);
         tcp_close(g_tcp_server_pcb);
         return;
     }
@@ -76,11 +73,11 @@ void tcp_echo_server_init(void)
     g_tcp_server_pcb = tcp_listen(g_tcp_server_pcb);
     if (g_tcp_server_pcb == NULL)
     {
-        sendUARTMessage("TCP Listen failed\r\n", 19);
+        LOG_MSG(NETIF, ERROR, "TCP Listen failed\r\n", 19);
         return;
     }
     
     tcp_accept(g_tcp_server_pcb, tcp_echo_accept_callback);
-    sendUARTMessage("TCP Echo Server started on port 8765\r\n", 38);
+    LOG_MSG(NETIF, INFO, "TCP Echo Server started on port 8765\r\n", 38);
 }
 
@@ -0,0 +1,205 @@
+/**********************************************************************************************************************
+ * \file Sched.c
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Event-driven Cooperative Scheduler Implementation
+ *********************************************************************************************************************/
+
+#include "Sched.h"
+#include "IfxCpu.h"
+#include "IfxStm.h"
+#include <string.h>
+
+#ifndef __wait
+#define __wait()    __asm("wait")
+#endif
+
+/* Each scheduler runs its tasks on one core; any core may post */
+Sched g_Sched_net;
+Sched g_Sched_app;
+
+/* Clear the task's ready bit, a post racing with it either lands before (and is consumed) or after (and runs again) */
+static void ClearReady(Sched *sched, uint32 bit)
+{
+    uint32 ready;
+
+    do
+    {
+        ready = sched->ready;
+    } while (__cmpAndSwap((unsigned int *)&sched->ready, ready & ~bit, ready) != ready);
+}
+
+static void RunTask(Sched *sched, uint8 task)
+{
+    Sched_TaskStats *stats    = &sched->stats[task];
+    uint32           postedAt = sched->postedAt[task];
+    uint32           start;
+    uint32           ticks;
+    boolean          more;
+
+    /* postedAt belongs to the next post once the bit is clear */
+    ClearReady(sched, 1UL << task);
+
+    start = IfxStm_getLower(&MODULE_STM0);
+    more  = sched->task[task].run();
+    ticks = IfxStm_getLower(&MODULE_STM0) - start;
+
+    stats->runs++;
+    stats->runTicks += ticks;
+
+    if (ticks > stats->maxRunTicks)
+    {
+        stats->maxRunTicks = ticks;
+    }
+
+    if ((start - postedAt) > stats->maxLatencyTicks)
+    {
+        stats->maxLatencyTicks = start - postedAt;
+    }
+
+    if (more != FALSE)
+    {
+        Sched_post(sched, task);
+    }
+}
+
+/**
+ * @brief Clear a scheduler and set its tasks, highest priority first; no task is ready
+ */
+void Sched_init(Sched *sched, const Sched_Task *task, uint8 count, uint32 coreIndex, Sched_WakeHook wake)
+{
+    memset(sched, 0, sizeof(*sched));
+
+    sched->task  = task;
+    sched->count = (count < SCHED_MAX_TASKS) ? count : SCHED_MAX_TASKS;
+    sched->core  = (uint8)coreIndex;
+    sched->wake  = wake;
+}
+
+/**
+ * @brief Make a task ready (interrupt-safe, any core); nothing happens if it is ready already
+ */
+void Sched_post(Sched *sched, uint8 task)
+{
+    uint32 bit = 1UL << task;
+    uint32 ready;
+
+    do
+    {
+        ready = sched->ready;
+
+        if ((ready & bit) != 0)
+        {
+            return;
+        }
+
+        /* stamped before the bit is set: the core running the task reads it only after */
+        sched->postedAt[task] = IfxStm_getLower(&MODULE_STM0);
+    } while (__cmpAndSwap((unsigned int *)&sched->ready, ready | bit, ready) != ready);
+
+    if ((sched->wake != NULL_PTR) && (IfxCpu_getCoreIndex() != sched->core))
+    {
+        sched->wake(sched->core);
+    }
+}
+
+/**
+ * @brief Run the ready task of highest priority
+ * @return FALSE if no task was ready
+ */
+boolean Sched_runOnce(Sched *sched)
+{
+    uint32 ready = sched->ready;
+    uint8  task  = 0;
+
+    if (ready == 0)
+    {
+        return FALSE;
+    }
+
+    while ((ready & 1) == 0)
+    {
+        ready >>= 1;
+        task++;
+    }
+
+    RunTask(sched, task);
+    return TRUE;
+}
+
+/**
+ * @brief One pass over the tasks in priority order, running each that is ready when its turn comes
+ *
+ * For a caller that steps the cores in turn (host build): a task posted by one of higher priority still runs in the
+ * same pass, but a task that keeps posting itself, or one of higher priority, waits for the next pass.
+ */
+void Sched_runReady(Sched *sched)
+{
+    uint8 task;
+
+    for (task = 0; (task < sched->count) && (sched->ready != 0); task++)
+    {
+        if ((sched->ready & (1UL << task)) != 0)
+        {
+            RunTask(sched, task);
+        }
+    }
+}
+
+/**
+ * @brief Run the schedulers of this core forever, sleeping whenever no task is ready
+ * @param sched Schedulers in priority order: a task of the first one runs before any task of the second
+ */
+void Sched_run(Sched *const *sched, uint8 count)
+{
+    uint8 i;
+
+    while (1)
+    {
+        boolean ran = FALSE;
+
+        for (i = 0; (i < count) && (ran == FALSE); i++)
+        {
+            ran = Sched_runOnce(sched[i]);
+        }
+
+        if (ran != FALSE)
+        {
+            continue;
+        }
+
+        /* Interrupts stay off from the last check through the WAIT: a request raised after the check is held
+         * pending and ends the WAIT instead of being taken just before it, then runs once they are enabled */
+        __disable();
+
+        for (i = 0; (i < count) && (sched[i]->ready == 0); i++)
+        {
+        }
+
+        if (i == count)
+        {
+            for (i = 0; i < count; i++)
+            {
+                sched[i]->idles++;
+            }
+
+            __wait();
+            __enable();
+        }
+        else
+        {
+            __enable();
+        }
+    }
+}
+
+const Sched_TaskStats *Sched_getStats(const Sched *sched, uint8 task)
+{
+    return &sched->stats[task];
+}
+
+void Sched_resetStats(Sched *sched)
+{
+    memset(sched->stats, 0, sizeof(sched->stats));
+    sched->idles = 0;
+}
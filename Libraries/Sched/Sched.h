@@ -0,0 +1,99 @@
+/**********************************************************************************************************************
+ * \file Sched.h
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Event-driven Cooperative Scheduler - Interface
+ *
+ * Every core runs its work as a handful of run-to-completion tasks instead of polling everything in a loop. A task
+ * runs only after it was posted: by an interrupt (GETH, STM compare), by a mailbox post from the other core or by
+ * another task. Posting sets the task's bit in the scheduler's ready word; the tasks are in priority order, so the
+ * lowest set bit is the next task to run and a task posted from an interrupt runs as soon as the current one returns.
+ * Posts coalesce: a task posted several times before it runs, runs once. A task that returns TRUE still has work and
+ * is posted again, behind any task of higher priority that became ready meanwhile.
+ *
+ * The ready word is changed with compare-and-swap only, so interrupts and the other core may post at any time. A post
+ * from another core calls the scheduler's wake hook, which raises an interrupt on the owning core to end its wait.
+ * When no task is ready the core sleeps (WAIT) until the next interrupt. It enters the WAIT with interrupts still
+ * disabled from its last look at the ready words, so a service request raised after that look stays pending and ends
+ * the WAIT at once; the interrupt is taken when the core enables interrupts again, and no post is slept through.
+ *
+ * Each task counts its runs, the STM0 ticks it ran for and the longest time from its post to its start.
+ *********************************************************************************************************************/
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include "Ifx_Types.h"
+
+/* Configuration */
+#define SCHED_MAX_TASKS             32                  /* Tasks per scheduler, one bit each of the ready word  */
+
+/* Runs the task once; TRUE if it has more work and must run again */
+typedef boolean (*Sched_TaskFunction)(void);
+
+/* Raises the wake-up interrupt of a core sleeping in Sched_run() */
+typedef void (*Sched_WakeHook)(uint32 coreIndex);
+
+typedef struct
+{
+    const char         *name;
+    Sched_TaskFunction  run;
+} Sched_Task;
+
+typedef struct
+{
+    uint32 runs;                        /* Times the task ran                                       */
+    uint32 runTicks;                    /* STM0 ticks spent in the task, wraps                      */
+    uint32 maxRunTicks;                 /* Longest run                                              */
+    uint32 maxLatencyTicks;             /* Longest delay from a post to the start of the run        */
+} Sched_TaskStats;
+
+typedef struct
+{
+    volatile uint32     ready;          /* Bit n: task n posted and not yet started                 */
+    const Sched_Task   *task;           /* Task table, highest priority first                       */
+    uint8               count;          /* Tasks in the table                                       */
+    uint8               core;           /* Core that runs the tasks                                 */
+    Sched_WakeHook      wake;           /* NULL_PTR if no other core posts, or the core never waits */
+    uint32              idles;          /* Times the core slept with no task of this scheduler ready */
+    uint32              postedAt[SCHED_MAX_TASKS];  /* STM0 tick of the post that made the task ready */
+    Sched_TaskStats     stats[SCHED_MAX_TASKS];
+} Sched;
+
+/* Interrupt, mailbox or module event that posts a task; does nothing until bound */
+typedef struct
+{
+    Sched  *sched;
+    uint8   task;
+} Sched_Event;
+
+/* Schedulers */
+extern Sched g_Sched_net;               /* CPU_WHICH_SERVICE_ETHERNET: lwIP, DoIP transport          */
+extern Sched g_Sched_app;               /* CPU_WHICH_SERVICE_APP: UDS, VCI                           */
+
+/* Function Prototypes */
+void    Sched_init(Sched *sched, const Sched_Task *task, uint8 count, uint32 coreIndex, Sched_WakeHook wake);
+void    Sched_post(Sched *sched, uint8 task);
+boolean Sched_runOnce(Sched *sched);
+void    Sched_runReady(Sched *sched);
+void    Sched_run(Sched *const *sched, uint8 count);
+const Sched_TaskStats *Sched_getStats(const Sched *sched, uint8 task);
+void    Sched_resetStats(Sched *sched);
+
+/* Let an event post a task of a scheduler */
+IFX_INLINE void Sched_bind(Sched_Event *event, Sched *sched, uint8 task)
+{
+    event->task  = task;
+    event->sched = sched;
+}
+
+/* Post the task bound to the event (interrupt-safe, any core) */
+IFX_INLINE void Sched_signal(const Sched_Event *event)
+{
+    if (event->sched != NULL_PTR)
+    {
+        Sched_post(event->sched, event->task);
+    }
+}
+
+#endif /* SCHED_H_ */
@@ -0,0 +1,87 @@
+/**********************************************************************************************************************
+ * \file Sched_Isr.c
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ * 
+ * Scheduler Interrupt Service Routines Implementation
+ *********************************************************************************************************************/
+
+#include "Sched_Isr.h"
+#include "Configuration.h"
+#include "ConfigurationIsr.h"
+#include "IfxCpu_Irq.h"
+#include "IfxSrc.h"
+#include "IfxStm.h"
+#include "Ipc_Mailbox.h"
+#include "Sched.h"
+#include "Timer_Wheel.h"
+
+/* Longest comparator delay, well inside the 42 s wrap of the 32-bit compare at 100 MHz */
+#define SCHED_ISR_MAX_DELAY_MS  10000U
+
+/* GPSR group n serves CPUn */
+static volatile Ifx_SRC_SRCR *const g_wakeSrc[] = {&SRC_GPSR00, &SRC_GPSR10, &SRC_GPSR20};
+
+/**
+ * @brief Program STM0 Compare 1 to the next expiry of the application core's timer wheel
+ * 
+ * Compare hook of g_Timer_app, the counterpart of LwipIsr_armCompare() for the application core.
+ */
+void SchedIsr_armAppCompare(uint32 delayMs)
+{
+    if (delayMs > SCHED_ISR_MAX_DELAY_MS)
+    {
+        delayMs = SCHED_ISR_MAX_DELAY_MS;   /* also TIMER_WHEEL_IDLE */
+    }
+    else if (delayMs == 0)
+    {
+        delayMs = 1;
+    }
+    
+    IfxStm_updateCompare(&MODULE_STM0, IfxStm_Comparator_1,
+                         IfxStm_getLower(&MODULE_STM0) + (delayMs * IFX_CFG_STM_TICKS_PER_MS));
+}
+
+void SchedIsr_initWake(uint32 coreIndex)
+{
+    volatile Ifx_SRC_SRCR *src = g_wakeSrc[coreIndex];
+    
+    IfxSrc_init(src, IfxCpu_Irq_getTos((IfxCpu_ResourceCpu)coreIndex), ISR_PRIORITY_SCHED_WAKE);
+    IfxSrc_enable(src);
+}
+
+void SchedIsr_wake(uint32 coreIndex)
+{
+    IfxSrc_setRequest(g_wakeSrc[coreIndex]);
+}
+
+/**
+ * @brief Application Timer ISR (next timer wheel expiry)
+ * 
+ * This ISR is called by STM0 Compare 1 when the first timer of g_Timer_app expires; it posts the application core's
+ * timer task.
+ */
+IFX_INTERRUPT(SchedIsr_appTick, CPU_WHICH_SERVICE_APP, ISR_PRIORITY_APP_TICK);
+void SchedIsr_appTick(void)
+{
+    /* Not due again before the next poll reprograms it */
+    IfxStm_increaseCompare(&MODULE_STM0, IfxStm_Comparator_1, SCHED_ISR_MAX_DELAY_MS * IFX_CFG_STM_TICKS_PER_MS);
+    Sched_signal(&g_Timer_app.expired);
+}
+
+/**
+ * @brief Wake-up ISRs
+ * 
+ * Raised by a post from the other core. The poster has set the ready bit already; the pending request is what ends
+ * the WAIT of Sched_run(), the handler has nothing left to do.
+ */
+#if IPC_SPLIT_CORES
+IFX_INTERRUPT(SchedIsr_wakeApp, CPU_WHICH_SERVICE_APP, ISR_PRIORITY_SCHED_WAKE);
+void SchedIsr_wakeApp(void)
+{
+}
+
+IFX_INTERRUPT(SchedIsr_wakeNet, CPU_WHICH_SERVICE_ETHERNET, ISR_PRIORITY_SCHED_WAKE);
+void SchedIsr_wakeNet(void)
+{
+}
+#endif
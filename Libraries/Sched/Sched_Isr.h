@@ -0,0 +1,31 @@
+/**********************************************************************************************************************
+ * \file Sched_Isr.h
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ * 
+ * Scheduler Interrupt Service Routines - Interface
+ * 
+ * The interrupts that post tasks of the application core and wake a core waiting in Sched_run(): STM0 Compare 1 for
+ * the application core's timer wheel, and one general purpose software interrupt (GPSR) per core for posts from the
+ * other core. Each is taken by the core the deployment in Configuration.h gives its scheduler.
+ *********************************************************************************************************************/
+
+#ifndef SCHED_ISR_H_
+#define SCHED_ISR_H_
+
+#include "Ifx_Types.h"
+
+/* ISR Declarations (called from vector table) */
+void SchedIsr_appTick(void);
+void SchedIsr_wakeApp(void);
+void SchedIsr_wakeNet(void);
+
+/* Compare hook of g_Timer_app: next interrupt in delayMs */
+void SchedIsr_armAppCompare(uint32 delayMs);
+
+/* Route the wake-up interrupt of a core to it */
+void SchedIsr_initWake(uint32 coreIndex);
+
+/* Wake hook of the schedulers: raise the wake-up interrupt of a core */
+void SchedIsr_wake(uint32 coreIndex);
+
+#endif /* SCHED_ISR_H_ */
@@ -0,0 +1,338 @@
+/**********************************************************************************************************************
+ * \file Timer_Wheel.c
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Hierarchical Timer Wheel Implementation
+ *********************************************************************************************************************/
+
+#include "Timer_Wheel.h"
+#include "IfxStm.h"
+#include "Configuration.h"
+#include <string.h>
+
+#define TIMER_L0_MASK       (TIMER_WHEEL_L0_SLOTS - 1)
+#define TIMER_LN_MASK       (TIMER_WHEEL_LN_SLOTS - 1)
+#define TIMER_L1_BASE       TIMER_WHEEL_L0_SLOTS
+#define TIMER_L2_BASE       (TIMER_WHEEL_L0_SLOTS + TIMER_WHEEL_LN_SLOTS)
+#define TIMER_L1_SHIFT      TIMER_WHEEL_L0_BITS
+#define TIMER_L2_SHIFT      (TIMER_WHEEL_L0_BITS + TIMER_WHEEL_LN_BITS)
+
+#if (TIMER_WHEEL_SLOTS % 32) != 0
+#error "The timer wheel slots must fill whole bitmap words"
+#endif
+
+/* Each wheel is used by one core only */
+Timer_Wheel g_Timer_net;
+Timer_Wheel g_Timer_app;
+
+static void Link(Timer_Wheel *wheel, Timer_Entry *timer, uint32 slot)
+{
+    Timer_Entry **head = &wheel->slot[slot];
+
+    timer->next = *head;
+    if (*head != NULL_PTR)
+    {
+        (*head)->pprev = &timer->next;
+    }
+
+    timer->pprev = head;
+    *head        = timer;
+    timer->slot  = (uint16)slot;
+    timer->wheel = wheel;
+
+    wheel->occupied[slot >> 5] |= 1UL << (slot & 31);
+}
+
+static void Unlink(Timer_Entry *timer)
+{
+    Timer_Wheel *wheel = timer->wheel;
+
+    *timer->pprev = timer->next;
+    if (timer->next != NULL_PTR)
+    {
+        timer->next->pprev = timer->pprev;
+    }
+
+    if (wheel->slot[timer->slot] == NULL_PTR)
+    {
+        wheel->occupied[timer->slot >> 5] &= ~(1UL << (timer->slot & 31));
+    }
+
+    timer->wheel = NULL_PTR;
+}
+
+/* Put the timer in the slot of its expiry, seen from the next millisecond to process */
+static void File(Timer_Wheel *wheel, Timer_Entry *timer)
+{
+    uint32 expires = timer->expires;
+    uint32 delta   = expires - wheel->now;
+    uint32 slot;
+
+    if ((sint32)delta < 0)
+    {
+        slot = wheel->now & TIMER_L0_MASK;      /* overdue: runs with the next millisecond */
+    }
+    else if (delta < TIMER_WHEEL_L0_SLOTS)
+    {
+        slot = expires & TIMER_L0_MASK;
+    }
+    else if (delta < (1UL << TIMER_L2_SHIFT))
+    {
+        slot = TIMER_L1_BASE + ((expires >> TIMER_L1_SHIFT) & TIMER_LN_MASK);
+    }
+    else
+    {
+        if (delta >= TIMER_WHEEL_RANGE_MS)
+        {
+            expires = wheel->now + TIMER_WHEEL_RANGE_MS - 1;    /* farthest slot, filed again when it cascades */
+        }
+
+        slot = TIMER_L2_BASE + ((expires >> TIMER_L2_SHIFT) & TIMER_LN_MASK);
+    }
+
+    Link(wheel, timer, slot);
+}
+
+/* Move the timers of a coarse slot down, now that it is within reach of the finer level */
+static void Cascade(Timer_Wheel *wheel, uint32 slot)
+{
+    Timer_Entry *timer = wheel->slot[slot];
+    Timer_Entry *next;
+
+    wheel->slot[slot] = NULL_PTR;
+    wheel->occupied[slot >> 5] &= ~(1UL << (slot & 31));
+
+    while (timer != NULL_PTR)
+    {
+        next = timer->next;
+        File(wheel, timer);
+        wheel->stats.cascaded++;
+        timer = next;
+    }
+}
+
+/* First expiry or cascade the wheel has to process, FALSE if no timer is running */
+static boolean NextExpiry(const Timer_Wheel *wheel, uint32 *expiry)
+{
+    uint32 start = wheel->now & TIMER_L0_MASK;
+    uint32 ahead = 0;
+
+    if (wheel->stats.running == 0)
+    {
+        return FALSE;
+    }
+
+    /* the first level holds the next 256 ms exactly, the bitmap skips empty slots 32 at a time */
+    while (ahead < TIMER_WHEEL_L0_SLOTS)
+    {
+        uint32 slot = (start + ahead) & TIMER_L0_MASK;
+        uint32 bits = wheel->occupied[slot >> 5] >> (slot & 31);
+
+        if (bits == 0)
+        {
+            ahead += 32 - (slot & 31);
+            continue;
+        }
+
+        while ((bits & 1) == 0)
+        {
+            bits >>= 1;
+            ahead++;
+        }
+
+        if (ahead < TIMER_WHEEL_L0_SLOTS)
+        {
+            *expiry = wheel->now + ahead;
+            return TRUE;
+        }
+    }
+
+    /* only coarser timers: the wrap of the first level cascades them */
+    *expiry = wheel->now + ((TIMER_WHEEL_L0_SLOTS - start) & TIMER_L0_MASK);
+    return TRUE;
+}
+
+/**
+ * @brief Clear a wheel and set the hook that programs the core's comparator
+ */
+void Timer_Wheel_init(Timer_Wheel *wheel, Timer_CompareHook hook)
+{
+    memset(wheel, 0, sizeof(*wheel));
+
+    wheel->now   = Timer_nowMs();
+    wheel->armed = TIMER_WHEEL_IDLE;
+    wheel->hook  = hook;
+}
+
+/**
+ * @brief Run the callbacks of all timers expired since the last poll (owning core's timer task)
+ */
+void Timer_Wheel_poll(Timer_Wheel *wheel)
+{
+    uint32       now = Timer_nowMs();
+    uint32       expiry;
+    Timer_Entry *timer;
+
+    while ((wheel->stats.running != 0) && ((sint32)(now - wheel->now) >= 0))
+    {
+        uint32 index = wheel->now & TIMER_L0_MASK;
+
+        if (index == 0)
+        {
+            uint32 index1 = (wheel->now >> TIMER_L1_SHIFT) & TIMER_LN_MASK;
+
+            Cascade(wheel, TIMER_L1_BASE + index1);
+
+            if (index1 == 0)
+            {
+                Cascade(wheel, TIMER_L2_BASE + ((wheel->now >> TIMER_L2_SHIFT) & TIMER_LN_MASK));
+            }
+        }
+
+        /* timers the callbacks start for this millisecond land in the next one */
+        wheel->now++;
+
+        while ((timer = wheel->slot[index]) != NULL_PTR)
+        {
+            Unlink(timer);
+
+            if ((now - timer->expires) > wheel->stats.maxLateMs)
+            {
+                wheel->stats.maxLateMs = now - timer->expires;
+            }
+
+            if (timer->period != 0)
+            {
+                /* drift-free, but periods missed while the loop was held up are skipped */
+                timer->expires += timer->period;
+                if ((sint32)(timer->expires - wheel->now) < 0)
+                {
+                    timer->expires = now + timer->period;
+                }
+
+                File(wheel, timer);
+            }
+            else
+            {
+                wheel->stats.running--;
+            }
+
+            wheel->stats.fired++;
+            timer->callback(timer->arg);
+        }
+    }
+
+    /* nothing to catch up on */
+    if (wheel->stats.running == 0)
+    {
+        wheel->now = now + 1;
+    }
+
+    if (wheel->hook != NULL_PTR)
+    {
+        if (!NextExpiry(wheel, &expiry))
+        {
+            expiry = TIMER_WHEEL_IDLE;
+        }
+
+        if (expiry != wheel->armed)
+        {
+            wheel->armed = expiry;
+            wheel->hook((expiry == TIMER_WHEEL_IDLE) ? TIMER_WHEEL_IDLE : (expiry - now));
+        }
+    }
+}
+
+/**
+ * @brief Milliseconds from the last poll to the next expiry (or cascade), TIMER_WHEEL_IDLE if none
+ */
+uint32 Timer_Wheel_nextExpiry(const Timer_Wheel *wheel)
+{
+    uint32 expiry;
+
+    if (!NextExpiry(wheel, &expiry))
+    {
+        return TIMER_WHEEL_IDLE;
+    }
+
+    return expiry - (wheel->now - 1);
+}
+
+/**
+ * @brief TRUE if a timer expired (or a cascade is due) since the last poll, for a wheel without comparator
+ */
+boolean Timer_Wheel_isDue(const Timer_Wheel *wheel)
+{
+    uint32 expiry;
+
+    return (NextExpiry(wheel, &expiry) && ((sint32)(Timer_nowMs() - expiry) >= 0)) ? TRUE : FALSE;
+}
+
+const Timer_WheelStats *Timer_Wheel_getStats(const Timer_Wheel *wheel)
+{
+    return &wheel->stats;
+}
+
+/**
+ * @brief Prepare a timer; must not be running
+ */
+void Timer_init(Timer_Entry *timer, Timer_Callback callback, void *arg)
+{
+    memset(timer, 0, sizeof(*timer));
+
+    timer->callback = callback;
+    timer->arg      = arg;
+}
+
+/**
+ * @brief (Re)start a timer: first expiry after delayMs, then every periodMs (0: one-shot)
+ */
+void Timer_start(Timer_Wheel *wheel, Timer_Entry *timer, uint32 delayMs, uint32 periodMs)
+{
+    uint32 now = Timer_nowMs();
+
+    Timer_stop(timer);
+
+    /* an empty wheel has nothing to catch up on: its time jumps to now */
+    if (wheel->stats.running == 0)
+    {
+        wheel->now = now;
+    }
+
+    timer->expires = now + delayMs;
+    timer->period  = periodMs;
+    File(wheel, timer);
+
+    wheel->stats.running++;
+    wheel->stats.started++;
+
+    /* due before the comparator fires: bring it forward, the core may sleep before the next poll */
+    if ((wheel->hook != NULL_PTR) &&
+        ((wheel->armed == TIMER_WHEEL_IDLE) || ((sint32)(timer->expires - wheel->armed) < 0)))
+    {
+        wheel->armed = timer->expires;
+        wheel->hook(delayMs);
+    }
+}
+
+/**
+ * @brief Stop a timer; nothing happens if it is not running
+ */
+void Timer_stop(Timer_Entry *timer)
+{
+    Timer_Wheel *wheel = timer->wheel;
+
+    if (wheel != NULL_PTR)
+    {
+        Unlink(timer);
+        wheel->stats.running--;
+    }
+}
+
+/**
+ * @brief Milliseconds of the STM0 counter, wraps after 49 days
+ */
+uint32 Timer_nowMs(void)
+{
+    return (uint32)(IfxStm_get(&MODULE_STM0) / IFX_CFG_STM_TICKS_PER_MS);
+}
@@ -0,0 +1,96 @@
+/**********************************************************************************************************************
+ * \file Timer_Wheel.h
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Hierarchical Timer Wheel - Interface
+ *
+ * One-shot and periodic software timers on a millisecond time base derived from STM0. A running timer is a node in
+ * the slot list of its expiry: 256 slots of 1 ms, then 64 slots of 256 ms and 64 slots of 16.384 s. Starting and
+ * stopping a timer is O(1), and a poll only visits the slots of the milliseconds that passed since the last one,
+ * whatever the number of timers. Timers of the coarser levels move down a level (cascade) each time the finer level
+ * wraps; delays beyond the last level wait in its farthest slot and are filed again on every cascade.
+ *
+ * Every core has its own wheel, polled by its timer task, so callbacks run in the context of the module that started
+ * the timer and never in an interrupt. A wheel with a compare hook is told after each poll, and whenever a timer is
+ * started ahead of it, how long it may sleep until its next expiry, for the core's STM comparator; the comparator
+ * interrupt signals the wheel's expired event, which posts the timer task.
+ *********************************************************************************************************************/
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include "Ifx_Types.h"
+#include "Sched.h"
+
+/* Configuration */
+#define TIMER_WHEEL_L0_BITS         8                   /* 1 ms slots of the first level                        */
+#define TIMER_WHEEL_LN_BITS         6                   /* Slots of each coarser level                          */
+#define TIMER_WHEEL_L0_SLOTS        (1U << TIMER_WHEEL_L0_BITS)
+#define TIMER_WHEEL_LN_SLOTS        (1U << TIMER_WHEEL_LN_BITS)
+#define TIMER_WHEEL_SLOTS           (TIMER_WHEEL_L0_SLOTS + (2 * TIMER_WHEEL_LN_SLOTS))
+#define TIMER_WHEEL_RANGE_MS        (1UL << (TIMER_WHEEL_L0_BITS + (2 * TIMER_WHEEL_LN_BITS)))
+
+#define TIMER_WHEEL_IDLE            0xFFFFFFFFUL        /* Timer_Wheel_nextExpiry(): no timer running           */
+
+typedef void (*Timer_Callback)(void *arg);
+
+/* Programs the core's comparator: the wheel wants to be polled again in delayMs, or never (TIMER_WHEEL_IDLE) */
+typedef void (*Timer_CompareHook)(uint32 delayMs);
+
+struct Timer_Wheel;
+
+typedef struct Timer_Entry
+{
+    struct Timer_Entry  *next;          /* Slot list, NULL_PTR at the end                           */
+    struct Timer_Entry **pprev;         /* Link that points to this timer                           */
+    struct Timer_Wheel  *wheel;         /* Wheel the timer runs on, NULL_PTR while stopped          */
+    uint32               expires;       /* Timer_nowMs() of the expiry                              */
+    uint32               period;        /* Restarted with this period on expiry, 0 for one-shot     */
+    uint16               slot;          /* Slot index in the wheel                                  */
+    Timer_Callback       callback;
+    void                *arg;
+} Timer_Entry;
+
+typedef struct
+{
+    uint32 running;                     /* Timers currently started                                 */
+    uint32 started;                     /* Timer_start() calls                                      */
+    uint32 fired;                       /* Callbacks run                                            */
+    uint32 cascaded;                    /* Timers moved down a level                                */
+    uint32 maxLateMs;                   /* Largest delay between expiry and callback                */
+} Timer_WheelStats;
+
+typedef struct Timer_Wheel
+{
+    uint32             now;             /* Next millisecond to process                              */
+    uint32             armed;           /* Expiry last passed to the compare hook                   */
+    Timer_CompareHook  hook;            /* NULL_PTR if the wheel is only polled                     */
+    Sched_Event        expired;         /* Signalled by the comparator interrupt                    */
+    Timer_Entry       *slot[TIMER_WHEEL_SLOTS];
+    uint32             occupied[TIMER_WHEEL_SLOTS / 32];    /* Non-empty slots, finds the next expiry */
+    Timer_WheelStats   stats;
+} Timer_Wheel;
+
+/* Wheels */
+extern Timer_Wheel g_Timer_net;         /* CPU_WHICH_SERVICE_ETHERNET: lwIP, DoIP transport          */
+extern Timer_Wheel g_Timer_app;         /* CPU_WHICH_SERVICE_APP: UDS, VCI                           */
+
+/* Function Prototypes */
+void    Timer_Wheel_init(Timer_Wheel *wheel, Timer_CompareHook hook);
+void    Timer_Wheel_poll(Timer_Wheel *wheel);
+uint32  Timer_Wheel_nextExpiry(const Timer_Wheel *wheel);
+boolean Timer_Wheel_isDue(const Timer_Wheel *wheel);
+const Timer_WheelStats *Timer_Wheel_getStats(const Timer_Wheel *wheel);
+
+void    Timer_init(Timer_Entry *timer, Timer_Callback callback, void *arg);
+void    Timer_start(Timer_Wheel *wheel, Timer_Entry *timer, uint32 delayMs, uint32 periodMs);
+void    Timer_stop(Timer_Entry *timer);
+uint32  Timer_nowMs(void);
+
+/* TRUE while the timer is started and has not expired (periodic timers stay started) */
+IFX_INLINE boolean Timer_isRunning(const Timer_Entry *timer)
+{
+    return (timer->wheel != NULL_PTR) ? TRUE : FALSE;
+}
+
+#endif /* TIMER_WHEEL_H_ */
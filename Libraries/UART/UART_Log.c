@@ -0,0 +1,36 @@
+/**********************************************************************************************************************
+ * \file UART_Log.c
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Log Levels and Module Masks Implementation
+ *********************************************************************************************************************/
+
+#include "UART_Log.h"
+
+volatile uint8 g_logMask[LOG_MODULE_COUNT] =
+{
+    LOG_MASK_DEFAULT, LOG_MASK_DEFAULT, LOG_MASK_DEFAULT, LOG_MASK_DEFAULT, LOG_MASK_DEFAULT
+};
+
+/**
+ * @brief Replace the level masks of all modules
+ * @param masks LOG_MODULE_COUNT bytes in Log_Module order
+ */
+void Log_SetMasks(const uint8 *masks)
+{
+    for (uint8 i = 0; i < LOG_MODULE_COUNT; i++)
+    {
+        g_logMask[i] = masks[i] & LOG_MASK_UP_TO(LOG_LEVEL_DEBUG);
+    }
+}
+
+/**
+ * @brief Copy the level masks of all modules (LOG_MODULE_COUNT bytes)
+ */
+void Log_GetMasks(uint8 *masks)
+{
+    for (uint8 i = 0; i < LOG_MODULE_COUNT; i++)
+    {
+        masks[i] = g_logMask[i];
+    }
+}
@@ -0,0 +1,106 @@
+/**********************************************************************************************************************
+ * \file UART_Log.h
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Log Levels and Module Masks - Interface
+ *
+ * Every log site names its module and level. A level above the module's compile-time maximum (LOG_MAX_<module> in
+ * AppConfig.h) folds to a constant FALSE and the site is compiled out. The remaining sites are filtered at run time by
+ * the module's level mask, which a tester changes with WriteDataByIdentifier 0x2E, DID UDS_DID_LOG_MASK.
+ *
+ *   LOG_MSG(DOIP, INFO, "[DoIP] TCP connected\r\n", 22);
+ *   LOG_TRACE(UDS, DEBUG, TRACE_UDS_VCI_REPORT, count);
+ *********************************************************************************************************************/
+
+#ifndef UART_LOG_H_
+#define UART_LOG_H_
+
+#include "Ifx_Types.h"
+#include "AppConfig.h"
+#include "UART_Logging.h"
+#include "UART_Trace.h"
+
+/* Log Levels */
+#define LOG_LEVEL_NONE              0
+#define LOG_LEVEL_ERROR             1           /* Failures                                     */
+#define LOG_LEVEL_WARN              2           /* Recoverable problems, dropped requests       */
+#define LOG_LEVEL_INFO              3           /* State changes (connection, collection)       */
+#define LOG_LEVEL_DEBUG             4           /* Per-message traces on the diagnostic path    */
+
+/* Runtime mask of the levels up to and including level */
+#define LOG_MASK_UP_TO(level)       ((uint8)((1U << (level)) - 1U))
+
+/* Compile-time maxima, overridden in AppConfig.h */
+#ifndef LOG_MAX_BUILD
+#define LOG_MAX_BUILD               LOG_LEVEL_DEBUG
+#endif
+#ifndef LOG_MAX_DOIP
+#define LOG_MAX_DOIP                LOG_MAX_BUILD
+#endif
+#ifndef LOG_MAX_UDS
+#define LOG_MAX_UDS                 LOG_MAX_BUILD
+#endif
+#ifndef LOG_MAX_VCI
+#define LOG_MAX_VCI                 LOG_MAX_BUILD
+#endif
+#ifndef LOG_MAX_FLASH
+#define LOG_MAX_FLASH               LOG_MAX_BUILD
+#endif
+#ifndef LOG_MAX_NETIF
+#define LOG_MAX_NETIF               LOG_MAX_BUILD
+#endif
+#ifndef LOG_MASK_DEFAULT
+#define LOG_MASK_DEFAULT            LOG_MASK_UP_TO(LOG_LEVEL_INFO)
+#endif
+
+/* Log Modules */
+typedef enum
+{
+    LOG_MODULE_DOIP = 0,
+    LOG_MODULE_UDS,
+    LOG_MODULE_VCI,
+    LOG_MODULE_FLASH,
+    LOG_MODULE_NETIF,           /* lwIP debug output, GETH netif and the echo servers */
+    LOG_MODULE_COUNT
+} Log_Module;
+
+/* Level mask per module, bit (level - 1) enables the level. Written by the UDS core, read by all. */
+extern volatile uint8 g_logMask[LOG_MODULE_COUNT];
+
+/* TRUE if module logs at level; constant FALSE above the compile-time maximum. The module and level names are
+ * pasted directly so that a build-wide define such as DEBUG cannot replace them. */
+#define LOG_ENABLED(module, level) \
+    LOG_ENABLED_LEVEL(LOG_MODULE_##module, LOG_MAX_##module, LOG_LEVEL_##level)
+
+#define LOG_ENABLED_LEVEL(index, max, level) \
+    (((level) <= (max)) && ((g_logMask[(index)] & (1U << ((level) - 1))) != 0U))
+
+#define LOG_MSG(module, level, msg, count) \
+    do { \
+        if (LOG_ENABLED_LEVEL(LOG_MODULE_##module, LOG_MAX_##module, LOG_LEVEL_##level)) \
+        { \
+            sendUARTMessage((msg), (count)); \
+        } \
+    } while (0)
+
+#define LOG_TRACE(module, level, id, ...) \
+    do { \
+        if (LOG_ENABLED_LEVEL(LOG_MODULE_##module, LOG_MAX_##module, LOG_LEVEL_##level)) \
+        { \
+            UART_TRACE((id), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_TRACE_DATA(module, level, id, data, dataLength, ...) \
+    do { \
+        if (LOG_ENABLED_LEVEL(LOG_MODULE_##module, LOG_MAX_##module, LOG_LEVEL_##level)) \
+        { \
+            UART_TRACE_DATA((id), (data), (dataLength), __VA_ARGS__); \
+        } \
+    } while (0)
+
+/* Function Prototypes */
+void Log_SetMasks(const uint8 *masks);
+void Log_GetMasks(uint8 *masks);
+
+#endif /* UART_LOG_H_ */
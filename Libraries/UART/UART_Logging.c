@@ -30,7 +30,12 @@
 /*********************************************************************************************************************/
 #include "UART_Logging.h"
 #include "IfxAsclin_Asc.h"
+#include "IfxDma_Dma.h"
+#include "IfxSrc.h"
+#include "IfxCpu.h"
 #include "IfxCpu_Irq.h"
+#include "Configuration.h"
+#include <string.h>
 
 /*********************************************************************************************************************/
 /*------------------------------------------------------Macros-------------------------------------------------------*/
@@ -40,24 +45,139 @@
 #define SERIAL_PIN_RX           IfxAsclin0_RXA_P14_1_IN                     /* RX pin of the board                  */
 #define SERIAL_PIN_TX           IfxAsclin0_TX_P14_0_OUT                     /* TX pin of the board                  */
 
-#define INTPRIO_ASCLIN0_TX      19                                          /* Priority of the ISR                  */
+#define UART_LOG_DMA_CHANNEL    IfxDma_ChannelId_1                          /* DMA channel feeding the TX FIFO      */
+#define INTPRIO_UART_LOG_DMA    19                                          /* Priority of the DMA done ISR         */
 
-#define ASC_TX_BUFFER_SIZE      64                                          /* Definition of the buffer size        */
+#define UART_LOG_CORES          IFXCPU_NUM_MODULES                          /* Any core may be given a subsystem    */
+#define UART_LOG_RING_MASK      (UART_LOG_RING_SIZE - 1)
+
+#if (UART_LOG_RING_SIZE & UART_LOG_RING_MASK) != 0
+#error "UART_LOG_RING_SIZE must be a power of two"
+#endif
+
+/*********************************************************************************************************************/
+/*--------------------------------------------------Type Definitions-------------------------------------------------*/
+/*********************************************************************************************************************/
+/* Single-producer ring: only the owning core advances head, only the DMA drain advances tail */
+typedef struct
+{
+    volatile uint32 head;                                                   /* Bytes written by the owning core     */
+    volatile uint32 tail;                                                   /* Bytes sent out by the DMA            */
+    uint32          droppedMessages;                                        /* Messages refused on a full ring      */
+    uint8           buffer[UART_LOG_RING_SIZE];
+} UART_LogRing;
 
 /*********************************************************************************************************************/
 /*-------------------------------------------------Global variables--------------------------------------------------*/
 /*********************************************************************************************************************/
 IfxAsclin_Asc g_asc;                                                        /* Declaration of the ASC handle        */
-uint8 g_ascTxBuffer[ASC_TX_BUFFER_SIZE + sizeof(Ifx_Fifo) + 8];             /* Declaration of the FIFO parameters   */
+IfxDma_Dma_Channel g_uartDmaChannel;                                        /* DMA channel ring -> ASCLIN0 TXDATA   */
+
+/* The rings live in CPU0 DSPR like the rest of .bss: the other cores and the DMA reach them through the global
+ * address, which is not cached. */
+static UART_LogRing g_uartLog[UART_LOG_CORES];
+
+/* Held from the start of a DMA chunk until the drain finds all rings empty: whoever holds it owns the channel */
+static IfxCpu_mutexLock g_uartDmaBusy;
+static uint8  g_uartDmaRing;                                                /* Ring of the chunk in flight          */
+static uint32 g_uartDmaLength;                                              /* Bytes in the chunk in flight         */
 
 /*********************************************************************************************************************/
 /*---------------------------------------------Function Implementations----------------------------------------------*/
 /*********************************************************************************************************************/
-IFX_INTERRUPT(asclin0TxISR, 0, INTPRIO_ASCLIN0_TX);                     /* Adding the Interrupt Service Routine     */
+/* Hand the next contiguous run of pending bytes to the DMA, starting with g_uartDmaRing.
+ * The caller owns g_uartDmaBusy. Returns FALSE if all rings are empty. */
+static boolean UART_startChunk(void)
+{
+    uint8 i;
+
+    for (i = 0; i < UART_LOG_CORES; i++)
+    {
+        UART_LogRing *ring = &g_uartLog[g_uartDmaRing];
+        uint32 tail = ring->tail;
+        uint32 pending = ring->head - tail;
+
+        if (pending != 0)
+        {
+            uint32 offset = tail & UART_LOG_RING_MASK;
+
+            /* stop at the end of the buffer, the rest follows in the next chunk */
+            g_uartDmaLength = __minu(pending, UART_LOG_RING_SIZE - offset);
+
+            IfxDma_Dma_setChannelSourceAddress(&g_uartDmaChannel,
+                IFXCPU_GLB_ADDR_DSPR(IfxCpu_getCoreId(), &ring->buffer[offset]));
+            IfxDma_Dma_setChannelTransferCount(&g_uartDmaChannel, g_uartDmaLength);
+            IfxDma_enableChannelTransaction(g_uartDmaChannel.dma, g_uartDmaChannel.channelId);
+
+            /* the TX FIFO level request is only raised on a level change: trigger the first transfer by hand */
+            IfxSrc_setRequest(IfxAsclin_getSrcPointerTx(&MODULE_ASCLIN0));
+            return TRUE;
+        }
 
-void asclin0TxISR(void)
+        g_uartDmaRing = (uint8)((g_uartDmaRing + 1) % UART_LOG_CORES);
+    }
+
+    return FALSE;
+}
+
+/* TRUE if any ring has bytes the DMA has not taken yet */
+static boolean UART_pending(void)
 {
-    IfxAsclin_Asc_isrTransmit(&g_asc);
+    uint8 i;
+
+    for (i = 0; i < UART_LOG_CORES; i++)
+    {
+        if (g_uartLog[i].head != g_uartLog[i].tail)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* Start the DMA unless a chunk is already in flight. The owner re-checks the rings after releasing the channel, so
+ * bytes committed while it was about to go idle are not left behind. */
+static void UART_kick(void)
+{
+    while (IfxCpu_acquireMutex(&g_uartDmaBusy))
+    {
+        if (UART_startChunk())
+        {
+            return;
+        }
+
+        IfxCpu_releaseMutex(&g_uartDmaBusy);
+
+        if (UART_pending() == FALSE)
+        {
+            return;
+        }
+    }
+}
+
+IFX_INTERRUPT(uartLogDmaISR, CPU_WHICH_SERVICE_LOG, INTPRIO_UART_LOG_DMA);    /* Adding the Interrupt Service Routine */
+
+void uartLogDmaISR(void)
+{
+    UART_LogRing *ring = &g_uartLog[g_uartDmaRing];
+    uint32 tail = ring->tail + g_uartDmaLength;
+
+    ring->tail = tail;
+
+    /* a chunk cut at the end of the buffer is continued first so the message is not interleaved with another core */
+    if (((tail & UART_LOG_RING_MASK) != 0) || (ring->head == tail))
+    {
+        g_uartDmaRing = (uint8)((g_uartDmaRing + 1) % UART_LOG_CORES);
+    }
+
+    if (UART_startChunk())
+    {
+        return;
+    }
+
+    IfxCpu_releaseMutex(&g_uartDmaBusy);
+    UART_kick();
 }
 
 void initUART(void)
@@ -69,13 +189,11 @@ void initUART(void)
     /* Set the desired baud rate */
     ascConfig.baudrate.baudrate = SERIAL_BAUDRATE;
 
-    /* ISR priorities and interrupt target */
-    ascConfig.interrupt.txPriority = INTPRIO_ASCLIN0_TX;
-    ascConfig.interrupt.typeOfService = IfxCpu_Irq_getTos(IfxCpu_getCoreIndex());
-
-    /* FIFO configuration */
-    ascConfig.txBuffer = &g_ascTxBuffer;
-    ascConfig.txBufferSize = ASC_TX_BUFFER_SIZE;
+    /* The TX FIFO level request goes to the DMA channel instead of a CPU, so no software FIFO is needed */
+    ascConfig.interrupt.txPriority = UART_LOG_DMA_CHANNEL;
+    ascConfig.interrupt.typeOfService = IfxSrc_Tos_dma;
+    ascConfig.txBuffer = NULL_PTR;
+    ascConfig.txBufferSize = 0;
 
     /* Port pins configuration */
     const IfxAsclin_Asc_Pins pins =
@@ -89,9 +207,74 @@ void initUART(void)
     ascConfig.pins = &pins;
 
     IfxAsclin_Asc_initModule(&g_asc, &ascConfig);                       /* Initialize module with above parameters  */
+
+    /* DMA channel: one byte from the ring to TXDATA per TX FIFO request */
+    IfxDma_Dma_Config dmaConfig;
+    IfxDma_Dma dma;
+    IfxDma_Dma_initModuleConfig(&dmaConfig, &MODULE_DMA);
+    IfxDma_Dma_initModule(&dma, &dmaConfig);
+
+    IfxDma_Dma_ChannelConfig channelConfig;
+    IfxDma_Dma_initChannelConfig(&channelConfig, &dma);
+    channelConfig.channelId = UART_LOG_DMA_CHANNEL;
+    channelConfig.hardwareRequestEnabled = FALSE;                       /* Enabled per chunk by UART_startChunk()   */
+    channelConfig.requestMode = IfxDma_ChannelRequestMode_oneTransferPerRequest;
+    channelConfig.operationMode = IfxDma_ChannelOperationMode_single;
+    channelConfig.moveSize = IfxDma_ChannelMoveSize_8bit;
+    channelConfig.blockMode = IfxDma_ChannelMove_1;
+    channelConfig.sourceAddressIncrementStep = IfxDma_ChannelIncrementStep_1;
+    channelConfig.destinationAddress = (uint32)&MODULE_ASCLIN0.TXDATA.U;
+    channelConfig.destinationCircularBufferEnabled = TRUE;              /* Keep writing the same register           */
+    channelConfig.destinationAddressCircularRange = IfxDma_ChannelIncrementCircular_none;
+    channelConfig.channelInterruptEnabled = TRUE;
+    channelConfig.channelInterruptPriority = INTPRIO_UART_LOG_DMA;
+    channelConfig.channelInterruptTypeOfService = IfxCpu_Irq_getTos((IfxCpu_ResourceCpu)CPU_WHICH_SERVICE_LOG);
+    IfxDma_Dma_initChannel(&g_uartDmaChannel, &channelConfig);
 }
 
 void sendUARTMessage(char * msg, Ifx_SizeT count)
 {
-    IfxAsclin_Asc_write(&g_asc, msg, &count, TIME_INFINITE);            /* Transfer of data                         */
+    uint32 core = IfxCpu_getCoreIndex();
+    UART_LogRing *ring;
+    uint32 head;
+    uint32 offset;
+    uint32 first;
+
+    if ((count <= 0) || (core >= UART_LOG_CORES))
+    {
+        return;
+    }
+
+    ring = &g_uartLog[core];
+    head = ring->head;
+
+    if ((uint32)count > (UART_LOG_RING_SIZE - (head - ring->tail)))   /* Never wait for the UART: drop instead    */
+    {
+        ring->droppedMessages++;
+        return;
+    }
+
+    offset = head & UART_LOG_RING_MASK;
+    first = __minu((uint32)count, UART_LOG_RING_SIZE - offset);
+    memcpy(&ring->buffer[offset], msg, first);
+    memcpy(ring->buffer, msg + first, (uint32)count - first);
+
+    /* the bytes must be visible to the DMA before the new head */
+    __dsync();
+    ring->head = head + (uint32)count;
+
+    UART_kick();
+}
+
+uint32 UART_getDroppedMessages(void)
+{
+    uint32 dropped = 0;
+    uint8 i;
+
+    for (i = 0; i < UART_LOG_CORES; i++)
+    {
+        dropped += g_uartLog[i].droppedMessages;
+    }
+
+    return dropped;
 }
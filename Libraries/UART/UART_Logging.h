@@ -33,10 +33,17 @@
 /*********************************************************************************************************************/
 #include "Ifx_Types.h"
 
+/*********************************************************************************************************************/
+/*------------------------------------------------------Macros-------------------------------------------------------*/
+/*********************************************************************************************************************/
+#define UART_LOG_RING_SIZE      4096                    /* Log ring per core in bytes, power of two */
+
 /*********************************************************************************************************************/
 /*------------------------------------------------Function Prototypes------------------------------------------------*/
 /*********************************************************************************************************************/
 void initUART(void);                                    /* Initialization function  */
-void sendUARTMessage(char * msg, Ifx_SizeT count);      /* Send function            */
+void sendUARTMessage(char * msg, Ifx_SizeT count);      /* Send function, never blocks: drops the message if the ring
+                                                         * of the calling core is full                              */
+uint32 UART_getDroppedMessages(void);                   /* Messages dropped on a full ring since start-up          */
 
 #endif /* UART_LOGGING_H_ */
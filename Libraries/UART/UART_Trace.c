@@ -0,0 +1,61 @@
+/**********************************************************************************************************************
+ * \file UART_Trace.c
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Binary Trace Log Implementation
+ *********************************************************************************************************************/
+
+#include "UART_Trace.h"
+#include "UART_Logging.h"
+#include "IfxStm.h"
+#include <string.h>
+
+#define UART_TRACE_HEADER_SIZE      8
+
+/**
+ * @brief Append one trace frame to the UART log ring
+ * @details The frame is assembled on the stack and handed over in a single sendUARTMessage() call, so it is either
+ *          logged whole or dropped whole when the ring is full.
+ */
+void UART_Trace(UART_TraceId id, const uint32 *args, uint8 argCount, const void *data, uint16 dataLength)
+{
+    uint8  frame[UART_TRACE_HEADER_SIZE + (4 * UART_TRACE_MAX_ARGS) + UART_TRACE_MAX_DATA];
+    uint32 timestamp = IfxStm_getLower(&MODULE_STM0);
+    uint16 offset;
+
+    if (argCount > UART_TRACE_MAX_ARGS)
+    {
+        argCount = UART_TRACE_MAX_ARGS;
+    }
+
+    if ((data == NULL_PTR) || (dataLength > UART_TRACE_MAX_DATA))
+    {
+        dataLength = (data == NULL_PTR) ? 0 : UART_TRACE_MAX_DATA;
+    }
+
+    frame[0] = UART_TRACE_SYNC;
+    frame[1] = (uint8)id;
+    frame[2] = argCount;
+    frame[3] = (uint8)dataLength;
+    frame[4] = (uint8)timestamp;
+    frame[5] = (uint8)(timestamp >> 8);
+    frame[6] = (uint8)(timestamp >> 16);
+    frame[7] = (uint8)(timestamp >> 24);
+    offset = UART_TRACE_HEADER_SIZE;
+
+    for (uint8 i = 0; i < argCount; i++)
+    {
+        frame[offset++] = (uint8)args[i];
+        frame[offset++] = (uint8)(args[i] >> 8);
+        frame[offset++] = (uint8)(args[i] >> 16);
+        frame[offset++] = (uint8)(args[i] >> 24);
+    }
+
+    if (dataLength != 0)
+    {
+        memcpy(&frame[offset], data, dataLength);
+        offset += dataLength;
+    }
+
+    sendUARTMessage((char *)frame, offset);
+}
@@ -0,0 +1,67 @@
+/**********************************************************************************************************************
+ * \file UART_Trace.h
+ * \copyright Copyright (C) Infineon Technologies AG 2019
+ *
+ * Binary Trace Log - Interface
+ *
+ * Hot-path call sites record a trace ID, the STM0 timestamp and their raw arguments as one binary frame in the UART
+ * log ring instead of formatting text. Frames start with UART_TRACE_SYNC, a byte that never occurs in the ASCII text
+ * lines, so both share the serial line. test/trace_decoder.py reads the format strings below and renders the stream.
+ *
+ * Frame (little endian):
+ *   [sync (1)][id (1)][argCount (1)][dataLength (1)][STM0 ticks (4)][args (4 * argCount)][data (dataLength)]
+ *********************************************************************************************************************/
+
+#ifndef UART_TRACE_H_
+#define UART_TRACE_H_
+
+#include "Ifx_Types.h"
+
+/* Configuration */
+#define UART_TRACE_SYNC             0xA5        /* First byte of every frame, outside the ASCII range  */
+#define UART_TRACE_MAX_ARGS         4           /* 32-bit arguments per frame                           */
+#define UART_TRACE_MAX_DATA         16          /* Raw bytes per frame (hex dumps, IDs)                 */
+
+/* Trace events: X(id, format). The decoder takes the format strings from this table, so IDs are assigned in order
+ * and only appended. %H renders the raw data as hex, %s as text. */
+#define UART_TRACE_EVENTS(X) \
+    X(TRACE_DOIP_RX,            "[DoIP] RX: %u bytes") \
+    X(TRACE_UDS_RX,             "[UDS] RX: SID=0x%02X, SA=0x%04X, TA=0x%04X, Len=%u Data: %H") \
+    X(TRACE_UDS_TX,             "[UDS] TX: SID=0x%02X, SA=0x%04X, TA=0x%04X, Total=%u bytes Data: %H") \
+    X(TRACE_UDS_VCI_REPORT,     "[UDS] VCI report sent (%u ECUs)") \
+    X(TRACE_HEALTH_REPORT,      "[Health] Status report sent (%u ECUs)") \
+    X(TRACE_VCI_REPORT,         "[VCI] Report sent to VMG (%u ECUs)") \
+    X(TRACE_VCI_BROADCAST_ERR,  "[VCI] Broadcast failed: err=%d") \
+    X(TRACE_VCI_RECEIVED,       "[VCI] Received from %s (%u/%u)") \
+    X(TRACE_VCI_TIMEOUT,        "[VCI] Collection timeout (%u Zone ECUs + ZGW)") \
+    X(TRACE_TCP_ECHO,           "TCP Echo: %u bytes") \
+    X(TRACE_DOIP_NACK,          "[DoIP] TX: Generic NACK 0x%02X") \
+    X(TRACE_FLASH_DOWNLOAD,     "[Flash] Download complete: %u bytes in %u ms (%u KB/s)") \
+    X(TRACE_FLASH_UPLOAD,       "[Flash] Upload complete: %u bytes in %u ms (%u KB/s)") \
+    X(TRACE_DOIP_ACCEPT,        "[DoIP] Server: tester connected on socket %u (%u open)") \
+    X(TRACE_DOIP_ROUTING,       "[DoIP] Server: routing activation SA=0x%04X on socket %u, code 0x%02X") \
+    X(TRACE_DOIP_CLOSE,         "[DoIP] Server: socket %u closed (reason %u)") \
+    X(TRACE_DOIP_ROUTE_TIMEOUT, "[DoIP] Router: no response from 0x%04X to 0x%04X")
+
+#define UART_TRACE_ID(id, format)   id,
+
+typedef enum
+{
+    UART_TRACE_EVENTS(UART_TRACE_ID)
+    UART_TRACE_COUNT
+} UART_TraceId;
+
+/* Function Prototypes */
+void UART_Trace(UART_TraceId id, const uint32 *args, uint8 argCount, const void *data, uint16 dataLength);
+
+/* Record an event with up to UART_TRACE_MAX_ARGS integer arguments */
+#define UART_TRACE(id, ...) \
+    UART_Trace((id), (const uint32[]){__VA_ARGS__}, \
+               (uint8)(sizeof((const uint32[]){__VA_ARGS__}) / sizeof(uint32)), NULL_PTR, 0)
+
+/* Same, followed by dataLength raw bytes (truncated to UART_TRACE_MAX_DATA) */
+#define UART_TRACE_DATA(id, data, dataLength, ...) \
+    UART_Trace((id), (const uint32[]){__VA_ARGS__}, \
+               (uint8)(sizeof((const uint32[]){__VA_ARGS__}) / sizeof(uint32)), (data), (dataLength))
+
+#endif /* UART_TRACE_H_ */
@@ -7,13 +7,14 @@
 
 #include "vci_manager.h"
 #include "AppConfig.h"
-#include "UART_Logging.h"
+#include "UART_Log.h"
 #include "Libraries/DoIP/doip_types.h"
-#include "IfxStm.h"
+#include "Libraries/DoIP/doip_client.h"
+#include "Timer_Wheel.h"
+#include "Ipc_Mailbox.h"
 #include "lwip/udp.h"
 #include "lwip/pbuf.h"
 #include <string.h>
-#include <stdio.h>
 
 extern struct udp_pcb *g_udp_server_pcb;
 extern DoIP_VCI_Info g_vci_database[MAX_ZONE_ECUS + 1];
@@ -21,7 +22,22 @@ extern uint8 g_zone_ecu_count;
 extern boolean g_vci_collection_complete;
 extern DoIP_VCI_Info g_zgw_vci;
 extern boolean g_vci_collection_active;
-extern uint32 g_vci_collection_start_time;
+
+/* Collection requested while the last VCI report still referenced the database */
+static boolean g_vci_start_waiting = FALSE;
+
+/* Collection timeout, or the retry of a start or timeout held up by the report (application core's wheel) */
+static Timer_Entry g_vci_timer;
+
+static void OnVciTimer(void *arg);
+
+/**
+ * @brief Prepare the collection timer
+ */
+void VCI_Init(void)
+{
+    Timer_init(&g_vci_timer, OnVciTimer, NULL_PTR);
+}
 
 /**
  * @brief Send UDP broadcast to request VCI from all Zone ECUs
@@ -31,9 +47,19 @@ extern uint32 g_vci_collection_start_time;
  */
 void VCI_SendCollectionRequest(void)
 {
+    /* The UDP PCB belongs to the Ethernet core */
+    if (!Ipc_onNetCore())
+    {
+        if (!Ipc_Mailbox_post(&g_Ipc_appToNet, IPC_MSG_VCI_REQUEST, NULL_PTR, 0))
+        {
+            LOG_MSG(VCI, WARN, "[VCI] Mailbox full\r\n", 20);
+        }
+        return;
+    }
+    
     if (g_udp_server_pcb == NULL)
     {
-        sendUARTMessage("[VCI] UDP not ready\r\n", 21);
+        LOG_MSG(VCI, ERROR, "[VCI] UDP not ready\r\n", 21);
         return;
     }
     
@@ -44,7 +70,7 @@ void VCI_SendCollectionRequest(void)
     struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 4, PBUF_RAM);
     if (p == NULL)
     {
-        sendUARTMessage("[VCI] pbuf alloc failed\r\n", 25);
+        LOG_MSG(VCI, ERROR, "[VCI] pbuf alloc failed\r\n", 25);
         return;
     }
     
@@ -61,21 +87,16 @@ void VCI_SendCollectionRequest(void)
     
     if (err == ERR_OK)
     {
-        sendUARTMessage("[VCI] Broadcast request sent (192.168.1.255:13400)\r\n", 53);
+        LOG_MSG(VCI, INFO, "[VCI] Broadcast request sent (192.168.1.255:13400)\r\n", 53);
     }
     else
     {
-        char msg[64];
-        sprintf(msg, "[VCI] Broadcast failed: err=%d\r\n", err);
-        sendUARTMessage(msg, strlen(msg));
+        LOG_TRACE(VCI, ERROR, TRACE_VCI_BROADCAST_ERR, err);
     }
 }
 
-/**
- * @brief Start VCI collection from Zone ECUs
- * Called by UDS Routine Control (0x31 01 F001)
- */
-void VCI_StartCollection(void)
+/* Reset the database and broadcast the request */
+static void BeginCollection(void)
 {
     /* Reset VCI database */
     g_zone_ecu_count = 0;
@@ -86,40 +107,113 @@ void VCI_StartCollection(void)
     
     /* Start collection timer */
     g_vci_collection_active = TRUE;
-    g_vci_collection_start_time = IfxStm_getLower(&MODULE_STM0);
+    Timer_start(&g_Timer_app, &g_vci_timer, VCI_COLLECTION_TIMEOUT_MS, 0);
     
     /* Send broadcast request */
     VCI_SendCollectionRequest();
     
-    sendUARTMessage("[VCI] Collection started (10s timeout)\r\n", 40);
+    LOG_MSG(VCI, INFO, "[VCI] Collection started (10s timeout)\r\n", 40);
 }
 
 /**
- * @brief Check VCI collection timeout in main loop
+ * @brief Start VCI collection from Zone ECUs
+ * Called by UDS Routine Control (0x31 01 F001)
+ * 
+ * The last VCI report is sent from the database in place; while the VMG has
+ * not acknowledged it the start is retried every VCI_REPORT_RETRY_MS.
  */
-void VCI_CheckCollectionTimeout(void)
+void VCI_StartCollection(void)
 {
-    if (!g_vci_collection_active || g_vci_collection_complete)
+    g_vci_collection_complete = FALSE;
+    
+    if (DoIP_Client_VciReportBusy())
+    {
+        g_vci_start_waiting = TRUE;
+        Timer_start(&g_Timer_app, &g_vci_timer, VCI_REPORT_RETRY_MS, 0);
+        return;
+    }
+    
+    BeginCollection();
+}
+
+/**
+ * @brief Store a VCI record received from a Zone ECU
+ * 
+ * @param record [Magic (4)][ECU ID (16)][SW (8)][HW (8)][Serial (16)]
+ * 
+ * Runs where the VCI database lives (application core); the UDP callback on
+ * the Ethernet core forwards records through the net-to-app mailbox.
+ */
+void VCI_AddRecord(const uint8 *record)
+{
+    /* Late records must not change a database a report is sent from */
+    if ((g_zone_ecu_count >= MAX_ZONE_ECUS) || g_vci_start_waiting || DoIP_Client_VciReportBusy())
     {
         return;
     }
     
-    /* Check timeout */
-    uint32 elapsed_ticks = IfxStm_getLower(&MODULE_STM0) - g_vci_collection_start_time;
-    uint32 timeout_ticks = (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, VCI_COLLECTION_TIMEOUT_MS);
+    /* Parse VCI data */
+    DoIP_VCI_Info *vci = &g_vci_database[g_zone_ecu_count];
+    memcpy(vci->ecu_id, &record[4], 16);
+    memcpy(vci->sw_version, &record[20], 8);
+    memcpy(vci->hw_version, &record[28], 8);
+    memcpy(vci->serial_num, &record[36], 16);
+    
+    g_zone_ecu_count++;
+    
+    /* Log received VCI */
+    LOG_TRACE_DATA(VCI, INFO, TRACE_VCI_RECEIVED, vci->ecu_id, sizeof(vci->ecu_id), g_zone_ecu_count, MAX_ZONE_ECUS);
     
-    if (elapsed_ticks >= timeout_ticks)
+    /* Check if collection complete */
+    if (g_zone_ecu_count == MAX_ZONE_ECUS && !g_vci_collection_complete)
     {
-        /* Timeout reached - finalize collection with current ECUs */
-        g_vci_collection_complete = TRUE;
-        g_vci_collection_active = FALSE;
+        LOG_MSG(VCI, INFO, "[VCI] Collection complete! Adding ZG VCI...\r\n", 46);
         
-        /* Add ZG's VCI to the end */
+        /* Add ZG's own VCI */
         memcpy(&g_vci_database[g_zone_ecu_count], &g_zgw_vci, sizeof(DoIP_VCI_Info));
+        g_vci_collection_complete = TRUE;
+        Timer_stop(&g_vci_timer);
         
-        char msg[64];
-        sprintf(msg, "[VCI] Collection timeout (%d Zone ECUs + ZGW)\r\n", g_zone_ecu_count);
-        sendUARTMessage(msg, strlen(msg));
+        LOG_MSG(VCI, INFO, "[VCI] Ready to send to VMG\r\n", 29);
     }
 }
 
+/* Collection timeout, or the retry of a start or timeout that found the report unacknowledged */
+static void OnVciTimer(void *arg)
+{
+    (void)arg;
+    
+    /* Start a waiting collection once the report is acknowledged */
+    if (g_vci_start_waiting)
+    {
+        if (DoIP_Client_VciReportBusy())
+        {
+            Timer_start(&g_Timer_app, &g_vci_timer, VCI_REPORT_RETRY_MS, 0);
+            return;
+        }
+    
+        g_vci_start_waiting = FALSE;
+        BeginCollection();
+        return;
+    }
+    
+    if (!g_vci_collection_active || g_vci_collection_complete)
+    {
+        return;
+    }
+    
+    if (DoIP_Client_VciReportBusy())
+    {
+        Timer_start(&g_Timer_app, &g_vci_timer, VCI_REPORT_RETRY_MS, 0);
+        return;
+    }
+    
+    /* Timeout reached - finalize collection with current ECUs */
+    g_vci_collection_complete = TRUE;
+    g_vci_collection_active = FALSE;
+    
+    /* Add ZG's VCI to the end */
+    memcpy(&g_vci_database[g_zone_ecu_count], &g_zgw_vci, sizeof(DoIP_VCI_Info));
+    
+    LOG_TRACE(VCI, WARN, TRACE_VCI_TIMEOUT, g_zone_ecu_count);
+}
@@ -10,10 +10,17 @@
 
 #include "Ifx_Types.h"
 
+/* Size of a VCI record as sent by a Zone ECU: magic + DoIP_VCI_Info */
+#define VCI_RECORD_SIZE     (4 + 48)
+
+/* Retry interval of a collection start or timeout held up by an unacknowledged VCI report */
+#define VCI_REPORT_RETRY_MS 10
+
 /* Function Prototypes */
+void VCI_Init(void);
 void VCI_SendCollectionRequest(void);
 void VCI_StartCollection(void);
-void VCI_CheckCollectionTimeout(void);
+void VCI_AddRecord(const uint8 *record);
 
 #endif /* VCI_MANAGER_H_ */
 
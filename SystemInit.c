@@ -6,6 +6,7 @@
 #include "SystemInit.h"
 #include "Ifx_Types.h"
 #include "IfxCpu.h"
+#include "IfxCpu_Irq.h"
 #include "IfxScuWdt.h"
 #include "IfxStm.h"
 #include "IfxGeth_Eth.h"
@@ -18,9 +19,17 @@
 #include "lwip/udp.h"
 #include "lwip/pbuf.h"
 #include "Libraries/DoIP/doip_client.h"
+#include "Libraries/DoIP/doip_router.h"
+#include "Libraries/DoIP/doip_server.h"
 #include "Libraries/DoIP/uds_handler.h"
 #include "Flash4_Driver.h"
 #include "Flash4_Test.h"
+#include "Ipc_Mailbox.h"
+#include "lwip_isr.h"
+#include "Sched_Isr.h"
+#include "SystemMain.h"
+#include "vci_manager.h"
+#include "Timer_Wheel.h"
 #include "TcpEchoServer.h"
 #include "UdpEchoServer.h"
 #include <string.h>
@@ -33,14 +42,45 @@ extern DoIP_VCI_Info g_zgw_vci;
 extern DoIP_HealthStatus_Info g_health_data[MAX_ZONE_ECUS + 1];
 
 static void Init_System(void);
+static void Init_Logging(void);
 static void Init_STM_Timer(void);
+static void Init_Flash(void);
 static void Init_Ethernet(void);
 static void Wait_PHY_Link(void);
 static void Init_DoIP(void);
+static void Init_UDS(void);
 static void Init_VCI(void);
 static void Init_Health_Database(void);
+static void Init_Application(void);
 static void Print_System_Ready(void);
 
+#if (CPU_WHICH_SERVICE_ETHERNET >= IFXCPU_NUM_MODULES) || (CPU_WHICH_SERVICE_APP >= IFXCPU_NUM_MODULES) || \
+    (CPU_WHICH_SERVICE_FLASH >= IFXCPU_NUM_MODULES) || (CPU_WHICH_SERVICE_LOG >= IFXCPU_NUM_MODULES)
+#error "The deployment in Configuration.h names a CPU the device does not have"
+#endif
+
+/* One step of the bring-up, run by the core that owns the subsystem */
+typedef struct
+{
+    uint32 core;
+    void (*init)(void);
+} Init_Stage;
+
+/* In order: the UART first so every later stage can log, the network before the application as it always was */
+static const Init_Stage g_initStages[] = {
+    {CPU_WHICH_SERVICE_LOG,      Init_Logging},
+    {0,                          Init_STM_Timer},       /* comparators of both timer wheels, routed to their cores */
+    {0,                          Ipc_Mailbox_init},     /* before either side posts or binds a mailbox event */
+    {CPU_WHICH_SERVICE_FLASH,    Init_Flash},
+    {CPU_WHICH_SERVICE_ETHERNET, SystemInit_Network},
+    {CPU_WHICH_SERVICE_APP,      Init_Application},
+};
+
+#define INIT_STAGE_COUNT    (sizeof(g_initStages) / sizeof(g_initStages[0]))
+
+/* Stages finished; a core waits here for the stages of the other cores before its own */
+static volatile uint32 g_initStagesDone = 0;
+
 static void Init_System(void)
 {
     IfxCpu_enableInterrupts();
@@ -50,6 +90,12 @@ static void Init_System(void)
     IfxCpu_waitEvent(&g_cpuSyncEvent, 1);
 }
 
+static void Init_Logging(void)
+{
+    initUART();
+    sendUARTMessage("Zonal Gateway Starting...\r\n", 28);
+}
+
 static void Init_STM_Timer(void)
 {
     IfxStm_CompareConfig stmCompareConfig;
@@ -57,11 +103,25 @@ static void Init_STM_Timer(void)
     stmCompareConfig.triggerPriority = ISR_PRIORITY_OS_TICK;
     stmCompareConfig.comparatorInterrupt = IfxStm_ComparatorInterrupt_ir0;
     stmCompareConfig.ticks = IFX_CFG_STM_TICKS_PER_MS * 10;
-    stmCompareConfig.typeOfService = IfxSrc_Tos_cpu0;
+    stmCompareConfig.typeOfService = IfxCpu_Irq_getTos((IfxCpu_ResourceCpu)CPU_WHICH_SERVICE_ETHERNET);  /* lwIP timers */
+    IfxStm_initCompare(&MODULE_STM0, &stmCompareConfig);
+    
+    IfxStm_initCompareConfig(&stmCompareConfig);
+    stmCompareConfig.comparator = IfxStm_Comparator_1;
+    stmCompareConfig.triggerPriority = ISR_PRIORITY_APP_TICK;
+    stmCompareConfig.comparatorInterrupt = IfxStm_ComparatorInterrupt_ir1;
+    stmCompareConfig.ticks = IFX_CFG_STM_TICKS_PER_MS * 10;
+    stmCompareConfig.typeOfService = IfxCpu_Irq_getTos((IfxCpu_ResourceCpu)CPU_WHICH_SERVICE_APP);  /* app timers */
     IfxStm_initCompare(&MODULE_STM0, &stmCompareConfig);
     sendUARTMessage("STM Timer OK\r\n", 14);
 }
 
+static void Init_Flash(void)
+{
+    Flash4_Init();
+    Test_Flash4();
+}
+
 static void Init_Ethernet(void)
 {
     IfxGeth_enableModule(&MODULE_GETH);
@@ -88,8 +148,9 @@ static void Wait_PHY_Link(void)
     
     while (1)
     {
-        Ifx_Lwip_pollTimerFlags();
+        Timer_Wheel_poll(&g_Timer_net);
         Ifx_Lwip_pollReceiveFlags();
+        Ifx_Lwip_pollTimeouts();
         
         if (netif_is_link_up(&g_Lwip.netif))
         {
@@ -115,13 +176,19 @@ static void Init_DoIP(void)
     doip_config.source_address = DOIP_ZONAL_GW_ADDRESS;
     DoIP_Client_Init(&doip_config);
     sendUARTMessage("[DoIP] Client ready (will connect in 5s)\r\n", 43);
-    
+    DoIP_Server_Init(DOIP_ZONAL_GW_ADDRESS);
+    DoIP_Router_Init();
+}
+
+static void Init_UDS(void)
+{
     UDS_Init();
     sendUARTMessage("[UDS] Handler initialized\r\n", 27);
 }
 
 static void Init_VCI(void)
 {
+    VCI_Init();
     memcpy(g_zgw_vci.ecu_id, ZGW_ECU_ID, sizeof(ZGW_ECU_ID));
     memcpy(g_zgw_vci.sw_version, ZGW_SW_VERSION, sizeof(ZGW_SW_VERSION));
     memcpy(g_zgw_vci.hw_version, ZGW_HW_VERSION, sizeof(ZGW_HW_VERSION));
@@ -173,16 +240,18 @@ static void Print_System_Ready(void)
     sendUARTMessage("===========================================\r\n", 44);
 }
 
-void SystemInit_All(void)
+/* lwIP, echo servers and DoIP client: everything owned by the Ethernet core */
+void SystemInit_Network(void)
 {
-    Init_System();
-    
-    initUART();
-    sendUARTMessage("Zonal Gateway Starting...\r\n", 28);
+    /* The lwIP and DoIP timers; STM0 Compare 0 wakes the core for the next expiry */
+    Timer_Wheel_init(&g_Timer_net, LwipIsr_armCompare);
+#if IPC_SPLIT_CORES
+    SchedIsr_initWake(CPU_WHICH_SERVICE_ETHERNET);
+    SystemMain_InitNet(SchedIsr_wake);
+#else
+    SystemMain_InitNet(NULL_PTR);
+#endif
     
-    Init_STM_Timer();
-    Flash4_Init();
-    Test_Flash4();
     Init_Ethernet();
     
     tcp_echo_server_init();
@@ -190,8 +259,48 @@ void SystemInit_All(void)
     
     Wait_PHY_Link();
     Init_DoIP();
+}
+
+/* UDS, VCI and health data: everything owned by the application core */
+static void Init_Application(void)
+{
+    /* The VCI and UDS timers; STM0 Compare 1 wakes the core for the next expiry */
+    Timer_Wheel_init(&g_Timer_app, SchedIsr_armAppCompare);
+#if IPC_SPLIT_CORES
+    SchedIsr_initWake(CPU_WHICH_SERVICE_APP);
+    SystemMain_InitApp(SchedIsr_wake);
+#else
+    SystemMain_InitApp(NULL_PTR);
+#endif
+    Init_UDS();
     Init_VCI();
     Init_Health_Database();
     Print_System_Ready();
 }
 
+void SystemInit_Core(void)
+{
+    uint32 core = IfxCpu_getCoreIndex();
+    uint32 stage;
+    
+    /* CPU0 starts alone: watchdogs, then it releases the other cores */
+    if (core == 0)
+    {
+        Init_System();
+    }
+    
+    for (stage = 0; stage < INIT_STAGE_COUNT; stage++)
+    {
+        if (g_initStages[stage].core == core)
+        {
+            g_initStages[stage].init();
+            g_initStagesDone = stage + 1;
+        }
+        else
+        {
+            while (g_initStagesDone <= stage)
+            {
+            }
+        }
+    }
+}
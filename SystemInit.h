@@ -8,6 +8,7 @@
 
 #include "Ifx_Types.h"
 
-void SystemInit_All(void);
+void SystemInit_Core(void);        /* Every core: bring up the subsystems the deployment in Configuration.h puts on it */
+void SystemInit_Network(void);     /* lwIP, echo servers, PHY link, DoIP client */
 
 #endif /* SYSTEM_INIT_H_ */
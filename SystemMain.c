@@ -1,21 +1,262 @@
 /**
  * @file SystemMain.c
  * @brief System Main Loop Manager Implementation
+ * @details Each core runs its work as tasks of its scheduler (Sched.h), in
+ *          priority order. A task runs only when posted: by the GETH and STM
+ *          compare interrupts, by a mailbox post from the other core, or by
+ *          another task. With no task ready the core waits for an interrupt.
+ *
+ *          Which core runs which scheduler is set by the deployment in
+ *          Configuration.h; every core enters SystemMain_Run().
  */
 
 #include "SystemMain.h"
+#include "IfxCpu.h"
+#include "Configuration.h"
 #include "Ifx_Lwip.h"
+#include "Ipc_Mailbox.h"
 #include "Libraries/DoIP/doip_client.h"
+#include "Libraries/DoIP/doip_connection.h"
+#include "Libraries/DoIP/uds_transaction.h"
+#include "Libraries/DoIP/uds_download.h"
+#include "Timer_Wheel.h"
 #include "vci_manager.h"
 
-void SystemMain_Loop(void)
+/* Ethernet core tasks, highest priority first */
+enum
 {
-    while (1)
+    NET_TASK_NETIF = 0,         /* GETH RX/TX interrupts: frames to lwIP, sent pbufs freed */
+    NET_TASK_TIMERS,            /* STM0 Compare 0: g_Timer_net (lwIP timeouts, DoIP deadlines) */
+    NET_TASK_MAILBOX,           /* App-to-net mailbox */
+    NET_TASK_OUTPUT,            /* After any of the above: DoIP client events, TCP output, lwIP timeout deadline */
+    NET_TASK_COUNT
+};
+
+/* Application core tasks, highest priority first */
+enum
+{
+    APP_TASK_MAILBOX = 0,       /* Net-to-app mailbox: diagnostic requests, VCI records */
+    APP_TASK_TIMERS,            /* STM0 Compare 1: g_Timer_app (VCI) */
+    APP_TASK_UDS,               /* Deferred UDS jobs and the flash download, while any is in progress */
+    APP_TASK_COUNT
+};
+
+/* Messages left in the app-to-net mailbox until a TX queue drains */
+static boolean g_appToNetBlocked = FALSE;
+
+/* Requests posted by the application core: executed where lwIP runs */
+static void ServeAppToNet(void)
+{
+    const Ipc_Message *msg;
+
+    while ((msg = Ipc_Mailbox_peek(&g_Ipc_appToNet)) != NULL_PTR)
+    {
+        /* TX queue of the connection full: keep the rest in the mailbox until tcp_sent drains it */
+        if (((msg->type == IPC_MSG_DOIP_SEND) || (msg->type == IPC_MSG_DOIP_STREAM)) &&
+            !DoIP_Connection_TxReady(msg->channel))
+        {
+            g_appToNetBlocked = TRUE;
+            return;
+        }
+
+        switch (msg->type)
+        {
+            case IPC_MSG_DOIP_SEND:
+                DoIP_Connection_Send(msg->channel, msg->data, msg->length, NULL_PTR, 0);
+                break;
+
+            case IPC_MSG_DOIP_STREAM:
+                DoIP_Connection_SendPosted(msg->channel, msg->data, msg->length);
+                break;
+
+            case IPC_MSG_VCI_REQUEST:
+                VCI_SendCollectionRequest();
+                break;
+
+            default:
+                break;
+        }
+
+        Ipc_Mailbox_release(&g_Ipc_appToNet);
+    }
+
+    g_appToNetBlocked = FALSE;
+}
+
+/* Traffic forwarded by the Ethernet core: handled by the application */
+static boolean ServeNetToApp(void)
+{
+    const Ipc_Message *msg;
+    boolean            served = FALSE;
+
+    while ((msg = Ipc_Mailbox_peek(&g_Ipc_netToApp)) != NULL_PTR)
+    {
+        switch (msg->type)
+        {
+            case IPC_MSG_DIAG_REQUEST:
+                DoIP_Connection_HandleDiagnostic(msg->channel, msg->data, msg->length);
+                break;
+
+            case IPC_MSG_VCI_RECORD:
+                VCI_AddRecord(msg->data);
+                break;
+
+            default:
+                break;
+        }
+
+        Ipc_Mailbox_release(&g_Ipc_netToApp);
+        served = TRUE;
+    }
+
+    return served;
+}
+
+static boolean NetifTask(void)
+{
+    Ifx_Lwip_pollReceiveFlags();
+
+    /* the ACKs that free a TX queue come in here (or a close drops it) */
+    if (g_appToNetBlocked)
+    {
+        Sched_post(&g_Sched_net, NET_TASK_MAILBOX);
+    }
+
+#if !IPC_SPLIT_CORES
+    /* diagnostic requests are handled inline by the receive path and may leave a job behind */
+    Sched_post(&g_Sched_app, APP_TASK_UDS);
+#endif
+
+    Sched_post(&g_Sched_net, NET_TASK_OUTPUT);
+
+    /* frames left over the RX budget */
+    return (g_Lwip.rxPending != 0) ? TRUE : FALSE;
+}
+
+static boolean NetTimersTask(void)
+{
+    Timer_Wheel_poll(&g_Timer_net);
+
+    /* a connection closed by a timeout drops what waits for it */
+    if (g_appToNetBlocked)
     {
-        Ifx_Lwip_pollTimerFlags();
-        Ifx_Lwip_pollReceiveFlags();
-        DoIP_Client_Poll();
-        VCI_CheckCollectionTimeout();
+        Sched_post(&g_Sched_net, NET_TASK_MAILBOX);
     }
+
+    Sched_post(&g_Sched_net, NET_TASK_OUTPUT);
+    return FALSE;
 }
 
+static boolean NetMailboxTask(void)
+{
+    ServeAppToNet();
+    Sched_post(&g_Sched_net, NET_TASK_OUTPUT);
+    return FALSE;
+}
+
+static boolean NetOutputTask(void)
+{
+    DoIP_Client_Poll();
+
+    /* one flush for everything written by the tasks before, and for what waited for send buffer space */
+    DoIP_Connection_Flush();
+
+    /* the tasks before may have started lwIP timeouts */
+    Ifx_Lwip_pollTimeouts();
+    return FALSE;
+}
+
+static boolean AppMailboxTask(void)
+{
+    if (ServeNetToApp())
+    {
+        Sched_post(&g_Sched_app, APP_TASK_UDS);
+    }
+
+    return FALSE;
+}
+
+static boolean AppTimersTask(void)
+{
+    Timer_Wheel_poll(&g_Timer_app);
+    return FALSE;
+}
+
+static boolean UdsTask(void)
+{
+    uint8 state;
+
+    UDS_Download_Poll();
+    UDS_Transaction_Poll();
+
+    /* the pipelines advance by polling the flash and the jobs: run again while either has work */
+    state = UDS_Download_GetStats()->state;
+
+    return ((state == UDS_DOWNLOAD_TRANSFER) || (state == UDS_DOWNLOAD_UPLOAD) ||
+            (UDS_Transaction_GetStats()->in_use != 0)) ? TRUE : FALSE;
+}
+
+static const Sched_Task g_netTasks[NET_TASK_COUNT] = {
+    {"netif", NetifTask},
+    {"net timers", NetTimersTask},
+    {"app-to-net", NetMailboxTask},
+    {"net output", NetOutputTask},
+};
+
+static const Sched_Task g_appTasks[APP_TASK_COUNT] = {
+    {"net-to-app", AppMailboxTask},
+    {"app timers", AppTimersTask},
+    {"uds", UdsTask},
+};
+
+void SystemMain_InitNet(Sched_WakeHook wake)
+{
+    Sched_init(&g_Sched_net, g_netTasks, NET_TASK_COUNT, CPU_WHICH_SERVICE_ETHERNET, wake);
+
+    Sched_bind(&g_Lwip.event, &g_Sched_net, NET_TASK_NETIF);
+    Sched_bind(&g_Timer_net.expired, &g_Sched_net, NET_TASK_TIMERS);
+    Sched_bind(&g_Ipc_appToNet.queue.posted, &g_Sched_net, NET_TASK_MAILBOX);
+}
+
+void SystemMain_InitApp(Sched_WakeHook wake)
+{
+    Sched_init(&g_Sched_app, g_appTasks, APP_TASK_COUNT, CPU_WHICH_SERVICE_APP, wake);
+
+    Sched_bind(&g_Timer_app.expired, &g_Sched_app, APP_TASK_TIMERS);
+    Sched_bind(&g_Ipc_netToApp.queue.posted, &g_Sched_app, APP_TASK_MAILBOX);
+
+    /* work started during initialisation */
+    Sched_post(&g_Sched_app, APP_TASK_TIMERS);
+    Sched_post(&g_Sched_app, APP_TASK_MAILBOX);
+}
+
+void SystemMain_NetStep(void)
+{
+    Sched_runReady(&g_Sched_net);
+}
+
+void SystemMain_AppStep(void)
+{
+    Sched_runReady(&g_Sched_app);
+}
+
+void SystemMain_Run(void)
+{
+    uint32 core  = IfxCpu_getCoreIndex();
+    Sched *sched[2];
+    uint8  count = 0;
+
+    /* network first: on a shared core the wire is served before the application */
+    if (core == CPU_WHICH_SERVICE_ETHERNET)
+    {
+        sched[count++] = &g_Sched_net;
+    }
+
+    if (core == CPU_WHICH_SERVICE_APP)
+    {
+        sched[count++] = &g_Sched_app;
+    }
+
+    /* a core without a scheduler only sleeps, its interrupts (Flash4, UART log) still run */
+    Sched_run(sched, count);
+}
@@ -7,8 +7,12 @@
 #define SYSTEM_MAIN_H_
 
 #include "Ifx_Types.h"
+#include "Sched.h"
 
-void SystemMain_Loop(void);
+void SystemMain_InitNet(Sched_WakeHook wake);   /* g_Sched_net tasks and events, after Timer_Wheel_init(&g_Timer_net) */
+void SystemMain_InitApp(Sched_WakeHook wake);   /* g_Sched_app tasks and events, after Timer_Wheel_init(&g_Timer_app) */
+void SystemMain_NetStep(void);  /* Ethernet core tasks ready now, once: netif, net timers, app-to-net mailbox, output */
+void SystemMain_AppStep(void);  /* Application core tasks ready now, once: net-to-app mailbox, app timers, UDS jobs */
+void SystemMain_Run(void);      /* Every core, after SystemInit_Core(): the schedulers deployed on it, forever */
 
 #endif /* SYSTEM_MAIN_H_ */
-
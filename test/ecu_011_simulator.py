@@ -1,7 +1,8 @@
 #!/usr/bin/env python3
 """
 ECU_011 Simulator
-Simulates Zone ECU that listens for VCI broadcast requests and responds
+Simulates Zone ECU that listens for VCI broadcast requests and responds,
+and answers the diagnostic requests the ZGW routes to it (DoIP over UDP)
 """
 
 import socket
@@ -17,6 +18,12 @@ class ECU_011_Simulator:
     VCI_MAGIC = 0x56434921  # "VCI!"
     VCI_REQUEST_MAGIC = b'RQST'  # VCI collection request from ZGW
     
+    # DoIP diagnostic messages (matches doip_types.h / AppConfig.h)
+    DOIP_DIAGNOSTIC_MESSAGE = 0x8001
+    LOGICAL_ADDRESS = 0x0011     # DOIP_ZONE_ECU_ADDRESS
+    FUNCTIONAL_ADDRESS = 0xE400  # DOIP_FUNCTIONAL_ADDRESS
+    DIAG_PORT = 13401            # ZONE_ECU_DOIP_PORT
+    
     def __init__(self, listen_port=13400):
         self.listen_port = listen_port
         
@@ -31,6 +38,10 @@ class ECU_011_Simulator:
         self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
         self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
         
+        # Diagnostic requests routed by the ZGW
+        self.diag_sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.diag_sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        
         self.running = False
         
     def create_vci_message(self):
@@ -105,6 +116,64 @@ class ECU_011_Simulator:
         finally:
             self.sock.close()
     
+    def handle_uds(self, request):
+        """UDS response to a routed request"""
+        sid = request[0]
+        
+        if sid == 0x22 and len(request) >= 3:
+            # ReadDataByIdentifier: every DID reads as the ECU ID
+            return bytes([0x62]) + request[1:3] + self.ecu_id.encode('ascii')
+        if sid == 0x3E and len(request) >= 2:
+            # TesterPresent
+            return bytes([0x7E, request[1] & 0x7F])
+        
+        # serviceNotSupported
+        return bytes([0x7F, sid, 0x11])
+    
+    def serve_diagnostics(self):
+        """Answer DoIP diagnostic messages routed by the ZGW"""
+        try:
+            self.diag_sock.bind(('', self.DIAG_PORT))
+            print(f"[ECU_011] Diagnostics on UDP port {self.DIAG_PORT}, logical address 0x{self.LOGICAL_ADDRESS:04X}")
+        except Exception as e:
+            print(f"[ECU_011] Failed to bind diagnostic socket: {e}")
+            return
+        
+        self.diag_sock.settimeout(1.0)
+        while self.running:
+            try:
+                data, addr = self.diag_sock.recvfrom(4096)
+            except socket.timeout:
+                continue
+            except Exception as e:
+                if self.running:
+                    print(f"[ECU_011] Error receiving diagnostic request: {e}")
+                continue
+            
+            # DoIP header (8) + SA (2) + TA (2) + at least the SID
+            if len(data) < 13:
+                continue
+            _, _, payload_type, payload_length = struct.unpack('!BBHI', data[:8])
+            if payload_type != self.DOIP_DIAGNOSTIC_MESSAGE or payload_length != len(data) - 8:
+                continue
+            source, target = struct.unpack('!HH', data[8:12])
+            if target not in (self.LOGICAL_ADDRESS, self.FUNCTIONAL_ADDRESS):
+                continue
+            
+            uds = self.handle_uds(data[12:])
+            
+            # Suppressed positive response (e.g. functional TesterPresent 3E 80)
+            if data[12] == 0x3E and uds[0] == 0x7E and len(data) > 13 and data[13] & 0x80:
+                continue
+            payload = struct.pack('!HH', self.LOGICAL_ADDRESS, source) + uds
+            response = struct.pack('!BBHI', 0x02, 0xFD, self.DOIP_DIAGNOSTIC_MESSAGE, len(payload)) + payload
+            
+            # Back to the ZGW's routing port, whichever it is
+            self.diag_sock.sendto(response, addr)
+            print(f"[ECU_011] Diagnostic 0x{data[12]:02X} from tester 0x{source:04X} answered")
+        
+        self.diag_sock.close()
+    
     def run(self):
         """Run simulator - listen for requests"""
         print("=" * 60)
@@ -113,6 +182,9 @@ class ECU_011_Simulator:
         print("Press Ctrl+C to stop")
         print("=" * 60)
         
+        self.running = True
+        threading.Thread(target=self.serve_diagnostics, daemon=True).start()
+        
         try:
             self.listen_for_requests()
         except KeyboardInterrupt:
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""
+Zonal Gateway Trace Decoder
+Renders the UART log stream: text lines pass through, binary trace frames
+(Libraries/UART/UART_Trace.h) are formatted with the strings of the
+UART_TRACE_EVENTS table.
+
+Usage:
+    trace_decoder.py capture.bin            # decode a saved capture
+    trace_decoder.py /dev/ttyACM0           # decode a serial port (pyserial)
+    cat capture.bin | trace_decoder.py -
+"""
+
+import os
+import re
+import struct
+import sys
+
+# Trace Configuration (UART_Trace.h)
+TRACE_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            '..', 'Libraries', 'UART', 'UART_Trace.h')
+TRACE_SYNC = 0xA5
+TRACE_HEADER_SIZE = 8
+STM_TICKS_PER_US = 100      # STM0 runs at 100 MHz
+
+SERIAL_BAUDRATE = 115200
+
+FORMAT_TOKEN = re.compile(r'%[-0-9]*[dxXuHs]')
+
+
+def load_events(path=TRACE_HEADER):
+    """Read the X(id, format) table; IDs are assigned in table order"""
+    events = []
+    with open(path) as header:
+        for line in header:
+            match = re.search(r'X\((TRACE_\w+),\s*"(.*)"\)', line)
+            if match:
+                events.append((match.group(1), match.group(2)))
+    return events
+
+
+def render(fmt, args, data):
+    """Substitute the integer arguments and the raw data into a format string"""
+    args = list(args)
+
+    def substitute(match):
+        token = match.group(0)
+        if token == '%H':
+            return ' '.join('%02X' % b for b in data)
+        if token == '%s':
+            return data.split(b'\0', 1)[0].decode('ascii', 'replace')
+        value = args.pop(0) if args else 0
+        if token.endswith('d'):
+            value = struct.unpack('<i', struct.pack('<I', value))[0]
+            token = token[:-1] + 'd'
+        elif token.endswith('u'):
+            token = token[:-1] + 'd'
+        return token % value
+
+    return FORMAT_TOKEN.sub(substitute, fmt)
+
+
+class TraceDecoder:
+    def __init__(self, events, out=sys.stdout):
+        self.events = events
+        self.out = out
+        self.pending = b''
+        self.last_ticks = None
+
+    def feed(self, chunk):
+        """Decode as much of the buffered stream as possible"""
+        self.pending += chunk
+        buf = self.pending
+        pos = 0
+
+        while pos < len(buf):
+            sync = buf.find(bytes([TRACE_SYNC]), pos)
+            if sync < 0:
+                self.out.write(buf[pos:].decode('ascii', 'replace'))
+                pos = len(buf)
+                break
+
+            # text in front of the frame
+            if sync > pos:
+                self.out.write(buf[pos:sync].decode('ascii', 'replace'))
+                pos = sync
+
+            if len(buf) - pos < TRACE_HEADER_SIZE:
+                break
+            _, event, argc, datalen, ticks = struct.unpack_from('<BBBBI', buf, pos)
+            size = TRACE_HEADER_SIZE + 4 * argc + datalen
+            if len(buf) - pos < size:
+                break
+
+            args = struct.unpack_from('<%dI' % argc, buf, pos + TRACE_HEADER_SIZE)
+            data = buf[pos + TRACE_HEADER_SIZE + 4 * argc:pos + size]
+            pos += size
+            self.emit(event, ticks, args, data)
+
+        self.pending = buf[pos:]
+
+    def emit(self, event, ticks, args, data):
+        if event < len(self.events):
+            text = render(self.events[event][1], args, data)
+        else:
+            text = '[TRACE] unknown id %d args=%s data=%s' % (event, list(args), data.hex())
+
+        # 32-bit STM0 ticks wrap every 42.9 s: show the delta to the previous frame
+        delta = 0 if self.last_ticks is None else (ticks - self.last_ticks) & 0xFFFFFFFF
+        self.last_ticks = ticks
+        self.out.write('%10.1f us +%9.1f  %s\r\n' % (ticks / STM_TICKS_PER_US,
+                                                   delta / STM_TICKS_PER_US, text))
+
+
+def open_input(name):
+    if name == '-':
+        return sys.stdin.buffer
+    if name.startswith('/dev/') or name.upper().startswith('COM'):
+        import serial
+        return serial.Serial(name, SERIAL_BAUDRATE, timeout=0.1)
+    return open(name, 'rb')
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__.strip())
+        sys.exit(2)
+
+    decoder = TraceDecoder(load_events())
+    source = open_input(sys.argv[1])
+
+    try:
+        while True:
+            chunk = source.read(4096)
+            if not chunk:
+                if hasattr(source, 'in_waiting'):
+                    continue    # serial port: keep waiting
+                break
+            decoder.feed(chunk)
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -8,6 +8,7 @@ import socket
 import struct
 import time
 import threading
+import queue
 
 # DoIP Configuration
 DOIP_PROTOCOL_VERSION = 0x02
@@ -22,6 +23,14 @@ DOIP_PAYLOAD_TYPE_VCI_REPORT = 0x9000  # VCI Report from ZGW
 
 # UDS Configuration
 UDS_SID_ROUTINE_CONTROL = 0x31
+UDS_SID_READ_DATA_BY_ID = 0x22
+UDS_SID_WRITE_DATA_BY_ID = 0x2E
+UDS_SID_REQUEST_DOWNLOAD = 0x34
+UDS_SID_REQUEST_UPLOAD = 0x35
+UDS_SID_TRANSFER_DATA = 0x36
+UDS_SID_REQUEST_TRANSFER_EXIT = 0x37
+UDS_NEGATIVE_RESPONSE = 0x7F
+UDS_NRC_RESPONSE_PENDING = 0x78
 UDS_RC_START_ROUTINE = 0x01
 UDS_POSITIVE_RESPONSE = 0x40
 
@@ -29,6 +38,18 @@ UDS_POSITIVE_RESPONSE = 0x40
 RID_VCI_COLLECTION_START = 0xF001
 RID_VCI_SEND_REPORT = 0xF002
 
+# Log level masks (UART_Log.h): one byte per module [DoIP, UDS, VCI, Flash, netif]
+DID_LOG_MASK = 0xF1C0
+LOG_MASK_INFO = 0x07
+LOG_MASK_DEBUG = 0x0F
+
+# UDS transaction pool occupancy: [in use][high water][pool size][exhausted (2)]
+DID_TRANSACTION_POOL = 0xF1C1
+
+# Flash download progress: [state][received (4)][programmed (4)][KB/s (2)][erase suspends (2)][blocks deferred (2)]
+DID_DOWNLOAD_STATUS = 0xF1C2
+DOWNLOAD_ADDRESS = 0x00040000   # First sector of the gateway's download region
+
 # DoIP Addresses
 ADDR_VMG = 0x0E00
 ADDR_ZGW = 0x0100
@@ -40,6 +61,8 @@ class VMGServer:
         self.server_sock = None
         self.client_sock = None
         self.running = False
+        self.downloading = False
+        self.download_responses = queue.Queue()
         
     def start(self):
         """Start VMG server"""
@@ -155,8 +178,10 @@ class VMGServer:
         ta = (payload[2] << 8) | payload[3]
         uds_data = payload[4:]
         
-        print(f"  Route: SA=0x{sa:04X}, TA=0x{ta:04X}")
-        print(f"  UDS Data ({len(uds_data)} bytes): {' '.join(f'{b:02X}' for b in uds_data)}")
+        # Upload blocks are too large to dump
+        if not self.downloading:
+            print(f"  Route: SA=0x{sa:04X}, TA=0x{ta:04X}")
+            print(f"  UDS Data ({len(uds_data)} bytes): {' '.join(f'{b:02X}' for b in uds_data)}")
         
         # Parse UDS
         if len(uds_data) < 1:
@@ -164,6 +189,16 @@ class VMGServer:
             
         sid = uds_data[0]
         
+        # Transfer responses go to download_image()/upload_image(), 0x78 only restarts the wait
+        if self.downloading and sid in (UDS_SID_REQUEST_DOWNLOAD + UDS_POSITIVE_RESPONSE,
+                                        UDS_SID_REQUEST_UPLOAD + UDS_POSITIVE_RESPONSE,
+                                        UDS_SID_TRANSFER_DATA + UDS_POSITIVE_RESPONSE,
+                                        UDS_SID_REQUEST_TRANSFER_EXIT + UDS_POSITIVE_RESPONSE,
+                                        UDS_NEGATIVE_RESPONSE):
+            if not (sid == UDS_NEGATIVE_RESPONSE and len(uds_data) >= 3 and uds_data[2] == UDS_NRC_RESPONSE_PENDING):
+                self.download_responses.put(uds_data)
+            return
+            
         # Decode UDS Service
         print(f"  Service ID: 0x{sid:02X}", end="")
         
@@ -246,6 +281,14 @@ class VMGServer:
                 elif did == 0xF194:  # Individual VCI
                     print("    → Individual VCI Data")
                     self.parse_vci_data(uds_data[3:])
+                elif did == DID_TRANSACTION_POOL and len(uds_data) >= 8:
+                    exhausted = (uds_data[6] << 8) | uds_data[7]
+                    print(f"    → UDS transactions: {uds_data[3]} in use, high-water {uds_data[4]} "
+                          f"of {uds_data[5]}, exhausted {exhausted}")
+                elif did == DID_DOWNLOAD_STATUS and len(uds_data) >= 18:
+                    state, received, programmed, kbps, suspends, deferred = struct.unpack('>BIIHHH', uds_data[3:18])
+                    print(f"    → Download: state {state}, received {received}, programmed {programmed}, "
+                          f"{kbps} KB/s, {suspends} erase suspends, {deferred} blocks deferred")
                     
         else:
             print(f" (Unknown/Other Service)")
@@ -317,7 +360,7 @@ class VMGServer:
         print("✓ VCI Report processing complete")
         print("="*60)
             
-    def send_diagnostic_response(self, sa, ta, uds_data):
+    def send_diagnostic_response(self, sa, ta, uds_data, quiet=False):
         """Send UDS diagnostic response"""
         # DoIP routing + UDS data
         payload = struct.pack('>HH', sa, ta) + uds_data
@@ -330,8 +373,93 @@ class VMGServer:
         
         message = header + payload
         self.client_sock.sendall(message)
-        print(f"[TX] Diagnostic Response: {' '.join(f'{b:02X}' for b in uds_data)}")
+        if not quiet:
+            print(f"[TX] Diagnostic Response: {' '.join(f'{b:02X}' for b in uds_data)}")
         
+    def download_image(self, size_kb):
+        """Download a test pattern into the gateway's Flash4 (0x34/0x36/0x37)"""
+        if not self.client_sock:
+            print("[VMG] No active connection")
+            return
+            
+        def request(uds_data):
+            self.send_diagnostic_response(ADDR_VMG, ADDR_ZGW, uds_data, quiet=True)
+            try:
+                return self.download_responses.get(timeout=10.0)
+            except queue.Empty:
+                return b''
+                
+        size = size_kb * 1024
+        image = bytes(((i * 31) ^ (i >> 9)) & 0xFF for i in range(size))
+        self.downloading = True
+        start = time.time()
+        try:
+            res = request(struct.pack('>BBBII', UDS_SID_REQUEST_DOWNLOAD, 0x00, 0x44, DOWNLOAD_ADDRESS, size))
+            if len(res) < 4 or res[0] != UDS_SID_REQUEST_DOWNLOAD + UDS_POSITIVE_RESPONSE:
+                print(f"[VMG] RequestDownload rejected: {res.hex()}")
+                return
+            # maxNumberOfBlockLength counts the SID and the block sequence counter
+            chunk = ((res[2] << 8) | res[3]) - 2
+            bsc = 1
+            for offset in range(0, size, chunk):
+                res = request(bytes([UDS_SID_TRANSFER_DATA, bsc]) + image[offset:offset + chunk])
+                if len(res) < 2 or res[0] != UDS_SID_TRANSFER_DATA + UDS_POSITIVE_RESPONSE or res[1] != bsc:
+                    print(f"[VMG] TransferData at {offset} failed: {res.hex()}")
+                    return
+                bsc = (bsc + 1) & 0xFF
+            res = request(bytes([UDS_SID_REQUEST_TRANSFER_EXIT]))
+            if len(res) < 7 or res[0] != UDS_SID_REQUEST_TRANSFER_EXIT + UDS_POSITIVE_RESPONSE:
+                print(f"[VMG] RequestTransferExit failed: {res.hex()}")
+                return
+            kbps, ms = struct.unpack('>HI', res[1:7])
+            print(f"[VMG] ✓ Downloaded {size_kb} KB in {time.time() - start:.2f} s "
+                  f"(gateway: {kbps} KB/s over {ms} ms)")
+        finally:
+            self.downloading = False
+            
+    def upload_image(self, size_kb):
+        """Upload the test pattern back from the gateway's Flash4 (0x35/0x36/0x37)"""
+        if not self.client_sock:
+            print("[VMG] No active connection")
+            return
+            
+        def request(uds_data):
+            self.send_diagnostic_response(ADDR_VMG, ADDR_ZGW, uds_data, quiet=True)
+            try:
+                return self.download_responses.get(timeout=10.0)
+            except queue.Empty:
+                return b''
+                
+        size = size_kb * 1024
+        image = bytes(((i * 31) ^ (i >> 9)) & 0xFF for i in range(size))
+        data = bytearray()
+        self.downloading = True
+        start = time.time()
+        try:
+            res = request(struct.pack('>BBBII', UDS_SID_REQUEST_UPLOAD, 0x00, 0x44, DOWNLOAD_ADDRESS, size))
+            if len(res) < 4 or res[0] != UDS_SID_REQUEST_UPLOAD + UDS_POSITIVE_RESPONSE:
+                print(f"[VMG] RequestUpload rejected: {res.hex()}")
+                return
+            print(f"[VMG] Upload block length {((res[2] << 8) | res[3]) - 2} bytes")
+            bsc = 1
+            while len(data) < size:
+                res = request(bytes([UDS_SID_TRANSFER_DATA, bsc]))
+                if len(res) < 3 or res[0] != UDS_SID_TRANSFER_DATA + UDS_POSITIVE_RESPONSE or res[1] != bsc:
+                    print(f"[VMG] TransferData at {len(data)} failed: {res[:8].hex()}")
+                    return
+                data += res[2:]
+                bsc = (bsc + 1) & 0xFF
+            res = request(bytes([UDS_SID_REQUEST_TRANSFER_EXIT]))
+            if len(res) < 7 or res[0] != UDS_SID_REQUEST_TRANSFER_EXIT + UDS_POSITIVE_RESPONSE:
+                print(f"[VMG] RequestTransferExit failed: {res.hex()}")
+                return
+            kbps, ms = struct.unpack('>HI', res[1:7])
+            match = "matches" if bytes(data) == image else "does NOT match"
+            print(f"[VMG] ✓ Uploaded {size_kb} KB in {time.time() - start:.2f} s "
+                  f"(gateway: {kbps} KB/s over {ms} ms), {match} the test image")
+        finally:
+            self.downloading = False
+            
     def send_vci_collection_command(self):
         """Send VCI collection start command (for manual trigger)"""
         if not self.client_sock:
@@ -372,6 +500,12 @@ def main():
     print("Commands:")
     print("  1 - Send VCI Collection Start")
     print("  2 - Send VCI Report Request")
+    print("  3 - Enable debug tracing (DID 0xF1C0)")
+    print("  4 - Disable debug tracing (DID 0xF1C0)")
+    print("  5 - Read UDS transaction pool (DID 0xF1C1)")
+    print("  6 - Download 256 KB test image to Flash4 (0x34/0x36/0x37)")
+    print("  7 - Read download status (DID 0xF1C2)")
+    print("  8 - Upload 256 KB from Flash4 and compare with the test image (0x35/0x36/0x37)")
     print("  q - Quit")
     print("="*60)
     
@@ -413,6 +547,56 @@ def main():
                 else:
                     print("[VMG] No active connection")
                     
+            elif cmd in ('3', '4'):
+                if server.client_sock:
+                    # Write the log level mask of all five modules
+                    mask = LOG_MASK_DEBUG if cmd == '3' else LOG_MASK_INFO
+                    uds_data = bytes([UDS_SID_WRITE_DATA_BY_ID,
+                                    (DID_LOG_MASK >> 8) & 0xFF,
+                                    DID_LOG_MASK & 0xFF]) + bytes([mask] * 5)
+                    payload = struct.pack('>HH', ADDR_VMG, ADDR_ZGW) + uds_data
+                    header = struct.pack('>BBHL', DOIP_PROTOCOL_VERSION,
+                                       DOIP_INVERSE_VERSION,
+                                       DOIP_PAYLOAD_TYPE_DIAG_MSG,
+                                       len(payload))
+                    server.client_sock.sendall(header + payload)
+                    print("[TX] Log mask 0x%02X written" % mask)
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd == '5':
+                if server.client_sock:
+                    # Read the transaction pool occupancy counters
+                    uds_data = bytes([UDS_SID_READ_DATA_BY_ID,
+                                    (DID_TRANSACTION_POOL >> 8) & 0xFF,
+                                    DID_TRANSACTION_POOL & 0xFF])
+                    payload = struct.pack('>HH', ADDR_VMG, ADDR_ZGW) + uds_data
+                    header = struct.pack('>BBHL', DOIP_PROTOCOL_VERSION,
+                                       DOIP_INVERSE_VERSION,
+                                       DOIP_PAYLOAD_TYPE_DIAG_MSG,
+                                       len(payload))
+                    server.client_sock.sendall(header + payload)
+                    print("[TX] Transaction pool read request sent")
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd == '6':
+                server.download_image(256)
+                
+            elif cmd == '7':
+                if server.client_sock:
+                    # Read the download progress and throughput counters
+                    uds_data = bytes([UDS_SID_READ_DATA_BY_ID,
+                                    (DID_DOWNLOAD_STATUS >> 8) & 0xFF,
+                                    DID_DOWNLOAD_STATUS & 0xFF])
+                    server.send_diagnostic_response(ADDR_VMG, ADDR_ZGW, uds_data, quiet=True)
+                    print("[TX] Download status read request sent")
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd == '8':
+                server.upload_image(256)
+                
     except KeyboardInterrupt:
         print("\n[VMG] Interrupted")
     finally: